@@ -58,6 +58,7 @@
 #include "util.h"
 #include "ticks.h"
 #include "commonutil.h"
+#include "lz4.h"
 #include "crc16.h"
 
 
@@ -446,6 +447,18 @@ static void SendCapabilities(void) {
     capabilities.via_usb = g_reply_via_usb;
     capabilities.bigbuf_size = BigBuf_get_size();
     capabilities.baudrate = 0; // no real baudrate for USB-CDC
+    // windowed commands wait in the USB endpoint or the USART fifo until we get to them
+    capabilities.cmd_window = PM3_CMD_WINDOW;
+    capabilities.download_compression = DOWNLOAD_COMPRESS_LZ4;
+    capabilities.device_cmds = 0;
+#ifdef WITH_ISO14443a
+    capabilities.device_cmds |= DEVICE_CMD_DESFIRE_CHKKEYS;
+    capabilities.device_cmds |= DEVICE_CMD_14A_SNIFF_STREAM;
+    capabilities.device_cmds |= DEVICE_CMD_MIFARE_DUMP;
+#endif
+#ifdef WITH_ISO15693
+    capabilities.device_cmds |= DEVICE_CMD_ISO15_READ_BLOCKS;
+#endif
 #ifdef WITH_FPC_USART
     if (g_reply_via_fpc)
         capabilities.baudrate = g_usart_baudrate;
@@ -1239,6 +1252,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             DirectTag15693Command(packet->oldarg[0], packet->oldarg[1], packet->oldarg[2], packet->data.asBytes);
             break;
         }
+        case CMD_HF_ISO15693_READ_BLOCKS: {
+            ReadBlocksIso15693((iso15_read_blocks_t *)packet->data.asBytes);
+            break;
+        }
         case CMD_HF_ISO15693_FINDAFI: {
             BruteforceIso15693Afi(packet->oldarg[0]);
             break;
@@ -1384,6 +1401,11 @@ static void PacketReceived(PacketCommandNG *packet) {
             break;
         }
         case CMD_HF_ISO14443A_SNIFF: {
+            // a streamed sniff sends from the sampling loop, only USB is fast enough for that
+            if ((packet->data.asBytes[0] & 0x04) && g_reply_via_fpc) {
+                reply_ng(CMD_HF_ISO14443A_SNIFF, PM3_EINVARG, NULL, 0);
+                break;
+            }
             SniffIso14443a(packet->data.asBytes[0]);
             reply_ng(CMD_HF_ISO14443A_SNIFF, PM3_SUCCESS, NULL, 0);
             break;
@@ -1454,6 +1476,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareReadSector(packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
             break;
         }
+        case CMD_HF_MIFARE_DUMP: {
+            MifareDump(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_WRITEBL: {
             MifareWriteBlock(packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
             break;
@@ -1635,6 +1661,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareSendCommand(packet->data.asBytes);
             break;
         }
+        case CMD_HF_DESFIRE_CHKKEYS: {
+            MifareDesfireCheckKeys(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_NACK_DETECT: {
             DetectNACKbug();
             break;
@@ -2004,11 +2034,29 @@ static void PacketReceived(PacketCommandNG *packet) {
             // arg2 = BigBuf tracelen
             //Dbprintf("transfer to client parameters: %" PRIu32 " | %" PRIu32 " | %" PRIu32, startidx, numofbytes, packet->oldarg[2]);
 
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
-                int result = reply_old(CMD_DOWNLOADED_BIGBUF, i, len, BigBuf_get_traceLen(), mem + startidx + i, len);
-                if (result != PM3_SUCCESS)
-                    Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+            if (packet->oldarg[2] & DOWNLOAD_COMPRESS_LZ4) {
+                // request arg2 = compression the client accepts.
+                // Each chunk is as much input as fits in one LZ4 block of a MIX frame.
+                uint8_t block[PM3_CMD_DATA_SIZE_MIX];
+                for (size_t i = 0; i < numofbytes;) {
+                    int srclen = numofbytes - i;
+                    int complen = LZ4_compress_destSize((const char *)mem + startidx + i, (char *)block, &srclen, sizeof(block));
+                    if (complen <= 0 || srclen <= 0) {
+                        Dbprintf("transfer to client failed ::  | compression at %d", i);
+                        break;
+                    }
+                    int result = reply_mix(CMD_DOWNLOADED_BIGBUF_LZ4, i, srclen, BigBuf_get_traceLen(), block, complen);
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + srclen, srclen, result);
+                    i += srclen;
+                }
+            } else {
+                for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+                    size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                    int result = reply_old(CMD_DOWNLOADED_BIGBUF, i, len, BigBuf_get_traceLen(), mem + startidx + i, len);
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+                }
             }
             // Trigger a finish downloading signal with an ACK frame
             // iceman,  when did sending samplingconfig array got attached here?!?
@@ -25,6 +25,7 @@ bool g_reply_with_crc_on_fpc = true;
 // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
 bool g_reply_via_fpc = false;
 bool g_reply_via_usb = false;
+uint16_t g_reply_seq = 0;
 
 int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len) {
     PacketResponseOLD txcmd = {CMD_UNKNOWN, {0, 0, 0}, {{0}}};
@@ -72,40 +73,49 @@ int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *d
 }
 
 static int reply_ng_internal(uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
-    PacketResponseNGRaw txBufferNG;
+    PacketResponseNGSeqRaw txBufferNG;
     size_t txBufferNGLen;
 
     // Compose the outgoing command frame
-    txBufferNG.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
-    txBufferNG.pre.cmd = cmd;
-    txBufferNG.pre.status = status;
-    txBufferNG.pre.ng = ng;
+    txBufferNG.pre.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    txBufferNG.pre.pre.cmd = cmd;
+    txBufferNG.pre.pre.status = status;
+    txBufferNG.pre.pre.ng = ng;
     if (len > PM3_CMD_DATA_SIZE) {
         len = PM3_CMD_DATA_SIZE;
         // overwrite status
-        txBufferNG.pre.status = PM3_EOVFLOW;
+        txBufferNG.pre.pre.status = PM3_EOVFLOW;
     }
 
     // length is only 15bit (32768)
-    txBufferNG.pre.length = (len & 0x7FFF);
+    txBufferNG.pre.pre.length = (len & 0x7FFF);
+
+    // replies to a windowed command carry its sequence number after the preamble
+    size_t prelen = sizeof(PacketResponseNGPreamble);
+    if (g_reply_seq) {
+        txBufferNG.pre.pre.magic = RESPONSENG_SEQ_PREAMBLE_MAGIC;
+        txBufferNG.pre.seq = g_reply_seq;
+        prelen = sizeof(PacketResponseNGSeqPreamble);
+    }
+    uint8_t *tx_data = (uint8_t *)&txBufferNG + prelen;
 
     // Add the (optional) content to the frame, with a maximum size of PM3_CMD_DATA_SIZE
     if (data && len) {
         for (size_t i = 0; i < len; i++) {
-            txBufferNG.data[i] = data[i];
+            tx_data[i] = data[i];
         }
     }
 
-    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketResponseNGPreamble) + len);
+    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)(tx_data + len);
     // Note: if we send to both FPC & USB, we'll set CRC for both if any of them require CRC
     if ((g_reply_via_fpc && g_reply_with_crc_on_fpc) || ((g_reply_via_usb) && g_reply_with_crc_on_usb)) {
         uint8_t first, second;
-        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketResponseNGPreamble) + len, &first, &second);
+        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, prelen + len, &first, &second);
         tx_post->crc = ((first << 8) | second);
     } else {
         tx_post->crc = RESPONSENG_POSTAMBLE_MAGIC;
     }
-    txBufferNGLen = sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble);
+    txBufferNGLen = prelen + len + sizeof(PacketResponseNGPostamble);
 
 #ifdef WITH_FPC_USART_HOST
     int resultfpc = PM3_EUNDEF;
@@ -151,8 +161,8 @@ int reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *d
 }
 
 static int receive_ng_internal(PacketCommandNG *rx, uint32_t read_ng(uint8_t *data, size_t len), bool usb, bool fpc) {
-    PacketCommandNGRaw rx_raw;
-    size_t bytes = read_ng((uint8_t *)&rx_raw.pre, sizeof(PacketCommandNGPreamble));
+    PacketCommandNGSeqRaw rx_raw;
+    size_t bytes = read_ng((uint8_t *)&rx_raw.pre.pre, sizeof(PacketCommandNGPreamble));
 
     if (bytes == 0)
         return PM3_ENODATA;
@@ -160,33 +170,46 @@ static int receive_ng_internal(PacketCommandNG *rx, uint32_t read_ng(uint8_t *da
     if (bytes != sizeof(PacketCommandNGPreamble))
         return PM3_EIO;
 
-    rx->magic = rx_raw.pre.magic;
-    rx->ng = rx_raw.pre.ng;
-    uint16_t length = rx_raw.pre.length;
-    rx->cmd = rx_raw.pre.cmd;
+    rx->magic = rx_raw.pre.pre.magic;
+    rx->ng = rx_raw.pre.pre.ng;
+    uint16_t length = rx_raw.pre.pre.length;
+    rx->cmd = rx_raw.pre.pre.cmd;
+    rx->seq = 0;
 
-    if (rx->magic == COMMANDNG_PREAMBLE_MAGIC) { // New style NG command
+    if (rx->magic == COMMANDNG_PREAMBLE_MAGIC || rx->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) { // New style NG command
         if (length > PM3_CMD_DATA_SIZE)
             return PM3_EOVFLOW;
 
+        // Windowed command, get the sequence number
+        size_t prelen = sizeof(PacketCommandNGPreamble);
+        if (rx->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) {
+            bytes = read_ng((uint8_t *)&rx_raw.pre.seq, sizeof(rx_raw.pre.seq));
+            if (bytes != sizeof(rx_raw.pre.seq))
+                return PM3_EIO;
+
+            rx->seq = rx_raw.pre.seq;
+            prelen = sizeof(PacketCommandNGSeqPreamble);
+        }
+        uint8_t *rx_data = (uint8_t *)&rx_raw + prelen;
+
         // Get the core and variable length payload
-        bytes = read_ng((uint8_t *)&rx_raw.data, length);
+        bytes = read_ng(rx_data, length);
         if (bytes != length)
             return PM3_EIO;
 
         if (rx->ng) {
-            memcpy(rx->data.asBytes, rx_raw.data, length);
+            memcpy(rx->data.asBytes, rx_data, length);
             rx->length = length;
         } else {
             uint64_t arg[3];
             if (length < sizeof(arg))
                 return PM3_EIO;
 
-            memcpy(arg, rx_raw.data, sizeof(arg));
+            memcpy(arg, rx_data, sizeof(arg));
             rx->oldarg[0] = arg[0];
             rx->oldarg[1] = arg[1];
             rx->oldarg[2] = arg[2];
-            memcpy(rx->data.asBytes, rx_raw.data + sizeof(arg), length - sizeof(arg));
+            memcpy(rx->data.asBytes, rx_data + sizeof(arg), length - sizeof(arg));
             rx->length = length - sizeof(arg);
         }
         // Get the postamble
@@ -198,21 +221,23 @@ static int receive_ng_internal(PacketCommandNG *rx, uint32_t read_ng(uint8_t *da
         rx->crc = rx_raw.foopost.crc;
         if (rx->crc != COMMANDNG_POSTAMBLE_MAGIC) {
             uint8_t first, second;
-            compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, sizeof(PacketCommandNGPreamble) + length, &first, &second);
+            compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, prelen + length, &first, &second);
             if ((first << 8) + second != rx->crc)
                 return PM3_EIO;
         }
         g_reply_via_usb = usb;
         g_reply_via_fpc = fpc;
+        g_reply_seq = rx->seq;
     } else {                               // Old style command
         PacketCommandOLD rx_old;
-        memcpy(&rx_old, &rx_raw.pre, sizeof(PacketCommandNGPreamble));
+        memcpy(&rx_old, &rx_raw.pre.pre, sizeof(PacketCommandNGPreamble));
         bytes = read_ng(((uint8_t *)&rx_old) + sizeof(PacketCommandNGPreamble), sizeof(PacketCommandOLD) - sizeof(PacketCommandNGPreamble));
         if (bytes != sizeof(PacketCommandOLD) - sizeof(PacketCommandNGPreamble))
             return PM3_EIO;
 
         g_reply_via_usb = usb;
         g_reply_via_fpc = fpc;
+        g_reply_seq = 0;
         rx->ng = false;
         rx->magic = 0;
         rx->crc = 0;
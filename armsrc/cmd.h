@@ -26,6 +26,8 @@ extern bool g_reply_with_crc_on_fpc;
 // "Session" flag, to tell via which interface next msgs should be sent: USB and/or FPC USART
 extern bool g_reply_via_fpc;
 extern bool g_reply_via_usb;
+// Sequence number of the windowed command being processed, echoed in all replies. 0 if none
+extern uint16_t g_reply_seq;
 
 int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len);
 int reply_ng(uint16_t cmd, int16_t status, uint8_t *data, size_t len);
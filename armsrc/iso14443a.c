@@ -637,12 +637,44 @@ static RAMFUNC int ManchesterDecoding_Thinfilm(uint8_t bit) {
 // triggering so that we start recording at the point that the tag is moved
 // near the reader.
 // "hf 14a sniff"
+// largest packet of a streamed sniff, the sampling loop checks the DMA buffer between packets
+#define SNIFF_STREAM_CHUNK 128
+
 //-----------------------------------------------------------------------------
+// Sends the trace records logged since the last call, as many whole records as fit in one
+// SNIFF_STREAM_CHUNK packet (a longer record goes alone).
+// Once everything is sent the trace starts over, so a streamed sniff never fills BigBuf.
+static void Sniff14aStream(uint32_t *streamed) {
+    uint8_t *trace = BigBuf_get_addr();
+    uint32_t trace_len = BigBuf_get_traceLen();
+
+    uint32_t end = *streamed;
+    while (end < trace_len) {
+        tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + end);
+        uint32_t rec_len = TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if ((end > *streamed) && (end + rec_len - *streamed > SNIFF_STREAM_CHUNK)) {
+            break;
+        }
+        end += rec_len;
+    }
+
+    if (end > *streamed) {
+        reply_ng(CMD_HF_ISO14443A_SNIFF_STREAM, PM3_SUCCESS, trace + *streamed, end - *streamed);
+        *streamed = end;
+    }
+
+    if (*streamed == trace_len) {
+        clear_trace();
+        *streamed = 0;
+    }
+}
+
 void RAMFUNC SniffIso14443a(uint8_t param) {
     LEDsoff();
     // param:
     // bit 0 - trigger from first card answer
     // bit 1 - trigger from first reader 7-bit request
+    // bit 2 - stream the trace to the client while sniffing, until the client sends a command
     iso14443a_setup(FPGA_HF_ISO14443A_SNIFFER);
 
     // Allocate memory from BigBuf for some buffers
@@ -691,6 +723,10 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
 
     uint32_t rx_samples = 0;
 
+    bool stream = (param & 0x04);
+    uint32_t streamed = 0;
+    uint32_t stream_timer = GetTickCount();
+
     // loop and listen
     while (BUTTON_PRESS() == false) {
         WDT_HIT();
@@ -713,6 +749,19 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
         }
         if (dataLen < 1) continue;
 
+        // send the trace between frames, one small packet at a time once a packet is worth it
+        // or every 50ms, while the DMA buffer has room for the samples coming in meanwhile
+        if (stream && (rx_samples & 0xFF) == 0 && TagIsActive == false && ReaderIsActive == false && dataLen < DMA_BUFFER_SIZE / 4) {
+            if (data_available()) {
+                break;
+            }
+            uint32_t pending = BigBuf_get_traceLen() - streamed;
+            if (pending >= SNIFF_STREAM_CHUNK || (pending && GetTickCountDelta(stream_timer) > 50)) {
+                Sniff14aStream(&streamed);
+                stream_timer = GetTickCount();
+            }
+        }
+
         // primary buffer was stopped( <-- we lost data!
         if (!AT91C_BASE_PDC_SSC->PDC_RCR) {
             AT91C_BASE_PDC_SSC->PDC_RPR = (uint32_t) dma->buf;
@@ -795,6 +844,10 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
     if (g_dbglevel >= DBG_ERROR) {
         Dbprintf("trace len = " _YELLOW_("%d"), BigBuf_get_traceLen());
     }
+
+    while (stream && BigBuf_get_traceLen()) {
+        Sniff14aStream(&streamed);
+    }
     switch_off();
 }
 
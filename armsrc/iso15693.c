@@ -107,7 +107,7 @@
 ///////////////////////////////////////////////////////////////////////
 
 // buffers
-#define ISO15693_MAX_RESPONSE_LENGTH     36 // allows read single block with the maximum block size of 256bits. Read multiple blocks not supported yet
+#define ISO15693_MAX_RESPONSE_LENGTH     36 // allows read single block with the maximum block size of 256bits. Read multiple blocks uses ISO15693_MAX_MULTI_RESPONSE_LENGTH
 #define ISO15693_MAX_COMMAND_LENGTH      45 // allows write single block with the maximum block size of 256bits. Write multiple blocks not supported yet
 
 // 32 + 2 crc + 1
@@ -1978,6 +1978,106 @@ void DirectTag15693Command(uint32_t datalen, uint32_t speed, uint32_t recv, uint
     LED_D_OFF();
 }
 
+// Reads payload->count blocks with READ MULTIPLE BLOCKS, payload->per_read at a time.
+// A tag error halves the blocks per read, down to READ SINGLE BLOCK. Timeouts and CRC
+// errors are retried. Replies the blocks read as far as they fit in one packet.
+#define ISO15693_MAX_MULTI_RESPONSE_LENGTH 256
+void ReadBlocksIso15693(iso15_read_blocks_t *payload) {
+
+    LED_A_ON();
+
+    uint8_t buf[PM3_CMD_DATA_SIZE] = {0};
+    iso15_read_blocks_resp_t *resp = (iso15_read_blocks_resp_t *)buf;
+
+    if (payload->blocksize == 0)
+        payload->blocksize = 4;
+
+    uint16_t stride = payload->blocksize + ((payload->flags & ISO15_REQ_OPTION) ? 1 : 0);
+    uint16_t count = MIN(payload->count, (sizeof(buf) - sizeof(iso15_read_blocks_resp_t)) / stride);
+    uint8_t per_read = MAX(1, MIN(payload->per_read, (ISO15693_MAX_MULTI_RESPONSE_LENGTH - 3) / stride));
+
+    // flags, command, uid, block, blocks - 1, crc
+    uint8_t cmd[15] = {payload->flags};
+    uint8_t cmdlen = 2;
+    if (payload->flags & ISO15_REQ_ADDRESS) {
+        memcpy(cmd + cmdlen, payload->uid, sizeof(payload->uid));
+        cmdlen += sizeof(payload->uid);
+    }
+
+    uint8_t recvbuf[ISO15693_MAX_MULTI_RESPONSE_LENGTH];
+    uint32_t start_time = 0, eof_time = 0;
+    bool init = true;
+    uint8_t tries = 0;
+    int status = PM3_SUCCESS;
+
+    while (resp->read < count) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        uint8_t n = MIN(per_read, count - resp->read);
+        uint8_t len = cmdlen;
+        cmd[len++] = payload->start + resp->read;
+        if (n == 1) {
+            cmd[1] = ISO15693_READBLOCK;
+        } else {
+            cmd[1] = ISO15693_READ_MULTI_BLOCK;
+            cmd[len++] = n - 1;
+        }
+        AddCrc15(cmd, len);
+        len += 2;
+
+        int recvlen = SendDataTag(cmd, len, init, payload->fast, recvbuf, sizeof(recvbuf), start_time, ISO15693_READER_TIMEOUT, &eof_time);
+        init = false;
+        start_time = eof_time + DELAY_ISO15693_VICC_TO_VCD_READER;
+
+        if (recvlen == PM3_ETEAROFF) {
+            status = PM3_ETEAROFF;
+            break;
+        }
+
+        if (recvlen >= 4 && CheckCrc15(recvbuf, recvlen) && (recvbuf[0] & ISO15_RES_ERROR)) {
+            // too many blocks at once for this tag, or past its memory
+            if (n > 1) {
+                per_read = n / 2;
+                tries = 0;
+                continue;
+            }
+            resp->error = recvbuf[1];
+            break;
+        }
+
+        if (recvlen == 1 + (n * stride) + 2 && CheckCrc15(recvbuf, recvlen)) {
+            memcpy(resp->data + (resp->read * stride), recvbuf + 1, n * stride);
+            resp->read += n;
+            tries = 0;
+            continue;
+        }
+
+        if (++tries < payload->retries) {
+            continue;
+        }
+
+        if (n > 1) {
+            per_read = n / 2;
+            tries = 0;
+            continue;
+        }
+
+        status = PM3_ETIMEOUT;
+        break;
+    }
+
+    resp->per_read = per_read;
+
+    if (g_dbglevel >= DBG_EXTENDED) Dbprintf("Read %u blocks, %u per read, status %d", resp->read, per_read, status);
+
+    reply_ng(CMD_HF_ISO15693_READ_BLOCKS, status, buf, sizeof(iso15_read_blocks_resp_t) + (resp->read * stride));
+    switch_off();
+}
+
 /*
 SLIx functions from official master forks.
 
@@ -280,6 +280,173 @@ void MifareReadSector(uint8_t arg0, uint8_t arg1, uint8_t *datain) {
     set_tracing(false);
 }
 
+//-----------------------------------------------------------------------------
+// Select once, then authenticate and read every sector of a MIFARE Classic tag.
+// Sector trailers are read with key A, data blocks with the key their access
+// conditions allow. Only a failed auth costs a reselect, the others are nested.
+// The dump is left in BigBuf for the client to download.
+//-----------------------------------------------------------------------------
+static bool mifare_dump_auth(struct Crypto1State *pcs, uint8_t *uid, uint32_t *cuid, bool *authed, uint8_t blockNo, uint8_t keyType, uint8_t *key) {
+    uint64_t ui64Key = bytes_to_num(key, 6);
+
+    if (*authed) {
+        if (mifare_classic_auth(pcs, *cuid, blockNo, keyType, ui64Key, AUTH_NESTED) == 0) {
+            return true;
+        }
+        // tag is halted after a failed auth
+        *authed = false;
+        crypto1_deinit(pcs);
+        if (!iso14443a_select_card(uid, NULL, cuid, true, 0, true)) {
+            if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't reselect card");
+            return false;
+        }
+    }
+
+    if (mifare_classic_auth(pcs, *cuid, blockNo, keyType, ui64Key, AUTH_FIRST)) {
+        crypto1_deinit(pcs);
+        iso14443a_select_card(uid, NULL, cuid, true, 0, true);
+        return false;
+    }
+
+    *authed = true;
+    return true;
+}
+
+void MifareDump(uint8_t *datain) {
+    mfc_dump_t *payload = (mfc_dump_t *)datain;
+    uint8_t sectorcnt = MIN(payload->sectorcnt, MIFARE_4K_MAXSECTOR);
+
+    mfc_dump_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+
+    LEDsoff();
+    LED_A_ON();
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+    clear_trace();
+    set_tracing(true);
+
+    uint8_t uid[10] = {0x00};
+    uint32_t cuid = 0;
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs = &mpcs;
+    bool authed = false;
+    int status = PM3_SUCCESS;
+
+    resp.blocks = FirstBlockOfSector(sectorcnt - 1) + NumBlocksPerSector(sectorcnt - 1);
+    uint8_t *dataout = BigBuf_malloc(resp.blocks * 16);
+    if (dataout == NULL) {
+        Dbprintf("out of memory");
+        status = PM3_EMALLOC;
+        goto out;
+    }
+    memset(dataout, 0, resp.blocks * 16);
+    resp.offset = dataout - BigBuf_get_addr();
+
+    if (!iso14443a_select_card(uid, NULL, &cuid, true, 0, true)) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't select card");
+        status = PM3_ECARDEXCHANGE;
+        goto out;
+    }
+
+    for (uint8_t sectorNo = 0; sectorNo < sectorcnt; sectorNo++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        uint8_t first = FirstBlockOfSector(sectorNo);
+        uint8_t trailer = first + NumBlocksPerSector(sectorNo) - 1;
+        uint8_t *keyA = payload->keys[MF_KEY_A][sectorNo];
+        uint8_t *keyB = payload->keys[MF_KEY_B][sectorNo];
+
+        // C1C2C3 per data area and trailer, defaults if the trailer can't be read
+        uint8_t rights[4] = {0x00, 0x00, 0x00, 0x01};
+
+        bool keya_ok = mifare_dump_auth(pcs, uid, &cuid, &authed, first, MF_KEY_A, keyA);
+        if (keya_ok) {
+            uint8_t *data = dataout + trailer * 16;
+            if (mifare_classic_readblock(pcs, cuid, trailer, data) == 0) {
+                mf_decode_access_rights(data, rights);
+                resp.read[trailer / 8] |= 1 << (trailer % 8);
+            } else {
+                if (g_dbglevel >= DBG_ERROR) Dbprintf("Sector[%2d]. Read trailer error", sectorNo);
+                keya_ok = false;
+                authed = false;
+                crypto1_deinit(pcs);
+                iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+            }
+        } else {
+            if (g_dbglevel >= DBG_ERROR) Dbprintf("Sector[%2d]. Auth error key A", sectorNo);
+        }
+
+        // key A blocks first, then key B ones with a single nested auth
+        for (uint8_t keyType = MF_KEY_A; keyType <= MF_KEY_B; keyType++) {
+            bool auth_done = (keyType == MF_KEY_A) && keya_ok;
+            bool auth_failed = (keyType == MF_KEY_A) && (keya_ok == false);
+
+            for (uint8_t blockNo = first; blockNo < trailer; blockNo++) {
+                uint8_t data_area = (sectorNo < 32) ? blockNo - first : (blockNo - first) / 5;
+                uint8_t want = ((rights[data_area] == 0x03) || (rights[data_area] == 0x05)) ? MF_KEY_B : MF_KEY_A;
+                if (rights[data_area] == 0x07 || want != keyType || auth_failed) {
+                    continue;
+                }
+
+                if (auth_done == false) {
+                    uint8_t *key = (keyType == MF_KEY_A) ? keyA : keyB;
+                    if (mifare_dump_auth(pcs, uid, &cuid, &authed, first, keyType, key) == false) {
+                        if (g_dbglevel >= DBG_ERROR) Dbprintf("Sector[%2d]. Auth error key %c", sectorNo, (keyType == MF_KEY_A) ? 'A' : 'B');
+                        auth_failed = true;
+                        continue;
+                    }
+                    auth_done = true;
+                }
+
+                if (mifare_classic_readblock(pcs, cuid, blockNo, dataout + blockNo * 16)) {
+                    if (g_dbglevel >= DBG_ERROR) Dbprintf("Sector[%2d]. Read block %3d error", sectorNo, blockNo);
+                    // the tag drops the session on a failed read
+                    authed = false;
+                    auth_done = false;
+                    crypto1_deinit(pcs);
+                    iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+                    continue;
+                }
+                resp.read[blockNo / 8] |= 1 << (blockNo % 8);
+            }
+        }
+    }
+
+    if (authed) {
+        mifare_classic_halt(pcs, cuid);
+    }
+
+    if (status == PM3_SUCCESS) {
+        for (uint16_t i = 0; i < resp.blocks; i++) {
+            if ((resp.read[i / 8] & (1 << (i % 8))) == 0) {
+                status = PM3_EPARTIAL;
+                break;
+            }
+        }
+    }
+
+    if (g_dbglevel >= DBG_EXTENDED) Dbprintf("Dump finished, status %d", status);
+
+out:
+    crypto1_deinit(pcs);
+
+    LED_B_ON();
+    reply_ng(CMD_HF_MIFARE_DUMP, status, (uint8_t *)&resp, sizeof(resp));
+    LED_B_OFF();
+
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    BigBuf_free();
+    set_tracing(false);
+}
+
 // arg0 = blockNo (start)
 // arg1 = Pages (number of blocks)
 // arg2 = useKey
@@ -624,6 +624,176 @@ void MifareDES_Auth1(uint8_t *datain) {
     LED_B_OFF();
 }
 
+// CBC for the key check. Encrypting chains as sending, decrypting as receiving, like the client does it.
+// in and out may be the same buffer
+static void DesfireChkCBC(uint8_t keytype, const uint8_t *key, const uint8_t *in, uint8_t *out, size_t len, uint8_t *iv, bool encrypt) {
+    mbedtls_des_context dctx;
+    mbedtls_des3_context d3ctx;
+    mbedtls_aes_context actx;
+
+    size_t bs = (keytype == T_AES) ? 16 : 8;
+    switch (keytype) {
+        case T_DES:
+            if (encrypt)
+                mbedtls_des_setkey_enc(&dctx, key);
+            else
+                mbedtls_des_setkey_dec(&dctx, key);
+            break;
+        case T_3DES:
+            if (encrypt)
+                mbedtls_des3_set2key_enc(&d3ctx, key);
+            else
+                mbedtls_des3_set2key_dec(&d3ctx, key);
+            break;
+        case T_3K3DES:
+            if (encrypt)
+                mbedtls_des3_set3key_enc(&d3ctx, key);
+            else
+                mbedtls_des3_set3key_dec(&d3ctx, key);
+            break;
+        case T_AES:
+            mbedtls_aes_init(&actx);
+            if (encrypt)
+                mbedtls_aes_setkey_enc(&actx, key, 128);
+            else
+                mbedtls_aes_setkey_dec(&actx, key, 128);
+            break;
+        default:
+            return;
+    }
+
+    for (size_t i = 0; i < len; i += bs) {
+        uint8_t blk[16];
+        if (encrypt) {
+            for (size_t j = 0; j < bs; j++)
+                blk[j] = in[i + j] ^ iv[j];
+        } else {
+            memcpy(blk, in + i, bs);
+        }
+
+        if (keytype == T_DES)
+            mbedtls_des_crypt_ecb(&dctx, blk, out + i);
+        else if (keytype == T_AES)
+            mbedtls_aes_crypt_ecb(&actx, encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, blk, out + i);
+        else
+            mbedtls_des3_crypt_ecb(&d3ctx, blk, out + i);
+
+        if (encrypt) {
+            memcpy(iv, out + i, bs);
+        } else {
+            for (size_t j = 0; j < bs; j++)
+                out[i + j] ^= iv[j];
+            memcpy(iv, blk, bs);
+        }
+    }
+}
+
+// One EV1 authentication (ISO 0x1A, AES 0xAA) with key number keyno, as DesfireAuthenticateEV1 in the client.
+// Uses the ISO14443-4 session of the client, the application must be selected already.
+// returns PM3_SUCCESS if the card accepts the key, PM3_ESOFT if not,
+// PM3_EWRONGANSWER if the card doesn't start an authentication with this key number / type
+static int DesfireChkKey(uint8_t keytype, uint8_t keyno, const uint8_t *key) {
+    uint8_t rndlen = (keytype == T_AES || keytype == T_3K3DES) ? 16 : 8;
+    uint8_t resp[MAX_FRAME_SIZE] = {0};
+    uint8_t cmd[5 + 32 + 1] = {0x90, (keytype == T_AES) ? MFDES_AUTHENTICATE_AES : MFDES_AUTHENTICATE_ISO, 0x00, 0x00, 0x01, keyno, 0x00};
+
+    // answer: ek(RndB) 91 AF CRC
+    int len = iso14_apdu(cmd, 7, false, resp, NULL);
+    if ((len != rndlen + 4) || (resp[rndlen] != 0x91) || (resp[rndlen + 1] != MFDES_ADDITIONAL_FRAME)) {
+        return PM3_EWRONGANSWER;
+    }
+
+    uint8_t rnda[16];
+    for (uint8_t i = 0; i < rndlen; i += 4) {
+        num_to_bytes(prng_successor(GetTickCount(), 32), 4, rnda + i);
+    }
+
+    uint8_t iv[16] = {0};
+    uint8_t rndb[16];
+    DesfireChkCBC(keytype, key, resp, rndb, rndlen, iv, false);
+
+    // ek(RndA + RndB'), RndB' = RndB rotated left by 8 bits
+    uint8_t both[32];
+    memcpy(both, rnda, rndlen);
+    memcpy(both + rndlen, rndb + 1, rndlen - 1);
+    both[rndlen * 2 - 1] = rndb[0];
+
+    cmd[1] = MFDES_ADDITIONAL_FRAME;
+    cmd[4] = rndlen * 2;
+    DesfireChkCBC(keytype, key, both, cmd + 5, rndlen * 2, iv, true);
+    cmd[5 + rndlen * 2] = 0x00;
+
+    // answer: ek(RndA') 91 00 CRC, a wrong key gets 91 AE
+    len = iso14_apdu(cmd, 5 + rndlen * 2 + 1, false, resp, NULL);
+    if ((len != rndlen + 4) || (resp[rndlen] != 0x91) || (resp[rndlen + 1] != MFDES_S_OPERATION_OK)) {
+        return PM3_ESOFT;
+    }
+
+    DesfireChkCBC(keytype, key, resp, resp, rndlen, iv, false);
+    rol(rnda, rndlen);
+    return (memcmp(resp, rnda, rndlen) == 0) ? PM3_SUCCESS : PM3_ESOFT;
+}
+
+// Checks a chunk of keys on one key number of the selected application, back to back.
+// Replies with the number of keys tried and the index of the found one,
+// status PM3_SUCCESS if a key was found, PM3_ESOFT if none, PM3_EWRONGANSWER if the key number / type is rejected
+void MifareDesfireCheckKeys(uint8_t *datain) {
+    struct p {
+        uint8_t keytype;    // DesfireCryptoAlgorithm
+        uint8_t keyno;
+        uint8_t keycount;
+        uint8_t keys[PM3_CMD_DATA_SIZE - 3];
+    } PACKED;
+    struct p *payload = (struct p *) datain;
+
+    struct {
+        uint8_t tried;
+        uint8_t found;
+    } PACKED rpayload = {0, 0};
+
+    size_t keylen = 0;
+    switch (payload->keytype) {
+        case T_DES:
+            keylen = 8;
+            break;
+        case T_3DES:
+        case T_AES:
+            keylen = 16;
+            break;
+        case T_3K3DES:
+            keylen = 24;
+            break;
+    }
+
+    if ((keylen == 0) || (payload->keycount * keylen > sizeof(payload->keys))) {
+        reply_ng(CMD_HF_DESFIRE_CHKKEYS, PM3_EINVARG, (uint8_t *)&rpayload, sizeof(rpayload));
+        return;
+    }
+
+    LED_A_ON();
+    int res = PM3_ESOFT;
+    for (uint8_t i = 0; i < payload->keycount; i++) {
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+        WDT_HIT();
+
+        res = DesfireChkKey(payload->keytype, payload->keyno, payload->keys + i * keylen);
+        rpayload.tried++;
+        if (res == PM3_SUCCESS) {
+            rpayload.found = i;
+            break;
+        }
+        if (res == PM3_EWRONGANSWER) {
+            break;
+        }
+    }
+    LED_A_OFF();
+
+    reply_ng(CMD_HF_DESFIRE_CHKKEYS, res, (uint8_t *)&rpayload, sizeof(rpayload));
+}
+
 // 3 different ISO ways to send data to a DESFIRE (direct, capsuled, capsuled ISO)
 // cmd  =  cmd bytes to send
 // cmd_len = length of cmd
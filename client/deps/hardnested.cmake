@@ -11,9 +11,10 @@ target_include_directories(pm3rrg_rdv4_hardnested_nosimd PRIVATE
         ../src)
 
 ## CPU-specific code
-## These are mostly for x86-based architectures, which is not useful for many Android devices.
+## x86-based architectures and aarch64 (NEON, SVE).
 ## Mingw platforms: AMD64
 set(X86_CPUS x86 x86_64 i686 AMD64)
+set(ARM64_CPUS aarch64 arm64 ARM64)
 
 message(STATUS "CMAKE_SYSTEM_PROCESSOR := ${CMAKE_SYSTEM_PROCESSOR}")
 
@@ -104,6 +105,47 @@ if ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST X86_CPUS)
             $<TARGET_OBJECTS:pm3rrg_rdv4_hardnested_avx>
             $<TARGET_OBJECTS:pm3rrg_rdv4_hardnested_avx2>
             $<TARGET_OBJECTS:pm3rrg_rdv4_hardnested_avx512>)
+elseif ("${CMAKE_SYSTEM_PROCESSOR}" IN_LIST ARM64_CPUS)
+    message(STATUS "Building optimised aarch64 binaries")
+
+    target_compile_options(pm3rrg_rdv4_hardnested_nosimd BEFORE PRIVATE
+            -march=armv8-a+nosimd)
+
+    ## aarch64 / NEON
+    add_library(pm3rrg_rdv4_hardnested_neon OBJECT
+            hardnested/hardnested_bf_core.c
+            hardnested/hardnested_bitarray_core.c)
+
+    target_compile_options(pm3rrg_rdv4_hardnested_neon PRIVATE -Wall -Werror -O3)
+    set_property(TARGET pm3rrg_rdv4_hardnested_neon PROPERTY POSITION_INDEPENDENT_CODE ON)
+
+    target_include_directories(pm3rrg_rdv4_hardnested_neon PRIVATE
+            ../../common
+            ../../include
+            ../src)
+
+    set(SIMD_TARGETS
+            $<TARGET_OBJECTS:pm3rrg_rdv4_hardnested_neon>)
+
+    ## aarch64 / SVE with 256 bit vectors, see hardnested_bf_core.h
+    if (CMAKE_C_COMPILER_ID STREQUAL "GNU" AND NOT CMAKE_C_COMPILER_VERSION VERSION_LESS 10)
+        add_library(pm3rrg_rdv4_hardnested_sve256 OBJECT
+                hardnested/hardnested_bf_core.c
+                hardnested/hardnested_bitarray_core.c)
+
+        target_compile_options(pm3rrg_rdv4_hardnested_sve256 PRIVATE -Wall -Werror -O3)
+        target_compile_options(pm3rrg_rdv4_hardnested_sve256 BEFORE PRIVATE
+                -march=armv8.2-a+sve -msve-vector-bits=256)
+        set_property(TARGET pm3rrg_rdv4_hardnested_sve256 PROPERTY POSITION_INDEPENDENT_CODE ON)
+
+        target_include_directories(pm3rrg_rdv4_hardnested_sve256 PRIVATE
+                ../../common
+                ../../include
+                ../src)
+
+        list(APPEND SIMD_TARGETS
+                $<TARGET_OBJECTS:pm3rrg_rdv4_hardnested_sve256>)
+    endif ()
 else ()
     message(STATUS "Not building optimised targets")
     set(SIMD_TARGETS)
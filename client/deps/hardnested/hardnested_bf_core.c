@@ -60,8 +60,21 @@ THE SOFTWARE.
 #include "crapto1/crapto1.h"
 #include "parity.h"
 #include "ui.h"             // PrintAndLogEx
+#include "hardnested_bitarray_core.h"
 //#include "common.h"
 
+#if defined (COMPILER_HAS_SIMD_SVE)
+#include <sys/auxv.h>
+#include <sys/prctl.h>
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+#ifndef PR_SVE_GET_VL
+#define PR_SVE_GET_VL 51
+#define PR_SVE_VL_LEN_MASK 0xffff
+#endif
+#endif
+
 // bitslice type
 // while AVX supports 256 bit vector floating point operations, we need integer operations for boolean logic
 // same for AVX2 and 512 bit vectors
@@ -74,6 +87,10 @@ THE SOFTWARE.
 #define MAX_BITSLICES 128
 #elif defined(__SSE2__)
 #define MAX_BITSLICES 128
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_SVE_BITS) && (__ARM_FEATURE_SVE_BITS == 256)
+#define MAX_BITSLICES 256
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MAX_BITSLICES 128
 #else // MMX or SSE or NOSIMD
 #define MAX_BITSLICES 64
 #endif
@@ -118,6 +135,12 @@ typedef union {
 #elif defined (__MMX__)
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_MMX
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_MMX
+#elif defined (__aarch64__) && defined (__ARM_FEATURE_SVE_BITS) && (__ARM_FEATURE_SVE_BITS == 256)
+#define BITSLICE_TEST_NONCES bitslice_test_nonces_SVE256
+#define CRACK_STATES_BITSLICED crack_states_bitsliced_SVE256
+#elif defined (__aarch64__) && defined (__ARM_NEON)
+#define BITSLICE_TEST_NONCES bitslice_test_nonces_NEON
+#define CRACK_STATES_BITSLICED crack_states_bitsliced_NEON
 #else
 #define BITSLICE_TEST_NONCES bitslice_test_nonces_NOSIMD
 #define CRACK_STATES_BITSLICED crack_states_bitsliced_NOSIMD
@@ -130,6 +153,8 @@ crack_states_bitsliced_t crack_states_bitsliced_AVX2;
 crack_states_bitsliced_t crack_states_bitsliced_AVX;
 crack_states_bitsliced_t crack_states_bitsliced_SSE2;
 crack_states_bitsliced_t crack_states_bitsliced_MMX;
+crack_states_bitsliced_t crack_states_bitsliced_SVE256;
+crack_states_bitsliced_t crack_states_bitsliced_NEON;
 crack_states_bitsliced_t crack_states_bitsliced_NOSIMD;
 crack_states_bitsliced_t crack_states_bitsliced_dispatch;
 
@@ -139,6 +164,8 @@ bitslice_test_nonces_t bitslice_test_nonces_AVX2;
 bitslice_test_nonces_t bitslice_test_nonces_AVX;
 bitslice_test_nonces_t bitslice_test_nonces_SSE2;
 bitslice_test_nonces_t bitslice_test_nonces_MMX;
+bitslice_test_nonces_t bitslice_test_nonces_SVE256;
+bitslice_test_nonces_t bitslice_test_nonces_NEON;
 bitslice_test_nonces_t bitslice_test_nonces_NOSIMD;
 bitslice_test_nonces_t bitslice_test_nonces_dispatch;
 
@@ -437,6 +464,12 @@ uint64_t CRACK_STATES_BITSLICED(uint32_t cuid, uint8_t *best_first_bytes, statel
 #if MAX_BITSLICES > 128
                                 && results.bytes64[2] == 0
                                 && results.bytes64[3] == 0
+#endif
+#if MAX_BITSLICES > 256
+                                && results.bytes64[4] == 0
+                                && results.bytes64[5] == 0
+                                && results.bytes64[6] == 0
+                                && results.bytes64[7] == 0
 #endif
                            ) {
 #if defined (DEBUG_BRUTE_FORCE)
@@ -543,7 +576,7 @@ out:
 
 
 
-#ifndef __MMX__
+#if !defined(__MMX__) && !(defined(__aarch64__) && defined(__ARM_NEON))
 
 // pointers to functions:
 crack_states_bitsliced_t *crack_states_bitsliced_function_p = &crack_states_bitsliced_dispatch;
@@ -556,31 +589,66 @@ void SetSIMDInstr(SIMDExecInstr instr) {
 
     crack_states_bitsliced_function_p = &crack_states_bitsliced_dispatch;
     bitslice_test_nonces_function_p = &bitslice_test_nonces_dispatch;
+    reset_bitarray_dispatch();
 }
 
-static SIMDExecInstr GetSIMDInstr(void) {
-    SIMDExecInstr instr;
+bool SIMDInstrSupported(SIMDExecInstr instr) {
 
 #if defined(COMPILER_HAS_SIMD)
     __builtin_cpu_init();
 #endif
 
+    switch (instr) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(COMPILER_HAS_SIMD)
+        case SIMD_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case SIMD_AVX:
+            return __builtin_cpu_supports("avx");
+        case SIMD_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case SIMD_MMX:
+            return __builtin_cpu_supports("mmx");
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            return (getauxval(AT_HWCAP) & HWCAP_SVE) && ((prctl(PR_SVE_GET_VL) & PR_SVE_VL_LEN_MASK) == 256 / 8);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            return true;
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+            return true;
+    }
+    return false;
+}
+
+static SIMDExecInstr GetSIMDInstr(void) {
+    SIMDExecInstr instr;
+
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f"))
+    if (SIMDInstrSupported(SIMD_AVX512))
         instr = SIMD_AVX512;
     else
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2"))
+        if (SIMDInstrSupported(SIMD_AVX2))
             instr = SIMD_AVX2;
-        else if (__builtin_cpu_supports("avx"))
+        else if (SIMDInstrSupported(SIMD_AVX))
             instr = SIMD_AVX;
-        else if (__builtin_cpu_supports("sse2"))
+        else if (SIMDInstrSupported(SIMD_SSE2))
             instr = SIMD_SSE2;
-        else if (__builtin_cpu_supports("mmx"))
+        else if (SIMDInstrSupported(SIMD_MMX))
             instr = SIMD_MMX;
         else
 #endif
+            // the SVE256 and NEON kernels are not build tested on AArch64 yet, they are never picked
+            // automatically, only when asked for with --iv / --ie
             instr = SIMD_NONE;
 
     return instr;
@@ -618,6 +686,16 @@ uint64_t crack_states_bitsliced_dispatch(uint32_t cuid, uint8_t *best_first_byte
         case SIMD_MMX:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_MMX;
             break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            crack_states_bitsliced_function_p = &crack_states_bitsliced_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            crack_states_bitsliced_function_p = &crack_states_bitsliced_NEON;
+            break;
 #endif
         case SIMD_AUTO:
         case SIMD_NONE:
@@ -649,6 +727,16 @@ void bitslice_test_nonces_dispatch(uint32_t nonces_to_bruteforce, const uint32_t
         case SIMD_MMX:
             bitslice_test_nonces_function_p = &bitslice_test_nonces_MMX;
             break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_NEON;
+            break;
 #endif
         case SIMD_AUTO:
         case SIMD_NONE:
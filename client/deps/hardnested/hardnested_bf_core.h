@@ -61,6 +61,16 @@ THE SOFTWARE.
 #  endif
 #endif
 
+// Advanced SIMD is part of every AArch64 CPU. SVE is compiled for a fixed vector length of 256 bits
+// (-msve-vector-bits=256) and only used on CPUs which run with exactly this vector length.
+// Both are experimental and only used when selected explicitly, see GetSIMDInstr()
+#if defined (__aarch64__)
+#  define COMPILER_HAS_SIMD_NEON
+#  if defined (__linux__) && !defined (__clang__) && (__GNUC__ >= 10)
+#    define COMPILER_HAS_SIMD_SVE
+#  endif
+#endif
+
 typedef enum {
     SIMD_AUTO,
 #if defined(COMPILER_HAS_SIMD_AVX512)
@@ -71,11 +81,18 @@ typedef enum {
     SIMD_AVX,
     SIMD_SSE2,
     SIMD_MMX,
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+    SIMD_SVE256,
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+    SIMD_NEON,
 #endif
     SIMD_NONE,
 } SIMDExecInstr;
 void SetSIMDInstr(SIMDExecInstr instr);
 SIMDExecInstr GetSIMDInstrAuto(void);
+bool SIMDInstrSupported(SIMDExecInstr instr);
 
 uint64_t crack_states_bitsliced(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found, uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce, uint8_t *bf_test_nonce_2nd_byte, noncelist_t *nonces);
 void bitslice_test_nonces(uint32_t nonces_to_bruteforce, uint32_t *bf_test_nonce, uint8_t *bf_test_nonce_par);
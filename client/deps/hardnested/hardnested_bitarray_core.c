@@ -98,6 +98,34 @@
 #define COUNT_BITARRAY_AND2 count_bitarray_AND2_MMX
 #define COUNT_BITARRAY_AND3 count_bitarray_AND3_MMX
 #define COUNT_BITARRAY_AND4 count_bitarray_AND4_MMX
+#elif defined (__aarch64__) && defined (__ARM_FEATURE_SVE_BITS) && (__ARM_FEATURE_SVE_BITS == 256)
+#define MALLOC_BITARRAY malloc_bitarray_SVE256
+#define FREE_BITARRAY free_bitarray_SVE256
+#define BITCOUNT bitcount_SVE256
+#define COUNT_STATES count_states_SVE256
+#define BITARRAY_AND bitarray_AND_SVE256
+#define BITARRAY_LOW20_AND bitarray_low20_AND_SVE256
+#define COUNT_BITARRAY_AND count_bitarray_AND_SVE256
+#define COUNT_BITARRAY_LOW20_AND count_bitarray_low20_AND_SVE256
+#define BITARRAY_AND4 bitarray_AND4_SVE256
+#define BITARRAY_OR bitarray_OR_SVE256
+#define COUNT_BITARRAY_AND2 count_bitarray_AND2_SVE256
+#define COUNT_BITARRAY_AND3 count_bitarray_AND3_SVE256
+#define COUNT_BITARRAY_AND4 count_bitarray_AND4_SVE256
+#elif defined (__aarch64__) && defined (__ARM_NEON)
+#define MALLOC_BITARRAY malloc_bitarray_NEON
+#define FREE_BITARRAY free_bitarray_NEON
+#define BITCOUNT bitcount_NEON
+#define COUNT_STATES count_states_NEON
+#define BITARRAY_AND bitarray_AND_NEON
+#define BITARRAY_LOW20_AND bitarray_low20_AND_NEON
+#define COUNT_BITARRAY_AND count_bitarray_AND_NEON
+#define COUNT_BITARRAY_LOW20_AND count_bitarray_low20_AND_NEON
+#define BITARRAY_AND4 bitarray_AND4_NEON
+#define BITARRAY_OR bitarray_OR_NEON
+#define COUNT_BITARRAY_AND2 count_bitarray_AND2_NEON
+#define COUNT_BITARRAY_AND3 count_bitarray_AND3_NEON
+#define COUNT_BITARRAY_AND4 count_bitarray_AND4_NEON
 #else
 #define MALLOC_BITARRAY malloc_bitarray_NOSIMD
 #define FREE_BITARRAY free_bitarray_NOSIMD
@@ -117,45 +145,49 @@
 
 // typedefs and declaration of functions:
 typedef uint32_t *malloc_bitarray_t(uint32_t);
-malloc_bitarray_t malloc_bitarray_AVX512, malloc_bitarray_AVX2, malloc_bitarray_AVX, malloc_bitarray_SSE2, malloc_bitarray_MMX, malloc_bitarray_NOSIMD, malloc_bitarray_dispatch;
+malloc_bitarray_t malloc_bitarray_AVX512, malloc_bitarray_AVX2, malloc_bitarray_AVX, malloc_bitarray_SSE2, malloc_bitarray_MMX, malloc_bitarray_SVE256, malloc_bitarray_NEON, malloc_bitarray_NOSIMD, malloc_bitarray_dispatch;
 typedef void free_bitarray_t(uint32_t *);
-free_bitarray_t free_bitarray_AVX512, free_bitarray_AVX2, free_bitarray_AVX, free_bitarray_SSE2, free_bitarray_MMX, free_bitarray_NOSIMD, free_bitarray_dispatch;
+free_bitarray_t free_bitarray_AVX512, free_bitarray_AVX2, free_bitarray_AVX, free_bitarray_SSE2, free_bitarray_MMX, free_bitarray_SVE256, free_bitarray_NEON, free_bitarray_NOSIMD, free_bitarray_dispatch;
 typedef uint32_t bitcount_t(uint32_t);
-bitcount_t bitcount_AVX512, bitcount_AVX2, bitcount_AVX, bitcount_SSE2, bitcount_MMX, bitcount_NOSIMD, bitcount_dispatch;
+bitcount_t bitcount_AVX512, bitcount_AVX2, bitcount_AVX, bitcount_SSE2, bitcount_MMX, bitcount_SVE256, bitcount_NEON, bitcount_NOSIMD, bitcount_dispatch;
 typedef uint32_t count_states_t(uint32_t *);
-count_states_t count_states_AVX512, count_states_AVX2, count_states_AVX, count_states_SSE2, count_states_MMX, count_states_NOSIMD, count_states_dispatch;
+count_states_t count_states_AVX512, count_states_AVX2, count_states_AVX, count_states_SSE2, count_states_MMX, count_states_SVE256, count_states_NEON, count_states_NOSIMD, count_states_dispatch;
 typedef void bitarray_AND_t(uint32_t[], uint32_t[]);
-bitarray_AND_t bitarray_AND_AVX512, bitarray_AND_AVX2, bitarray_AND_AVX, bitarray_AND_SSE2, bitarray_AND_MMX, bitarray_AND_NOSIMD, bitarray_AND_dispatch;
+bitarray_AND_t bitarray_AND_AVX512, bitarray_AND_AVX2, bitarray_AND_AVX, bitarray_AND_SSE2, bitarray_AND_MMX, bitarray_AND_SVE256, bitarray_AND_NEON, bitarray_AND_NOSIMD, bitarray_AND_dispatch;
 typedef void bitarray_low20_AND_t(uint32_t *, uint32_t *);
-bitarray_low20_AND_t bitarray_low20_AND_AVX512, bitarray_low20_AND_AVX2, bitarray_low20_AND_AVX, bitarray_low20_AND_SSE2, bitarray_low20_AND_MMX, bitarray_low20_AND_NOSIMD, bitarray_low20_AND_dispatch;
+bitarray_low20_AND_t bitarray_low20_AND_AVX512, bitarray_low20_AND_AVX2, bitarray_low20_AND_AVX, bitarray_low20_AND_SSE2, bitarray_low20_AND_MMX, bitarray_low20_AND_SVE256, bitarray_low20_AND_NEON, bitarray_low20_AND_NOSIMD, bitarray_low20_AND_dispatch;
 typedef uint32_t count_bitarray_AND_t(uint32_t *, uint32_t *);
-count_bitarray_AND_t count_bitarray_AND_AVX512, count_bitarray_AND_AVX2, count_bitarray_AND_AVX, count_bitarray_AND_SSE2, count_bitarray_AND_MMX, count_bitarray_AND_NOSIMD, count_bitarray_AND_dispatch;
+count_bitarray_AND_t count_bitarray_AND_AVX512, count_bitarray_AND_AVX2, count_bitarray_AND_AVX, count_bitarray_AND_SSE2, count_bitarray_AND_MMX, count_bitarray_AND_SVE256, count_bitarray_AND_NEON, count_bitarray_AND_NOSIMD, count_bitarray_AND_dispatch;
 typedef uint32_t count_bitarray_low20_AND_t(uint32_t *, uint32_t *);
-count_bitarray_low20_AND_t count_bitarray_low20_AND_AVX512, count_bitarray_low20_AND_AVX2, count_bitarray_low20_AND_AVX, count_bitarray_low20_AND_SSE2, count_bitarray_low20_AND_MMX, count_bitarray_low20_AND_NOSIMD, count_bitarray_low20_AND_dispatch;
+count_bitarray_low20_AND_t count_bitarray_low20_AND_AVX512, count_bitarray_low20_AND_AVX2, count_bitarray_low20_AND_AVX, count_bitarray_low20_AND_SSE2, count_bitarray_low20_AND_MMX, count_bitarray_low20_AND_SVE256, count_bitarray_low20_AND_NEON, count_bitarray_low20_AND_NOSIMD, count_bitarray_low20_AND_dispatch;
 typedef void bitarray_AND4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
-bitarray_AND4_t bitarray_AND4_AVX512, bitarray_AND4_AVX2, bitarray_AND4_AVX, bitarray_AND4_SSE2, bitarray_AND4_MMX, bitarray_AND4_NOSIMD, bitarray_AND4_dispatch;
+bitarray_AND4_t bitarray_AND4_AVX512, bitarray_AND4_AVX2, bitarray_AND4_AVX, bitarray_AND4_SSE2, bitarray_AND4_MMX, bitarray_AND4_SVE256, bitarray_AND4_NEON, bitarray_AND4_NOSIMD, bitarray_AND4_dispatch;
 typedef void bitarray_OR_t(uint32_t[], uint32_t[]);
-bitarray_OR_t bitarray_OR_AVX512, bitarray_OR_AVX2, bitarray_OR_AVX, bitarray_OR_SSE2, bitarray_OR_MMX, bitarray_OR_NOSIMD, bitarray_OR_dispatch;
+bitarray_OR_t bitarray_OR_AVX512, bitarray_OR_AVX2, bitarray_OR_AVX, bitarray_OR_SSE2, bitarray_OR_MMX, bitarray_OR_SVE256, bitarray_OR_NEON, bitarray_OR_NOSIMD, bitarray_OR_dispatch;
 typedef uint32_t count_bitarray_AND2_t(uint32_t *, uint32_t *);
-count_bitarray_AND2_t count_bitarray_AND2_AVX512, count_bitarray_AND2_AVX2, count_bitarray_AND2_AVX, count_bitarray_AND2_SSE2, count_bitarray_AND2_MMX, count_bitarray_AND2_NOSIMD, count_bitarray_AND2_dispatch;
+count_bitarray_AND2_t count_bitarray_AND2_AVX512, count_bitarray_AND2_AVX2, count_bitarray_AND2_AVX, count_bitarray_AND2_SSE2, count_bitarray_AND2_MMX, count_bitarray_AND2_SVE256, count_bitarray_AND2_NEON, count_bitarray_AND2_NOSIMD, count_bitarray_AND2_dispatch;
 typedef uint32_t count_bitarray_AND3_t(uint32_t *, uint32_t *, uint32_t *);
-count_bitarray_AND3_t count_bitarray_AND3_AVX512, count_bitarray_AND3_AVX2, count_bitarray_AND3_AVX, count_bitarray_AND3_SSE2, count_bitarray_AND3_MMX, count_bitarray_AND3_NOSIMD, count_bitarray_AND3_dispatch;
+count_bitarray_AND3_t count_bitarray_AND3_AVX512, count_bitarray_AND3_AVX2, count_bitarray_AND3_AVX, count_bitarray_AND3_SSE2, count_bitarray_AND3_MMX, count_bitarray_AND3_SVE256, count_bitarray_AND3_NEON, count_bitarray_AND3_NOSIMD, count_bitarray_AND3_dispatch;
 typedef uint32_t count_bitarray_AND4_t(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
-count_bitarray_AND4_t count_bitarray_AND4_AVX512, count_bitarray_AND4_AVX2, count_bitarray_AND4_AVX, count_bitarray_AND4_SSE2, count_bitarray_AND4_MMX, count_bitarray_AND4_NOSIMD, count_bitarray_AND4_dispatch;
+count_bitarray_AND4_t count_bitarray_AND4_AVX512, count_bitarray_AND4_AVX2, count_bitarray_AND4_AVX, count_bitarray_AND4_SSE2, count_bitarray_AND4_MMX, count_bitarray_AND4_SVE256, count_bitarray_AND4_NEON, count_bitarray_AND4_NOSIMD, count_bitarray_AND4_dispatch;
 
 
+// bitarrays are always aligned for the widest instruction set. This allows to switch the
+// instruction set (SetSIMDInstr()) while bitarrays are allocated.
+#define BITARRAY_ALIGNMENT 64
+
 inline uint32_t *MALLOC_BITARRAY(uint32_t x) {
 #if defined (_WIN32)
-    return __builtin_assume_aligned(_aligned_malloc((x), __BIGGEST_ALIGNMENT__), __BIGGEST_ALIGNMENT__);
+    return __builtin_assume_aligned(_aligned_malloc((x), BITARRAY_ALIGNMENT), BITARRAY_ALIGNMENT);
 #elif defined (__APPLE__)
     uint32_t *allocated_memory;
-    if (posix_memalign((void **)&allocated_memory, __BIGGEST_ALIGNMENT__, x)) {
+    if (posix_memalign((void **)&allocated_memory, BITARRAY_ALIGNMENT, x)) {
         return NULL;
     } else {
-        return __builtin_assume_aligned(allocated_memory, __BIGGEST_ALIGNMENT__);
+        return __builtin_assume_aligned(allocated_memory, BITARRAY_ALIGNMENT);
     }
 #else
-    return __builtin_assume_aligned(memalign(__BIGGEST_ALIGNMENT__, (x)), __BIGGEST_ALIGNMENT__);
+    return __builtin_assume_aligned(memalign(BITARRAY_ALIGNMENT, (x)), BITARRAY_ALIGNMENT);
 #endif
 }
 
@@ -287,7 +319,7 @@ inline uint32_t COUNT_BITARRAY_AND4(uint32_t *restrict A, uint32_t *restrict B,
 }
 
 
-#ifndef __MMX__
+#if !defined(__MMX__) && !(defined(__aarch64__) && defined(__ARM_NEON))
 
 // pointers to functions:
 malloc_bitarray_t *malloc_bitarray_function_p = &malloc_bitarray_dispatch;
@@ -304,236 +336,539 @@ count_bitarray_AND2_t *count_bitarray_AND2_function_p = &count_bitarray_AND2_dis
 count_bitarray_AND3_t *count_bitarray_AND3_function_p = &count_bitarray_AND3_dispatch;
 count_bitarray_AND4_t *count_bitarray_AND4_function_p = &count_bitarray_AND4_dispatch;
 
+// forget the functions chosen so far. Called when the instruction set is changed with SetSIMDInstr()
+void reset_bitarray_dispatch(void) {
+    malloc_bitarray_function_p = &malloc_bitarray_dispatch;
+    free_bitarray_function_p = &free_bitarray_dispatch;
+    bitcount_function_p = &bitcount_dispatch;
+    count_states_function_p = &count_states_dispatch;
+    bitarray_AND_function_p = &bitarray_AND_dispatch;
+    bitarray_low20_AND_function_p = &bitarray_low20_AND_dispatch;
+    count_bitarray_AND_function_p = &count_bitarray_AND_dispatch;
+    count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_dispatch;
+    bitarray_AND4_function_p = &bitarray_AND4_dispatch;
+    bitarray_OR_function_p = &bitarray_OR_dispatch;
+    count_bitarray_AND2_function_p = &count_bitarray_AND2_dispatch;
+    count_bitarray_AND3_function_p = &count_bitarray_AND3_dispatch;
+    count_bitarray_AND4_function_p = &count_bitarray_AND4_dispatch;
+}
+
 // determine the available instruction set at runtime and call the correct function
 uint32_t *malloc_bitarray_dispatch(uint32_t x) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) malloc_bitarray_function_p = &malloc_bitarray_AVX512;
-    else
+        case SIMD_AVX512:
+            malloc_bitarray_function_p = &malloc_bitarray_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) malloc_bitarray_function_p = &malloc_bitarray_AVX2;
-        else if (__builtin_cpu_supports("avx")) malloc_bitarray_function_p = &malloc_bitarray_AVX;
-        else if (__builtin_cpu_supports("sse2")) malloc_bitarray_function_p = &malloc_bitarray_SSE2;
-        else if (__builtin_cpu_supports("mmx")) malloc_bitarray_function_p = &malloc_bitarray_MMX;
-        else
+        case SIMD_AVX2:
+            malloc_bitarray_function_p = &malloc_bitarray_AVX2;
+            break;
+        case SIMD_AVX:
+            malloc_bitarray_function_p = &malloc_bitarray_AVX;
+            break;
+        case SIMD_SSE2:
+            malloc_bitarray_function_p = &malloc_bitarray_SSE2;
+            break;
+        case SIMD_MMX:
+            malloc_bitarray_function_p = &malloc_bitarray_MMX;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            malloc_bitarray_function_p = &malloc_bitarray_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            malloc_bitarray_function_p = &malloc_bitarray_NEON;
+            break;
+#endif
+        default:
             malloc_bitarray_function_p = &malloc_bitarray_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*malloc_bitarray_function_p)(x);
 }
 
 void free_bitarray_dispatch(uint32_t *x) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) free_bitarray_function_p = &free_bitarray_AVX512;
-    else
+        case SIMD_AVX512:
+            free_bitarray_function_p = &free_bitarray_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) free_bitarray_function_p = &free_bitarray_AVX2;
-        else if (__builtin_cpu_supports("avx")) free_bitarray_function_p = &free_bitarray_AVX;
-        else if (__builtin_cpu_supports("sse2")) free_bitarray_function_p = &free_bitarray_SSE2;
-        else if (__builtin_cpu_supports("mmx")) free_bitarray_function_p = &free_bitarray_MMX;
-        else
+        case SIMD_AVX2:
+            free_bitarray_function_p = &free_bitarray_AVX2;
+            break;
+        case SIMD_AVX:
+            free_bitarray_function_p = &free_bitarray_AVX;
+            break;
+        case SIMD_SSE2:
+            free_bitarray_function_p = &free_bitarray_SSE2;
+            break;
+        case SIMD_MMX:
+            free_bitarray_function_p = &free_bitarray_MMX;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            free_bitarray_function_p = &free_bitarray_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            free_bitarray_function_p = &free_bitarray_NEON;
+            break;
+#endif
+        default:
             free_bitarray_function_p = &free_bitarray_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     (*free_bitarray_function_p)(x);
 }
 
 uint32_t bitcount_dispatch(uint32_t a) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) bitcount_function_p = &bitcount_AVX512;
-    else
+        case SIMD_AVX512:
+            bitcount_function_p = &bitcount_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) bitcount_function_p = &bitcount_AVX2;
-        else if (__builtin_cpu_supports("avx")) bitcount_function_p = &bitcount_AVX;
-        else if (__builtin_cpu_supports("sse2")) bitcount_function_p = &bitcount_SSE2;
-        else if (__builtin_cpu_supports("mmx")) bitcount_function_p = &bitcount_MMX;
-        else
+        case SIMD_AVX2:
+            bitcount_function_p = &bitcount_AVX2;
+            break;
+        case SIMD_AVX:
+            bitcount_function_p = &bitcount_AVX;
+            break;
+        case SIMD_SSE2:
+            bitcount_function_p = &bitcount_SSE2;
+            break;
+        case SIMD_MMX:
+            bitcount_function_p = &bitcount_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitcount_function_p = &bitcount_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitcount_function_p = &bitcount_NEON;
+            break;
 #endif
+        default:
             bitcount_function_p = &bitcount_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*bitcount_function_p)(a);
 }
 
 uint32_t count_states_dispatch(uint32_t *bitarray) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_states_function_p = &count_states_AVX512;
-    else
+        case SIMD_AVX512:
+            count_states_function_p = &count_states_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_states_function_p = &count_states_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_states_function_p = &count_states_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_states_function_p = &count_states_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_states_function_p = &count_states_MMX;
-        else
+        case SIMD_AVX2:
+            count_states_function_p = &count_states_AVX2;
+            break;
+        case SIMD_AVX:
+            count_states_function_p = &count_states_AVX;
+            break;
+        case SIMD_SSE2:
+            count_states_function_p = &count_states_SSE2;
+            break;
+        case SIMD_MMX:
+            count_states_function_p = &count_states_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_states_function_p = &count_states_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_states_function_p = &count_states_NEON;
+            break;
 #endif
+        default:
             count_states_function_p = &count_states_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_states_function_p)(bitarray);
 }
 
 void bitarray_AND_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) bitarray_AND_function_p = &bitarray_AND_AVX512;
-    else
+        case SIMD_AVX512:
+            bitarray_AND_function_p = &bitarray_AND_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) bitarray_AND_function_p = &bitarray_AND_AVX2;
-        else if (__builtin_cpu_supports("avx")) bitarray_AND_function_p = &bitarray_AND_AVX;
-        else if (__builtin_cpu_supports("sse2")) bitarray_AND_function_p = &bitarray_AND_SSE2;
-        else if (__builtin_cpu_supports("mmx")) bitarray_AND_function_p = &bitarray_AND_MMX;
-        else
+        case SIMD_AVX2:
+            bitarray_AND_function_p = &bitarray_AND_AVX2;
+            break;
+        case SIMD_AVX:
+            bitarray_AND_function_p = &bitarray_AND_AVX;
+            break;
+        case SIMD_SSE2:
+            bitarray_AND_function_p = &bitarray_AND_SSE2;
+            break;
+        case SIMD_MMX:
+            bitarray_AND_function_p = &bitarray_AND_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitarray_AND_function_p = &bitarray_AND_SVE256;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitarray_AND_function_p = &bitarray_AND_NEON;
+            break;
+#endif
+        default:
             bitarray_AND_function_p = &bitarray_AND_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     (*bitarray_AND_function_p)(A, B);
 }
 
 void bitarray_low20_AND_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX512;
-    else
+        case SIMD_AVX512:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX2;
-        else if (__builtin_cpu_supports("avx")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX;
-        else if (__builtin_cpu_supports("sse2")) bitarray_low20_AND_function_p = &bitarray_low20_AND_SSE2;
-        else if (__builtin_cpu_supports("mmx")) bitarray_low20_AND_function_p = &bitarray_low20_AND_MMX;
-        else
+        case SIMD_AVX2:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX2;
+            break;
+        case SIMD_AVX:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX;
+            break;
+        case SIMD_SSE2:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_SSE2;
+            break;
+        case SIMD_MMX:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_SVE256;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitarray_low20_AND_function_p = &bitarray_low20_AND_NEON;
+            break;
+#endif
+        default:
             bitarray_low20_AND_function_p = &bitarray_low20_AND_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     (*bitarray_low20_AND_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX512;
-    else
+        case SIMD_AVX512:
+            count_bitarray_AND_function_p = &count_bitarray_AND_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_bitarray_AND_function_p = &count_bitarray_AND_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_bitarray_AND_function_p = &count_bitarray_AND_MMX;
-        else
+        case SIMD_AVX2:
+            count_bitarray_AND_function_p = &count_bitarray_AND_AVX2;
+            break;
+        case SIMD_AVX:
+            count_bitarray_AND_function_p = &count_bitarray_AND_AVX;
+            break;
+        case SIMD_SSE2:
+            count_bitarray_AND_function_p = &count_bitarray_AND_SSE2;
+            break;
+        case SIMD_MMX:
+            count_bitarray_AND_function_p = &count_bitarray_AND_MMX;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_bitarray_AND_function_p = &count_bitarray_AND_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_bitarray_AND_function_p = &count_bitarray_AND_NEON;
+            break;
+#endif
+        default:
             count_bitarray_AND_function_p = &count_bitarray_AND_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_bitarray_AND_function_p)(A, B);
 }
 
 uint32_t count_bitarray_low20_AND_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX512;
-    else
+        case SIMD_AVX512:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_MMX;
-        else
+        case SIMD_AVX2:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX2;
+            break;
+        case SIMD_AVX:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX;
+            break;
+        case SIMD_SSE2:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_SSE2;
+            break;
+        case SIMD_MMX:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_MMX;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_NEON;
+            break;
+#endif
+        default:
             count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_bitarray_low20_AND_function_p)(A, B);
 }
 
 void bitarray_AND4_dispatch(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) bitarray_AND4_function_p = &bitarray_AND4_AVX512;
-    else
+        case SIMD_AVX512:
+            bitarray_AND4_function_p = &bitarray_AND4_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) bitarray_AND4_function_p = &bitarray_AND4_AVX2;
-        else if (__builtin_cpu_supports("avx")) bitarray_AND4_function_p = &bitarray_AND4_AVX;
-        else if (__builtin_cpu_supports("sse2")) bitarray_AND4_function_p = &bitarray_AND4_SSE2;
-        else if (__builtin_cpu_supports("mmx")) bitarray_AND4_function_p = &bitarray_AND4_MMX;
-        else
+        case SIMD_AVX2:
+            bitarray_AND4_function_p = &bitarray_AND4_AVX2;
+            break;
+        case SIMD_AVX:
+            bitarray_AND4_function_p = &bitarray_AND4_AVX;
+            break;
+        case SIMD_SSE2:
+            bitarray_AND4_function_p = &bitarray_AND4_SSE2;
+            break;
+        case SIMD_MMX:
+            bitarray_AND4_function_p = &bitarray_AND4_MMX;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitarray_AND4_function_p = &bitarray_AND4_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitarray_AND4_function_p = &bitarray_AND4_NEON;
+            break;
+#endif
+        default:
             bitarray_AND4_function_p = &bitarray_AND4_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     (*bitarray_AND4_function_p)(A, B, C, D);
 }
 
 void bitarray_OR_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) bitarray_OR_function_p = &bitarray_OR_AVX512;
-    else
+        case SIMD_AVX512:
+            bitarray_OR_function_p = &bitarray_OR_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) bitarray_OR_function_p = &bitarray_OR_AVX2;
-        else if (__builtin_cpu_supports("avx")) bitarray_OR_function_p = &bitarray_OR_AVX;
-        else if (__builtin_cpu_supports("sse2")) bitarray_OR_function_p = &bitarray_OR_SSE2;
-        else if (__builtin_cpu_supports("mmx")) bitarray_OR_function_p = &bitarray_OR_MMX;
-        else
+        case SIMD_AVX2:
+            bitarray_OR_function_p = &bitarray_OR_AVX2;
+            break;
+        case SIMD_AVX:
+            bitarray_OR_function_p = &bitarray_OR_AVX;
+            break;
+        case SIMD_SSE2:
+            bitarray_OR_function_p = &bitarray_OR_SSE2;
+            break;
+        case SIMD_MMX:
+            bitarray_OR_function_p = &bitarray_OR_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            bitarray_OR_function_p = &bitarray_OR_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            bitarray_OR_function_p = &bitarray_OR_NEON;
+            break;
 #endif
+        default:
             bitarray_OR_function_p = &bitarray_OR_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     (*bitarray_OR_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND2_dispatch(uint32_t *A, uint32_t *B) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX512;
-    else
+        case SIMD_AVX512:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_bitarray_AND2_function_p = &count_bitarray_AND2_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_bitarray_AND2_function_p = &count_bitarray_AND2_MMX;
-        else
+        case SIMD_AVX2:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX2;
+            break;
+        case SIMD_AVX:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX;
+            break;
+        case SIMD_SSE2:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_SSE2;
+            break;
+        case SIMD_MMX:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_SVE256;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_bitarray_AND2_function_p = &count_bitarray_AND2_NEON;
+            break;
 #endif
+        default:
             count_bitarray_AND2_function_p = &count_bitarray_AND2_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_bitarray_AND2_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND3_dispatch(uint32_t *A, uint32_t *B, uint32_t *C) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX512;
-    else
+        case SIMD_AVX512:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_bitarray_AND3_function_p = &count_bitarray_AND3_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_bitarray_AND3_function_p = &count_bitarray_AND3_MMX;
-        else
+        case SIMD_AVX2:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX2;
+            break;
+        case SIMD_AVX:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX;
+            break;
+        case SIMD_SSE2:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_SSE2;
+            break;
+        case SIMD_MMX:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_SVE256;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_bitarray_AND3_function_p = &count_bitarray_AND3_NEON;
+            break;
+#endif
+        default:
             count_bitarray_AND3_function_p = &count_bitarray_AND3_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_bitarray_AND3_function_p)(A, B, C);
 }
 
 uint32_t count_bitarray_AND4_dispatch(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D) {
+    switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    if (__builtin_cpu_supports("avx512f")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX512;
-    else
+        case SIMD_AVX512:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX512;
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD)
-        if (__builtin_cpu_supports("avx2")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX2;
-        else if (__builtin_cpu_supports("avx")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX;
-        else if (__builtin_cpu_supports("sse2")) count_bitarray_AND4_function_p = &count_bitarray_AND4_SSE2;
-        else if (__builtin_cpu_supports("mmx")) count_bitarray_AND4_function_p = &count_bitarray_AND4_MMX;
-        else
+        case SIMD_AVX2:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX2;
+            break;
+        case SIMD_AVX:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX;
+            break;
+        case SIMD_SSE2:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_SSE2;
+            break;
+        case SIMD_MMX:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_SVE256;
+            break;
 #endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            count_bitarray_AND4_function_p = &count_bitarray_AND4_NEON;
+            break;
+#endif
+        default:
             count_bitarray_AND4_function_p = &count_bitarray_AND4_NOSIMD;
+            break;
+    }
 
     // call the most optimized function for this CPU
     return (*count_bitarray_AND4_function_p)(A, B, C, D);
@@ -52,6 +52,7 @@ THE SOFTWARE.
 
 #include <stdint.h>
 
+void reset_bitarray_dispatch(void);
 uint32_t *malloc_bitarray(uint32_t x);
 void free_bitarray(uint32_t *x);
 uint32_t bitcount(uint32_t a);
@@ -67,6 +67,7 @@ THE SOFTWARE.
 #include "parity.h"
 #include "fileutils.h"
 #include "pm3_cmd.h"
+#include "crc32.h"
 
 #define NUM_BRUTE_FORCE_THREADS         (num_CPUs())
 #define DEFAULT_BRUTE_FORCE_RATE        (120000000.0) // if benchmark doesn't succeed
@@ -76,6 +77,11 @@ THE SOFTWARE.
 
 // debugging options
 #define DEBUG_KEY_ELIMINATION           1
+
+#define CHECKPOINT_MAGIC                "PM3HNCP"
+#define CHECKPOINT_VERSION              1
+#define CHECKPOINT_WRITE_INTERVAL       10000   // ms between rewrites for completed buckets
+#define MAX_BUCKETS                     128
 // #define DEBUG_BRUTE_FORCE
 
 typedef enum {
@@ -88,11 +94,514 @@ static uint32_t bf_test_nonce[256];
 static uint8_t bf_test_nonce_2nd_byte[256];
 static uint8_t bf_test_nonce_par[256];
 static uint32_t bucket_count = 0;
-static statelist_t *buckets[128];
+static statelist_t *buckets[MAX_BUCKETS];
 static uint32_t keys_found = 0;
 static uint64_t num_keys_tested;
 static uint64_t found_bs_key = 0;
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// brute force checkpoints
+//
+// Every call of brute_force_bs() is one section of the checkpoint file. A section is identified by a
+// fingerprint over the test nonces and the (sorted) candidate buckets, and remembers which buckets have
+// been completely searched. The file is rewritten when a section starts or finishes, and at most every
+// CHECKPOINT_WRITE_INTERVAL ms for completed buckets, so an interrupted run can skip all (but the last few)
+// finished buckets when resumed.
+
+typedef struct {
+    uint32_t fingerprint;
+    uint32_t bucket_count;
+    uint32_t done[MAX_BUCKETS / 32];            // completed buckets bitmap
+    uint64_t keys_tested;
+    uint8_t finished;
+} PACKED checkpoint_section_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+} PACKED checkpoint_hdr_t;
+
+static char *checkpoint_filename = NULL;
+static checkpoint_section_t *checkpoint_sections = NULL;
+static uint32_t checkpoint_num_sections = 0;
+static uint32_t checkpoint_max_sections = 0;
+static checkpoint_section_t *checkpoint_current = NULL;
+static uint64_t checkpoint_last_write = 0;
+static pthread_mutex_t checkpoint_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool checkpoint_read(void) {
+    FILE *f = fopen(checkpoint_filename, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    checkpoint_hdr_t hdr;
+    bool ok = (fread(&hdr, sizeof(hdr), 1, f) == 1)
+              && (memcmp(hdr.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0)
+              && (hdr.version == CHECKPOINT_VERSION)
+              && (fsize == (long)(sizeof(hdr) + (uint64_t)hdr.num_sections * sizeof(checkpoint_section_t)));
+
+    if (ok && hdr.num_sections > 0) {
+        checkpoint_sections = calloc(hdr.num_sections, sizeof(checkpoint_section_t));
+        ok = (checkpoint_sections != NULL)
+             && (fread(checkpoint_sections, sizeof(checkpoint_section_t), hdr.num_sections, f) == hdr.num_sections);
+    }
+    fclose(f);
+
+    if (ok == false) {
+        free(checkpoint_sections);
+        checkpoint_sections = NULL;
+        hdr.num_sections = 0;
+    }
+    checkpoint_num_sections = hdr.num_sections;
+    checkpoint_max_sections = hdr.num_sections;
+    return ok;
+}
+
+// caller holds checkpoint_mutex
+static void checkpoint_write(void) {
+    size_t len = strlen(checkpoint_filename) + 5;
+    char tmpname[len];
+    snprintf(tmpname, len, "%s.tmp", checkpoint_filename);
+
+    FILE *f = fopen(tmpname, "wb");
+    if (f == NULL) {
+        return;
+    }
+
+    checkpoint_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.num_sections = checkpoint_num_sections;
+
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+    ok = ok && (fwrite(checkpoint_sections, sizeof(checkpoint_section_t), checkpoint_num_sections, f) == checkpoint_num_sections);
+    ok = (fclose(f) == 0) && ok;
+
+    if (ok == false || rename(tmpname, checkpoint_filename) != 0) {
+        remove(tmpname);
+    }
+    checkpoint_last_write = msclock();
+}
+
+void brute_force_set_checkpoint(const char *filename, bool resume) {
+    free(checkpoint_filename);
+    checkpoint_filename = NULL;
+    free(checkpoint_sections);
+    checkpoint_sections = NULL;
+    checkpoint_num_sections = 0;
+    checkpoint_max_sections = 0;
+    checkpoint_current = NULL;
+
+    if (filename == NULL || strlen(filename) == 0) {
+        return;
+    }
+
+    checkpoint_filename = strdup(filename);
+    if (checkpoint_filename == NULL) {
+        return;
+    }
+
+    if (resume) {
+        if (checkpoint_read()) {
+            PrintAndLogEx(INFO, "Resuming brute force from checkpoint " _YELLOW_("%s"), checkpoint_filename);
+        } else {
+            PrintAndLogEx(WARNING, "No valid checkpoint in " _YELLOW_("%s") ", starting from scratch", checkpoint_filename);
+        }
+    }
+}
+
+void brute_force_clear_checkpoint(void) {
+    if (checkpoint_filename != NULL) {
+        remove(checkpoint_filename);
+    }
+    brute_force_set_checkpoint(NULL, false);
+}
+
+static int compare_buckets(const void *b1, const void *b2) {
+    const statelist_t *s1 = *(statelist_t *const *)b1;
+    const statelist_t *s2 = *(statelist_t *const *)b2;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        if (s1->len[odd_even] != s2->len[odd_even])
+            return (s1->len[odd_even] > s2->len[odd_even]) - (s2->len[odd_even] > s1->len[odd_even]);
+        if (s1->states[odd_even][0] != s2->states[odd_even][0])
+            return (s1->states[odd_even][0] > s2->states[odd_even][0]) - (s2->states[odd_even][0] > s1->states[odd_even][0]);
+    }
+    return 0;
+}
+
+static uint32_t bucket_fingerprint(uint32_t cuid) {
+    uint32_t data[2 + 256 + MAX_BUCKETS * 4];
+    uint32_t n = 0;
+    data[n++] = cuid;
+    data[n++] = nonces_to_bruteforce;
+    for (uint32_t i = 0; i < nonces_to_bruteforce && i < 256; i++) {
+        data[n++] = bf_test_nonce[i];
+    }
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        data[n++] = buckets[i]->len[ODD_STATE];
+        data[n++] = buckets[i]->len[EVEN_STATE];
+        data[n++] = buckets[i]->states[ODD_STATE][0];
+        data[n++] = buckets[i]->states[EVEN_STATE][0];
+    }
+    uint8_t crc[4] = {0};
+    crc32_ex((uint8_t *)data, n * sizeof(uint32_t), crc);
+    return (uint32_t)crc[0] | ((uint32_t)crc[1] << 8) | ((uint32_t)crc[2] << 16) | ((uint32_t)crc[3] << 24);
+}
+
+// find or add the section for the current bucket list. Buckets get sorted to have a stable order.
+static void checkpoint_start_section(uint32_t cuid) {
+    checkpoint_current = NULL;
+    if (checkpoint_filename == NULL) {
+        return;
+    }
+
+    qsort(buckets, bucket_count, sizeof(statelist_t *), compare_buckets);
+    uint32_t fingerprint = bucket_fingerprint(cuid);
+
+    pthread_mutex_lock(&checkpoint_mutex);
+    for (uint32_t i = 0; i < checkpoint_num_sections; i++) {
+        if (checkpoint_sections[i].fingerprint == fingerprint && checkpoint_sections[i].bucket_count == bucket_count) {
+            checkpoint_current = &checkpoint_sections[i];
+            break;
+        }
+    }
+    if (checkpoint_current == NULL && checkpoint_num_sections == checkpoint_max_sections) {
+        // no worker threads are running yet, nobody else points into the table
+        uint32_t max_sections = MAX(checkpoint_max_sections * 2, 16);
+        checkpoint_section_t *sections = realloc(checkpoint_sections, max_sections * sizeof(checkpoint_section_t));
+        if (sections == NULL) {
+            PrintAndLogEx(WARNING, "Out of memory for checkpoint sections, this candidate set won't be checkpointed");
+            pthread_mutex_unlock(&checkpoint_mutex);
+            return;
+        }
+        checkpoint_sections = sections;
+        checkpoint_max_sections = max_sections;
+    }
+    if (checkpoint_current == NULL) {
+        checkpoint_current = &checkpoint_sections[checkpoint_num_sections++];
+        memset(checkpoint_current, 0, sizeof(checkpoint_section_t));
+        checkpoint_current->fingerprint = fingerprint;
+        checkpoint_current->bucket_count = bucket_count;
+        checkpoint_write();
+    }
+    pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+static bool checkpoint_bucket_done(uint32_t bucket) {
+    if (checkpoint_current == NULL) {
+        return false;
+    }
+    return (checkpoint_current->done[bucket / 32] >> (bucket % 32)) & 1;
+}
+
+static void checkpoint_set_bucket_done(uint32_t bucket) {
+    if (checkpoint_current == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&checkpoint_mutex);
+    checkpoint_current->done[bucket / 32] |= (1U << (bucket % 32));
+    checkpoint_current->keys_tested = __atomic_load_n(&num_keys_tested, __ATOMIC_SEQ_CST);
+    if (msclock() - checkpoint_last_write >= CHECKPOINT_WRITE_INTERVAL) {
+        checkpoint_write();
+    }
+    pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// brute force export
+//
+// Instead of brute forcing locally, the candidate buckets are exported MAX_BUCKETS at a time. Every such batch
+// (a "round") is split into shards of about equal size. Each shard file holds everything needed to crack it on
+// another machine with the standalone hardnested_worker: cuid, best first bytes, all (cuid XORed) nonces and the
+// candidate states of its buckets. Rounds are numbered in the order they are written: brute_force_bs() is called
+// once per Sum(a8) guess, most probable guess first, and one guess can take several rounds. The rounds of one
+// guess follow the candidate list, they are not sorted by probability.
+
+#define SHARD_MAGIC                     "PM3HNSH"
+#define SHARD_VERSION                   1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t cuid;
+    uint32_t num_acquired_nonces;
+    uint32_t round;
+    uint32_t shard;
+    uint32_t num_shards;
+    uint32_t num_buckets;
+    uint64_t num_states;
+    uint8_t best_first_bytes[256];
+} PACKED shard_hdr_t;
+
+typedef struct {
+    uint32_t nonce_enc;
+    uint8_t par_enc;
+} PACKED shard_nonce_t;
+
+static char *export_prefix = NULL;
+static uint32_t export_num_shards = 0;
+static uint32_t export_round = 0;
+static uint32_t export_files = 0;
+
+void brute_force_set_export(const char *prefix, uint32_t num_shards) {
+    free(export_prefix);
+    export_prefix = NULL;
+    export_num_shards = MIN(MAX(num_shards, 1), MAX_BUCKETS);
+    export_round = 0;
+    export_files = 0;
+
+    if (prefix != NULL && strlen(prefix) > 0) {
+        export_prefix = strdup(prefix);
+    }
+}
+
+uint32_t brute_force_exported_shards(void) {
+    return export_files;
+}
+
+static bool write_shard(const char *filename, const shard_hdr_t *hdr, const uint8_t *bucket_shard, noncelist_t *nonces) {
+    FILE *f = fopen(filename, "wb");
+    if (f == NULL) {
+        return false;
+    }
+
+    bool ok = (fwrite(hdr, sizeof(shard_hdr_t), 1, f) == 1);
+
+    for (uint16_t first_byte = 0; first_byte < 256 && ok; first_byte++) {
+        uint16_t num = 0;
+        for (noncelistentry_t *n = nonces[first_byte].first; n != NULL; n = n->next) {
+            num++;
+        }
+        ok = (fwrite(&num, sizeof(num), 1, f) == 1);
+        for (noncelistentry_t *n = nonces[first_byte].first; n != NULL && ok; n = n->next) {
+            shard_nonce_t sn = { .nonce_enc = n->nonce_enc, .par_enc = n->par_enc };
+            ok = (fwrite(&sn, sizeof(sn), 1, f) == 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < bucket_count && ok; i++) {
+        if (bucket_shard[i] != hdr->shard) {
+            continue;
+        }
+        ok = (fwrite(buckets[i]->len, sizeof(uint32_t), 2, f) == 2);
+        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE && ok; odd_even++) {
+            ok = (fwrite(buckets[i]->states[odd_even], sizeof(uint32_t), buckets[i]->len[odd_even], f) == buckets[i]->len[odd_even]);
+        }
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    if (ok == false) {
+        remove(filename);
+    }
+    return ok;
+}
+
+static void export_shards(uint32_t cuid, uint32_t num_acquired_nonces, noncelist_t *nonces, uint8_t *best_first_bytes) {
+
+    uint32_t round = export_round++;
+    if (bucket_count == 0) {
+        return;
+    }
+
+    // stable bucket order, the worker's checkpoints rely on it
+    qsort(buckets, bucket_count, sizeof(statelist_t *), compare_buckets);
+
+    // largest buckets first, each goes to the currently smallest shard
+    uint8_t order[MAX_BUCKETS];
+    uint64_t bucket_states[MAX_BUCKETS];
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        bucket_states[i] = (uint64_t)buckets[i]->len[ODD_STATE] * buckets[i]->len[EVEN_STATE];
+        uint32_t j = i;
+        for (; j > 0 && bucket_states[order[j - 1]] < bucket_states[i]; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    uint32_t num_shards = MIN(export_num_shards, bucket_count);
+    uint64_t shard_states[num_shards];
+    uint32_t shard_buckets[num_shards];
+    memset(shard_states, 0, sizeof(shard_states));
+    memset(shard_buckets, 0, sizeof(shard_buckets));
+    uint8_t bucket_shard[MAX_BUCKETS];
+
+    for (uint32_t i = 0; i < bucket_count; i++) {
+        uint32_t smallest = 0;
+        for (uint32_t s = 1; s < num_shards; s++) {
+            if (shard_states[s] < shard_states[smallest]) {
+                smallest = s;
+            }
+        }
+        bucket_shard[order[i]] = smallest;
+        shard_states[smallest] += bucket_states[order[i]];
+        shard_buckets[smallest]++;
+    }
+
+    size_t fnlen = strlen(export_prefix) + 32;
+    char fn[fnlen];
+    for (uint32_t s = 0; s < num_shards; s++) {
+        shard_hdr_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC));
+        hdr.version = SHARD_VERSION;
+        hdr.cuid = cuid;
+        hdr.num_acquired_nonces = num_acquired_nonces;
+        hdr.round = round;
+        hdr.shard = s;
+        hdr.num_shards = num_shards;
+        hdr.num_buckets = shard_buckets[s];
+        hdr.num_states = shard_states[s];
+        memcpy(hdr.best_first_bytes, best_first_bytes, sizeof(hdr.best_first_bytes));
+
+        snprintf(fn, fnlen, "%s_%02u_%03u.shard", export_prefix, round, s);
+        if (write_shard(fn, &hdr, bucket_shard, nonces) == false) {
+            PrintAndLogEx(ERR, "Failed to write shard " _YELLOW_("%s"), fn);
+            continue;
+        }
+        export_files++;
+    }
+
+    PrintAndLogEx(SUCCESS, "Exported round " _YELLOW_("%u") ", %u buckets in " _YELLOW_("%u") " shards to `" _YELLOW_("%s_%02u_*.shard") "`"
+                  , round
+                  , bucket_count
+                  , num_shards
+                  , export_prefix
+                  , round
+                 );
+}
+
+void brute_force_free_shard(bf_shard_t *shard) {
+    if (shard->nonces != NULL) {
+        for (uint16_t i = 0; i < 256; i++) {
+            noncelistentry_t *n = shard->nonces[i].first;
+            while (n != NULL) {
+                noncelistentry_t *next = n->next;
+                free(n);
+                n = next;
+            }
+        }
+        free(shard->nonces);
+        shard->nonces = NULL;
+    }
+
+    statelist_t *p = shard->candidates;
+    while (p != NULL) {
+        statelist_t *next = p->next;
+        free(p->states[ODD_STATE]);
+        free(p->states[EVEN_STATE]);
+        free(p);
+        p = next;
+    }
+    shard->candidates = NULL;
+}
+
+int brute_force_read_shard(const char *filename, bf_shard_t *shard) {
+    memset(shard, 0, sizeof(bf_shard_t));
+
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        return PM3_EFILE;
+    }
+
+    shard_hdr_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1
+            || memcmp(hdr.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0
+            || hdr.version != SHARD_VERSION
+            || hdr.num_buckets > MAX_BUCKETS) {
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    shard->cuid = hdr.cuid;
+    shard->num_acquired_nonces = hdr.num_acquired_nonces;
+    shard->round = hdr.round;
+    shard->shard = hdr.shard;
+    shard->num_shards = hdr.num_shards;
+    shard->num_buckets = hdr.num_buckets;
+    shard->num_states = hdr.num_states;
+    memcpy(shard->best_first_bytes, hdr.best_first_bytes, sizeof(shard->best_first_bytes));
+
+    shard->nonces = calloc(256, sizeof(noncelist_t));
+    if (shard->nonces == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+    int res = PM3_SUCCESS;
+
+    // keep the original order, prepare_bf_test_nonces() depends on it
+    for (uint16_t first_byte = 0; first_byte < 256 && res == PM3_SUCCESS; first_byte++) {
+        uint16_t num = 0;
+        if (fread(&num, sizeof(num), 1, f) != 1) {
+            res = PM3_EFILE;
+            break;
+        }
+        noncelistentry_t **tail = &shard->nonces[first_byte].first;
+        for (uint16_t i = 0; i < num; i++) {
+            shard_nonce_t sn;
+            if (fread(&sn, sizeof(sn), 1, f) != 1) {
+                res = PM3_EFILE;
+                break;
+            }
+            noncelistentry_t *n = calloc(1, sizeof(noncelistentry_t));
+            if (n == NULL) {
+                res = PM3_EMALLOC;
+                break;
+            }
+            n->nonce_enc = sn.nonce_enc;
+            n->par_enc = sn.par_enc;
+            *tail = n;
+            tail = (noncelistentry_t **)&n->next;
+        }
+        shard->nonces[first_byte].num = num;
+    }
+
+    statelist_t **tail = &shard->candidates;
+    for (uint32_t i = 0; i < hdr.num_buckets && res == PM3_SUCCESS; i++) {
+        statelist_t *p = calloc(1, sizeof(statelist_t));
+        if (p == NULL) {
+            res = PM3_EMALLOC;
+            break;
+        }
+        *tail = p;
+        tail = (statelist_t **)&p->next;
+
+        if (fread(p->len, sizeof(uint32_t), 2, f) != 2 || p->len[ODD_STATE] >= (1 << 24) || p->len[EVEN_STATE] >= (1 << 24)) {
+            res = PM3_EFILE;
+            break;
+        }
+        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+            // add End Of List marker
+            p->states[odd_even] = malloc((p->len[odd_even] + 1) * sizeof(uint32_t));
+            if (p->states[odd_even] == NULL) {
+                res = PM3_EMALLOC;
+                break;
+            }
+            if (fread(p->states[odd_even], sizeof(uint32_t), p->len[odd_even], f) != p->len[odd_even]) {
+                res = PM3_EFILE;
+                break;
+            }
+            p->states[odd_even][p->len[odd_even]] = 0xffffffff;
+        }
+    }
+    fclose(f);
+
+    if (res != PM3_SUCCESS) {
+        brute_force_free_shard(shard);
+        return res;
+    }
+
+    shard->nonces[shard->best_first_bytes[0]].expected_num_brute_force = (float)shard->num_states / 2.0;
+    return PM3_SUCCESS;
+}
+
 inline uint8_t trailing_zeros(uint8_t byte) {
     static const uint8_t trailing_zeros_LUT[256] = {
         8, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
@@ -162,7 +671,7 @@ crack_states_thread(void *x) {
     uint32_t current_bucket = thread_id;
     while (current_bucket < bucket_count) {
         statelist_t *bucket = buckets[current_bucket];
-        if (bucket) {
+        if (bucket && checkpoint_bucket_done(current_bucket) == false) {
 #if defined (DEBUG_BRUTE_FORCE)
             PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on bucket " _YELLOW_("%u") "\n", thread_id, current_bucket);
 #endif
@@ -171,15 +680,18 @@ crack_states_thread(void *x) {
                 __atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST);
                 __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
 
-                char progress_text[80];
-                char keystr[19];
-                sprintf(keystr, "%012" PRIX64 "  ", key);
-                sprintf(progress_text, "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
-                hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
+                if (!thread_arg->silent) {
+                    char progress_text[80];
+                    char keystr[19];
+                    sprintf(keystr, "%012" PRIX64 "  ", key);
+                    sprintf(progress_text, "Brute force phase completed.  Key found: " _GREEN_("%s"), keystr);
+                    hardnested_print_progress(thread_arg->num_acquired_nonces, progress_text, 0.0, 0);
+                }
                 break;
             } else if (keys_found) {
                 break;
             } else {
+                checkpoint_set_bucket_done(current_bucket);
                 if (!thread_arg->silent) {
                     char progress_text[80];
                     sprintf(progress_text, "Brute force phase: %6.02f%%\t", 100.0 * (float)num_keys_tested / (float)(thread_arg->maximum_states));
@@ -306,46 +818,77 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 
     bitslice_test_nonces(nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par);
 
-    // count number of states to go
-    bucket_count = 0;
-    for (statelist_t *p = candidates; p != NULL; p = p->next) {
-        if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
-            buckets[bucket_count] = p;
-            bucket_count++;
+    uint64_t start_time = msclock();
+
+    // buckets are searched MAX_BUCKETS at a time. Each batch is its own checkpoint section and export round
+    statelist_t *p = candidates;
+    do {
+        bucket_count = 0;
+        for (; p != NULL && bucket_count < MAX_BUCKETS; p = p->next) {
+            if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
+                buckets[bucket_count] = p;
+                bucket_count++;
+            }
         }
-    }
 
-    uint64_t start_time = msclock();
+        if (silent == false && export_prefix != NULL) {
+            export_shards(cuid, num_acquired_nonces, nonces, best_first_bytes);
+            continue;
+        }
+
+        checkpoint_current = NULL;
+        if (silent == false && bucket_count > 0) {
+            checkpoint_start_section(cuid);
+            if (checkpoint_current != NULL) {
+                if (checkpoint_current->finished) {
+                    PrintAndLogEx(INFO, "Checkpoint: this candidate set has already been searched, skipping");
+                    num_keys_tested = checkpoint_current->keys_tested;
+                    continue;
+                }
+                num_keys_tested = checkpoint_current->keys_tested;
+            }
+        }
 
 #if defined(__linux__) ||  defined(__APPLE__)
-    if (NUM_BRUTE_FORCE_THREADS < 0)
-        return false;
+        if (NUM_BRUTE_FORCE_THREADS < 0)
+            return false;
 #endif
 
-    pthread_t threads[NUM_BRUTE_FORCE_THREADS];
-    struct args {
-        bool silent;
-        int thread_ID;
-        uint32_t cuid;
-        uint32_t num_acquired_nonces;
-        uint64_t maximum_states;
-        noncelist_t *nonces;
-        uint8_t *best_first_bytes;
-    } thread_args[NUM_BRUTE_FORCE_THREADS];
+        pthread_t threads[NUM_BRUTE_FORCE_THREADS];
+        struct args {
+            bool silent;
+            int thread_ID;
+            uint32_t cuid;
+            uint32_t num_acquired_nonces;
+            uint64_t maximum_states;
+            noncelist_t *nonces;
+            uint8_t *best_first_bytes;
+        } thread_args[NUM_BRUTE_FORCE_THREADS];
+
+        for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
+            thread_args[i].thread_ID = i;
+            thread_args[i].silent = silent;
+            thread_args[i].cuid = cuid;
+            thread_args[i].num_acquired_nonces = num_acquired_nonces;
+            thread_args[i].maximum_states = maximum_states;
+            thread_args[i].nonces = nonces;
+            thread_args[i].best_first_bytes = best_first_bytes;
+            pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
+        }
+        for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
+            pthread_join(threads[i], 0);
+        }
 
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
-        thread_args[i].thread_ID = i;
-        thread_args[i].silent = silent;
-        thread_args[i].cuid = cuid;
-        thread_args[i].num_acquired_nonces = num_acquired_nonces;
-        thread_args[i].maximum_states = maximum_states;
-        thread_args[i].nonces = nonces;
-        thread_args[i].best_first_bytes = best_first_bytes;
-        pthread_create(&threads[i], NULL, crack_states_thread, (void *)&thread_args[i]);
-    }
-    for (uint32_t i = 0; i < NUM_BRUTE_FORCE_THREADS; i++) {
-        pthread_join(threads[i], 0);
-    }
+        if (checkpoint_current != NULL && keys_found == 0) {
+            pthread_mutex_lock(&checkpoint_mutex);
+            checkpoint_current->finished = 1;
+            checkpoint_current->keys_tested = num_keys_tested;
+            checkpoint_write();
+            pthread_mutex_unlock(&checkpoint_mutex);
+        }
+        checkpoint_current = NULL;
+
+    } while (p != NULL && keys_found == 0);
 
     uint64_t elapsed_time = msclock() - start_time;
 
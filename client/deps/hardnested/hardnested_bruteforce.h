@@ -53,9 +53,29 @@ typedef struct {
     void *next;
 } statelist_t;
 
+// one shard of an exported brute force, see brute_force_set_export()
+typedef struct {
+    uint32_t cuid;
+    uint32_t num_acquired_nonces;
+    uint32_t round;
+    uint32_t shard;
+    uint32_t num_shards;
+    uint32_t num_buckets;
+    uint64_t num_states;
+    uint8_t best_first_bytes[256];
+    noncelist_t *nonces;                        // 256 lists, indexed by first byte
+    statelist_t *candidates;
+} bf_shard_t;
+
 void prepare_bf_test_nonces(noncelist_t *nonces, uint8_t best_first_byte);
 bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint32_t num_acquired_nonces, uint64_t maximum_states, noncelist_t *nonces, uint8_t *best_first_bytes, uint64_t *found_key);
 float brute_force_benchmark(void);
+void brute_force_set_checkpoint(const char *filename, bool resume);
+void brute_force_clear_checkpoint(void);
+void brute_force_set_export(const char *prefix, uint32_t num_shards);
+uint32_t brute_force_exported_shards(void);
+int brute_force_read_shard(const char *filename, bf_shard_t *shard);
+void brute_force_free_shard(bf_shard_t *shard);
 uint8_t trailing_zeros(uint8_t byte);
 bool verify_key(uint32_t cuid, noncelist_t *nonces, const uint8_t *best_first_bytes, uint32_t odd, uint32_t even);
 
@@ -0,0 +1,167 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Standalone brute forcer for one shard of a hardnested attack.
+//
+// Shards are written by `hf mf hardnested --export <prefix>`, copy them to
+// as many machines as you like and run
+//     hardnested_worker <prefix>_<round>_<shard>.shard
+// on each of them. The found key is printed and written to <shard file>.key.
+// An interrupted worker continues from <shard file>.checkpoint.
+//
+// To compile it:
+// make -C client/deps/hardnested hardnested_worker
+//-----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "hardnested_bruteforce.h"
+#include "hardnested_bf_core.h"
+#include "cmdhfmfhard.h"      // hardnested_print_progress
+#include "fileutils.h"        // searchFile
+#include "ui.h"               // PrintAndLogEx
+#include "util.h"             // num_CPUs
+#include "util_posix.h"
+#include "pm3_cmd.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// minimal replacements for the client functions used by the brute forcer
+
+static uint64_t start_time = 0;
+
+void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
+    static const char *prefixes[] = { "", "[+] ", "[=] ", "[-] ", "[!] ", "[!!] ", "[#] ", "", "[?] " };
+    va_list args;
+    va_start(args, fmt);
+    fputs(prefixes[level], stdout);
+    vprintf(fmt, args);
+    va_end(args);
+    if (level != INPLACE) {
+        fputc('\n', stdout);
+    }
+    fflush(stdout);
+}
+
+void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time) {
+    static uint64_t last_print_time = 0;
+    if (msclock() - last_print_time > min_diff_print_time) {
+        last_print_time = msclock();
+        PrintAndLogEx(INFO, " %7.0f | %7u | %-55s | %15.0f", (float)(msclock() - start_time) / 1000.0, nonces, activity, brute_force);
+    }
+}
+
+int searchFile(char **foundpath, const char *pm3dir, const char *searchname, const char *suffix, bool silent) {
+    // brute force benchmark data isn't needed in the worker
+    return PM3_EFILE;
+}
+
+int num_CPUs(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors;
+#else
+    int count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count <= 0)
+        count = 1;
+    return count;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int usage(const char *prog) {
+    printf("Usage: %s <shard file> [<key file>]\n", prog);
+    printf("\n");
+    printf("  Brute forces one shard written by `hf mf hardnested --export <prefix>`.\n");
+    printf("  The found key is written to <key file>, default <shard file>.key\n");
+    printf("\n");
+    printf("Exit code: 0 key found, 1 key not in this shard, 2 error\n");
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2 || argc > 3) {
+        return usage(argv[0]);
+    }
+
+    const char *shardfile = argv[1];
+    size_t fnlen = strlen(shardfile) + 16;
+    char keyfile[fnlen];
+    char checkpointfile[fnlen];
+    if (argc == 3) {
+        snprintf(keyfile, fnlen, "%s", argv[2]);
+    } else {
+        snprintf(keyfile, fnlen, "%s.key", shardfile);
+    }
+    snprintf(checkpointfile, fnlen, "%s.checkpoint", shardfile);
+
+    bf_shard_t shard;
+    int res = brute_force_read_shard(shardfile, &shard);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "Failed to read shard file " _YELLOW_("%s"), shardfile);
+        return 2;
+    }
+
+    PrintAndLogEx(INFO, "cuid " _YELLOW_("%08" PRIx32) ", round " _YELLOW_("%u") ", shard " _YELLOW_("%u") "/%u, " _YELLOW_("%u") " buckets, %" PRIu64 " states"
+                  , shard.cuid
+                  , shard.round
+                  , shard.shard + 1
+                  , shard.num_shards
+                  , shard.num_buckets
+                  , shard.num_states
+                 );
+
+    SetSIMDInstr(SIMD_AUTO);
+    prepare_bf_test_nonces(shard.nonces, shard.best_first_bytes[0]);
+    brute_force_set_checkpoint(checkpointfile, access(checkpointfile, F_OK) == 0);
+
+    start_time = msclock();
+    uint64_t found_key = 0;
+    bool key_found = brute_force_bs(NULL, shard.candidates, shard.cuid, shard.num_acquired_nonces, shard.num_states, shard.nonces, shard.best_first_bytes, &found_key);
+    uint64_t elapsed = msclock() - start_time;
+
+    brute_force_free_shard(&shard);
+
+    if (key_found == false) {
+        brute_force_set_checkpoint(NULL, false);
+        PrintAndLogEx(FAILED, "Key not in this shard ( %.1f s )", (float)elapsed / 1000.0);
+        return 1;
+    }
+
+    brute_force_clear_checkpoint();
+    PrintAndLogEx(SUCCESS, "Key found: " _GREEN_("%012" PRIx64) " ( %.1f s )", found_key, (float)elapsed / 1000.0);
+
+    FILE *f = fopen(keyfile, "w");
+    if (f == NULL) {
+        PrintAndLogEx(ERR, "Failed to write key file " _YELLOW_("%s"), keyfile);
+        return 0;
+    }
+    fprintf(f, "%012" PRIx64 "\n", found_key);
+    fclose(f);
+    PrintAndLogEx(SUCCESS, "Saved key to " _YELLOW_("%s"), keyfile);
+    return 0;
+}
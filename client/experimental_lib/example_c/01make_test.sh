@@ -1,3 +1,4 @@
 #!/bin/bash
 
 gcc -o test test.c -I../../include -lpm3rrg_rdv4 -L../build -lpthread
+gcc -o test_threads test_threads.c -I../../include -lpm3rrg_rdv4 -L../build -lpthread
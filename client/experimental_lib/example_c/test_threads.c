@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "pm3.h"
+
+// Two offline handles decoding two different traces in parallel threads.
+// Each handle has its own graph buffer, so every run must find its own ID.
+
+#define RUNS 20
+
+typedef struct {
+    pm3 *p;
+    char load[256];
+    const char *demod;
+    const char *expected;
+    int failures;
+} job_t;
+
+static void *worker(void *arg) {
+    job_t *job = (job_t *)arg;
+    int samples[16];
+
+    for (int i = 0; i < RUNS; i++) {
+        pm3_console(job->p, job->load);
+        char *json = pm3_console_json(job->p, job->demod);
+        if (json == NULL || strstr(json, job->expected) == NULL) {
+            printf("[%s] run %d: expected %s, got %s\n", job->demod, i, job->expected, json ? json : "(null)");
+            job->failures++;
+        }
+        free(json);
+        if (pm3_samples_get(job->p, samples, 16) != 16) {
+            printf("[%s] run %d: no samples\n", job->demod, i);
+            job->failures++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *traces = (argc > 1) ? argv[1] : "../../../traces";
+
+    job_t jobs[2] = {
+        { .demod = "lf em 410x demod", .expected = "0F0368568B" },
+        { .demod = "lf hid demod", .expected = "2006ec0c86" },
+    };
+    snprintf(jobs[0].load, sizeof(jobs[0].load), "data load -f %s/lf_ATA5577_em410x.pm3", traces);
+    snprintf(jobs[1].load, sizeof(jobs[1].load), "data load -f %s/lf_ATA5577_hid.pm3", traces);
+
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        jobs[i].p = pm3_open(NULL);
+        if (jobs[i].p == NULL) {
+            printf("cannot open offline handle\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, worker, &jobs[i]);
+    }
+    int failures = 0;
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+        failures += jobs[i].failures;
+        pm3_close(jobs[i].p);
+    }
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -16,10 +16,20 @@
 #ifndef LIBPM3_H
 #define LIBPM3_H
 
+#include <stddef.h>
+
 typedef struct pm3_device pm3;
 
+// Opens a handle with its own graph, demod and trace buffers. port NULL opens an offline handle.
+// Returns NULL if the device can't be opened. Several handles can run commands from parallel threads.
 pm3 *pm3_open(const char *port);
 int pm3_console(pm3 *dev, const char *cmd);
+// Runs cmd like pm3_console but collects its output instead of printing it. Returns a JSON object
+// {"command", "status", "lines": [{"level", "text"}], "samples", "demod": {"bits", "clock", "start"}}
+// to be freed with free(), NULL on error
+char *pm3_console_json(pm3 *dev, const char *cmd);
+// Copies up to len samples of the graph buffer of dev into dest, returns the number copied
+size_t pm3_samples_get(pm3 *dev, int *dest, size_t len);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Client context, the buffers commands work on
+//-----------------------------------------------------------------------------
+#include "clientctx.h"
+
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+pm3_context_t g_default_context;
+__thread pm3_context_t *g_selected_context = NULL;
+
+pm3_context_t *SelectContext(pm3_context_t *ctx) {
+    pm3_context_t *prev = g_selected_context;
+    g_selected_context = ctx;
+    return prev;
+}
+
+pm3_context_t *NewContext(void) {
+    return calloc(1, sizeof(pm3_context_t));
+}
+
+void FreeContext(pm3_context_t *ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+    ClearContextTrace(ctx);
+    free(ctx);
+}
+
+static void release(void *p, size_t map_len) {
+#ifndef _WIN32
+    if (map_len) {
+        munmap(p, map_len);
+        return;
+    }
+#else
+    (void)map_len;
+#endif
+    free(p);
+}
+
+void ClearContextTrace(pm3_context_t *ctx) {
+    release(ctx->trace, ctx->trace_map_len);
+    ctx->trace = NULL;
+    ctx->trace_len = 0;
+    ctx->trace_map_len = 0;
+
+    // a mapped index file, else the frames were built in memory
+    if (ctx->trace_index_map) {
+        release(ctx->trace_index_map, ctx->trace_index_map_len);
+    } else {
+        free((void *)ctx->trace_frames);
+    }
+    ctx->trace_frames = NULL;
+    ctx->trace_frame_count = 0;
+    ctx->trace_index_map = NULL;
+    ctx->trace_index_map_len = 0;
+}
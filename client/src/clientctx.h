@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Client context, the buffers commands work on
+//-----------------------------------------------------------------------------
+
+#ifndef CLIENTCTX_H__
+#define CLIENTCTX_H__
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_GRAPH_TRACE_LEN (40000 * 8)
+#define MAX_DEMOD_BUF_LEN (1024*128)
+
+// Called for each line printed while the context is selected, instead of printing it.
+// line has no prefix and no ANSI colors.
+typedef void (*pm3_print_cb_t)(int level, const char *line, void *arg);
+
+struct trace_frame;
+
+// Graph, demod and trace buffers. The console and the plot window share the default context,
+// each libpm3 handle has its own one so several handles can run commands in parallel threads.
+typedef struct pm3_context {
+    int graph_buffer[MAX_GRAPH_TRACE_LEN];
+    size_t graph_trace_len;
+
+    uint8_t demod_buffer[MAX_DEMOD_BUF_LEN];
+    size_t demod_buffer_len;
+    int demod_clock;
+    int32_t demod_start_idx;
+
+    // trace downloaded or loaded by "trace" commands. trace_map_len is set when trace is a mapped file
+    uint8_t *trace;
+    uint64_t trace_len;
+    size_t trace_map_len;
+    // frame index of trace (see cmdtrace.h), loaded with the trace file or built by "trace list"
+    const struct trace_frame *trace_frames;
+    uint64_t trace_frame_count;
+    void *trace_index_map;
+    size_t trace_index_map_len;
+
+    // save_restoreGB / save_restoreDB
+    int saved_graph_buffer[MAX_GRAPH_TRACE_LEN];
+    size_t saved_graph_trace_len;
+    int saved_grid_offset;
+    bool graph_saved;
+    uint8_t saved_demod_buffer[MAX_DEMOD_BUF_LEN];
+    size_t saved_demod_buffer_len;
+    int saved_demod_clock;
+    int32_t saved_demod_start_idx;
+    bool demod_saved;
+
+    pm3_print_cb_t print_cb;
+    void *print_arg;
+} pm3_context_t;
+
+extern pm3_context_t g_default_context;
+extern __thread pm3_context_t *g_selected_context;
+
+// Context of the calling thread, the one it selected with SelectContext, else the default context
+static inline pm3_context_t *GetContext(void) {
+    return g_selected_context ? g_selected_context : &g_default_context;
+}
+
+// Selects ctx for the calling thread, NULL for the default context. Returns the previous selection
+pm3_context_t *SelectContext(pm3_context_t *ctx);
+pm3_context_t *NewContext(void);
+void FreeContext(pm3_context_t *ctx);
+// Frees or unmaps the trace of ctx and its frame index
+void ClearContextTrace(pm3_context_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -35,10 +35,6 @@
 #include "cmdlft55xx.h"          // print...
 #include "crypto/asn1utils.h"    // ASN1 decode / print
 
-uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN];
-size_t g_DemodBufferLen = 0;
-int32_t g_DemodStartIdx = 0;
-int g_DemodClock = 0;
 
 static int CmdHelp(const char *Cmd);
 
@@ -146,25 +142,21 @@ static double compute_autoc(const int *data, size_t n, int lag) {
 
 // option '1' to save g_DemodBuffer any other to restore
 void save_restoreDB(uint8_t saveOpt) {
-    static uint8_t SavedDB[MAX_DEMOD_BUF_LEN];
-    static size_t SavedDBlen;
-    static bool DB_Saved = false;
-    static size_t savedDemodStartIdx = 0;
-    static int savedDemodClock = 0;
+    pm3_context_t *ctx = GetContext();
 
     if (saveOpt == GRAPH_SAVE) { //save
 
-        memcpy(SavedDB, g_DemodBuffer, sizeof(g_DemodBuffer));
-        SavedDBlen = g_DemodBufferLen;
-        DB_Saved = true;
-        savedDemodStartIdx = g_DemodStartIdx;
-        savedDemodClock = g_DemodClock;
-    } else if (DB_Saved) { //restore
+        memcpy(ctx->saved_demod_buffer, g_DemodBuffer, sizeof(g_DemodBuffer));
+        ctx->saved_demod_buffer_len = g_DemodBufferLen;
+        ctx->demod_saved = true;
+        ctx->saved_demod_start_idx = g_DemodStartIdx;
+        ctx->saved_demod_clock = g_DemodClock;
+    } else if (ctx->demod_saved) { //restore
 
-        memcpy(g_DemodBuffer, SavedDB, sizeof(g_DemodBuffer));
-        g_DemodBufferLen = SavedDBlen;
-        g_DemodClock = savedDemodClock;
-        g_DemodStartIdx = savedDemodStartIdx;
+        memcpy(g_DemodBuffer, ctx->saved_demod_buffer, sizeof(g_DemodBuffer));
+        g_DemodBufferLen = ctx->saved_demod_buffer_len;
+        g_DemodClock = ctx->saved_demod_clock;
+        g_DemodStartIdx = ctx->saved_demod_start_idx;
     }
 }
 
@@ -779,6 +771,95 @@ static int Cmdaskrawdemod(const char *Cmd) {
     return ASKDemod_ext(clk, invert, max_err, max_len, amplify, true, false, 0, &st);
 }
 
+// in place radix-2 FFT of n complex values, n is a power of 2. The inverse one is not scaled by 1/n
+static void fft(double *re, double *im, size_t n, bool inverse, const double *tw_re, const double *tw_im) {
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    for (size_t m = 2; m <= n; m <<= 1) {
+        size_t step = n / m;
+        for (size_t i = 0; i < n; i += m) {
+            for (size_t k = 0; k < m / 2; k++) {
+                double wr = tw_re[k * step];
+                double wi = inverse ? -tw_im[k * step] : tw_im[k * step];
+                size_t a = i + k, b = i + k + m / 2;
+                double xr = re[b] * wr - im[b] * wi;
+                double xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr;
+                im[b] = im[a] - xi;
+                re[a] += xr;
+                im[a] += xi;
+            }
+        }
+    }
+}
+
+// sums[i] = in[0] * in[i] + ... + in[len - 1 - i] * in[len - 1] for all lags i < len, through an FFT.
+// The sums are exact integers as long as the FFT rounding error stays small, false if the samples are too
+// large for that or on allocation failure
+static bool lag_sums(const int *in, size_t len, int64_t *sums) {
+
+    // the FFT error grows with the energy of the signal
+    double energy = 0;
+    for (size_t i = 0; i < len; i++) {
+        energy += (double)in[i] * in[i];
+    }
+    if (energy > (double)(1ULL << 40)) {
+        return false;
+    }
+
+    size_t n = 1;
+    while (n < 2 * len) {
+        n <<= 1;
+    }
+
+    double *re = calloc(n, sizeof(double));
+    double *im = calloc(n, sizeof(double));
+    double *tw_re = calloc(n / 2, sizeof(double));
+    double *tw_im = calloc(n / 2, sizeof(double));
+    bool ok = (re && im && tw_re && tw_im);
+
+    if (ok) {
+        for (size_t k = 0; k < n / 2; k++) {
+            tw_re[k] = cos(2 * M_PI * k / n);
+            tw_im[k] = -sin(2 * M_PI * k / n);
+        }
+        for (size_t i = 0; i < len; i++) {
+            re[i] = in[i];
+        }
+
+        fft(re, im, n, false, tw_re, tw_im);
+        for (size_t i = 0; i < n; i++) {
+            re[i] = re[i] * re[i] + im[i] * im[i];
+            im[i] = 0;
+        }
+        fft(re, im, n, true, tw_re, tw_im);
+
+        for (size_t i = 0; i < len; i++) {
+            sums[i] = llround(re[i] / n);
+        }
+    }
+
+    free(re);
+    free(im);
+    free(tw_re);
+    free(tw_im);
+    return ok;
+}
+
 int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose) {
     // sanity check
     if (window > len) window = len;
@@ -797,10 +878,27 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
 
     int *correl_buf = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
 
+    // sum of (in[j] - mean) * (in[j + i] - mean) expanded, from the lag sums and prefix sums of in.
+    // Falls back to summing each lag, O(len^2), if the lag sums can't be had
+    int64_t *sums = calloc(len + 1, sizeof(int64_t));
+    int64_t *prefix = calloc(len + 1, sizeof(int64_t));
+    if (sums && prefix && lag_sums(in, len, sums)) {
+        for (size_t j = 0; j < len; j++) {
+            prefix[j + 1] = prefix[j] + in[j];
+        }
+    } else {
+        free(sums);
+        sums = NULL;
+    }
+
     for (size_t i = 0; i < len - window; ++i) {
 
-        for (size_t j = 0; j < (len - i); j++) {
-            autocv += (in[j] - mean) * (in[j + i] - mean);
+        if (sums) {
+            autocv += (double)sums[i] - mean * (double)(prefix[len - i] + prefix[len] - prefix[i]) + (len - i) * mean * mean;
+        } else {
+            for (size_t j = 0; j < (len - i); j++) {
+                autocv += (in[j] - mean) * (in[j + i] - mean);
+            }
         }
         autocv = (1.0 / (len - i)) * autocv;
 
@@ -846,6 +944,9 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
         PrintAndLogEx(FAILED, "no repeating pattern found, try increasing window size");
     }
 
+    free(sums);
+    free(prefix);
+
     int retval = correlation;
     if (SaveGrph) {
         //g_GraphTraceLen = g_GraphTraceLen - window;
@@ -1562,6 +1663,9 @@ void setClockGrid(uint32_t clk, int offset) {
     else
         PrintAndLogEx(DEBUG, "DEBUG: (setClockGrid) demodoffset %d, clk %d", offset, clk);
 
+    // the plot window shows the default context only
+    if (GetContext() != &g_default_context) return;
+
     if (offset > clk) offset %= clk;
     if (offset < 0) offset += clk;
 
@@ -1756,7 +1860,7 @@ int getSamplesEx(uint32_t start, uint32_t end, bool verbose) {
         PrintAndLogEx(INFO, "Reading " _YELLOW_("%u") " bytes from device memory", n);
 
     PacketResponseNG response;
-    if (!GetFromDevice(BIG_BUF, got, n, start, NULL, 0, &response, 10000, true)) {
+    if (!GetFromDeviceEx(BIG_BUF, got, n, start, NULL, 0, &response, 10000, true, verbose ? PrintDownloadProgress : NULL, NULL)) {
         PrintAndLogEx(WARNING, "timeout while waiting for reply.");
         return PM3_ETIMEOUT;
     }
@@ -2047,13 +2151,23 @@ static int CmdLoad(const char *Cmd) {
         }
     }
 
+    int res = loadGraphFile(path);
+    free(path);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%zu") " samples", g_GraphTraceLen);
+    RepaintGraphWindow();
+    return PM3_SUCCESS;
+}
+
+int loadGraphFile(const char *path) {
     FILE *f = fopen(path, "r");
     if (!f) {
         PrintAndLogEx(WARNING, "couldn't open '%s'", path);
-        free(path);
         return PM3_EFILE;
     }
-    free(path);
 
     g_GraphTraceLen = 0;
     char line[80];
@@ -2066,8 +2180,6 @@ static int CmdLoad(const char *Cmd) {
     }
     fclose(f);
 
-    PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%zu") " samples", g_GraphTraceLen);
-
     uint8_t bits[g_GraphTraceLen];
     size_t size = getFromGraphBuf(bits);
 
@@ -2077,7 +2189,6 @@ static int CmdLoad(const char *Cmd) {
 
     setClockGrid(0, 0);
     g_DemodBufferLen = 0;
-    RepaintGraphWindow();
     return PM3_SUCCESS;
 }
 
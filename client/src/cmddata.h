@@ -20,6 +20,7 @@
 #define CMDDATA_H__
 
 #include "common.h"
+#include "clientctx.h" // MAX_DEMOD_BUF_LEN, g_DemodBuffer
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -81,6 +82,8 @@ int printDemodBuff(uint8_t offset, bool strip_leading, bool invert, bool print_h
 
 void setDemodBuff(const uint8_t *buff, size_t size, size_t start_idx);
 bool getDemodBuff(uint8_t *buff, size_t *size);
+// Loads the samples of a pm3 file into the graph buffer
+int loadGraphFile(const char *path);
 void save_restoreDB(uint8_t saveOpt);// option '1' to save g_DemodBuffer any other to restore
 int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose);
 
@@ -91,12 +94,11 @@ void setClockGrid(uint32_t clk, int offset);
 int directionalThreshold(const int *in, int *out, size_t len, int8_t up, int8_t down);
 int AskEdgeDetect(const int *in, int *out, int len, int threshold);
 
-#define MAX_DEMOD_BUF_LEN (1024*128)
-extern uint8_t g_DemodBuffer[MAX_DEMOD_BUF_LEN];
-extern size_t g_DemodBufferLen;
-
-extern int g_DemodClock;
-extern int32_t g_DemodStartIdx;
+// demod buffer of the calling thread's context, see clientctx.h
+#define g_DemodBuffer (GetContext()->demod_buffer)
+#define g_DemodBufferLen (GetContext()->demod_buffer_len)
+#define g_DemodClock (GetContext()->demod_clock)
+#define g_DemodStartIdx (GetContext()->demod_start_idx)
 
 #ifdef __cplusplus
 }
@@ -357,7 +357,7 @@ static int CmdFlashMemDump(const char *Cmd) {
     }
 
     PrintAndLogEx(INFO, "downloading "_YELLOW_("%u")" bytes from flash memory", len);
-    if (!GetFromDevice(FLASH_MEM, dump, len, offset, NULL, 0, NULL, -1, true)) {
+    if (!GetFromDeviceEx(FLASH_MEM, dump, len, offset, NULL, 0, NULL, -1, true, PrintDownloadProgress, NULL)) {
         PrintAndLogEx(FAILED, "ERROR; downloading from flash memory");
         free(dump);
         return PM3_EFLASH;
@@ -377,7 +377,7 @@ static int CmdFlashMemSpiFFSDump(const char *Cmd) {
     // download from device
     uint32_t start_index = 0;
     PrintAndLogEx(INFO, "downloading "_YELLOW_("%u") " bytes from `" _YELLOW_("%s") "` (spiffs)", len, src);
-    if (!GetFromDevice(SPIFFS, dump, len, start_index, (uint8_t *)src, slen, NULL, -1, true)) {
+    if (!GetFromDeviceEx(SPIFFS, dump, len, start_index, (uint8_t *)src, slen, NULL, -1, true, PrintDownloadProgress, NULL)) {
         PrintAndLogEx(FAILED, "error, downloading from spiffs");
         free(dump);
         return PM3_EFLASH;
@@ -532,7 +532,7 @@ static int CmdFlashMemSpiFFSView(const char *Cmd) {
     uint32_t start_index = 0;
     PrintAndLogEx(INFO, "downloading "_YELLOW_("%u") " bytes from `" _YELLOW_("%s") "` (spiffs)", len, src);
 
-    if (!GetFromDevice(SPIFFS, dump, len, start_index, (uint8_t *)src, slen, NULL, -1, true)) {
+    if (!GetFromDeviceEx(SPIFFS, dump, len, start_index, (uint8_t *)src, slen, NULL, -1, true, PrintDownloadProgress, NULL)) {
         PrintAndLogEx(FAILED, "error, downloading from spiffs");
         free(dump);
         return PM3_EFLASH;
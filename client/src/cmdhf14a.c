@@ -196,7 +196,7 @@ static int CmdHF14AList(const char *Cmd) {
 }
 
 int hf14a_getconfig(hf14a_config *config) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     if (config == NULL)
         return PM3_EINVARG;
@@ -214,7 +214,7 @@ int hf14a_getconfig(hf14a_config *config) {
 }
 
 int hf14a_setconfig(hf14a_config *config, bool verbose) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     clearCommandBuffer();
     if (config != NULL) {
@@ -254,7 +254,7 @@ static int hf_14a_config_example(void) {
     return PM3_SUCCESS;
 }
 static int CmdHf14AConfig(const char *Cmd) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf 14a config",
@@ -763,17 +763,116 @@ int CmdHF14ASim(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// how long to wait for the final sniff reply once the device was asked to stop (ms)
+#define SNIFF_STREAM_STOP_TIMEOUT 2500
+
+// Sniffs until <Enter> or the pm3 button, appending the records the device streams to a trace file
+static int sniff_stream(uint8_t param, const char *preferredName) {
+    char *fn = newfilenamemcopy(preferredName, ".trace");
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+        free(fn);
+        return PM3_EFILE;
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443A_SNIFF, (uint8_t *)&param, sizeof(uint8_t));
+
+    PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " or pm3-button to stop sniffing");
+
+    tracelog_hdr_t first_hdr = {0};
+    uint64_t total = 0;
+    bool stopping = false;
+    uint64_t stop_time = 0;
+    int res = PM3_SUCCESS;
+
+    for (;;) {
+        if (stopping == false && kbd_enter_pressed()) {
+            // any command ends a streamed sniff
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            stopping = true;
+            stop_time = msclock();
+        }
+
+        if (IsCommunicationThreadDead()) {
+            PrintAndLogEx(WARNING, "\nlost connection to the device, stopped streaming");
+            res = PM3_EIO;
+            break;
+        }
+
+        if (stopping && (msclock() - stop_time > SNIFF_STREAM_STOP_TIMEOUT)) {
+            PrintAndLogEx(WARNING, "\nno answer from the device after stopping, giving up");
+            res = PM3_ETIMEOUT;
+            break;
+        }
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeoutW(CMD_UNKNOWN, &resp, 100, false) == false) {
+            continue;
+        }
+
+        if (resp.cmd == CMD_HF_ISO14443A_SNIFF) {
+            if (resp.status != PM3_SUCCESS) {
+                PrintAndLogEx(WARNING, "\ndevice refused to stream the sniff ( %d )", resp.status);
+                res = resp.status;
+            }
+            break;
+        }
+
+        if (resp.cmd != CMD_HF_ISO14443A_SNIFF_STREAM || resp.length == 0) {
+            continue;
+        }
+
+        if (fwrite(resp.data.asBytes, 1, resp.length, f) != resp.length) {
+            PrintAndLogEx(WARNING, "failed to write to `" _YELLOW_("%s") "`", fn);
+            if (stopping == false) {
+                SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+                stopping = true;
+                stop_time = msclock();
+            }
+            res = PM3_EFILE;
+        }
+        fflush(f);
+
+        if (total == 0) {
+            memcpy(&first_hdr, resp.data.asBytes, sizeof(first_hdr));
+        }
+        TracePrintStreamed(resp.data.asBytes, resp.length, &first_hdr, ISO_14443A, (total == 0));
+        total += resp.length;
+    }
+
+    fclose(f);
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(SUCCESS, "saved " _YELLOW_("%" PRIu64) " bytes to trace file `" _YELLOW_("%s") "`", total, fn);
+    if (total) {
+        TraceIndexFile(fn, ISO_14443A);
+    }
+    PrintAndLogEx(HINT, "try " _YELLOW_("`trace load -f %s`") " and " _YELLOW_("`trace list -1 -t 14a`"), fn);
+    free(fn);
+    return res;
+}
+
 int CmdHF14ASniff(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf 14a sniff",
                   "Collect data from the field and save into command buffer.\n"
-                  "Buffer accessible from command 'hf 14a list'",
-                  " hf 14a sniff -c -r");
+                  "Buffer accessible from command 'hf 14a list'\n"
+                  "With --stream, frames are shown live and appended to a trace file,\n"
+                  "so the capture isn't limited by the device memory",
+                  " hf 14a sniff -c -r\n"
+                  " hf 14a sniff --stream -f reader-interop   -> stream into reader-interop.trace");
 
     void *argtable[] = {
         arg_param_begin,
         arg_lit0("c", "card", "triggered by first data from card"),
         arg_lit0("r", "reader", "triggered by first 7-bit request from reader (REQ,WUP,...)"),
+        arg_lit0(NULL, "stream", "stream frames to the client while sniffing"),
+        arg_str0("f", "file", "<fn>", "trace file to stream into (def hf-14a-sniff.trace)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -788,11 +887,32 @@ int CmdHF14ASniff(const char *Cmd) {
         param |= 0x02;
     }
 
+    bool stream = arg_get_lit(ctx, 3);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
     CLIParserFree(ctx);
 
-    clearCommandBuffer();
-    SendCommandNG(CMD_HF_ISO14443A_SNIFF, (uint8_t *)&param, sizeof(uint8_t));
-    return PM3_SUCCESS;
+    if (stream == false) {
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_ISO14443A_SNIFF, (uint8_t *)&param, sizeof(uint8_t));
+        return PM3_SUCCESS;
+    }
+
+    if ((g_pm3_capabilities.device_cmds & DEVICE_CMD_14A_SNIFF_STREAM) == 0) {
+        PrintAndLogEx(WARNING, "Device firmware doesn't support " _YELLOW_("--stream") ", flash the Proxmark3 with the same version as the client");
+        return PM3_ENOTIMPL;
+    }
+    // the device sends from its sampling loop, a usart link is too slow for that
+    if (g_conn.send_via_fpc_usart) {
+        PrintAndLogEx(WARNING, _YELLOW_("--stream") " needs the USB connection");
+        return PM3_EINVARG;
+    }
+
+    param |= 0x04;
+    return sniff_stream(param, (fnlen) ? filename : "hf-14a-sniff");
 }
 
 int ExchangeRAW14a(uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, bool silentMode) {
@@ -33,6 +33,7 @@
 #include "commonutil.h"        // ARRAYLEN
 #include "comms.h"             // clearCommandBuffer
 #include "cmdtrace.h"
+#include "iso15.h"              // iso15_read_blocks_t
 #include "iso15693tools.h"     // ISO15693 error codes etc
 #include "protocols.h"         // ISO15693 command set
 #include "crypto/libpcrypto.h"
@@ -1349,7 +1350,71 @@ static int CmdHF15Dump(const char *Cmd) {
     uint8_t data[256 * 4] = {0};
     memset(data, 0, sizeof(data));
 
-    for (int retry = 0; (retry < 5 && blocknum < 0x100); retry++) {
+    // read on device, as many blocks per READ MULTIPLE BLOCKS as the tag accepts.
+    // The device lowers per_read until the tag takes it, down to single block reads
+    iso15_read_blocks_t payload = {
+        .flags = flags,
+        .fast = fast,
+        .per_read = 0xFF,
+        .blocksize = 4,
+        .retries = 5,
+    };
+    memcpy(payload.uid, uid, sizeof(payload.uid));
+
+    uint8_t stride = payload.blocksize + ((flags & ISO15_REQ_OPTION) ? 1 : 0);
+    // blocks that fit in one reply
+    uint8_t max_count = (PM3_CMD_DATA_SIZE - sizeof(iso15_read_blocks_resp_t)) / stride;
+    // firmware without it, read block by block
+    bool on_device = (g_pm3_capabilities.device_cmds & DEVICE_CMD_ISO15_READ_BLOCKS);
+
+    while (on_device && blocknum < 0x100) {
+        payload.start = blocknum;
+        payload.count = MIN(0x100 - blocknum, max_count);
+
+        // worst case every block ends up read on its own and every read is retried,
+        // one exchange takes a few ms at 1 out of 4 and about 100 ms at 1 out of 256
+        uint32_t timeout = 1000 + (payload.count * payload.retries * (fast ? 20 : 100));
+
+        PacketResponseNG resp;
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_ISO15693_READ_BLOCKS, (uint8_t *)&payload, sizeof(payload));
+        if (WaitForResponseTimeout(CMD_HF_ISO15693_READ_BLOCKS, &resp, timeout) == false) {
+            PrintAndLogEx(NORMAL, "");
+            PrintAndLogEx(ERR, "timeout while waiting for reply");
+            DropField();
+            return PM3_ETIMEOUT;
+        }
+
+        iso15_read_blocks_resp_t *rb = (iso15_read_blocks_resp_t *)resp.data.asBytes;
+        for (int i = 0; i < rb->read; i++) {
+            uint8_t *blk = rb->data + (i * stride);
+            mem[blocknum].lock = (stride > payload.blocksize) ? blk[0] : 0;
+            memcpy(mem[blocknum].block, blk + stride - payload.blocksize, 4);
+            memcpy(data + (blocknum * 4), blk + stride - payload.blocksize, 4);
+            blocknum++;
+        }
+        payload.per_read = rb->per_read;
+
+        PrintAndLogEx(INPLACE, "blk %3d", blocknum);
+
+        if (rb->error) {
+            PrintAndLogEx(NORMAL, "");
+            PrintAndLogEx(FAILED, "Tag returned Error %i: %s", rb->error, TagErrorStr(rb->error));
+            break;
+        }
+
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(NORMAL, "");
+            PrintAndLogEx(FAILED, "iso15693 command failed");
+            break;
+        }
+
+        if (rb->read == 0) {
+            break;
+        }
+    }
+
+    for (int retry = 0; (on_device == false && retry < 5 && blocknum < 0x100); retry++) {
 
         req[10] = blocknum;
         AddCrc15(req, 11);
@@ -2480,13 +2480,15 @@ static int CmdHFiClass_loclass(const char *Cmd) {
                   "  <8 byte CSN><8 byte CC><4 byte NR><4 byte MAC>\n"
                   "   ... totalling N*24 bytes",
                   "hf iclass loclass -f iclass_dump.bin\n"
-                  "hf iclass loclass --test");
+                  "hf iclass loclass --test\n"
+                  "hf iclass loclass --bench");
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("f", "file", "<fn>", "filename with nr/mac data from `hf iclass sim -t 2` "),
         arg_lit0(NULL, "test",        "Perform self-test"),
         arg_lit0(NULL, "long",        "Perform self-test, including long ones"),
+        arg_lit0(NULL, "bench",       "Benchmark MAC calculation (keys/s per thread)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -2497,9 +2499,14 @@ static int CmdHFiClass_loclass(const char *Cmd) {
 
     bool test = arg_get_lit(ctx, 2);
     bool longtest = arg_get_lit(ctx, 3);
+    bool bench = arg_get_lit(ctx, 4);
 
     CLIParserFree(ctx);
 
+    if (bench) {
+        return benchMAC();
+    }
+
     if (test || longtest) {
         int errors = testCipherUtils();
         errors += testMAC();
@@ -3411,7 +3418,8 @@ typedef struct {
 
 static size_t iclass_tc = 1;
 
-static pthread_mutex_t generator_mutex = PTHREAD_MUTEX_INITIALIZER;
+// each thread takes every iclass_tc'th chunk of DOMAC_BATCH_SIZE keys,
+// diversifies them and runs them through the bitsliced MAC engine in one go.
 static void *bf_generate_mac(void *thread_arg) {
 
     iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
@@ -3428,21 +3436,25 @@ static void *bf_generate_mac(void *thread_arg) {
     memcpy(csn, targ->csn, sizeof(csn));
     memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
 
-    uint8_t key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_keys[DOMAC_BATCH_SIZE * 8];
+    uint8_t macs[DOMAC_BATCH_SIZE * 4];
 
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    for (uint32_t i = idx * DOMAC_BATCH_SIZE; i < keycnt; i += iclass_tc * DOMAC_BATCH_SIZE) {
 
-        memcpy(key, keys + 8 * i, 8);
+        uint32_t cnt = MIN(keycnt - i, DOMAC_BATCH_SIZE);
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw)
-            memcpy(div_key, key, 8);
-        else
-            HFiClassCalcDivKey(csn, key, div_key, use_elite);
+        for (uint32_t j = 0; j < cnt; j++) {
+            if (use_raw)
+                memcpy(div_keys + (j * 8), keys + 8 * (i + j), 8);
+            else
+                HFiClassCalcDivKey(csn, keys + 8 * (i + j), div_keys + (j * 8), use_elite);
+        }
+
+        doMAC_batch(cc_nr, div_keys, cnt, macs);
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+        for (uint32_t j = 0; j < cnt; j++) {
+            memcpy(list[i + j].mac, macs + (j * 4), 4);
+        }
     }
     return NULL;
 }
@@ -3450,8 +3462,6 @@ static void *bf_generate_mac(void *thread_arg) {
 // precalc diversified keys and their MAC
 void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
-
     iclass_tc = num_CPUs();
     pthread_t threads[iclass_tc];
     iclass_thread_arg_t args[iclass_tc];
@@ -3497,27 +3507,33 @@ static void *bf_generate_mackey(void *thread_arg) {
     memcpy(csn, targ->csn, sizeof(csn));
     memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
 
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_keys[DOMAC_BATCH_SIZE * 8];
+    uint8_t macs[DOMAC_BATCH_SIZE * 4];
 
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    for (uint32_t i = idx * DOMAC_BATCH_SIZE; i < keycnt; i += iclass_tc * DOMAC_BATCH_SIZE) {
 
-        memcpy(list[i].key, keys + 8 * i, 8);
+        uint32_t cnt = MIN(keycnt - i, DOMAC_BATCH_SIZE);
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw)
-            memcpy(div_key, list[i].key, 8);
-        else
-            HFiClassCalcDivKey(csn, list[i].key, div_key, use_elite);
+        for (uint32_t j = 0; j < cnt; j++) {
+            memcpy(list[i + j].key, keys + 8 * (i + j), 8);
+
+            if (use_raw)
+                memcpy(div_keys + (j * 8), list[i + j].key, 8);
+            else
+                HFiClassCalcDivKey(csn, list[i + j].key, div_keys + (j * 8), use_elite);
+        }
+
+        doMAC_batch(cc_nr, div_keys, cnt, macs);
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+        for (uint32_t j = 0; j < cnt; j++) {
+            memcpy(list[i + j].mac, macs + (j * 4), 4);
+        }
     }
     return NULL;
 }
 
 void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
     iclass_tc = num_CPUs();
     pthread_t threads[iclass_tc];
     iclass_thread_arg_t args[iclass_tc];
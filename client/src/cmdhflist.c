@@ -28,6 +28,7 @@
 #include "ui.h"
 #include "crc16.h"
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "protocols.h"
 #include "cmdhficlass.h"
 
@@ -1572,11 +1573,24 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
 
             // check default keys
             if (!traceCrypto1 && dicKeys != NULL && dicKeysCount > 0) {
-                for (int i = 0; i < dicKeysCount; i++) {
-                    if (NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
-                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
-
-                        mfLastKey = dicKeys[i];
+                // bitsliced check of the whole dictionary against ar/at, full check of the few matching keys
+                crypto1_auth_t auth = {
+                    .uid = AuthData.uid,
+                    .nt = AuthData.nt_enc,
+                    .nr_enc = AuthData.nr_enc,
+                    .ar_enc = AuthData.ar_enc,
+                    .at_enc = AuthData.at_enc,
+                    .nested = true,
+                    .has_at = true,
+                };
+                uint32_t found[8];
+                size_t num_found = crypto1_bs_check_keys(&auth, dicKeys, dicKeysCount, found, ARRAYLEN(found));
+                for (size_t i = 0; i < num_found && i < ARRAYLEN(found); i++) {
+                    uint64_t key = dicKeys[found[i]];
+                    if (NestedCheckKey(key, &AuthData, cmd, cmdsize, parity)) {
+                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", key);
+
+                        mfLastKey = key;
                         traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                         break;
                     };
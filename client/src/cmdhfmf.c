@@ -606,6 +606,75 @@ static int FastDumpWithEcFill(uint8_t numsectors) {
     return PM3_SUCCESS;
 }
 
+// blocks read ahead by hf mf dump in one windowed batch
+typedef struct {
+    mf_readblock_t req[256];  // in batch order
+    bool ok[256];             // by block number
+    uint8_t data[256][16];    // by block number
+} mf_dump_batch_t;
+
+static size_t mf_dump_batch_build(uint32_t idx, uint8_t *data, void *ctx) {
+    mf_dump_batch_t *batch = (mf_dump_batch_t *)ctx;
+    memcpy(data, &batch->req[idx], sizeof(mf_readblock_t));
+    return sizeof(mf_readblock_t);
+}
+
+static void mf_dump_batch_reply(uint32_t idx, PacketResponseNG *resp, void *ctx) {
+    mf_dump_batch_t *batch = (mf_dump_batch_t *)ctx;
+    if (resp == NULL || resp->status != PM3_SUCCESS) {
+        return;
+    }
+    uint8_t blockno = batch->req[idx].blockno;
+    batch->ok[blockno] = true;
+    memcpy(batch->data[blockno], resp->data.asBytes, 16);
+}
+
+static void mf_dump_batch_add(mf_dump_batch_t *batch, uint16_t *count, uint8_t blockno, uint8_t keytype, const uint8_t *key) {
+    batch->req[*count].blockno = blockno;
+    batch->req[*count].keytype = keytype;
+    memcpy(batch->req[*count].key, key, sizeof(batch->req[*count].key));
+    (*count)++;
+}
+
+// reads all sectors on the device in one command. Blocks read are marked in batch->ok
+static int mf_dump_on_device(mf_dump_batch_t *batch, uint8_t numSectors, uint8_t keyA[][6], uint8_t keyB[][6]) {
+    mfc_dump_t payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.sectorcnt = numSectors;
+    for (uint8_t sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+        memcpy(payload.keys[MF_KEY_A][sectorNo], keyA[sectorNo], 6);
+        memcpy(payload.keys[MF_KEY_B][sectorNo], keyB[sectorNo], 6);
+    }
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_DUMP, (uint8_t *)&payload, sizeof(payload));
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_DUMP, &resp, 5000) == false) {
+        PrintAndLogEx(DEBUG, "on device dump timeout");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS && resp.status != PM3_EPARTIAL) {
+        PrintAndLogEx(DEBUG, "on device dump failed ( %d )", resp.status);
+        return resp.status;
+    }
+
+    mfc_dump_resp_t *dump = (mfc_dump_resp_t *)resp.data.asBytes;
+    if (dump->blocks == 0 || dump->blocks > ARRAYLEN(batch->data)) {
+        return PM3_ESOFT;
+    }
+
+    if (GetFromDevice(BIG_BUF, (uint8_t *)batch->data, dump->blocks * 16, dump->offset, NULL, 0, NULL, 2500, false) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    for (uint16_t i = 0; i < dump->blocks; i++) {
+        batch->ok[i] = (dump->read[i / 8] >> (i % 8)) & 1;
+    }
+    return resp.status;
+}
+
 static int CmdHF14AMfDump(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mf dump",
@@ -740,6 +809,29 @@ static int CmdHF14AMfDump(const char *Cmd) {
     PrintAndLogEx(INFO, "Reading sector access bits...");
     PrintAndLogEx(INFO, "." NOLF);
 
+    mf_dump_batch_t *batch = calloc(1, sizeof(mf_dump_batch_t));
+    if (batch == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    // the whole card in one command, whatever it couldn't read is read block by block below
+    if (g_pm3_capabilities.device_cmds & DEVICE_CMD_MIFARE_DUMP) {
+        mf_dump_on_device(batch, numSectors, keyA, keyB);
+    }
+
+    // all sector trailers in one go, failed ones are retried below
+    uint16_t batch_count = 0;
+    for (sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+        uint8_t trailer = FirstBlockOfSector(sectorNo) + NumBlocksPerSector(sectorNo) - 1;
+        if (batch->ok[trailer] == false) {
+            mf_dump_batch_add(batch, &batch_count, trailer, MF_KEY_A, keyA[sectorNo]);
+        }
+    }
+    if (batch_count) {
+        SendCommandNGWindowed(CMD_HF_MIFARE_READBL, batch_count, mf_dump_batch_build, mf_dump_batch_reply, batch, 1500);
+    }
+
     uint8_t tries;
     mf_readblock_t payload;
     for (sectorNo = 0; sectorNo < numSectors; sectorNo++) {
@@ -747,6 +839,12 @@ static int CmdHF14AMfDump(const char *Cmd) {
             PrintAndLogEx(NORMAL, "." NOLF);
             fflush(stdout);
 
+            uint8_t trailer = FirstBlockOfSector(sectorNo) + NumBlocksPerSector(sectorNo) - 1;
+            if (batch->ok[trailer]) {
+                mf_decode_access_rights(batch->data[trailer], rights[sectorNo]);
+                break;
+            }
+
             payload.blockno = FirstBlockOfSector(sectorNo) + NumBlocksPerSector(sectorNo) - 1;
             payload.keytype = MF_KEY_A;
             memcpy(payload.key, keyA[sectorNo], sizeof(payload.key));
@@ -756,12 +854,8 @@ static int CmdHF14AMfDump(const char *Cmd) {
 
             if (WaitForResponseTimeout(CMD_HF_MIFARE_READBL, &resp, 1500)) {
 
-                uint8_t *data = resp.data.asBytes;
                 if (resp.status == PM3_SUCCESS) {
-                    rights[sectorNo][0] = ((data[7] & 0x10) >> 2) | ((data[8] & 0x1) << 1) | ((data[8] & 0x10) >> 4); // C1C2C3 for data area 0
-                    rights[sectorNo][1] = ((data[7] & 0x20) >> 3) | ((data[8] & 0x2) << 0) | ((data[8] & 0x20) >> 5); // C1C2C3 for data area 1
-                    rights[sectorNo][2] = ((data[7] & 0x40) >> 4) | ((data[8] & 0x4) >> 1) | ((data[8] & 0x40) >> 6); // C1C2C3 for data area 2
-                    rights[sectorNo][3] = ((data[7] & 0x80) >> 5) | ((data[8] & 0x8) >> 2) | ((data[8] & 0x80) >> 7); // C1C2C3 for sector trailer
+                    mf_decode_access_rights(resp.data.asBytes, rights[sectorNo]);
                     break;
                 } else if (tries == 2) { // on last try set defaults
                     PrintAndLogEx(FAILED, "\ncould not get access rights for sector %2d. Trying with defaults...", sectorNo);
@@ -779,11 +873,40 @@ static int CmdHF14AMfDump(const char *Cmd) {
     PrintAndLogEx(SUCCESS, "Finished reading sector access bits");
     PrintAndLogEx(INFO, "Dumping all blocks from card...");
 
+    // all readable blocks not read yet in one go, with the same key choice as below. Failed ones are retried below
+    batch_count = 0;
+    for (sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+        for (blockNo = 0; blockNo < NumBlocksPerSector(sectorNo); blockNo++) {
+            uint8_t block = FirstBlockOfSector(sectorNo) + blockNo;
+            uint8_t data_area = (sectorNo < 32) ? blockNo : blockNo / 5;
+            if (batch->ok[block]) {
+                continue;
+            } else if (blockNo == NumBlocksPerSector(sectorNo) - 1) {
+                mf_dump_batch_add(batch, &batch_count, block, MF_KEY_A, keyA[sectorNo]);
+            } else if ((rights[sectorNo][data_area] == 0x03) || (rights[sectorNo][data_area] == 0x05)) {
+                mf_dump_batch_add(batch, &batch_count, block, MF_KEY_B, keyB[sectorNo]);
+            } else if (rights[sectorNo][data_area] != 0x07) {
+                mf_dump_batch_add(batch, &batch_count, block, MF_KEY_A, keyA[sectorNo]);
+            }
+        }
+    }
+    if (batch_count) {
+        SendCommandNGWindowed(CMD_HF_MIFARE_READBL, batch_count, mf_dump_batch_build, mf_dump_batch_reply, batch, 1500);
+    }
+
     for (sectorNo = 0; sectorNo < numSectors; sectorNo++) {
         for (blockNo = 0; blockNo < NumBlocksPerSector(sectorNo); blockNo++) {
             bool received = false;
 
             for (tries = 0; tries < MIFARE_SECTOR_RETRY; tries++) {
+                uint8_t block = FirstBlockOfSector(sectorNo) + blockNo;
+                if (batch->ok[block]) {
+                    resp.status = PM3_SUCCESS;
+                    memcpy(resp.data.asBytes, batch->data[block], 16);
+                    received = true;
+                    break;
+                }
+
                 if (blockNo == NumBlocksPerSector(sectorNo) - 1) { // sector trailer. At least the Access Conditions can always be read with key A.
 
                     payload.blockno = FirstBlockOfSector(sectorNo) + blockNo;
@@ -857,6 +980,8 @@ static int CmdHF14AMfDump(const char *Cmd) {
         }
     }
 
+    free(batch);
+
     PrintAndLogEx(SUCCESS, "time: %" PRIu64 " seconds\n", (msclock() - t1) / 1000);
 
     PrintAndLogEx(SUCCESS, "\nSucceeded in dumping all blocks");
@@ -1245,7 +1370,9 @@ static int CmdHF14AMfNested(const char *Cmd) {
     }
 
     if (singleSector) {
-        int16_t isOK = mfnested(blockNo, keyType, key, trgBlockNo, trgKeyType, keyBlock, true);
+        crapto1_arena_t *arena = crapto1_arena_create(0);
+        int16_t isOK = mfnested(blockNo, keyType, key, trgBlockNo, trgKeyType, keyBlock, true, arena);
+        crapto1_arena_destroy(arena);
         switch (isOK) {
             case PM3_ETIMEOUT:
                 PrintAndLogEx(ERR, "Command execute timeout\n");
@@ -1317,6 +1444,8 @@ static int CmdHF14AMfNested(const char *Cmd) {
 
         // nested sectors
         bool calibrate = true;
+        // recovery tables of every CPU, shared by all sectors
+        crapto1_arena_t *arena = crapto1_arena_create(0);
 
         for (trgKeyType = MF_KEY_A; trgKeyType <= MF_KEY_B; ++trgKeyType) {
             for (uint8_t sectorNo = 0; sectorNo < SectorsCnt; ++sectorNo) {
@@ -1324,7 +1453,7 @@ static int CmdHF14AMfNested(const char *Cmd) {
 
                     if (e_sector[sectorNo].foundKey[trgKeyType]) continue;
 
-                    int16_t isOK = mfnested(blockNo, keyType, key, FirstBlockOfSector(sectorNo), trgKeyType, keyBlock, calibrate);
+                    int16_t isOK = mfnested(blockNo, keyType, key, FirstBlockOfSector(sectorNo), trgKeyType, keyBlock, calibrate, arena);
                     switch (isOK) {
                         case PM3_ETIMEOUT:
                             PrintAndLogEx(ERR, "Command execute timeout\n");
@@ -1349,11 +1478,13 @@ static int CmdHF14AMfNested(const char *Cmd) {
                         default :
                             PrintAndLogEx(ERR, "Unknown error.\n");
                     }
+                    crapto1_arena_destroy(arena);
                     free(e_sector);
                     return PM3_ESOFT;
                 }
             }
         }
+        crapto1_arena_destroy(arena);
 
         t1 = msclock() - t1;
         PrintAndLogEx(SUCCESS, "time in nested " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
@@ -1568,6 +1699,9 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
     PrintAndLogEx(SUCCESS, "Time to check "_YELLOW_("%zu") " known keys: %.0f seconds\n", ARRAYLEN(g_mifare_default_keys), (float)t2 / 1000.0);
     PrintAndLogEx(SUCCESS, "enter static nested key recovery");
 
+    // recovery tables of every CPU, shared by all sectors
+    crapto1_arena_t *arena = crapto1_arena_create(0);
+
     // nested sectors
     for (trgKeyType = MF_KEY_A; trgKeyType <= MF_KEY_B; ++trgKeyType) {
         for (uint8_t sectorNo = 0; sectorNo < SectorsCnt; ++sectorNo) {
@@ -1576,7 +1710,7 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
 
                 if (e_sector[sectorNo].foundKey[trgKeyType]) continue;
 
-                int16_t isOK = mfStaticNested(blockNo, keyType, key, FirstBlockOfSector(sectorNo), trgKeyType, keyBlock);
+                int16_t isOK = mfStaticNested(blockNo, keyType, key, FirstBlockOfSector(sectorNo), trgKeyType, keyBlock, arena);
                 switch (isOK) {
                     case PM3_ETIMEOUT :
                         PrintAndLogEx(ERR, "Command execute timeout");
@@ -1595,11 +1729,13 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
                     default :
                         PrintAndLogEx(ERR, "unknown error.\n");
                 }
+                crapto1_arena_destroy(arena);
                 free(e_sector);
                 return PM3_ESOFT;
             }
         }
     }
+    crapto1_arena_destroy(arena);
 
     t1 = msclock() - t1;
     PrintAndLogEx(SUCCESS, "time in static nested " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
@@ -1702,7 +1838,12 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "hf mf hardnested -r\n"
                   "hf mf hardnested -r --tk a0a1a2a3a4a5\n"
                   "hf mf hardnested -t --tk a0a1a2a3a4a5\n"
-                  "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF"
+                  "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
+                  "hf mf hardnested --build-cache --table-cache /tmp/pm3    --> expand bitflip tables once\n"
+                  "hf mf hardnested -r --table-cache /tmp/pm3               --> map pre-expanded bitflip tables\n"
+                  "hf mf hardnested -r --resume                             --> continue an interrupted brute force\n"
+                  "hf mf hardnested -r --export /tmp/card --shards 16       --> write brute force shards for `hardnested_worker`\n"
+                  "hf mf hardnested --bench                                 --> test and benchmark all SIMD instruction sets"
                  );
 
     void *argtable[] = {
@@ -1721,6 +1862,12 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         arg_lit0("s",  "slow",           "Slower acquisition (required by some non standard cards)"),
         arg_lit0("t",  "tests",          "Run tests"),
         arg_lit0("w",  "wr",             "Acquire nonces and UID, and write them to file `hf-mf-<UID>-nonces.bin`"),
+        arg_str0(NULL, "table-cache", "<dir>", "Use pre-expanded bitflip tables from <dir> (memory mapped)"),
+        arg_lit0(NULL, "build-cache",    "Expand bitflip tables into --table-cache <dir>, verify them and quit"),
+        arg_lit0(NULL, "resume",         "Resume brute force from `<nonce file>.checkpoint`"),
+        arg_str0(NULL, "export", "<prefix>", "Don't brute force, write candidate shards to `<prefix>_<round>_<shard>.shard`"),
+        arg_int0(NULL, "shards", "<dec>", "Number of shards per round for --export (def 16)"),
+        arg_lit0(NULL, "bench",          "Test all available SIMD instruction sets and measure their brute force rate"),
 
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD)
@@ -1731,6 +1878,12 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         arg_lit0(NULL, "i5", "AVX512"),
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        arg_lit0(NULL, "ie", "NEON (experimental)"),
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        arg_lit0(NULL, "iv", "SVE 256 bit (experimental)"),
 #endif
         arg_param_end
     };
@@ -1779,18 +1932,54 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     bool tests = arg_get_lit(ctx, 13);
     bool nonce_file_write = arg_get_lit(ctx, 14);
 
-    bool in = arg_get_lit(ctx, 15);
+    int cachedirlen = 0;
+    char cachedir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 15), (uint8_t *)cachedir, FILE_PATH_SIZE, &cachedirlen);
+    bool build_cache = arg_get_lit(ctx, 16);
+    bool resume = arg_get_lit(ctx, 17);
+
+    int exportlen = 0;
+    char export_prefix[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 18), (uint8_t *)export_prefix, FILE_PATH_SIZE, &exportlen);
+    uint32_t shards = arg_get_u32_def(ctx, 19, 16);
+
+    bool bench = arg_get_lit(ctx, 20);
+
+    bool in = arg_get_lit(ctx, 21);
 #if defined(COMPILER_HAS_SIMD)
-    bool im = arg_get_lit(ctx, 16);
-    bool is = arg_get_lit(ctx, 17);
-    bool ia = arg_get_lit(ctx, 18);
-    bool i2 = arg_get_lit(ctx, 19);
+    bool im = arg_get_lit(ctx, 22);
+    bool is = arg_get_lit(ctx, 23);
+    bool ia = arg_get_lit(ctx, 24);
+    bool i2 = arg_get_lit(ctx, 25);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 20);
+    bool i5 = arg_get_lit(ctx, 26);
+#endif
+    // x86 and ARM instruction sets are never compiled together
+#if defined(COMPILER_HAS_SIMD_NEON)
+    bool ie = arg_get_lit(ctx, 22);
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+    bool iv = arg_get_lit(ctx, 23);
 #endif
     CLIParserFree(ctx);
 
+    if (bench) {
+        return hardnested_simd_test();
+    }
+
+    if (build_cache) {
+        if (cachedirlen == 0) {
+            PrintAndLogEx(WARNING, "--build-cache requires --table-cache <dir>");
+            return PM3_EINVARG;
+        }
+        return hardnested_build_table_cache(cachedir);
+    }
+
+    hardnested_set_table_cache(cachedirlen ? cachedir : NULL);
+    hardnested_set_resume(resume);
+    hardnested_set_export(exportlen ? export_prefix : NULL, shards);
+
     // set SIM instructions
     SetSIMDInstr(SIMD_AUTO);
 
@@ -1808,6 +1997,14 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         SetSIMDInstr(SIMD_SSE2);
     if (im)
         SetSIMDInstr(SIMD_MMX);
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+    if (iv)
+        SetSIMDInstr(SIMD_SVE256);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+    if (ie)
+        SetSIMDInstr(SIMD_NEON);
 #endif
     if (in)
         SetSIMDInstr(SIMD_NONE);
@@ -1925,6 +2122,12 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
         arg_lit0(NULL, "i5", "AVX512"),
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        arg_lit0(NULL, "ie", "NEON (experimental)"),
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        arg_lit0(NULL, "iv", "SVE 256 bit (experimental)"),
 #endif
         arg_param_end
     };
@@ -1975,6 +2178,13 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
     bool i5 = arg_get_lit(ctx, 18);
+#endif
+    // x86 and ARM instruction sets are never compiled together
+#if defined(COMPILER_HAS_SIMD_NEON)
+    bool ie = arg_get_lit(ctx, 14);
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+    bool iv = arg_get_lit(ctx, 15);
 #endif
     CLIParserFree(ctx);
 
@@ -2024,6 +2234,14 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
         SetSIMDInstr(SIMD_SSE2);
     if (im)
         SetSIMDInstr(SIMD_MMX);
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+    if (iv)
+        SetSIMDInstr(SIMD_SVE256);
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+    if (ie)
+        SetSIMDInstr(SIMD_NEON);
 #endif
     if (in)
         SetSIMDInstr(SIMD_NONE);
@@ -2032,6 +2250,8 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
     // Nested and Hardnested parameter
     uint64_t key64 = 0;
     bool calibrate = true;
+    // recovery tables of every CPU, created by the first nested attack and shared by all sectors
+    crapto1_arena_t *arena = NULL;
     // Attack key storage variables
     uint8_t *keyBlock = NULL;
     uint32_t key_cnt = 0;
@@ -2458,17 +2678,22 @@ skipReadBKey:
                                           (current_key_type_i == MF_KEY_B) ? 'B' : 'A');
                         }
 tryNested:
-                        isOK = mfnested(FirstBlockOfSector(sectorno), keytype, key, FirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key, calibrate);
+                        if (arena == NULL) {
+                            arena = crapto1_arena_create(0);
+                        }
+                        isOK = mfnested(FirstBlockOfSector(sectorno), keytype, key, FirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key, calibrate, arena);
 
                         switch (isOK) {
                             case PM3_ETIMEOUT: {
                                 PrintAndLogEx(ERR, "\nError: No response from Proxmark3.");
+                                crapto1_arena_destroy(arena);
                                 free(e_sector);
                                 free(fptr);
                                 return PM3_ESOFT;
                             }
                             case PM3_EOPABORTED: {
                                 PrintAndLogEx(WARNING, "\nButton pressed. Aborted.");
+                                crapto1_arena_destroy(arena);
                                 free(e_sector);
                                 free(fptr);
                                 return PM3_EOPABORTED;
@@ -2500,6 +2725,7 @@ tryNested:
                             }
                             default: {
                                 PrintAndLogEx(ERR, "unknown Error.\n");
+                                crapto1_arena_destroy(arena);
                                 free(e_sector);
                                 free(fptr);
                                 return PM3_ESOFT;
@@ -2532,6 +2758,7 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                                     break;
                                 }
                             }
+                            crapto1_arena_destroy(arena);
                             free(e_sector);
                             free(fptr);
                             return PM3_ESOFT;
@@ -2552,17 +2779,22 @@ tryStaticnested:
                                           (current_key_type_i == MF_KEY_B) ? 'B' : 'A');
                         }
 
-                        isOK = mfStaticNested(sectorno, keytype, key, FirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key);
+                        if (arena == NULL) {
+                            arena = crapto1_arena_create(0);
+                        }
+                        isOK = mfStaticNested(sectorno, keytype, key, FirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key, arena);
                         DropField();
                         switch (isOK) {
                             case PM3_ETIMEOUT: {
                                 PrintAndLogEx(ERR, "\nError: No response from Proxmark3");
+                                crapto1_arena_destroy(arena);
                                 free(e_sector);
                                 free(fptr);
                                 return PM3_ESOFT;
                             }
                             case PM3_EOPABORTED: {
                                 PrintAndLogEx(WARNING, "\nButton pressed, user aborted");
+                                crapto1_arena_destroy(arena);
                                 free(e_sector);
                                 free(fptr);
                                 return PM3_EOPABORTED;
@@ -2592,6 +2824,7 @@ tryStaticnested:
     }
 
 all_found:
+    crapto1_arena_destroy(arena);
 
     // Show the results to the user
     PrintAndLogEx(NORMAL, "");
@@ -2671,6 +2904,72 @@ all_found:
     return PM3_SUCCESS;
 }
 
+// hf mf fchk --shard: the dictionary is split in slices across the connected devices
+typedef struct {
+    uint8_t sectorsCnt;
+    uint8_t *keyBlock;
+    uint32_t keycnt;
+    sector_t *e_sector[PM3_MAX_DEVICES]; // found keys, per device
+    bool stop;                           // atomic, a device found all keys or the user aborted
+} mf_chk_fast_shard_t;
+
+// checks slice n of count of the dictionary, the keys found go to e_sector[n]
+static int mf_chk_fast_shard(pm3_device_t *dev, int n, int count, void *ctx) {
+    (void) dev;
+    mf_chk_fast_shard_t *shard = (mf_chk_fast_shard_t *)ctx;
+    uint32_t first = (uint64_t)shard->keycnt * n / count;
+    uint32_t keycnt = (uint64_t)shard->keycnt * (n + 1) / count - first;
+    uint8_t *keyBlock = shard->keyBlock + first * 6;
+
+    if (keycnt == 0) {
+        return PM3_SUCCESS;
+    }
+
+    uint32_t chunksize = keycnt > (PM3_CMD_DATA_SIZE / 6) ? (PM3_CMD_DATA_SIZE / 6) : keycnt;
+    bool firstChunk = true, lastChunk = false;
+
+    // strategys. 1= deep first on sector 0 AB,  2= width first on all sectors
+    for (uint8_t strategy = 1; strategy < 3; strategy++) {
+        PrintAndLogEx(INFO, "Running strategy %u", strategy);
+
+        // main keychunk loop
+        for (uint32_t i = 0; i < keycnt; i += chunksize) {
+
+            // the keyboard is only watched by the console thread
+            if ((n == 0) && kbd_enter_pressed()) {
+                PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+                __atomic_store_n(&shard->stop, true, __ATOMIC_SEQ_CST);
+            }
+            if (__atomic_load_n(&shard->stop, __ATOMIC_SEQ_CST)) {
+                return PM3_EOPABORTED;
+            }
+
+            uint32_t size = ((keycnt - i)  > chunksize) ? chunksize : keycnt - i;
+
+            // last chunk?
+            if (size == keycnt - i)
+                lastChunk = true;
+
+            int res = mfCheckKeys_fast(shard->sectorsCnt, firstChunk, lastChunk, strategy, size, keyBlock + (i * 6), shard->e_sector[n], false);
+
+            if (firstChunk)
+                firstChunk = false;
+
+            // all keys,  aborted
+            if (res == PM3_SUCCESS) {
+                __atomic_store_n(&shard->stop, true, __ATOMIC_SEQ_CST);
+                return PM3_SUCCESS;
+            }
+            if (res == 2 || res == PM3_ETIMEOUT) {
+                return PM3_ETIMEOUT;
+            }
+        } // end chunks of keys
+        firstChunk = true;
+        lastChunk = false;
+    } // end strategy
+    return PM3_SUCCESS;
+}
+
 static int CmdHF14AMfChk_fast(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mf fchk",
@@ -2682,7 +2981,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
                   "hf mf fchk --1k -f mfc_default_keys.dic        --> Target 1K using default dictionary file\n"
                   "hf mf fchk --1k --emu                          --> Target 1K, write keys to emulator memory\n"
                   "hf mf fchk --1k --dump                         --> Target 1K, write keys to file\n"
-                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory");
+                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory\n"
+                  "hf mf fchk --1k -f mfc_default_keys --shard    --> Target 1K, split the dictionary across all devices");
 
     void *argtable[] = {
         arg_param_begin,
@@ -2695,6 +2995,7 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
         arg_lit0(NULL, "dump", "Dump found keys to binary file"),
         arg_lit0(NULL, "mem", "Use dictionary from flashmemory"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_lit0(NULL, "shard", "Split the dictionary across all connected devices, each with a copy of the card"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -2715,11 +3016,17 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 9), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool shard = arg_get_lit(ctx, 10);
 
     CLIParserFree(ctx);
 
     //validations
 
+    if (shard && use_flashmemory) {
+        PrintAndLogEx(WARNING, "Dictionary in flash memory can't be split across devices");
+        return PM3_EINVARG;
+    }
+
     if ((m0 + m1 + m2 + m4) > 1) {
         PrintAndLogEx(WARNING, "Only specify one MIFARE Type");
         return PM3_EINVARG;
@@ -2846,9 +3153,6 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     }
 
 
-    uint32_t chunksize = keycnt > (PM3_CMD_DATA_SIZE / 6) ? (PM3_CMD_DATA_SIZE / 6) : keycnt;
-    bool firstChunk = true, lastChunk = false;
-
     int i = 0;
     // time
     uint64_t t1 = msclock();
@@ -2856,40 +3160,50 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     if (use_flashmemory) {
         PrintAndLogEx(SUCCESS, "Using dictionary in flash memory");
         mfCheckKeys_fast(sectorsCnt, true, true, 1, 0, keyBlock, e_sector, use_flashmemory);
-    } else {
-
-        // strategys. 1= deep first on sector 0 AB,  2= width first on all sectors
-        for (uint8_t strategy = 1; strategy < 3; strategy++) {
-            PrintAndLogEx(INFO, "Running strategy %u", strategy);
-
-            // main keychunk loop
-            for (i = 0; i < keycnt; i += chunksize) {
-
-                if (kbd_enter_pressed()) {
-                    PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
-                    goto out;
+    } else if (shard && (CountProxmarks() > 1)) {
+        mf_chk_fast_shard_t chk = {
+            .sectorsCnt = sectorsCnt,
+            .keyBlock = keyBlock,
+            .keycnt = keycnt,
+            .stop = false,
+        };
+        for (i = 0; i < PM3_MAX_DEVICES; i++) {
+            if (initSectorTable(&chk.e_sector[i], sectorsCnt) != sectorsCnt) {
+                for (int j = 0; j < i; j++) {
+                    free(chk.e_sector[j]);
                 }
+                free(keyBlock);
+                free(e_sector);
+                return PM3_EMALLOC;
+            }
+        }
 
-                uint32_t size = ((keycnt - i)  > chunksize) ? chunksize : keycnt - i;
-
-                // last chunk?
-                if (size == keycnt - i)
-                    lastChunk = true;
-
-                res = mfCheckKeys_fast(sectorsCnt, firstChunk, lastChunk, strategy, size, keyBlock + (i * 6), e_sector, false);
+        PrintAndLogEx(INFO, "Splitting " _YELLOW_("%d") " keys across " _YELLOW_("%d") " devices", keycnt, CountProxmarks());
+        RunOnProxmarks(mf_chk_fast_shard, &chk);
 
-                if (firstChunk)
-                    firstChunk = false;
-
-                // all keys,  aborted
-                if (res == PM3_SUCCESS || res == 2)
-                    goto out;
-            } // end chunks of keys
-            firstChunk = true;
-            lastChunk = false;
-        } // end strategy
+        // keep the keys found by any device
+        for (int d = 0; d < PM3_MAX_DEVICES; d++) {
+            for (i = 0; i < sectorsCnt; i++) {
+                for (int k = 0; k < 2; k++) {
+                    if ((e_sector[i].foundKey[k] == 0) && chk.e_sector[d][i].foundKey[k]) {
+                        e_sector[i].foundKey[k] = chk.e_sector[d][i].foundKey[k];
+                        e_sector[i].Key[k] = chk.e_sector[d][i].Key[k];
+                    }
+                }
+            }
+            free(chk.e_sector[d]);
+        }
+    } else {
+        mf_chk_fast_shard_t chk = {
+            .sectorsCnt = sectorsCnt,
+            .keyBlock = keyBlock,
+            .keycnt = keycnt,
+            .e_sector = { e_sector },
+            .stop = false,
+        };
+        mf_chk_fast_shard(g_session.current_device, 0, 1, &chk);
     }
-out:
+
     t1 = msclock() - t1;
     PrintAndLogEx(INFO, "time in checkkeys (fast) " _YELLOW_("%.1fs") "\n", (float)(t1 / 1000.0));
 
@@ -3799,6 +4113,7 @@ int CmdHF14AMfELoad(const char *Cmd) {
                   "Load emulator memory with data from (bin/eml/json) dump file",
                   "hf mf eload -f hf-mf-01020304.bin\n"
                   "hf mf eload --4k -f hf-mf-01020304.eml\n"
+                  "hf mf eload --verify -f hf-mf-01020304.bin   -> check the upload\n"
                  );
     void *argtable[] = {
         arg_param_begin,
@@ -3809,6 +4124,7 @@ int CmdHF14AMfELoad(const char *Cmd) {
         arg_lit0(NULL, "4k", "MIFARE Classic 4k / S70"),
         arg_lit0(NULL, "ul", "MIFARE Ultralight family"),
         arg_int0("q", "qty", "<dec>", "manually set number of blocks (overrides)"),
+        arg_lit0(NULL, "verify", "read back emulator memory and check its CRC"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -3824,6 +4140,7 @@ int CmdHF14AMfELoad(const char *Cmd) {
     bool mu = arg_get_lit(ctx, 6);
 
     int numblks = arg_get_int_def(ctx, 7, -1);
+    bool verify = arg_get_lit(ctx, 8);
 
     CLIParserFree(ctx);
 
@@ -3922,32 +4239,24 @@ int CmdHF14AMfELoad(const char *Cmd) {
     PrintAndLogEx(INFO, "Uploading to emulator memory");
     PrintAndLogEx(INFO, "." NOLF);
 
-    // fast push mode
-    g_conn.block_after_ACK = true;
-
-    size_t offset = 0;
-    int cnt = 0;
-
-    while (datalen && cnt < block_cnt) {
-        if (datalen == block_width) {
-            // Disable fast mode on last packet
-            g_conn.block_after_ACK = false;
-        }
+    int cnt = MIN(block_cnt, (int)(datalen / block_width));
+    if (mfEmlSetMemBulk(data, 0, cnt, block_width) != PM3_SUCCESS) {
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(FAILED, "Can't set emulator memory");
+        free(data);
+        return PM3_ESOFT;
+    }
+    PrintAndLogEx(NORMAL, "");
 
-        if (mfEmlSetMem_xt(data + offset, cnt, 1, block_width) != PM3_SUCCESS) {
-            PrintAndLogEx(FAILED, "Can't set emulator mem at block: %3d", cnt);
+    if (verify) {
+        if (mfEmlVerifyMem(data, 0, cnt, block_width) != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "Verify emulator memory ( " _RED_("fail") " )");
             free(data);
             return PM3_ESOFT;
         }
-        PrintAndLogEx(NORMAL, "." NOLF);
-        fflush(stdout);
-
-        cnt++;
-        offset += block_width;
-        datalen -= block_width;
+        PrintAndLogEx(SUCCESS, "Verify emulator memory ( " _GREEN_("ok") " )");
     }
     free(data);
-    PrintAndLogEx(NORMAL, "");
 
     if (block_width == 4) {
         PrintAndLogEx(HINT, "You are ready to simulate. See " _YELLOW_("`hf mfu sim -h`"));
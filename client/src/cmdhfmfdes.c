@@ -820,6 +820,77 @@ static void DesFill2bPattern(
     (*startPattern)++;
 }
 
+// Checks keyList[0..keyListLen-1] (keyLen bytes each) on key number keyno of the selected application.
+// With EV1 and no KDF, firmware that has it runs the authentications back to back, chunk by chunk,
+// otherwise the client authenticates key by key.
+// returns PM3_SUCCESS and the index of the key in *foundIdx, PM3_ESOFT if no key matches,
+// PM3_EWRONGANSWER if the card rejects the key number / type, PM3_EOPABORTED if aborted,
+// PM3_ETIMEOUT if the device doesn't answer
+static int DesfireCheckKeyList(DesfireContext_t *dctx, DesfireSecureChannel secureChannel, uint8_t keyno, DesfireCryptoAlgorithm keyType,
+                               uint8_t *keyList, size_t keyLen, uint32_t keyListLen, uint32_t *foundIdx) {
+
+    bool on_device = (g_pm3_capabilities.device_cmds & DEVICE_CMD_DESFIRE_CHKKEYS);
+    if ((on_device == false) || (secureChannel != DACEV1) || (dctx->cmdSet != DCCNativeISO) || (dctx->kdfAlgo != MFDES_KDF_ALGO_NONE)) {
+        for (uint32_t curkey = 0; curkey < keyListLen; curkey++) {
+            DesfireSetKeyNoClear(dctx, keyno, keyType, keyList + curkey * keyLen);
+            int res = DesfireAuthenticate(dctx, secureChannel, false);
+            if (res == PM3_SUCCESS) {
+                *foundIdx = curkey;
+                return PM3_SUCCESS;
+            } else if (res < 7) {
+                return PM3_EWRONGANSWER;
+            }
+        }
+        return PM3_ESOFT;
+    }
+
+    struct {
+        uint8_t keytype;
+        uint8_t keyno;
+        uint8_t keycount;
+        uint8_t keys[PM3_CMD_DATA_SIZE - 3];
+    } PACKED payload;
+
+    struct {
+        uint8_t tried;
+        uint8_t found;
+    } PACKED *rpayload;
+
+    uint32_t chunk = MIN(sizeof(payload.keys) / keyLen, UINT8_MAX);
+    uint32_t curkey = 0;
+    while (curkey < keyListLen) {
+        if (kbd_enter_pressed()) {
+            return PM3_EOPABORTED;
+        }
+
+        payload.keytype = keyType;
+        payload.keyno = keyno;
+        payload.keycount = MIN(chunk, keyListLen - curkey);
+        memcpy(payload.keys, keyList + curkey * keyLen, payload.keycount * keyLen);
+
+        PacketResponseNG resp;
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_DESFIRE_CHKKEYS, (uint8_t *)&payload, 3 + payload.keycount * keyLen);
+        if (WaitForResponseTimeout(CMD_HF_DESFIRE_CHKKEYS, &resp, 2500 + payload.keycount * 100) == false) {
+            PrintAndLogEx(ERR, "command execution time out");
+            return PM3_ETIMEOUT;
+        }
+        if (resp.length < sizeof(*rpayload)) {
+            return PM3_EWRONGANSWER;
+        }
+        rpayload = (void *)resp.data.asBytes;
+
+        if (resp.status == PM3_SUCCESS) {
+            *foundIdx = curkey + rpayload->found;
+            return PM3_SUCCESS;
+        } else if (resp.status != PM3_ESOFT) {
+            return resp.status;
+        }
+        curkey += rpayload->tried;
+    }
+    return PM3_ESOFT;
+}
+
 static int AuthCheckDesfire(DesfireContext_t *dctx,
                             DesfireSecureChannel secureChannel,
                             const uint8_t *aid,
@@ -916,23 +987,22 @@ static int AuthCheckDesfire(DesfireContext_t *dctx,
         for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
 
             if (usedkeys[keyno] == 1 && foundKeys[0][keyno][0] == 0) {
-                for (uint32_t curkey = 0; curkey < deskeyListLen; curkey++) {
-                    DesfireSetKeyNoClear(dctx, keyno, T_DES, deskeyList[curkey]);
-                    res = DesfireAuthenticate(dctx, secureChannel, false);
-                    if (res == PM3_SUCCESS) {
-                        PrintAndLogEx(SUCCESS, "AID 0x%06X, Found DES Key %02u          : " _GREEN_("%s"), curaid, keyno, sprint_hex(deskeyList[curkey], 8));
-                        foundKeys[0][keyno][0] = 0x01;
-                        *result = true;
-                        memcpy(&foundKeys[0][keyno][1], deskeyList[curkey], 8);
-                        break;
-                    } else if (res < 7) {
-                        badlen = true;
-                        DropField();
-                        res = DesfireSelectAIDHex(dctx, curaid, false, 0);
-                        if (res != PM3_SUCCESS) {
-                            return res;
-                        }
-                        break;
+                uint32_t curkey = 0;
+                res = DesfireCheckKeyList(dctx, secureChannel, keyno, T_DES, deskeyList[0], 8, deskeyListLen, &curkey);
+                if (res == PM3_SUCCESS) {
+                    PrintAndLogEx(SUCCESS, "AID 0x%06X, Found DES Key %02u          : " _GREEN_("%s"), curaid, keyno, sprint_hex(deskeyList[curkey], 8));
+                    foundKeys[0][keyno][0] = 0x01;
+                    *result = true;
+                    memcpy(&foundKeys[0][keyno][1], deskeyList[curkey], 8);
+                } else if (res == PM3_EOPABORTED || res == PM3_ETIMEOUT) {
+                    DropField();
+                    return res;
+                } else if (res != PM3_ESOFT) {
+                    badlen = true;
+                    DropField();
+                    res = DesfireSelectAIDHex(dctx, curaid, false, 0);
+                    if (res != PM3_SUCCESS) {
+                        return res;
                     }
                 }
                 if (badlen == true) {
@@ -948,23 +1018,22 @@ static int AuthCheckDesfire(DesfireContext_t *dctx,
         for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
 
             if (usedkeys[keyno] == 1 && foundKeys[1][keyno][0] == 0) {
-                for (uint32_t curkey = 0; curkey < aeskeyListLen; curkey++) {
-                    DesfireSetKeyNoClear(dctx, keyno, T_3DES, aeskeyList[curkey]);
-                    res = DesfireAuthenticate(dctx, secureChannel, false);
-                    if (res == PM3_SUCCESS) {
-                        PrintAndLogEx(SUCCESS, "AID 0x%06X, Found 2TDEA Key %02u        : " _GREEN_("%s"), curaid, keyno, sprint_hex(aeskeyList[curkey], 16));
-                        foundKeys[1][keyno][0] = 0x01;
-                        *result = true;
-                        memcpy(&foundKeys[1][keyno][1], aeskeyList[curkey], 16);
-                        break;
-                    } else if (res < 7) {
-                        badlen = true;
-                        DropField();
-                        res = DesfireSelectAIDHex(dctx, curaid, false, 0);
-                        if (res != PM3_SUCCESS) {
-                            return res;
-                        }
-                        break;
+                uint32_t curkey = 0;
+                res = DesfireCheckKeyList(dctx, secureChannel, keyno, T_3DES, aeskeyList[0], 16, aeskeyListLen, &curkey);
+                if (res == PM3_SUCCESS) {
+                    PrintAndLogEx(SUCCESS, "AID 0x%06X, Found 2TDEA Key %02u        : " _GREEN_("%s"), curaid, keyno, sprint_hex(aeskeyList[curkey], 16));
+                    foundKeys[1][keyno][0] = 0x01;
+                    *result = true;
+                    memcpy(&foundKeys[1][keyno][1], aeskeyList[curkey], 16);
+                } else if (res == PM3_EOPABORTED || res == PM3_ETIMEOUT) {
+                    DropField();
+                    return res;
+                } else if (res != PM3_ESOFT) {
+                    badlen = true;
+                    DropField();
+                    res = DesfireSelectAIDHex(dctx, curaid, false, 0);
+                    if (res != PM3_SUCCESS) {
+                        return res;
                     }
                 }
                 if (badlen == true) {
@@ -980,23 +1049,22 @@ static int AuthCheckDesfire(DesfireContext_t *dctx,
         for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
 
             if (usedkeys[keyno] == 1 && foundKeys[2][keyno][0] == 0) {
-                for (uint32_t curkey = 0; curkey < aeskeyListLen; curkey++) {
-                    DesfireSetKeyNoClear(dctx, keyno, T_AES, aeskeyList[curkey]);
-                    res = DesfireAuthenticate(dctx, secureChannel, false);
-                    if (res == PM3_SUCCESS) {
-                        PrintAndLogEx(SUCCESS, "AID 0x%06X, Found AES Key %02u          : " _GREEN_("%s"), curaid, keyno, sprint_hex(aeskeyList[curkey], 16));
-                        foundKeys[2][keyno][0] = 0x01;
-                        *result = true;
-                        memcpy(&foundKeys[2][keyno][1], aeskeyList[curkey], 16);
-                        break;
-                    } else if (res < 7) {
-                        badlen = true;
-                        DropField();
-                        res = DesfireSelectAIDHex(dctx, curaid, false, 0);
-                        if (res != PM3_SUCCESS) {
-                            return res;
-                        }
-                        break;
+                uint32_t curkey = 0;
+                res = DesfireCheckKeyList(dctx, secureChannel, keyno, T_AES, aeskeyList[0], 16, aeskeyListLen, &curkey);
+                if (res == PM3_SUCCESS) {
+                    PrintAndLogEx(SUCCESS, "AID 0x%06X, Found AES Key %02u          : " _GREEN_("%s"), curaid, keyno, sprint_hex(aeskeyList[curkey], 16));
+                    foundKeys[2][keyno][0] = 0x01;
+                    *result = true;
+                    memcpy(&foundKeys[2][keyno][1], aeskeyList[curkey], 16);
+                } else if (res == PM3_EOPABORTED || res == PM3_ETIMEOUT) {
+                    DropField();
+                    return res;
+                } else if (res != PM3_ESOFT) {
+                    badlen = true;
+                    DropField();
+                    res = DesfireSelectAIDHex(dctx, curaid, false, 0);
+                    if (res != PM3_SUCCESS) {
+                        return res;
                     }
                 }
                 if (badlen == true) {
@@ -1012,23 +1080,22 @@ static int AuthCheckDesfire(DesfireContext_t *dctx,
         for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
 
             if (usedkeys[keyno] == 1 && foundKeys[3][keyno][0] == 0) {
-                for (uint32_t curkey = 0; curkey < k3kkeyListLen; curkey++) {
-                    DesfireSetKeyNoClear(dctx, keyno, T_3K3DES, k3kkeyList[curkey]);
-                    res = DesfireAuthenticate(dctx, secureChannel, false);
-                    if (res == PM3_SUCCESS) {
-                        PrintAndLogEx(SUCCESS, "AID 0x%06X, Found 3TDEA Key %02u        : " _GREEN_("%s"), curaid, keyno, sprint_hex(k3kkeyList[curkey], 24));
-                        foundKeys[3][keyno][0] = 0x01;
-                        *result = true;
-                        memcpy(&foundKeys[3][keyno][1], k3kkeyList[curkey], 16);
-                        break;
-                    } else if (res < 7) {
-                        badlen = true;
-                        DropField();
-                        res = DesfireSelectAIDHex(dctx, curaid, false, 0);
-                        if (res != PM3_SUCCESS) {
-                            return res;
-                        }
-                        break;
+                uint32_t curkey = 0;
+                res = DesfireCheckKeyList(dctx, secureChannel, keyno, T_3K3DES, k3kkeyList[0], 24, k3kkeyListLen, &curkey);
+                if (res == PM3_SUCCESS) {
+                    PrintAndLogEx(SUCCESS, "AID 0x%06X, Found 3TDEA Key %02u        : " _GREEN_("%s"), curaid, keyno, sprint_hex(k3kkeyList[curkey], 24));
+                    foundKeys[3][keyno][0] = 0x01;
+                    *result = true;
+                    memcpy(&foundKeys[3][keyno][1], k3kkeyList[curkey], 16);
+                } else if (res == PM3_EOPABORTED || res == PM3_ETIMEOUT) {
+                    DropField();
+                    return res;
+                } else if (res != PM3_ESOFT) {
+                    badlen = true;
+                    DropField();
+                    res = DesfireSelectAIDHex(dctx, curaid, false, 0);
+                    if (res != PM3_SUCCESS) {
+                        return res;
                     }
                 }
 
@@ -1267,6 +1334,9 @@ static int CmdHF14aDesChk(const char *Cmd) {
         if (res == PM3_EOPABORTED) {
             break;
         }
+        if (res == PM3_ETIMEOUT) {
+            return res;
+        }
 
         if (pattern2b && startPattern < 0x10000) {
             if (verbose == false)
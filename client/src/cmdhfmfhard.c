@@ -31,6 +31,12 @@
 #include <math.h>
 #include <time.h> // MingW
 #include <bzlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "commonutil.h"  // ARRAYLEN
 #include "comms.h"
@@ -44,6 +50,7 @@
 #include "hardnested_bf_core.h"
 #include "hardnested_bitarray_core.h"
 #include "fileutils.h"
+#include "crc32.h"
 
 #define NUM_CHECK_BITFLIPS_THREADS      (num_CPUs())
 #define NUM_REDUCTION_WORKING_THREADS   (num_CPUs())
@@ -53,6 +60,12 @@
 #define STATE_FILES_DIRECTORY           "hardnested_tables/"
 #define STATE_FILE_TEMPLATE             "bitflip_%d_%03" PRIx16 "_states.bin.bz2"
 
+#define BITFLIP_CACHE_FILE              "hardnested_bitflips.cache"
+#define BITFLIP_CACHE_MAGIC             "PM3HNBF"
+#define BITFLIP_CACHE_VERSION           2
+#define BITFLIP_CACHE_ALIGN             4096
+#define BITFLIP_CACHE_NO_ARRAY          0xFFFFFFFF
+
 #define DEBUG_KEY_ELIMINATION
 // #define DEBUG_REDUCTION
 
@@ -81,8 +94,8 @@ static uint64_t known_target_key;
 static uint32_t test_state[2] = {0, 0};
 static float brute_force_per_second;
 
-static void get_SIMD_instruction_set(char *instruction_set) {
-    switch (GetSIMDInstrAuto()) {
+static void get_SIMD_instruction_set(SIMDExecInstr instr, char *instruction_set) {
+    switch (instr) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
         case SIMD_AVX512:
             strcpy(instruction_set, "AVX512F");
@@ -101,6 +114,16 @@ static void get_SIMD_instruction_set(char *instruction_set) {
         case SIMD_MMX:
             strcpy(instruction_set, "MMX");
             break;
+#endif
+#if defined(COMPILER_HAS_SIMD_SVE)
+        case SIMD_SVE256:
+            strcpy(instruction_set, "SVE256");
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            strcpy(instruction_set, "NEON");
+            break;
 #endif
         case SIMD_AUTO:
         case SIMD_NONE:
@@ -112,7 +135,7 @@ static void get_SIMD_instruction_set(char *instruction_set) {
 static void print_progress_header(void) {
     char progress_text[80];
     char instr_set[12] = "";
-    get_SIMD_instruction_set(instr_set);
+    get_SIMD_instruction_set(GetSIMDInstrAuto(), instr_set);
     sprintf(progress_text, "Start using " _YELLOW_("%d") " threads and " _YELLOW_("%s") " SIMD core", num_CPUs(), instr_set);
 
     PrintAndLogEx(INFO, "Hardnested attack starting...");
@@ -242,7 +265,7 @@ static void init_bunzip2(bz_stream *compressed_stream, char *input_buffer, uint3
 
 }
 
-static void init_bitflip_bitarrays(void) {
+static void decompress_bitflip_bitarrays(void) {
 #if defined (DEBUG_REDUCTION)
     uint8_t line = 0;
 #endif
@@ -330,6 +353,316 @@ static void init_bitflip_bitarrays(void) {
         }
         effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
     }
+}
+
+static void free_bitflip_bitarrays(void);
+
+//----------------------------------------------------------------------------
+// Pre-expanded bitflip table cache.
+// All bitarrays which survive IGNORE_BITFLIP_THRESHOLD are written uncompressed
+// into one flat file, page aligned. Later runs map it read only, so there is no
+// bunzip2 at startup and the pages are shared between concurrent processes.
+//----------------------------------------------------------------------------
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t bitarray_size;                     // bytes per bitarray
+    uint32_t num_bitarrays;
+    uint32_t data_offset;                       // first bitarray,  BITFLIP_CACHE_ALIGN aligned
+    uint8_t index_crc[4];                       // crc32 over the index below
+    uint8_t data_crc[4];                        // crc32 over the bitarray crc32s in the index
+} PACKED bitflip_cache_hdr_t;
+
+typedef struct {
+    uint32_t count[2][0x400];
+    uint32_t slot[2][0x400];                    // bitarray number or BITFLIP_CACHE_NO_ARRAY
+    uint8_t array_crc[2 * 0x400][4];            // crc32 of each bitarray,  by bitarray number
+} PACKED bitflip_cache_index_t;
+
+#define BITFLIP_BITARRAY_SIZE   (sizeof(uint32_t) * (1 << 19))
+
+static bool hardnested_resume = false;
+
+void hardnested_set_resume(bool resume) {
+    hardnested_resume = resume;
+}
+
+static char hardnested_export_prefix[FILE_PATH_SIZE] = {0};
+static uint32_t hardnested_export_shards = 0;
+
+void hardnested_set_export(const char *prefix, uint32_t num_shards) {
+    memset(hardnested_export_prefix, 0, sizeof(hardnested_export_prefix));
+    if (prefix != NULL) {
+        strncpy(hardnested_export_prefix, prefix, sizeof(hardnested_export_prefix) - 1);
+    }
+    hardnested_export_shards = num_shards;
+}
+
+static char *bitflip_cache_dir = NULL;
+static void *bitflip_cache_map = NULL;
+static size_t bitflip_cache_map_len = 0;
+
+void hardnested_set_table_cache(const char *dir) {
+    free(bitflip_cache_dir);
+    bitflip_cache_dir = NULL;
+    if (dir != NULL && strlen(dir) > 0) {
+        bitflip_cache_dir = strdup(dir);
+    }
+}
+
+static char *bitflip_cache_path(const char *dir) {
+    size_t len = strlen(dir) + 1 + strlen(BITFLIP_CACHE_FILE) + 1;
+    char *path = calloc(len, sizeof(char));
+    if (path == NULL) {
+        return NULL;
+    }
+    snprintf(path, len, "%s%s%s", dir, (dir[strlen(dir) - 1] == PATHSEP[0]) ? "" : PATHSEP, BITFLIP_CACHE_FILE);
+    return path;
+}
+
+#ifndef _WIN32
+typedef struct {
+    const bitflip_cache_hdr_t *hdr;
+    const bitflip_cache_index_t *idx;
+    uint32_t first;
+    uint32_t step;
+    bool ok;
+} bitflip_cache_verify_args_t;
+
+static void *verify_bitflip_cache_thread(void *arg) {
+    bitflip_cache_verify_args_t *a = (bitflip_cache_verify_args_t *)arg;
+    const uint8_t *data = (const uint8_t *)a->hdr + a->hdr->data_offset;
+    for (uint32_t slot = a->first; a->ok && slot < a->hdr->num_bitarrays; slot += a->step) {
+        uint8_t crc[4] = {0};
+        crc32_ex(data + (size_t)slot * a->hdr->bitarray_size, a->hdr->bitarray_size, crc);
+        a->ok = (memcmp(crc, a->idx->array_crc[slot], sizeof(crc)) == 0);
+    }
+    return NULL;
+}
+
+// checks every mapped bitarray against its crc32, spread over all CPUs
+static bool verify_bitflip_cache_arrays(const bitflip_cache_hdr_t *hdr, const bitflip_cache_index_t *idx) {
+    uint32_t num_threads = num_CPUs();
+    pthread_t thread_id[num_threads];
+    bitflip_cache_verify_args_t args[num_threads];
+
+    for (uint32_t i = 0; i < num_threads; i++) {
+        args[i].hdr = hdr;
+        args[i].idx = idx;
+        args[i].first = i;
+        args[i].step = num_threads;
+        args[i].ok = true;
+        pthread_create(&thread_id[i], NULL, verify_bitflip_cache_thread, &args[i]);
+    }
+
+    bool ok = true;
+    for (uint32_t i = 0; i < num_threads; i++) {
+        pthread_join(thread_id[i], NULL);
+        ok = ok && args[i].ok;
+    }
+    return ok;
+}
+
+// only the header and index are checked on load, the full per table crc32 pass reads every page
+// of the mapping and is done once by --build-cache on the file it has just written
+static int load_bitflip_cache(const char *dir, bool verify_arrays) {
+
+    char *path = bitflip_cache_path(dir);
+    if (path == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PrintAndLogEx(WARNING, "No bitflip table cache at " _YELLOW_("%s"), path);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(sizeof(bitflip_cache_hdr_t) + sizeof(bitflip_cache_index_t))) {
+        PrintAndLogEx(WARNING, "Bitflip table cache " _YELLOW_("%s") " is truncated", path);
+        close(fd);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        PrintAndLogEx(WARNING, "Failed to map bitflip table cache " _YELLOW_("%s"), path);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    const bitflip_cache_hdr_t *hdr = (const bitflip_cache_hdr_t *)map;
+    const bitflip_cache_index_t *idx = (const bitflip_cache_index_t *)((const uint8_t *)map + sizeof(bitflip_cache_hdr_t));
+
+    uint8_t crc[4] = {0};
+    crc32_ex((const uint8_t *)idx, sizeof(bitflip_cache_index_t), crc);
+
+    uint8_t data_crc[4] = {0};
+    if (hdr->num_bitarrays <= ARRAYLEN(idx->array_crc)) {
+        crc32_ex((const uint8_t *)idx->array_crc, hdr->num_bitarrays * 4, data_crc);
+    }
+
+    if (memcmp(hdr->magic, BITFLIP_CACHE_MAGIC, sizeof(BITFLIP_CACHE_MAGIC)) != 0
+            || hdr->version != BITFLIP_CACHE_VERSION
+            || hdr->bitarray_size != BITFLIP_BITARRAY_SIZE
+            || hdr->num_bitarrays > ARRAYLEN(idx->array_crc)
+            || (hdr->data_offset % BITFLIP_CACHE_ALIGN) != 0
+            || (uint64_t)hdr->data_offset + (uint64_t)hdr->num_bitarrays * hdr->bitarray_size > (uint64_t)st.st_size
+            || memcmp(crc, hdr->index_crc, sizeof(crc)) != 0
+            || memcmp(data_crc, hdr->data_crc, sizeof(data_crc)) != 0
+            || (verify_arrays && verify_bitflip_cache_arrays(hdr, idx) == false)) {
+        PrintAndLogEx(WARNING, "Bitflip table cache " _YELLOW_("%s") " is invalid or from another version, rebuild it with `" _YELLOW_("hf mf hardnested --build-cache") "`", path);
+        munmap(map, st.st_size);
+        free(path);
+        return PM3_EFILE;
+    }
+
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        num_effective_bitflips[odd_even] = 0;
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            count_bitflip_bitarrays[odd_even][bitflip] = idx->count[odd_even][bitflip];
+            uint32_t slot = idx->slot[odd_even][bitflip];
+            if (slot == BITFLIP_CACHE_NO_ARRAY || slot >= hdr->num_bitarrays) {
+                bitflip_bitarrays[odd_even][bitflip] = NULL;
+                continue;
+            }
+            bitflip_bitarrays[odd_even][bitflip] = (uint32_t *)((uint8_t *)map + hdr->data_offset + (size_t)slot * hdr->bitarray_size);
+            effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = bitflip;
+        }
+        effective_bitflip[odd_even][num_effective_bitflips[odd_even]] = 0x400; // EndOfList marker
+    }
+
+    bitflip_cache_map = map;
+    bitflip_cache_map_len = st.st_size;
+    free(path);
+    return PM3_SUCCESS;
+}
+#endif
+
+int hardnested_build_table_cache(const char *dir) {
+#ifdef _WIN32
+    PrintAndLogEx(WARNING, "Bitflip table cache is not supported on this platform");
+    return PM3_ENOTIMPL;
+#else
+    if (dir == NULL || strlen(dir) == 0) {
+        return PM3_EINVARG;
+    }
+
+    char *path = bitflip_cache_path(dir);
+    if (path == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    PrintAndLogEx(INFO, "Expanding bitflip tables...");
+    decompress_bitflip_bitarrays();
+
+    bitflip_cache_index_t *idx = calloc(1, sizeof(bitflip_cache_index_t));
+    if (idx == NULL) {
+        free(path);
+        free_bitflip_bitarrays();
+        return PM3_EMALLOC;
+    }
+
+    bitflip_cache_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BITFLIP_CACHE_MAGIC, sizeof(BITFLIP_CACHE_MAGIC));
+    hdr.version = BITFLIP_CACHE_VERSION;
+    hdr.bitarray_size = BITFLIP_BITARRAY_SIZE;
+    hdr.data_offset = ((sizeof(hdr) + sizeof(bitflip_cache_index_t) + BITFLIP_CACHE_ALIGN - 1) / BITFLIP_CACHE_ALIGN) * BITFLIP_CACHE_ALIGN;
+
+    // crc32 per bitarray, then one crc32 over all of them
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t bitflip = 0x000; bitflip < 0x400; bitflip++) {
+            idx->count[odd_even][bitflip] = count_bitflip_bitarrays[odd_even][bitflip];
+            idx->slot[odd_even][bitflip] = BITFLIP_CACHE_NO_ARRAY;
+            if (bitflip == 0x000 || bitflip_bitarrays[odd_even][bitflip] == NULL) {
+                continue;
+            }
+            crc32_ex((uint8_t *)bitflip_bitarrays[odd_even][bitflip], BITFLIP_BITARRAY_SIZE, idx->array_crc[hdr.num_bitarrays]);
+            idx->slot[odd_even][bitflip] = hdr.num_bitarrays++;
+        }
+    }
+    crc32_ex((uint8_t *)idx->array_crc, hdr.num_bitarrays * 4, hdr.data_crc);
+    crc32_ex((uint8_t *)idx, sizeof(bitflip_cache_index_t), hdr.index_crc);
+
+    // write to a temp file and rename,  so running processes never map a half written cache
+    size_t tmplen = strlen(path) + 5;
+    char *tmppath = calloc(tmplen, sizeof(char));
+    if (tmppath == NULL) {
+        free(idx);
+        free(path);
+        free_bitflip_bitarrays();
+        return PM3_EMALLOC;
+    }
+    snprintf(tmppath, tmplen, "%s.tmp", path);
+
+    int res = PM3_SUCCESS;
+    FILE *f = fopen(tmppath, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(ERR, "Could not create " _YELLOW_("%s"), tmppath);
+        res = PM3_EFILE;
+    } else {
+        uint8_t pad[BITFLIP_CACHE_ALIGN] = {0};
+        size_t head = sizeof(hdr) + sizeof(bitflip_cache_index_t);
+        bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+        ok = ok && (fwrite(idx, sizeof(bitflip_cache_index_t), 1, f) == 1);
+        ok = ok && (fwrite(pad, 1, hdr.data_offset - head, f) == hdr.data_offset - head);
+
+        for (odd_even_t odd_even = EVEN_STATE; ok && odd_even <= ODD_STATE; odd_even++) {
+            for (uint16_t bitflip = 0x001; ok && bitflip < 0x400; bitflip++) {
+                if (idx->slot[odd_even][bitflip] != BITFLIP_CACHE_NO_ARRAY) {
+                    ok = (fwrite(bitflip_bitarrays[odd_even][bitflip], BITFLIP_BITARRAY_SIZE, 1, f) == 1);
+                }
+            }
+        }
+        ok = (fclose(f) == 0) && ok;
+
+        if (ok == false || rename(tmppath, path) != 0) {
+            PrintAndLogEx(ERR, "Failed to write " _YELLOW_("%s"), path);
+            remove(tmppath);
+            res = PM3_EFILE;
+        } else {
+            PrintAndLogEx(SUCCESS, "Wrote " _YELLOW_("%u") " bitflip tables ( " _YELLOW_("%" PRIu64) " MB ) to " _YELLOW_("%s"),
+                          hdr.num_bitarrays,
+                          ((uint64_t)hdr.data_offset + (uint64_t)hdr.num_bitarrays * BITFLIP_BITARRAY_SIZE) >> 20,
+                          path
+                         );
+        }
+    }
+
+    free(tmppath);
+    free(idx);
+    free(path);
+    free_bitflip_bitarrays();
+
+    // read back what landed on disk and check every table against its crc32
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(INFO, "Verifying bitflip table cache...");
+        res = load_bitflip_cache(dir, true);
+        free_bitflip_bitarrays();
+        if (res == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "Bitflip table cache verified");
+        }
+    }
+    return res;
+#endif
+}
+
+static void init_bitflip_bitarrays(void) {
+
+    bool cached = false;
+#ifndef _WIN32
+    if (bitflip_cache_dir != NULL) {
+        cached = (load_bitflip_cache(bitflip_cache_dir, false) == PM3_SUCCESS);
+    }
+#endif
+    if (cached == false) {
+        decompress_bitflip_bitarrays();
+    }
 
     uint16_t i = 0;
     uint16_t j = 0;
@@ -371,11 +704,22 @@ static void init_bitflip_bitarrays(void) {
 }
 
 static void free_bitflip_bitarrays(void) {
+#ifndef _WIN32
+    if (bitflip_cache_map != NULL) {
+        munmap(bitflip_cache_map, bitflip_cache_map_len);
+        bitflip_cache_map = NULL;
+        bitflip_cache_map_len = 0;
+        memset(bitflip_bitarrays, 0, sizeof(bitflip_bitarrays));
+        return;
+    }
+#endif
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
         free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
+        bitflip_bitarrays[ODD_STATE][bitflip] = NULL;
     }
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
         free_bitarray(bitflip_bitarrays[EVEN_STATE][bitflip]);
+        bitflip_bitarrays[EVEN_STATE][bitflip] = NULL;
     }
 }
 
@@ -2074,18 +2418,18 @@ static void free_candidates_memory(statelist_t *sl) {
     free(sl);
 }
 
-static void pre_XOR_nonces(void) {
+static void pre_XOR_nonces(noncelist_t *nonce_list, uint32_t xor_cuid) {
     // prepare acquired nonces for faster brute forcing.
 
     // XOR the cryptoUID and its parity
     for (uint16_t i = 0; i < 256; i++) {
-        noncelistentry_t *test_nonce = nonces[i].first;
+        noncelistentry_t *test_nonce = nonce_list[i].first;
         while (test_nonce != NULL) {
-            test_nonce->nonce_enc ^= cuid;
-            test_nonce->par_enc ^= oddparity8(cuid >>  0 & 0xff) << 0;
-            test_nonce->par_enc ^= oddparity8(cuid >>  8 & 0xff) << 1;
-            test_nonce->par_enc ^= oddparity8(cuid >> 16 & 0xff) << 2;
-            test_nonce->par_enc ^= oddparity8(cuid >> 24 & 0xff) << 3;
+            test_nonce->nonce_enc ^= xor_cuid;
+            test_nonce->par_enc ^= oddparity8(xor_cuid >>  0 & 0xff) << 0;
+            test_nonce->par_enc ^= oddparity8(xor_cuid >>  8 & 0xff) << 1;
+            test_nonce->par_enc ^= oddparity8(xor_cuid >> 16 & 0xff) << 2;
+            test_nonce->par_enc ^= oddparity8(xor_cuid >> 24 & 0xff) << 3;
             test_nonce = test_nonce->next;
         }
     }
@@ -2201,11 +2545,252 @@ static void init_it_all(void) {
     memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SIMD self test and benchmark. Every compiled (and supported) instruction set must produce the same
+// results as the plain C implementation. The brute force rate is measured with hardnested_bf_bench_data.bin
+
+#define SIMD_TEST_KEY         0xa0a1a2a3a4a5
+#define SIMD_TEST_CUID        0xdeadbeef
+#define SIMD_TEST_NONCES      4096
+#define SIMD_TEST_STATES      2048
+#define SIMD_TEST_KERNELS     13
+
+static const char *simd_test_kernel_names[SIMD_TEST_KERNELS] = {
+    "count_states", "bitarray_AND", "bitarray_low20_AND", "count_bitarray_AND", "count_bitarray_low20_AND",
+    "bitarray_AND4", "bitarray_OR", "count_bitarray_AND2", "count_bitarray_AND3", "count_bitarray_AND4",
+    "count_states (sparse)", "count_bitarray_AND2 (sparse)", "crack_states_bitsliced"
+};
+
+static uint32_t simd_test_random(uint32_t *seed) {
+    // xorshift32
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+static void simd_test_fill(uint32_t *bitarray, uint32_t seed, bool sparse) {
+    // sparse bitarrays have lots of zero halfwords, which is what the low20 functions are looking for
+    for (uint32_t i = 0; i < (1 << 19); i++) {
+        uint32_t r = simd_test_random(&seed);
+        if (sparse) {
+            if ((r & 0x03) == 0) r &= 0xffff0000;
+            if ((r & 0x0c) == 0) r &= 0x0000ffff;
+        }
+        bitarray[i] = r;
+    }
+}
+
+static uint32_t simd_test_digest(const uint32_t *bitarray, uint32_t count) {
+    // FNV-1a over the resulting bitarray and the returned count
+    uint32_t hash = 0x811c9dc5 ^ count;
+    for (uint32_t i = 0; i < (1 << 19); i++) {
+        hash = (hash ^ bitarray[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static void simd_test_bitarrays(uint32_t *results) {
+    uint32_t *A = malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+    uint32_t *B = malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+    uint32_t *C = malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+    uint32_t *D = malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+    if (A == NULL || B == NULL || C == NULL || D == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in simd_test_bitarrays(). Aborting...\n");
+        exit(4);
+    }
+
+    uint8_t k = 0;
+    simd_test_fill(A, 1, false);
+    simd_test_fill(B, 2, true);
+    simd_test_fill(C, 3, false);
+    simd_test_fill(D, 4, false);
+    results[k++] = simd_test_digest(A, count_states(A));
+    bitarray_AND(A, C);
+    results[k++] = simd_test_digest(A, 0);
+    bitarray_low20_AND(A, B);
+    results[k++] = simd_test_digest(A, 0);
+    simd_test_fill(A, 5, false);
+    results[k++] = simd_test_digest(A, count_bitarray_AND(A, D));
+    simd_test_fill(A, 6, false);
+    results[k++] = simd_test_digest(A, count_bitarray_low20_AND(A, B));
+    bitarray_AND4(A, B, C, D);
+    results[k++] = simd_test_digest(A, 0);
+    bitarray_OR(A, C);
+    results[k++] = simd_test_digest(A, 0);
+    results[k++] = simd_test_digest(A, count_bitarray_AND2(A, D));
+    results[k++] = simd_test_digest(A, count_bitarray_AND3(A, C, D));
+    results[k++] = simd_test_digest(A, count_bitarray_AND4(A, B, C, D));
+    results[k++] = simd_test_digest(B, count_states(B));
+    results[k++] = simd_test_digest(B, count_bitarray_AND2(B, B));
+
+    free_bitarray(D);
+    free_bitarray(C);
+    free_bitarray(B);
+    free_bitarray(A);
+}
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t simd_test_brute_force(noncelist_t *test_nonces, uint8_t *test_best_first_bytes, statelist_t *test_candidates) {
+    // the candidate list is searched with the currently selected instruction set
+    float rate = 0.0;
+    uint64_t key = 0;
+    uint64_t test_states = (uint64_t)test_candidates->len[ODD_STATE] * test_candidates->len[EVEN_STATE];
+    prepare_bf_test_nonces(test_nonces, test_best_first_bytes[0]);
+    if (brute_force_bs(&rate, test_candidates, SIMD_TEST_CUID, SIMD_TEST_NONCES, test_states, test_nonces, test_best_first_bytes, &key) == false) {
+        return -1;
+    }
+    return key;
+}
+
+int hardnested_simd_test(void) {
+
+    // generate nonces for a known key and sort them by first byte
+    noncelist_t *test_nonces = calloc(256, sizeof(noncelist_t));
+    if (test_nonces == NULL) {
+        PrintAndLogEx(ERR, "Out of memory error in hardnested_simd_test(). Aborting...\n");
+        return PM3_EMALLOC;
+    }
+    srand(0x5eed);
+    for (uint32_t i = 0; i < SIMD_TEST_NONCES; i++) {
+        uint32_t nt_enc = 0;
+        uint8_t par_enc = 0;
+        simulate_MFplus_RNG(SIMD_TEST_CUID, SIMD_TEST_KEY, &nt_enc, &par_enc);
+        noncelist_t *list = &test_nonces[nt_enc >> 24];
+        bool seen = false;
+        for (noncelistentry_t *p = list->first; p != NULL; p = p->next) {
+            if ((p->nonce_enc & 0x00ff0000) == (nt_enc & 0x00ff0000)) {
+                seen = true;
+                break;
+            }
+        }
+        if (seen) {
+            continue;
+        }
+        noncelistentry_t *entry = calloc(1, sizeof(noncelistentry_t));
+        if (entry == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in hardnested_simd_test(). Aborting...\n");
+            exit(4);
+        }
+        entry->nonce_enc = nt_enc;
+        entry->par_enc = par_enc;
+        entry->next = list->first;
+        list->first = entry;
+        list->num++;
+    }
+
+    // use the first byte with the most nonces for the bitsliced brute force
+    uint8_t test_best_first_bytes[256];
+    uint8_t b0 = 0;
+    for (uint16_t i = 1; i < 256; i++) {
+        if (test_nonces[i].num > test_nonces[b0].num) {
+            b0 = i;
+        }
+    }
+    test_best_first_bytes[0] = b0;
+    for (uint16_t i = 0, j = 1; i < 256; i++) {
+        if (i != b0) {
+            test_best_first_bytes[j++] = i;
+        }
+    }
+    pre_XOR_nonces(test_nonces, SIMD_TEST_CUID);
+
+    // random candidate states, plus the correct one (the state after the best first byte is shifted in)
+    struct Crypto1State *pcs = crypto1_create(SIMD_TEST_KEY);
+    crypto1_byte(pcs, (SIMD_TEST_CUID >> 24) ^ b0, true);
+    uint32_t key_state[2];
+    key_state[ODD_STATE] = pcs->odd & 0x00ffffff;
+    key_state[EVEN_STATE] = pcs->even & 0x00ffffff;
+    crypto1_destroy(pcs);
+
+    statelist_t test_candidates = {{NULL, NULL}, {SIMD_TEST_STATES, SIMD_TEST_STATES}, NULL};
+    uint32_t seed = 0x12345678;
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        test_candidates.states[odd_even] = calloc(SIMD_TEST_STATES + 1, sizeof(uint32_t));
+        if (test_candidates.states[odd_even] == NULL) {
+            PrintAndLogEx(ERR, "Out of memory error in hardnested_simd_test(). Aborting...\n");
+            exit(4);
+        }
+        for (uint32_t i = 0; i < SIMD_TEST_STATES - 1; i++) {
+            test_candidates.states[odd_even][i] = simd_test_random(&seed) & 0x00ffffff;
+        }
+        test_candidates.states[odd_even][SIMD_TEST_STATES - 1] = key_state[odd_even];
+        qsort(test_candidates.states[odd_even], SIMD_TEST_STATES, sizeof(uint32_t), compare_uint32);
+        test_candidates.states[odd_even][SIMD_TEST_STATES] = -1;
+    }
+
+    PrintAndLogEx(INFO, "Testing all available SIMD instruction sets against the plain C implementation...");
+    PrintAndLogEx(INFO, "---------+--------+----------------------");
+    PrintAndLogEx(INFO, " SIMD    | result | brute force states/s");
+    PrintAndLogEx(INFO, "---------+--------+----------------------");
+
+    uint32_t reference[SIMD_TEST_KERNELS] = {0};
+    int res = PM3_SUCCESS;
+
+    // SIMD_NONE is the last entry of the enum. Run it first, it is the reference.
+    for (int instr = SIMD_NONE; instr > SIMD_AUTO; instr--) {
+        if (SIMDInstrSupported(instr) == false) {
+            continue;
+        }
+        SetSIMDInstr(instr);
+
+        uint32_t results[SIMD_TEST_KERNELS] = {0};
+        simd_test_bitarrays(results);
+        uint64_t found_key = simd_test_brute_force(test_nonces, test_best_first_bytes, &test_candidates);
+        results[SIMD_TEST_KERNELS - 1] = (found_key == SIMD_TEST_KEY);
+        if (instr == SIMD_NONE) {
+            memcpy(reference, results, sizeof(reference));
+        }
+
+        bool ok = (found_key == SIMD_TEST_KEY);
+        for (uint8_t k = 0; k < SIMD_TEST_KERNELS; k++) {
+            if (results[k] != reference[k]) {
+                PrintAndLogEx(FAILED, "%s differs from the plain C implementation", simd_test_kernel_names[k]);
+                ok = false;
+            }
+        }
+        if (found_key != SIMD_TEST_KEY) {
+            PrintAndLogEx(FAILED, "crack_states_bitsliced didn't find key %012" PRIx64, (uint64_t)SIMD_TEST_KEY);
+        }
+
+        float bf_rate = brute_force_benchmark();
+
+        char instr_set[12] = "";
+        get_SIMD_instruction_set(instr, instr_set);
+        PrintAndLogEx(INFO, " %-7s | %s | %20.0f", instr_set, ok ? "  " _GREEN_("ok") "  " : " " _RED_("fail") " ", bf_rate);
+        if (ok == false) {
+            res = PM3_ESOFT;
+        }
+    }
+    PrintAndLogEx(INFO, "---------+--------+----------------------");
+
+    SetSIMDInstr(SIMD_AUTO);
+
+    free(test_candidates.states[ODD_STATE]);
+    free(test_candidates.states[EVEN_STATE]);
+    for (uint16_t i = 0; i < 256; i++) {
+        free_nonce_list(test_nonces[i].first);
+    }
+    free(test_nonces);
+
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(SUCCESS, "All SIMD instruction sets ( " _GREEN_("ok") " )");
+    } else {
+        PrintAndLogEx(FAILED, "SIMD self test ( " _RED_("fail") " )");
+    }
+    return res;
+}
+
 int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename) {
     char progress_text[80];
     char instr_set[12] = {0};
 
-    get_SIMD_instruction_set(instr_set);
+    get_SIMD_instruction_set(GetSIMDInstrAuto(), instr_set);
 
     // initialize static arrays
     memset(part_sum_count, 0, sizeof(part_sum_count));
@@ -2280,7 +2865,7 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
                 }
 
                 best_first_bytes[0] = best_first_byte_smallest_bitarray;
-                pre_XOR_nonces();
+                pre_XOR_nonces(nonces, cuid);
                 prepare_bf_test_nonces(nonces, best_first_bytes[0]);
 
                 key_found = brute_force(foundkey);
@@ -2289,7 +2874,7 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
                 free_candidates_memory(candidates);
                 candidates = NULL;
             } else {
-                pre_XOR_nonces();
+                pre_XOR_nonces(nonces, cuid);
                 prepare_bf_test_nonces(nonces, best_first_bytes[0]);
                 for (uint8_t j = 0; j < NUM_SUMS && !key_found; j++) {
                     float expected_brute_force = nonces[best_first_bytes[0]].expected_num_brute_force;
@@ -2385,6 +2970,21 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
         Tests();
 
         free_bitflip_bitarrays();
+
+        bool exporting = (strlen(hardnested_export_prefix) > 0);
+        brute_force_set_export(exporting ? hardnested_export_prefix : NULL, hardnested_export_shards);
+
+        // keep track of the brute force progress next to the nonce file
+        if (exporting) {
+            PrintAndLogEx(INFO, "Exporting brute force to shard files, no local brute force");
+        } else if (filename != NULL && strlen(filename) && (nonce_file_read || nonce_file_write)) {
+            char checkpoint_fn[FILE_PATH_SIZE + 12] = {0};
+            snprintf(checkpoint_fn, sizeof(checkpoint_fn), "%s.checkpoint", filename);
+            brute_force_set_checkpoint(checkpoint_fn, hardnested_resume);
+        } else if (hardnested_resume) {
+            PrintAndLogEx(WARNING, "Resume needs a nonce file, ignoring");
+        }
+
         bool key_found = false;
         num_keys_tested = 0;
         uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
@@ -2404,7 +3004,7 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             }
 
             best_first_bytes[0] = best_first_byte_smallest_bitarray;
-            pre_XOR_nonces();
+            pre_XOR_nonces(nonces, cuid);
             prepare_bf_test_nonces(nonces, best_first_bytes[0]);
 
             key_found = brute_force(foundkey);
@@ -2414,7 +3014,7 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             candidates = NULL;
         } else {
 
-            pre_XOR_nonces();
+            pre_XOR_nonces(nonces, cuid);
             prepare_bf_test_nonces(nonces, best_first_bytes[0]);
 
             for (uint8_t j = 0; j < NUM_SUMS && !key_found; j++) {
@@ -2442,6 +3042,18 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             }
         }
 
+        if (key_found) {
+            brute_force_clear_checkpoint();
+        } else {
+            brute_force_set_checkpoint(NULL, false);
+        }
+
+        if (exporting) {
+            PrintAndLogEx(SUCCESS, "Exported " _YELLOW_("%u") " shard files", brute_force_exported_shards());
+            PrintAndLogEx(HINT, "Hint: crack them with `" _YELLOW_("hardnested_worker <shard file>") "`, lowest round first");
+            brute_force_set_export(NULL, 0);
+        }
+
         free_nonces_memory();
         free_bitarray(all_bitflips_bitarray[ODD_STATE]);
         free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
@@ -22,6 +22,11 @@
 #include "common.h"
 
 int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename);
+void hardnested_set_table_cache(const char *dir);
+int hardnested_build_table_cache(const char *dir);
+void hardnested_set_resume(bool resume);
+void hardnested_set_export(const char *prefix, uint32_t num_shards);
+int hardnested_simd_test(void);
 void hardnested_print_progress(uint32_t nonces, const char *activity, float brute_force, uint64_t min_diff_print_time);
 
 #endif
@@ -2666,6 +2666,7 @@ static int CmdHF14AMfUeLoad(const char *Cmd) {
         arg_str1("f", "file", "<fn>", "filename of dump"),
         arg_lit1(NULL, "ul", "MIFARE Ultralight family"),
         arg_int0("q", "qty", "<dec>", "number of blocks to load from eml file"),
+        arg_lit0(NULL, "verify", "read back emulator memory and check its CRC"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
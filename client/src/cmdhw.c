@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <inttypes.h>
 
 #include "cmdparser.h"    // command_t
 #include "cliparser.h"
@@ -33,9 +34,13 @@
 #include "pm3_cmd.h"
 #include "pmflash.h"      // rdv40validation_t
 #include "cmdflashmem.h"  // get_signature..
+#include "util_posix.h"   // usclock
 
 static int CmdHelp(const char *Cmd);
 
+// number of log2 latency buckets of hw pingbench
+#define PINGBENCH_BUCKETS 16
+
 static void lookupChipID(uint32_t iChipID, uint32_t mem_used) {
     char asBuff[120];
     memset(asBuff, 0, sizeof(asBuff));
@@ -813,27 +818,219 @@ static int CmdPing(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint64_t *sent;
+    uint64_t *samples;
+    uint32_t done;
+    uint32_t timeouts;
+    uint32_t errors;
+} pingbench_t;
+
+static size_t pingbench_build(uint32_t idx, uint8_t *data, void *ctx) {
+    pingbench_t *pb = (pingbench_t *)ctx;
+    memcpy(data, pb->data, pb->len);
+    pb->sent[idx] = usclock();
+    return pb->len;
+}
+
+static void pingbench_reply(uint32_t idx, PacketResponseNG *resp, void *ctx) {
+    pingbench_t *pb = (pingbench_t *)ctx;
+    if (resp == NULL) {
+        pb->timeouts++;
+        return;
+    }
+    pb->samples[pb->done++] = usclock() - pb->sent[idx];
+    if (pb->len && memcmp(pb->data, resp->data.asBytes, pb->len) != 0)
+        pb->errors++;
+}
+
+static int CmdPingBench(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw pingbench",
+                  "Measure the round trip latency to the Proxmark3 with a series of pings",
+                  "hw pingbench\n"
+                  "hw pingbench -n 10000 --len 512\n"
+                  "hw pingbench -w                   --> keep several pings in flight"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", "num", "<dec>", "number of pings (def 1000)"),
+        arg_u64_0("l", "len", "<dec>", "length of payload to send"),
+        arg_lit0("w", "window", "windowed mode, fill the command window of the device"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t num = arg_get_u32_def(ctx, 1, 1000);
+    uint32_t len = arg_get_u32_def(ctx, 2, 0);
+    bool windowed = arg_get_lit(ctx, 3);
+    CLIParserFree(ctx);
+
+    if (num == 0)
+        num = 1;
+
+    if (len > PM3_CMD_DATA_SIZE)
+        len = PM3_CMD_DATA_SIZE;
+
+    uint64_t *samples = calloc(num, sizeof(uint64_t));
+    uint64_t *sent = calloc(num, sizeof(uint64_t));
+    if (samples == NULL || sent == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(samples);
+        free(sent);
+        return PM3_EMALLOC;
+    }
+
+    uint8_t data[PM3_CMD_DATA_SIZE] = {0};
+    for (uint16_t i = 0; i < len; i++)
+        data[i] = i & 0xFF;
+
+    if (windowed) {
+        if (g_conn.cmd_window == 0) {
+            PrintAndLogEx(WARNING, "Device firmware doesn't support windowed mode, sending one ping at a time");
+        }
+        PrintAndLogEx(INFO, "Sending " _YELLOW_("%u") " pings with payload len " _YELLOW_("%u") ", window " _YELLOW_("%u"), num, len, MAX(g_conn.cmd_window, 1));
+    } else {
+        PrintAndLogEx(INFO, "Sending " _YELLOW_("%u") " pings with payload len " _YELLOW_("%u") ", press " _GREEN_("<Enter>") " to abort", num, len);
+    }
+
+    uint32_t done = 0, timeouts = 0, errors = 0;
+    uint64_t t_start = usclock();
+
+    if (windowed) {
+        pingbench_t pb = { data, len, sent, samples, 0, 0, 0 };
+        SendCommandNGWindowed(CMD_PING, num, pingbench_build, pingbench_reply, &pb, 1000);
+        done = pb.done;
+        timeouts = pb.timeouts;
+        errors = pb.errors;
+    } else {
+        for (uint32_t i = 0; i < num; i++) {
+
+            if (kbd_enter_pressed()) {
+                PrintAndLogEx(WARNING, "\naborted via keyboard!");
+                break;
+            }
+
+            PacketResponseNG resp;
+            clearCommandBuffer();
+            uint64_t t1 = usclock();
+            SendCommandNG(CMD_PING, data, len);
+            if (WaitForResponseTimeout(CMD_PING, &resp, 1000) == false) {
+                timeouts++;
+                continue;
+            }
+            samples[done++] = usclock() - t1;
+
+            if (len && memcmp(data, resp.data.asBytes, len) != 0)
+                errors++;
+        }
+    }
+    uint64_t t_total = usclock() - t_start;
+
+    free(sent);
+
+    if (done == 0) {
+        PrintAndLogEx(WARNING, "Ping response " _RED_("timeout"));
+        free(samples);
+        return PM3_ETIMEOUT;
+    }
+
+    // log2 buckets, starting at < 64 us
+    uint32_t hist[PINGBENCH_BUCKETS] = {0};
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < done; i++) {
+        uint8_t b = 0;
+        while (b < PINGBENCH_BUCKETS - 1 && samples[i] >= ((uint64_t)64 << b))
+            b++;
+        hist[b]++;
+        sum += samples[i];
+    }
+
+    qsort(samples, done, sizeof(uint64_t), cmp_u64);
+
+    uint32_t hmax = 0;
+    for (uint8_t b = 0; b < PINGBENCH_BUCKETS; b++)
+        hmax = MAX(hmax, hist[b]);
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Round trip latency") " ------------------------");
+    for (uint8_t b = 0; b < PINGBENCH_BUCKETS; b++) {
+        if (hist[b] == 0)
+            continue;
+
+        char bar[41] = {0};
+        memset(bar, '#', MAX(1, (uint64_t)hist[b] * 40 / hmax));
+        if (b == PINGBENCH_BUCKETS - 1) {
+            PrintAndLogEx(INFO, "      >= %7" PRIu64 " us | %7u | %s", (uint64_t)64 << (b - 1), hist[b], bar);
+        } else {
+            PrintAndLogEx(INFO, "%7" PRIu64 " - %7" PRIu64 " us | %7u | %s", b ? (uint64_t)64 << (b - 1) : 0, ((uint64_t)64 << b) - 1, hist[b], bar);
+        }
+    }
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "pings.... " _YELLOW_("%u") " ok, %u timeout, %u content errors", done, timeouts, errors);
+    PrintAndLogEx(INFO, "min...... " _YELLOW_("%" PRIu64) " us", samples[0]);
+    PrintAndLogEx(INFO, "avg...... " _YELLOW_("%" PRIu64) " us", sum / done);
+    PrintAndLogEx(INFO, "median... " _YELLOW_("%" PRIu64) " us", samples[done / 2]);
+    PrintAndLogEx(INFO, "99%%...... " _YELLOW_("%" PRIu64) " us", samples[(uint64_t)done * 99 / 100]);
+    PrintAndLogEx(INFO, "max...... " _YELLOW_("%" PRIu64) " us", samples[done - 1]);
+    PrintAndLogEx(INFO, "rate..... " _YELLOW_("%.0f") " pings/s", (double)done * 1000000.0 / (double)MAX(t_total, 1));
+
+    free(samples);
+    return PM3_SUCCESS;
+}
+
+static void print_devices(void) {
+    PrintAndLogEx(INFO, " #  | port");
+    PrintAndLogEx(INFO, "----+-------------------------------");
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        pm3_device_t *dev = GetProxmark(i);
+        if (dev == NULL) {
+            continue;
+        }
+        PrintAndLogEx(INFO, " %s%d | %s%s"
+                      , (dev == g_session.current_device) ? _GREEN_("*") : " "
+                      , i
+                      , dev->conn->serial_port_name
+                      , dev->conn->send_via_fpc_usart ? " ( FPC UART )" : ""
+                     );
+    }
+}
+
 static int CmdConnect(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hw connect",
                   "Connects to a Proxmark3 device via specified serial port.\n"
+                  "Give several ports to connect several devices, the first one is the default device.\n"
                   "Baudrate here is only for physical UART or UART-BT, NOT for USB-CDC or blue shark add-on",
                   "hw connect -p "SERIAL_PORT_EXAMPLE_H"\n"
-                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" -b 115200"
+                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" -b 115200\n"
+                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" -p tcp:localhost:4321   --> connect two devices"
                  );
 
     void *argtable[] = {
         arg_param_begin,
-        arg_str0("p", "port", NULL, "Serial port to connect to, else retry the last used one"),
+        arg_strx0("p", "port", NULL, "Serial port to connect to, else retry the last used one"),
         arg_u64_0("b", "baud", "<dec>", "Baudrate"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
 
-    int p_len = FILE_PATH_SIZE;
-    char port[FILE_PATH_SIZE] = {0};
-    CLIGetStrWithReturn(ctx, 1, (uint8_t *)port, &p_len);
+    struct arg_str *ports = arg_get_str(ctx, 1);
+    int nports = MIN(ports->count, PM3_MAX_DEVICES);
+    char port[PM3_MAX_DEVICES][FILE_PATH_SIZE];
+    memset(port, 0, sizeof(port));
+    for (int i = 0; i < nports; i++) {
+        strncpy(port[i], ports->sval[i], FILE_PATH_SIZE - 1);
+    }
     uint32_t baudrate = arg_get_u32_def(ctx, 2, USART_BAUD_RATE);
     CLIParserFree(ctx);
 
@@ -843,26 +1040,76 @@ static int CmdConnect(const char *Cmd) {
     }
 
     // default back to previous used serial port
-    if (strlen(port) == 0) {
+    if (nports == 0) {
         if (strlen(g_conn.serial_port_name) == 0) {
             PrintAndLogEx(WARNING, "Must specify a serial port");
             return PM3_EINVARG;
         }
-        memcpy(port, g_conn.serial_port_name, sizeof(port));
+        memcpy(port[0], g_conn.serial_port_name, sizeof(port[0]));
+        nports = 1;
     }
 
-    if (g_session.pm3_present) {
-        CloseProxmark(g_session.current_device);
-    }
+    CloseProxmarks();
 
     // 10 second timeout
-    OpenProxmark(&g_session.current_device, port, false, 10, false, baudrate);
+    OpenProxmark(&g_session.current_device, port[0], false, 10, false, baudrate);
 
     if (g_session.pm3_present && (TestProxmark(g_session.current_device) != PM3_SUCCESS)) {
         PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark3\n");
         CloseProxmark(g_session.current_device);
         return PM3_ENOTTY;
     }
+
+    for (int i = 1; (i < nports) && g_session.pm3_present; i++) {
+        pm3_device_t *dev = NULL;
+        if (OpenProxmark(&dev, port[i], false, 10, false, baudrate) == false) {
+            return PM3_ENOTTY;
+        }
+        if (TestProxmark(dev) != PM3_SUCCESS) {
+            PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark3 on " _YELLOW_("%s") "\n", port[i]);
+            CloseProxmark(dev);
+            return PM3_ENOTTY;
+        }
+    }
+
+    if (nports > 1) {
+        print_devices();
+    }
+    return PM3_SUCCESS;
+}
+
+static int CmdSelect(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw select",
+                  "Lists the connected Proxmark3 devices, or selects the default device commands are sent to",
+                  "hw select\n"
+                  "hw select -d 1"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_int0("d", "dev", "<dec>", "device number"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    int idx = arg_get_int_def(ctx, 1, -1);
+    CLIParserFree(ctx);
+
+    if (idx >= 0) {
+        pm3_device_t *dev = GetProxmark(idx);
+        if (dev == NULL) {
+            PrintAndLogEx(WARNING, "No device " _YELLOW_("%d") " connected", idx);
+            return PM3_EINVARG;
+        }
+        SetDefaultProxmark(dev);
+    }
+
+    if (CountProxmarks() == 0) {
+        PrintAndLogEx(INFO, "No device connected");
+        return PM3_SUCCESS;
+    }
+    print_devices();
     return PM3_SUCCESS;
 }
 
@@ -897,8 +1144,10 @@ static command_t CommandTable[] = {
     {"lcd",           CmdLCD,          IfPm3Lcd,        "Send command/data to LCD"},
     {"lcdreset",      CmdLCDReset,     IfPm3Lcd,        "Hardware reset LCD"},
     {"ping",          CmdPing,         IfPm3Present,    "Test if the Proxmark3 is responsive"},
+    {"pingbench",     CmdPingBench,    IfPm3Present,    "Measure round trip latency to the Proxmark3"},
     {"readmem",       CmdReadmem,      IfPm3Present,    "Read memory at decimal address from flash"},
     {"reset",         CmdReset,        IfPm3Present,    "Reset the Proxmark3"},
+    {"select",        CmdSelect,       AlwaysAvailable, "List connected Proxmark3 devices, select the default one"},
     {"setlfdivisor",  CmdSetDivisor,   IfPm3Present,    "Drive LF antenna at 12MHz / (divisor + 1)"},
     {"setmux",        CmdSetMux,       IfPm3Present,    "Set the ADC mux to a specific value"},
     {"standalone",    CmdStandalone,   IfPm3Present,    "Jump to the standalone mode"},
@@ -65,6 +65,11 @@
 #include "cmdlfzx8211.h"    // for ZX8211 menu
 #include "crc.h"
 #include "pm3_cmd.h"        // for LF_CMDREAD_MAX_EXTRA_SYMBOLS
+#include "clientctx.h"      // for `lf search --dir`
+#include "util_posix.h"     // msclock
+#include "jansson.h"
+#include <dirent.h>
+#include <pthread.h>
 
 static bool gs_lf_threshold_set = false;
 
@@ -262,7 +267,7 @@ int CmdLFCommandRead(const char *Cmd) {
     bool cm = arg_get_lit(ctx, 10);
     CLIParserFree(ctx);
 
-    if (g_session.pm3_present == false)
+    if (IsProxmarkPresent() == false)
         return PM3_ENOTTY;
 
 #define PAYLOAD_HEADER_SIZE (12 + (3 * LF_CMDREAD_MAX_EXTRA_SYMBOLS))
@@ -519,7 +524,7 @@ int lf_config_savereset(sample_config *config) {
 }
 
 int lf_getconfig(sample_config *config) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     if (config == NULL)
         return PM3_EINVARG;
@@ -537,7 +542,7 @@ int lf_getconfig(sample_config *config) {
 }
 
 int lf_config(sample_config *config) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     clearCommandBuffer();
     if (config != NULL)
@@ -592,7 +597,7 @@ int CmdLFConfig(const char *Cmd) {
     int16_t trigg = arg_get_int_def(ctx, 10, -1);
     CLIParserFree(ctx);
 
-    if (g_session.pm3_present == false)
+    if (IsProxmarkPresent() == false)
         return PM3_ENOTTY;
 
     // if called with no params, just print the device config
@@ -673,7 +678,7 @@ int CmdLFConfig(const char *Cmd) {
 }
 
 int lf_read(bool verbose, uint32_t samples) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     struct p {
         uint32_t samples : 31;
@@ -725,7 +730,7 @@ int CmdLFRead(const char *Cmd) {
     bool cm = arg_get_lit(ctx, 3);
     CLIParserFree(ctx);
 
-    if (g_session.pm3_present == false)
+    if (IsProxmarkPresent() == false)
         return PM3_ENOTTY;
 
     if (cm) {
@@ -739,7 +744,7 @@ int CmdLFRead(const char *Cmd) {
 }
 
 int lf_sniff(bool verbose, uint32_t samples) {
-    if (!g_session.pm3_present) return PM3_ENOTTY;
+    if (!IsProxmarkPresent()) return PM3_ENOTTY;
 
     struct p {
         uint32_t samples : 31;
@@ -794,7 +799,7 @@ int CmdLFSniff(const char *Cmd) {
     bool cm = arg_get_lit(ctx, 3);
     CLIParserFree(ctx);
 
-    if (g_session.pm3_present == false)
+    if (IsProxmarkPresent() == false)
         return PM3_ENOTTY;
 
     if (cm) {
@@ -886,7 +891,7 @@ int CmdLFSim(const char *Cmd) {
     uint16_t gap = arg_get_u32_def(ctx, 1, 0);
     CLIParserFree(ctx);
 
-    if (g_session.pm3_present == false) {
+    if (IsProxmarkPresent() == false) {
         PrintAndLogEx(DEBUG, "DEBUG: no proxmark present");
         return PM3_ENOTTY;
     }
@@ -1419,31 +1424,64 @@ out:
     return retval;
 }
 
-int CmdLFfind(const char *Cmd) {
+typedef struct {
+    int (*demod)(bool verbose);
+    const char *name;
+} lf_demod_t;
 
-    CLIParserContext *ctx;
-    CLIParserInit(&ctx, "lf search",
-                  "Read and search for valid known tag. For offline mode, you can `data load` first then search.",
-                  "lf search       -> try reading data from tag & search for known tag\n"
-                  "lf search -1    -> use data from the GraphBuffer & search for known tag\n"
-                  "lf search -u    -> try reading data from tag & search for known and unknown tag\n"
-                  "lf search -1u   -> use data from the GraphBuffer & search for known and unknown tag\n"
-                 );
+// known tags looked for in the graph buffer, in this order
+static const lf_demod_t lf_demods[] = {
+    // ask / man
+    {demodEM410x, "EM410x ID"},
+    {demodDestron, "FDX-A FECAVA Destron ID"}, // to do before HID
+    {demodGallagher, "GALLAGHER ID"},
+    {demodNoralsy, "Noralsy ID"},
+    {demodPresco, "Presco ID"},
+    {demodSecurakey, "Securakey ID"},
+    {demodViking, "Viking ID"},
+    {demodVisa2k, "Visa2000 ID"},
+    // ask / bi
+    {demodFDXB, "FDX-B ID"},
+    {demodJablotron, "Jablotron ID"},
+    {demodGuard, "Guardall G-Prox II ID"},
+    {demodNedap, "NEDAP ID"},
+    // nrz
+    {demodPac, "PAC/Stanley ID"},
+    // fsk
+    {demodHID, "HID Prox ID"},
+    {demodAWID, "AWID ID"},
+    {demodIOProx, "IO Prox ID"},
+    {demodPyramid, "Pyramid ID"},
+    {demodParadox, "Paradox ID"},
+    // psk
+    {demodIdteck, "Idteck ID"},
+    {demodKeri, "KERI ID"},
+    {demodNexWatch, "NexWatch ID"},
+    {demodIndala, "Indala ID"},
+    // {demodTI, "Texas Instrument ID"},
+    // {demodFermax, "Fermax ID"},
+};
+
+// tags and unknown modulations lf_search can report
+#define LF_SEARCH_MAX_FOUND (ARRAYLEN(lf_demods) + 7)
+
+// Searches the graph buffer, reading it from the tag first when is_online. The names of what was found
+// are stored in found, if not NULL
+// records one more tag type found by lf_search
+static void lf_search_found(const char *name, const char **found_names, int *found, size_t *found_count) {
+    if (found_names)
+        found_names[*found] = name;
+    (*found)++;
+    if (found_count)
+        *found_count = *found;
+}
+
+static int lf_search(bool is_online, bool search_cont, bool search_unk, const char **found_names, size_t *found_count) {
 
-    void *argtable[] = {
-        arg_param_begin,
-        arg_lit0("1", NULL, "Use data from Graphbuffer to search"),
-        arg_lit0("c", NULL, "Continue searching even after a first hit"),
-        arg_lit0("u", NULL, "Search for unknown tags. If not set, reads only known tags"),
-        arg_param_end
-    };
-    CLIExecWithReturn(ctx, Cmd, argtable, true);
-    bool use_gb = arg_get_lit(ctx, 1);
-    bool search_cont = arg_get_lit(ctx, 2);
-    bool search_unk = arg_get_lit(ctx, 3);
-    CLIParserFree(ctx);
     int found = 0;
-    bool is_online = (g_session.pm3_present && (use_gb == false));
+    if (found_count)
+        *found_count = 0;
+
     if (is_online)
         lf_read(false, 30000);
 
@@ -1471,9 +1509,8 @@ int CmdLFfind(const char *Cmd) {
         if (IfPm3Hitag()) {
             if (readHitagUid()) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Hitag") " found!");
-                if (search_cont) {
-                    found++;
-                } else {
+                lf_search_found("Hitag", found_names, &found, found_count);
+                if (search_cont == false) {
                     return PM3_SUCCESS;
                 }
             }
@@ -1483,9 +1520,8 @@ int CmdLFfind(const char *Cmd) {
         if (IfPm3EM4x50()) {
             if (read_em4x50_uid() == PM3_SUCCESS) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM4x50 ID") " found!");
-                if (search_cont) {
-                    found++;
-                } else {
+                lf_search_found("EM4x50 ID", found_names, &found, found_count);
+                if (search_cont == false) {
                     return PM3_SUCCESS;
                 }
             }
@@ -1499,9 +1535,8 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(INPLACE, "Searching for MOTOROLA tag...");
             if (readMotorolaUid()) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Motorola FlexPass ID") " found!");
-                if (search_cont) {
-                    found++;
-                } else {
+                lf_search_found("Motorola FlexPass ID", found_names, &found, found_count);
+                if (search_cont == false) {
                     return PM3_SUCCESS;
                 }
             }
@@ -1509,9 +1544,8 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(INPLACE, "Searching for COTAG tag...");
             if (readCOTAGUid()) {
                 PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("COTAG ID") " found!");
-                if (search_cont) {
-                    found++;
-                } else {
+                lf_search_found("COTAG ID", found_names, &found, found_count);
+                if (search_cont == false) {
                     return PM3_SUCCESS;
                 }
             }
@@ -1528,209 +1562,16 @@ int CmdLFfind(const char *Cmd) {
 
     int retval = PM3_SUCCESS;
 
-    // ask / man
-    if (demodEM410x(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM410x ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodDestron(true) == PM3_SUCCESS) { // to do before HID
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-A FECAVA Destron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGallagher(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("GALLAGHER ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNoralsy(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Noralsy ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPresco(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Presco ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodSecurakey(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Securakey ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodViking(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Viking ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodVisa2k(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Visa2000 ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // ask / bi
-    if (demodFDXB(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-B ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodJablotron(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Jablotron ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodGuard(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Guardall G-Prox II ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNedap(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NEDAP ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // nrz
-    if (demodPac(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("PAC/Stanley ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-
-    // fsk
-    if (demodHID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("HID Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodAWID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("AWID ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIOProx(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("IO Prox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodPyramid(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Pyramid ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodParadox(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Paradox ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
+    for (size_t i = 0; i < ARRAYLEN(lf_demods); i++) {
+        if (lf_demods[i].demod(true) == PM3_SUCCESS) {
+            PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", lf_demods[i].name);
+            lf_search_found(lf_demods[i].name, found_names, &found, found_count);
+            if (search_cont == false) {
+                goto out;
+            }
         }
     }
 
-    // psk
-    if (demodIdteck(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Idteck ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodKeri(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("KERI ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodNexWatch(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NexWatch ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodIndala(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Indala ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    /*
-    if (demodTI() == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Texas Instrument ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    if (demodFermax() == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Fermax ID") " found!");
-        if (search_cont) {
-            found++;
-        } else {
-            goto out;
-        }
-    }
-    */
     if (found == 0) {
         PrintAndLogEx(FAILED, _RED_("No known 125/134 kHz tags found!"));
     }
@@ -1751,9 +1592,8 @@ int CmdLFfind(const char *Cmd) {
         if (GetFskClock("", false)) {
             if (FSKrawDemod(0, 0, 0, 0, true) == PM3_SUCCESS) {
                 PrintAndLogEx(INFO, "Unknown FSK Modulated Tag found!");
-                if (search_cont) {
-                    found++;
-                } else {
+                lf_search_found("Unknown FSK", found_names, &found, found_count);
+                if (search_cont == false) {
                     goto out;
                 }
             }
@@ -1763,9 +1603,8 @@ int CmdLFfind(const char *Cmd) {
         if (ASKDemod_ext(0, 0, 0, 0, false, true, false, 1, &st) == PM3_SUCCESS) {
             PrintAndLogEx(INFO, "Unknown ASK Modulated and Manchester encoded Tag found!");
             PrintAndLogEx(INFO, "if it does not look right it could instead be ASK/Biphase - try " _YELLOW_("'data rawdemod --ab'"));
-            if (search_cont) {
-                found++;
-            } else {
+            lf_search_found("Unknown ASK", found_names, &found, found_count);
+            if (search_cont == false) {
                 goto out;
             }
         }
@@ -1775,9 +1614,8 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(INFO, "    Could also be PSK2 - try " _YELLOW_("'data rawdemod --p2'"));
             PrintAndLogEx(INFO, "    Could also be PSK3 - [currently not supported]");
             PrintAndLogEx(INFO, "    Could also be  NRZ - try " _YELLOW_("'data rawdemod --nr"));
-            if (search_cont) {
-                found++;
-            } else {
+            lf_search_found("Unknown PSK1", found_names, &found, found_count);
+            if (search_cont == false) {
                 goto out;
             }
         }
@@ -1799,6 +1637,234 @@ out:
     return retval;
 }
 
+// lf search --dir: the sample files are shared out to jobs, each searching its files in its own context
+typedef struct {
+    char **files;
+    int count;
+    int next;       // next file to search, atomic
+    bool search_cont;
+    bool search_unk;
+    FILE *out;
+    int found;      // files with a hit, atomic
+} lf_search_batch_t;
+
+// keeps the result lines of the search, its other output is dropped
+static void lf_search_batch_line(int level, const char *line, void *arg) {
+    if ((level == SUCCESS) && strlen(line)) {
+        json_array_append_new((json_t *)arg, json_string(line));
+    }
+}
+
+static void *lf_search_batch_job(void *targ) {
+    lf_search_batch_t *batch = (lf_search_batch_t *)targ;
+
+    pm3_context_t *ctx = NewContext();
+    if (ctx == NULL) {
+        return NULL;
+    }
+    SelectContext(ctx);
+
+    int n;
+    while ((n = __atomic_fetch_add(&batch->next, 1, __ATOMIC_SEQ_CST)) < batch->count) {
+
+        json_t *lines = json_array();
+        ctx->print_cb = lf_search_batch_line;
+        ctx->print_arg = lines;
+
+        const char *found[LF_SEARCH_MAX_FOUND];
+        size_t found_count = 0;
+        int res = loadGraphFile(batch->files[n]);
+        if (res == PM3_SUCCESS) {
+            res = lf_search(false, batch->search_cont, batch->search_unk, found, &found_count);
+        }
+
+        ctx->print_cb = NULL;
+        ctx->print_arg = NULL;
+
+        json_t *names = json_array();
+        for (size_t i = 0; i < found_count; i++) {
+            json_array_append_new(names, json_string(found[i]));
+        }
+        if (found_count) {
+            __atomic_add_fetch(&batch->found, 1, __ATOMIC_SEQ_CST);
+        }
+
+        json_t *root = json_object();
+        json_object_set_new(root, "file", json_string(batch->files[n]));
+        json_object_set_new(root, "status", json_integer(res));
+        json_object_set_new(root, "samples", json_integer(g_GraphTraceLen));
+        json_object_set_new(root, "found", names);
+        json_object_set_new(root, "lines", lines);
+        char *line = json_dumps(root, JSON_COMPACT);
+        json_decref(root);
+
+        if (line) {
+            pthread_mutex_lock(&g_print_lock);
+            fprintf(batch->out, "%s\n", line);
+            pthread_mutex_unlock(&g_print_lock);
+            free(line);
+        }
+    }
+
+    SelectContext(NULL);
+    FreeContext(ctx);
+    return NULL;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int lf_search_dir(const char *dir, int jobs, const char *outfn, bool search_cont, bool search_unk) {
+
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        PrintAndLogEx(WARNING, "couldn't open directory " _YELLOW_("%s"), dir);
+        return PM3_EFILE;
+    }
+
+    lf_search_batch_t batch = {
+        .search_cont = search_cont,
+        .search_unk = search_unk,
+        .out = stdout,
+    };
+
+    int size = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if ((len < 5) || (strcmp(ent->d_name + len - 4, ".pm3") != 0)) {
+            continue;
+        }
+        if (batch.count == size) {
+            size = size ? size * 2 : 64;
+            char **tmp = realloc(batch.files, size * sizeof(char *));
+            if (tmp == NULL) {
+                PrintAndLogEx(WARNING, "Failed to allocate memory");
+                break;
+            }
+            batch.files = tmp;
+        }
+        char *path = calloc(strlen(dir) + len + 2, sizeof(char));
+        if (path == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            break;
+        }
+        sprintf(path, "%s" PATHSEP "%s", dir, ent->d_name);
+        batch.files[batch.count++] = path;
+    }
+    closedir(d);
+
+    int res = PM3_SUCCESS;
+    if (batch.count == 0) {
+        PrintAndLogEx(WARNING, "no " _YELLOW_(".pm3") " files found in " _YELLOW_("%s"), dir);
+        res = PM3_EFILE;
+        goto out;
+    }
+    qsort(batch.files, batch.count, sizeof(char *), cmp_str);
+
+    if (outfn) {
+        batch.out = fopen(outfn, "w");
+        if (batch.out == NULL) {
+            PrintAndLogEx(WARNING, "couldn't create " _YELLOW_("%s"), outfn);
+            res = PM3_EFILE;
+            goto out;
+        }
+    }
+
+    if (jobs > batch.count) {
+        jobs = batch.count;
+    }
+
+    PrintAndLogEx(INFO, "Searching " _YELLOW_("%d") " files with " _YELLOW_("%d") " jobs", batch.count, jobs);
+    uint64_t t1 = msclock();
+
+    // the demods keep copies of the samples on the stack
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 16 * 1024 * 1024);
+
+    pthread_t *threads = calloc(jobs, sizeof(pthread_t));
+    int started = 0;
+    for (; threads && (started < jobs); started++) {
+        if (pthread_create(&threads[started], &attr, lf_search_batch_job, &batch)) {
+            break;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    if (started == 0) {
+        lf_search_batch_job(&batch);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    if (outfn) {
+        fclose(batch.out);
+        PrintAndLogEx(SUCCESS, "saved results to " _YELLOW_("%s"), outfn);
+    }
+    PrintAndLogEx(SUCCESS, "found tags in " _YELLOW_("%d") " of " _YELLOW_("%d") " files in " _YELLOW_("%.1f") " seconds",
+                  batch.found, batch.count, (float)(msclock() - t1) / 1000.0);
+
+out:
+    for (int i = 0; i < batch.count; i++) {
+        free(batch.files[i]);
+    }
+    free(batch.files);
+    return res;
+}
+
+int CmdLFfind(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "lf search",
+                  "Read and search for valid known tag. For offline mode, you can `data load` first then search.\n"
+                  "With --dir all .pm3 files of a directory are searched in parallel jobs, one JSON line per file.",
+                  "lf search       -> try reading data from tag & search for known tag\n"
+                  "lf search -1    -> use data from the GraphBuffer & search for known tag\n"
+                  "lf search -u    -> try reading data from tag & search for known and unknown tag\n"
+                  "lf search -1u   -> use data from the GraphBuffer & search for known and unknown tag\n"
+                  "lf search --dir traces -j 8 -f results.jsonl -> search all .pm3 files of traces"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0("1", NULL, "Use data from Graphbuffer to search"),
+        arg_lit0("c", NULL, "Continue searching even after a first hit"),
+        arg_lit0("u", NULL, "Search for unknown tags. If not set, reads only known tags"),
+        arg_str0(NULL, "dir", "<path>", "Search the .pm3 files of this directory"),
+        arg_int0("j", "jobs", "<dec>", "Number of parallel jobs for --dir (def: number of CPUs)"),
+        arg_str0("f", "file", "<fn>", "Write the JSON lines of --dir to this file instead of the console"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool use_gb = arg_get_lit(ctx, 1);
+    bool search_cont = arg_get_lit(ctx, 2);
+    bool search_unk = arg_get_lit(ctx, 3);
+
+    int dirlen = 0;
+    char dir[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)dir, FILE_PATH_SIZE, &dirlen);
+    int jobs = arg_get_int_def(ctx, 5, num_CPUs());
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 6), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    CLIParserFree(ctx);
+
+    if (dirlen) {
+        if (jobs < 1) {
+            PrintAndLogEx(WARNING, "Number of jobs must be at least 1");
+            return PM3_EINVARG;
+        }
+        return lf_search_dir(dir, jobs, fnlen ? filename : NULL, search_cont, search_unk);
+    }
+
+    bool is_online = (IsProxmarkPresent() && (use_gb == false));
+    return lf_search(is_online, search_cont, search_unk, NULL, NULL);
+}
+
 static command_t CommandTable[] = {
     {"help",        CmdHelp,            AlwaysAvailable, "This help"},
     {"-----------", CmdHelp,            AlwaysAvailable, "-------------- " _CYAN_("Low Frequency") " --------------"},
@@ -526,7 +526,7 @@ static int CmdAWIDBrute(const char *Cmd) {
     // main loop
     for (;;) {
 
-        if (!g_session.pm3_present) {
+        if (!IsProxmarkPresent()) {
             PrintAndLogEx(WARNING, "Device offline\n");
             return PM3_ENODATA;
         }
@@ -40,7 +40,7 @@
 #include "cliparser.h"
 #include "cmdhw.h"
 
-static uint64_t gs_em410xid = 0;
+static __thread uint64_t gs_em410xid = 0;
 
 static int CmdHelp(const char *Cmd);
 /* Read the ID of an EM410x tag.
@@ -1393,7 +1393,7 @@ int CmdEM4x05Chk(const char *Cmd) {
 
         for (uint32_t c = 0; c < keycount; ++c) {
 
-            if (!g_session.pm3_present) {
+            if (!IsProxmarkPresent()) {
                 PrintAndLogEx(WARNING, "device offline\n");
                 free(keyBlock);
                 return PM3_ENODATA;
@@ -1572,7 +1572,7 @@ int CmdEM4x05Unlock(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    if (g_session.pm3_present == false) {
+    if (IsProxmarkPresent() == false) {
         PrintAndLogEx(WARNING, "device offline\n");
         return PM3_ENODATA;
     }
@@ -561,7 +561,7 @@ static int CmdHIDBrute(const char *Cmd) {
     fin_hi = fin_low = false;
     do {
 
-        if (!g_session.pm3_present) {
+        if (!IsProxmarkPresent()) {
             PrintAndLogEx(WARNING, "Device offline\n");
             return PM3_ENODATA;
         }
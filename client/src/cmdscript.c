@@ -351,6 +351,8 @@ static int CmdScriptRun(const char *Cmd) {
         //luaL_dofile(lua_state, buf);
         // close the Lua state
         lua_close(lua_state);
+        // the console talks to the default device again, see core.select_device
+        SelectProxmark(NULL);
         luascriptfile_idx--;
         PrintAndLogEx(SUCCESS, "\nfinished " _YELLOW_("%s"), filename);
         return PM3_SUCCESS;
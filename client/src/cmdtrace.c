@@ -18,6 +18,12 @@
 #include "cmdtrace.h"
 
 #include <ctype.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "cmdparser.h"    // command_t
 #include "protocols.h"
@@ -30,23 +36,25 @@
 #include "cmdlfhitag.h"         // annotate hitag
 #include "pm3_cmd.h"            // tracelog_hdr_t
 #include "cliparser.h"          // args..
+#include "clientctx.h"          // trace of the context
+#include "crc32.h"              // trace index records crc
 
 static int CmdHelp(const char *Cmd);
 
-// trace pointer
-static uint8_t *gs_trace;
-static long gs_traceLen = 0;
+// trace of the calling thread's context
+#define gs_trace (GetContext()->trace)
+#define gs_traceLen (GetContext()->trace_len)
 
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+static bool is_last_record(uint64_t tracepos, uint64_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint64_t tracepos, uint8_t *trace) {
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint64_t *tracepos, uint64_t traceLen,
                                       uint8_t *trace, uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -80,13 +88,13 @@ static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, ui
     return true;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint64_t printHexLine(uint64_t tracepos, uint64_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
 
-    if (TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
+    if (tracepos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
         return traceLen;
     }
 
@@ -98,7 +106,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
         return tracepos;
     }
 
-    uint16_t ret;
+    uint64_t ret;
 
     switch (protocol) {
         case ISO_14443A: {
@@ -141,11 +149,12 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+// start is the time of the record at tracepos, relative to the first record of the trace
+static uint64_t printTraceLine(uint64_t tracepos, uint64_t traceLen, uint8_t *trace, uint64_t start, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
                                const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
-        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
+        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %" PRIu64 "  t-len %" PRIu64, tracepos, traceLen);
         return traceLen;
     }
 
@@ -156,14 +165,13 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     char explanation[40] = {0};
     uint8_t mfData[32] = {0};
     size_t mfDataLen = 0;
-    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
 
     duration = hdr->duration;
     data_len = hdr->data_len;
 
     if (tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
-        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %u", tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr), traceLen);
+        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %" PRIu64, tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr), traceLen);
         return traceLen;
     }
 
@@ -431,8 +439,8 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     for (int j = 0; j < num_lines ; j++) {
         if (j == 0) {
 
-            uint32_t time1 = hdr->timestamp - first_hdr->timestamp;
-            uint32_t time2 = end_of_transmission_timestamp - first_hdr->timestamp;
+            uint64_t time1 = start;
+            uint64_t time2 = start + (uint32_t)(end_of_transmission_timestamp - hdr->timestamp);
             if (prev_eot) {
                 time1 = hdr->timestamp - previous_end_of_transmission_timestamp;
                 time2 = duration;
@@ -449,9 +457,9 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                                   (j == num_lines - 1) ? explanation : ""
                                  );
                 } else {
-                    PrintAndLogEx(NORMAL, " %10u | %10u | Tag |%-72s | %s| %s",
-                                  (hdr->timestamp - first_hdr->timestamp),
-                                  (end_of_transmission_timestamp - first_hdr->timestamp),
+                    PrintAndLogEx(NORMAL, " %10" PRIu64 " | %10" PRIu64 " | Tag |%-72s | %s| %s",
+                                  time1,
+                                  time2,
                                   line[j],
                                   (j == num_lines - 1) ? crc : "    ",
                                   (j == num_lines - 1) ? explanation : ""
@@ -470,9 +478,9 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                                  );
                 } else {
                     PrintAndLogEx(NORMAL,
-                                  _YELLOW_(" %10u") " | " _YELLOW_("%10u") " | " _YELLOW_("Rdr") " |" _YELLOW_("%-72s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
-                                  (hdr->timestamp - first_hdr->timestamp),
-                                  (end_of_transmission_timestamp - first_hdr->timestamp),
+                                  _YELLOW_(" %10" PRIu64) " | " _YELLOW_("%10" PRIu64) " | " _YELLOW_("Rdr") " |" _YELLOW_("%-72s")" | " _YELLOW_("%s") "| " _YELLOW_("%s"),
+                                  time1,
+                                  time2,
                                   line[j],
                                   (j == num_lines - 1) ? crc : "    ",
                                   (j == num_lines - 1) ? explanation : ""
@@ -518,9 +526,9 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
 
         tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
 
-        PrintAndLogEx(NORMAL, " %10u | %10u | %s |fdt (Frame Delay Time): " _YELLOW_("%d"),
-                      (end_of_transmission_timestamp - first_hdr->timestamp),
-                      (next_hdr->timestamp - first_hdr->timestamp),
+        PrintAndLogEx(NORMAL, " %10" PRIu64 " | %10" PRIu64 " | %s |fdt (Frame Delay Time): " _YELLOW_("%d"),
+                      start + (uint32_t)(end_of_transmission_timestamp - hdr->timestamp),
+                      start + (uint32_t)(next_hdr->timestamp - hdr->timestamp),
                       "   ",
                       (next_hdr->timestamp - end_of_transmission_timestamp));
     }
@@ -528,6 +536,329 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
     return tracepos;
 }
 
+static void print_trace_header(bool use_relative) {
+    PrintAndLogEx(NORMAL, "");
+    if (use_relative) {
+        PrintAndLogEx(NORMAL, "        Gap |   Duration | Src | Data (! denotes parity error, ' denotes short bytes)                    | CRC | Annotation");
+    } else {
+        PrintAndLogEx(NORMAL, "      Start |        End | Src | Data (! denotes parity error)                                           | CRC | Annotation");
+    }
+    PrintAndLogEx(NORMAL, "------------+------------+-----+-------------------------------------------------------------------------+-----+--------------------");
+}
+
+// Prints trace records as they are streamed from the device. Times are relative to first_hdr,
+// the first record of the stream. The first chunk gets the column headers
+void TracePrintStreamed(uint8_t *trace, uint16_t len, const tracelog_hdr_t *first_hdr, uint8_t protocol, bool first_chunk) {
+    if (first_chunk) {
+        print_trace_header(false);
+        if (protocol == ISO_14443A || protocol == PROTO_MIFARE)
+            ClearAuthData();
+    }
+
+    uint64_t tracepos = 0;
+    while (is_last_record(tracepos, len) == false) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + tracepos);
+        tracepos = printTraceLine(tracepos, len, trace, (uint32_t)(hdr->timestamp - first_hdr->timestamp), protocol, false, false, NULL, false, NULL, 0);
+    }
+}
+
+// Frames of the records in trace. A timestamp more than 2^31 lower than the one before counts
+// as a wrap of the 32 bit device timestamp, smaller drops are records logged out of order
+static int trace_build_frames(const uint8_t *trace, uint64_t len, uint8_t protocol, trace_frame_t **frames, uint64_t *count) {
+    trace_frame_t *f = NULL;
+    uint64_t n = 0, cap = 0;
+    uint64_t high = 0;
+    uint32_t prev = 0;
+    uint64_t pos = 0;
+
+    while (is_last_record(pos, len) == false) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + pos);
+        uint64_t rec_len = TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (pos + rec_len > len) {
+            break;
+        }
+
+        if (n == cap) {
+            cap = (cap) ? cap * 2 : 256;
+            trace_frame_t *tmp = realloc(f, cap * sizeof(trace_frame_t));
+            if (tmp == NULL) {
+                PrintAndLogEx(FAILED, "Cannot allocate memory for trace index");
+                free(f);
+                return PM3_EMALLOC;
+            }
+            f = tmp;
+        }
+
+        if (n && hdr->timestamp < prev && prev - hdr->timestamp > 0x80000000U) {
+            high += 0x100000000ULL;
+        }
+        prev = hdr->timestamp;
+
+        memset(&f[n], 0, sizeof(trace_frame_t));
+        f[n].offset = pos;
+        f[n].timestamp = high | hdr->timestamp;
+        f[n].protocol = protocol;
+        f[n].isResponse = hdr->isResponse;
+        f[n].data_len = hdr->data_len;
+        n++;
+        pos += rec_len;
+    }
+
+    *frames = f;
+    *count = n;
+    return PM3_SUCCESS;
+}
+
+// Maps a whole file copy-on-write, or reads it where mmap isn't available. *map_len stays 0 then
+static int trace_map_file(const char *path, uint8_t **data, uint64_t *len, size_t *map_len) {
+    *map_len = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return PM3_EFILE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return PM3_EFILE;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return PM3_EFILE;
+    }
+
+    *data = map;
+    *len = st.st_size;
+    *map_len = st.st_size;
+    return PM3_SUCCESS;
+#else
+    size_t size = 0;
+    int res = loadFile_safeEx(path, "", (void **)data, &size, false);
+    *len = size;
+    return res;
+#endif
+}
+
+static char *trace_index_path(const char *path) {
+    char *idxpath = calloc(strlen(path) + strlen(TRACE_INDEX_SUFFIX) + 1, sizeof(char));
+    if (idxpath != NULL) {
+        sprintf(idxpath, "%s%s", path, TRACE_INDEX_SUFFIX);
+    }
+    return idxpath;
+}
+
+// crc32 over the first and the last record. A trace rewritten to the same length won't match its old index
+static bool trace_records_crc(const uint8_t *trace, uint64_t len, const trace_frame_t *frames, uint64_t count, uint8_t *crc) {
+    memset(crc, 0, 4);
+    if (count == 0) {
+        return true;
+    }
+
+    uint8_t edge_crc[8] = {0};
+    const trace_frame_t *edge[2] = {&frames[0], &frames[count - 1]};
+    for (uint8_t i = 0; i < 2; i++) {
+        if (edge[i]->offset + TRACELOG_HDR_LEN > len) {
+            return false;
+        }
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(trace + edge[i]->offset);
+        uint64_t rec_len = TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (edge[i]->offset + rec_len > len) {
+            return false;
+        }
+        crc32_ex(trace + edge[i]->offset, rec_len, edge_crc + (i * 4));
+    }
+    crc32_ex(edge_crc, sizeof(edge_crc), crc);
+    return true;
+}
+
+// Maps the index next to trace file path, if there is one and it indexes this trace
+static int trace_load_index(const char *path, const uint8_t *trace, uint64_t trace_len) {
+    char *idxpath = trace_index_path(path);
+    if (idxpath == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    uint8_t *map = NULL;
+    uint64_t len = 0;
+    size_t map_len = 0;
+    if (trace_map_file(idxpath, &map, &len, &map_len) != PM3_SUCCESS) {
+        free(idxpath);
+        return PM3_EFILE;
+    }
+
+    uint8_t crc[4] = {0};
+    const trace_index_hdr_t *hdr = (const trace_index_hdr_t *)map;
+    if (len < sizeof(trace_index_hdr_t)
+            || memcmp(hdr->magic, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC)) != 0
+            || hdr->version != TRACE_INDEX_VERSION
+            || hdr->frame_size != sizeof(trace_frame_t)
+            || hdr->trace_len != trace_len
+            || hdr->frame_count > (len - sizeof(trace_index_hdr_t)) / sizeof(trace_frame_t)
+            || trace_records_crc(trace, trace_len, (const trace_frame_t *)(map + sizeof(trace_index_hdr_t)), hdr->frame_count, crc) == false
+            || memcmp(crc, hdr->records_crc, sizeof(crc)) != 0) {
+        PrintAndLogEx(WARNING, "Trace index " _YELLOW_("%s") " is stale or from another version, ignoring it", idxpath);
+#ifndef _WIN32
+        if (map_len) {
+            munmap(map, map_len);
+        }
+#else
+        free(map);
+#endif
+        free(idxpath);
+        return PM3_EFILE;
+    }
+
+    pm3_context_t *cctx = GetContext();
+    cctx->trace_index_map = map;
+    cctx->trace_index_map_len = map_len;
+    cctx->trace_frames = (const trace_frame_t *)(map + sizeof(trace_index_hdr_t));
+    cctx->trace_frame_count = hdr->frame_count;
+
+    PrintAndLogEx(SUCCESS, "loaded index of " _YELLOW_("%" PRIu64) " frames", hdr->frame_count);
+    free(idxpath);
+    return PM3_SUCCESS;
+}
+
+// Writes the index of trace next to trace file path
+static int trace_save_index(const char *path, const uint8_t *trace, uint64_t len, uint8_t protocol) {
+    trace_frame_t *frames = NULL;
+    uint64_t count = 0;
+    int res = trace_build_frames(trace, len, protocol, &frames, &count);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    char *idxpath = trace_index_path(path);
+    if (idxpath == NULL) {
+        free(frames);
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(idxpath, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked. '" _YELLOW_("%s")"'", idxpath);
+        free(idxpath);
+        free(frames);
+        return PM3_EFILE;
+    }
+
+    trace_index_hdr_t hdr = {
+        .version = TRACE_INDEX_VERSION,
+        .frame_size = sizeof(trace_frame_t),
+        .trace_len = len,
+        .frame_count = count,
+    };
+    memcpy(hdr.magic, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC));
+    trace_records_crc(trace, len, frames, count, hdr.records_crc);
+
+    res = PM3_SUCCESS;
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 || (count && fwrite(frames, sizeof(trace_frame_t), count, f) != count)) {
+        PrintAndLogEx(WARNING, "error writing trace index " _YELLOW_("%s"), idxpath);
+        res = PM3_EFILE;
+    }
+    fclose(f);
+
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(SUCCESS, "saved index of " _YELLOW_("%" PRIu64) " frames to " _YELLOW_("%s"), count, idxpath);
+    }
+    free(idxpath);
+    free(frames);
+    return res;
+}
+
+// Writes the index of an existing trace file, e.g. one streamed from the device
+int TraceIndexFile(const char *filename, uint8_t protocol) {
+    uint8_t *trace = NULL;
+    uint64_t len = 0;
+    size_t map_len = 0;
+    if (trace_map_file(filename, &trace, &len, &map_len) != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "Could not open file " _YELLOW_("%s"), filename);
+        return PM3_EFILE;
+    }
+
+    int res = trace_save_index(filename, trace, len, protocol);
+
+#ifndef _WIN32
+    if (map_len) {
+        munmap(trace, map_len);
+    }
+#else
+    free(trace);
+#endif
+    return res;
+}
+
+// Frame index of the context trace, built on first use and kept until the trace changes
+static int trace_get_frames(const trace_frame_t **frames, uint64_t *count) {
+    pm3_context_t *cctx = GetContext();
+    if (cctx->trace_frames == NULL) {
+        trace_frame_t *f = NULL;
+        uint64_t n = 0;
+        int res = trace_build_frames(cctx->trace, cctx->trace_len, TRACE_PROTOCOL_UNKNOWN, &f, &n);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+        cctx->trace_frames = f;
+        cctx->trace_frame_count = n;
+    }
+    *frames = cctx->trace_frames;
+    *count = cctx->trace_frame_count;
+    return PM3_SUCCESS;
+}
+
+// First frame at or after time from, counted from the first frame
+// time of frame idx relative to the first frame, frames logged before it count as 0
+static uint64_t trace_frame_time(const trace_frame_t *frames, uint64_t idx) {
+    return (frames[idx].timestamp > frames[0].timestamp) ? frames[idx].timestamp - frames[0].timestamp : 0;
+}
+
+static uint64_t trace_find_frame(const trace_frame_t *frames, uint64_t count, uint64_t from) {
+    uint64_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (trace_frame_time(frames, mid) < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int trace_protocol_from_str(const char *type, uint8_t *protocol) {
+    // no crc, no annotations
+    *protocol = TRACE_PROTOCOL_UNKNOWN;
+
+    // validate type of output
+    if (strcmp(type, "14a") == 0)      *protocol = ISO_14443A;
+    else if (strcmp(type, "14b") == 0)      *protocol = ISO_14443B;
+    else if (strcmp(type, "15") == 0)       *protocol = ISO_15693;
+    else if (strcmp(type, "7816") == 0)     *protocol = ISO_7816_4;
+    else if (strcmp(type, "cryptorf") == 0) *protocol = PROTO_CRYPTORF;
+    else if (strcmp(type, "des") == 0)      *protocol = MFDES;
+    else if (strcmp(type, "felica") == 0)   *protocol = FELICA;
+    else if (strcmp(type, "hitag1") == 0)   *protocol = PROTO_HITAG1;
+    else if (strcmp(type, "hitag2") == 0)   *protocol = PROTO_HITAG2;
+    else if (strcmp(type, "hitags") == 0)   *protocol = PROTO_HITAGS;
+    else if (strcmp(type, "iclass") == 0)   *protocol = ICLASS;
+    else if (strcmp(type, "legic") == 0)    *protocol = LEGIC;
+    else if (strcmp(type, "lto") == 0)      *protocol = LTO;
+    else if (strcmp(type, "mf") == 0)       *protocol = PROTO_MIFARE;
+    else if (strcmp(type, "raw") == 0)      *protocol = TRACE_PROTOCOL_UNKNOWN;
+    else if (strcmp(type, "seos") == 0)     *protocol = SEOS;
+    else if (strcmp(type, "thinfilm") == 0) *protocol = THINFILM;
+    else if (strcmp(type, "topaz") == 0)    *protocol = TOPAZ;
+    else if (strcmp(type, "") == 0)         *protocol = TRACE_PROTOCOL_UNKNOWN;
+    else {
+        PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
+        return PM3_EINVARG;
+    }
+    return PM3_SUCCESS;
+}
+
 static int download_trace(void) {
 
     if (IfPm3Present() == false) {
@@ -536,10 +867,7 @@ static int download_trace(void) {
     }
 
     // reserve some space.
-    if (gs_trace)
-        free(gs_trace);
-
-    gs_traceLen = 0;
+    ClearContextTrace(GetContext());
 
     gs_trace = calloc(PM3_CMD_DATA_SIZE, sizeof(uint8_t));
     if (gs_trace == NULL) {
@@ -553,8 +881,7 @@ static int download_trace(void) {
     PacketResponseNG response;
     if (!GetFromDevice(BIG_BUF, gs_trace, PM3_CMD_DATA_SIZE, 0, NULL, 0, &response, 4000, true)) {
         PrintAndLogEx(WARNING, "timeout while waiting for reply.");
-        free(gs_trace);
-        gs_trace = NULL;
+        ClearContextTrace(GetContext());
         return PM3_ETIMEOUT;
     }
 
@@ -567,13 +894,13 @@ static int download_trace(void) {
         gs_trace = calloc(gs_traceLen, sizeof(uint8_t));
         if (gs_trace == NULL) {
             PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+            gs_traceLen = 0;
             return PM3_EMALLOC;
         }
 
-        if (!GetFromDevice(BIG_BUF, gs_trace, gs_traceLen, 0, NULL, 0, NULL, 2500, false)) {
+        if (!GetFromDeviceEx(BIG_BUF, gs_trace, gs_traceLen, 0, NULL, 0, NULL, 2500, false, PrintDownloadProgress, NULL)) {
             PrintAndLogEx(WARNING, "command execution time out");
-            free(gs_trace);
-            gs_trace = NULL;
+            ClearContextTrace(GetContext());
             return PM3_ETIMEOUT;
         }
     }
@@ -612,20 +939,22 @@ static int CmdTraceLoad(const char *Cmd) {
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
-    if (gs_trace) {
-        free(gs_trace);
-        gs_trace = NULL;
-    }
+    ClearContextTrace(GetContext());
 
-    size_t len = 0;
-    if (loadFile_safe(filename, ".trace", (void **)&gs_trace, &len) != PM3_SUCCESS) {
+    // mapped, so big traces load instantly and only the listed frames are paged in
+    char *path = NULL;
+    if (searchFile(&path, RESOURCES_SUBDIR, filename, ".trace", false) != PM3_SUCCESS
+            || trace_map_file(path, &gs_trace, &gs_traceLen, &GetContext()->trace_map_len) != PM3_SUCCESS) {
         PrintAndLogEx(FAILED, "Could not open file " _YELLOW_("%s"), filename);
+        free(path);
         return PM3_EIO;
     }
 
-    gs_traceLen = (long)len;
+    PrintAndLogEx(SUCCESS, "loaded " _YELLOW_("%" PRIu64) " bytes from binary file " _YELLOW_("%s"), gs_traceLen, filename);
+    trace_load_index(path, gs_trace, gs_traceLen);
+    free(path);
 
-    PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%lu") " bytes)", gs_traceLen);
+    PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%" PRIu64) " bytes)", gs_traceLen);
     PrintAndLogEx(HINT, "try " _YELLOW_("`trace list -1 -t ...`") " to view trace.  Remember the " _YELLOW_("`-1`") " param");
     return PM3_SUCCESS;
 }
@@ -635,13 +964,15 @@ static int CmdTraceSave(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace save",
                   "Save protocol data from trace buffer to binary file\n"
-                  "File extension is <.trace>",
-                  "trace save -f mytracefile    -> w/o file extension"
+                  "File extension is <.trace>, its frame index is saved next to it as <.trace.idx>",
+                  "trace save -f mytracefile         -> w/o file extension\n"
+                  "trace save -f mytracefile -t 14a  -> record the protocol in the index"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str1("f", "file", "<fn>", "Specify trace file to save"),
+        arg_str0("t", "type", NULL, "protocol of the trace, `trace list` uses it when called without -t"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -649,8 +980,18 @@ static int CmdTraceSave(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    int tlen = 0;
+    char type[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)type, sizeof(type), &tlen);
+    str_lower(type);
     CLIParserFree(ctx);
 
+    uint8_t protocol;
+    if (trace_protocol_from_str(type, &protocol) != PM3_SUCCESS) {
+        return PM3_EINVARG;
+    }
+
     if (gs_traceLen == 0) {
         download_trace();
         if (gs_traceLen == 0) {
@@ -659,8 +1000,17 @@ static int CmdTraceSave(const char *Cmd) {
         }
     }
 
-    saveFile(filename, ".trace", gs_trace, gs_traceLen);
-    return PM3_SUCCESS;
+    char *fn = newfilenamemcopy(filename, ".trace");
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    int res = saveFile(fn, ".trace", gs_trace, gs_traceLen);
+    if (res == PM3_SUCCESS) {
+        res = trace_save_index(fn, gs_trace, gs_traceLen, protocol);
+    }
+    free(fn);
+    return res;
 }
 
 int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol) {
@@ -690,6 +1040,10 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0(NULL, "dict", "<file>", "use dictionary keys file"),
+        arg_u64_0(NULL, "from", "<dec>", "list frames starting at or after this time, in trace time units"),
+        arg_u64_0(NULL, "to", "<dec>", "list frames starting up to this time, in trace time units"),
+        arg_u64_0(NULL, "skip", "<dec>", "skip this many frames"),
+        arg_u64_0("n", "count", "<dec>", "list at most this many frames"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -728,7 +1082,9 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf --dict <mfc_default_keys>    -> use dictionary keys file\n"
                   "trace list -t 14a -f                          -> show frame delay times\n"
-                  "trace list -t 14a -1                          -> use trace buffer "
+                  "trace list -t 14a -1                          -> use trace buffer\n"
+                  "trace list -t 14a -1 --skip 1000 -n 50        -> list frames 1000 to 1049\n"
+                  "trace list -t 14a -1 --from 2000000 --to 3000000 -> list frames starting within this time"
                  );
 
     void *argtable[] = {
@@ -742,6 +1098,10 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", NULL, "protocol to annotate the trace"),
         arg_str0(NULL, "dict", "<fn>", "use dictionary keys file"),
+        arg_u64_0(NULL, "from", "<dec>", "list frames starting at or after this time, in trace time units"),
+        arg_u64_0(NULL, "to", "<dec>", "list frames starting up to this time, in trace time units"),
+        arg_u64_0(NULL, "skip", "<dec>", "skip this many frames"),
+        arg_u64_0("n", "count", "<dec>", "list at most this many frames"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -765,35 +1125,18 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    // times are in trace time units, as listed without -u, counted from the first frame
+    uint64_t from = arg_get_u64_def(ctx, 9, 0);
+    uint64_t to = arg_get_u64_def(ctx, 10, UINT64_MAX);
+    uint64_t skip = arg_get_u64_def(ctx, 11, 0);
+    uint64_t max_frames = arg_get_u64_def(ctx, 12, UINT64_MAX);
+
     CLIParserFree(ctx);
 
     clearCommandBuffer();
 
-    // no crc, no annotations
-    uint8_t protocol = -1;
-
-    // validate type of output
-    if (strcmp(type, "14a") == 0)      protocol = ISO_14443A;
-    else if (strcmp(type, "14b") == 0)      protocol = ISO_14443B;
-    else if (strcmp(type, "15") == 0)       protocol = ISO_15693;
-    else if (strcmp(type, "7816") == 0)     protocol = ISO_7816_4;
-    else if (strcmp(type, "cryptorf") == 0) protocol = PROTO_CRYPTORF;
-    else if (strcmp(type, "des") == 0)      protocol = MFDES;
-    else if (strcmp(type, "felica") == 0)   protocol = FELICA;
-    else if (strcmp(type, "hitag1") == 0)   protocol = PROTO_HITAG1;
-    else if (strcmp(type, "hitag2") == 0)   protocol = PROTO_HITAG2;
-    else if (strcmp(type, "hitags") == 0)   protocol = PROTO_HITAGS;
-    else if (strcmp(type, "iclass") == 0)   protocol = ICLASS;
-    else if (strcmp(type, "legic") == 0)    protocol = LEGIC;
-    else if (strcmp(type, "lto") == 0)      protocol = LTO;
-    else if (strcmp(type, "mf") == 0)       protocol = PROTO_MIFARE;
-    else if (strcmp(type, "raw") == 0)      protocol = -1;
-    else if (strcmp(type, "seos") == 0)     protocol = SEOS;
-    else if (strcmp(type, "thinfilm") == 0) protocol = THINFILM;
-    else if (strcmp(type, "topaz") == 0)    protocol = TOPAZ;
-    else if (strcmp(type, "") == 0)         protocol = -1;
-    else {
-        PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
+    uint8_t protocol;
+    if (trace_protocol_from_str(type, &protocol) != PM3_SUCCESS) {
         return PM3_EINVARG;
     }
 
@@ -804,21 +1147,44 @@ int CmdTraceList(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    PrintAndLogEx(SUCCESS, "Recorded activity (trace len = " _YELLOW_("%lu") " bytes)", gs_traceLen);
+    PrintAndLogEx(SUCCESS, "Recorded activity (trace len = " _YELLOW_("%" PRIu64) " bytes)", gs_traceLen);
     if (gs_traceLen == 0) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    const trace_frame_t *frames = NULL;
+    uint64_t frame_count = 0;
+    int res = trace_get_frames(&frames, &frame_count);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    if (frame_count == 0) {
+        return PM3_SUCCESS;
+    }
+
+    // a trace saved with its protocol is annotated with it, unless asked otherwise
+    if (tlen == 0 && frames[0].protocol != TRACE_PROTOCOL_UNKNOWN) {
+        protocol = frames[0].protocol;
+    }
+
+    // the index gets us to the first frame to list without walking the records before it
+    uint64_t fidx = trace_find_frame(frames, frame_count, from);
+    fidx = (skip > frame_count - fidx) ? frame_count : fidx + skip;
 
     /*
     if (protocol == FELICA) {
         printFelica(gs_traceLen, gs_trace);
     } */
 
+    uint64_t listed = 0;
+
     if (show_hex) {
-        while (tracepos < gs_traceLen) {
-            tracepos = printHexLine(tracepos, gs_traceLen, gs_trace, protocol);
+        while (fidx < frame_count && listed < max_frames && trace_frame_time(frames, fidx) <= to) {
+            uint64_t tracepos = printHexLine(frames[fidx].offset, gs_traceLen, gs_trace, protocol);
+            listed++;
+            while (fidx < frame_count && frames[fidx].offset < tracepos) {
+                fidx++;
+            }
         }
     } else {
 
@@ -902,13 +1268,7 @@ int CmdTraceList(const char *Cmd) {
             }
         }
 
-        PrintAndLogEx(NORMAL, "");
-        if (use_relative) {
-            PrintAndLogEx(NORMAL, "        Gap |   Duration | Src | Data (! denotes parity error, ' denotes short bytes)                    | CRC | Annotation");
-        } else {
-            PrintAndLogEx(NORMAL, "      Start |        End | Src | Data (! denotes parity error)                                           | CRC | Annotation");
-        }
-        PrintAndLogEx(NORMAL, "------------+------------+-----+-------------------------------------------------------------------------+-----+--------------------");
+        print_trace_header(use_relative);
 
         // clean authentication data used with the mifare classic decrypt fct
         if (protocol == ISO_14443A || protocol == PROTO_MIFARE)
@@ -920,8 +1280,14 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        while (fidx < frame_count && listed < max_frames && trace_frame_time(frames, fidx) <= to) {
+            uint64_t tracepos = printTraceLine(frames[fidx].offset, gs_traceLen, gs_trace, trace_frame_time(frames, fidx), protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+            listed++;
+
+            // merged topaz frames are listed as one
+            while (fidx < frame_count && frames[fidx].offset < tracepos) {
+                fidx++;
+            }
 
             if (kbd_enter_pressed())
                 break;
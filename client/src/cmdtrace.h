@@ -20,9 +20,38 @@
 #define CMDTRACE_H__
 
 #include "common.h"
+#include "pm3_cmd.h"    // tracelog_hdr_t
+
+// Frame index written next to a trace file as <file>.trace.idx, so big traces can be listed
+// from any frame or time without walking all records before it.
+// The .trace file itself stays the raw tracelog records.
+#define TRACE_INDEX_SUFFIX      ".idx"
+#define TRACE_INDEX_MAGIC       "PM3TIDX"
+#define TRACE_INDEX_VERSION     1
+#define TRACE_PROTOCOL_UNKNOWN  0xFF
+
+typedef struct {
+    char magic[8];
+    uint16_t version;
+    uint16_t frame_size;        // sizeof(trace_frame_t)
+    uint8_t records_crc[4];     // crc32 of the first and the last record, the index is stale if it differs
+    uint64_t trace_len;         // length of the indexed trace file, the index is stale if it differs
+    uint64_t frame_count;
+} PACKED trace_index_hdr_t;
+
+typedef struct trace_frame {
+    uint64_t offset;            // of the record in the trace
+    uint64_t timestamp;         // record timestamp, 32 bit wraps unrolled so it never decreases
+    uint8_t protocol;           // TRACE_PROTOCOL_UNKNOWN if not known when indexed
+    uint8_t isResponse;
+    uint16_t data_len;
+    uint32_t reserved;
+} PACKED trace_frame_t;
 
 int CmdTrace(const char *Cmd);
 int CmdTraceList(const char *Cmd);
 int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol);
+void TracePrintStreamed(uint8_t *trace, uint16_t len, const tracelog_hdr_t *first_hdr, uint8_t protocol, bool first_chunk);
+int TraceIndexFile(const char *filename, uint8_t protocol);
 
 #endif
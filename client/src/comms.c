@@ -22,54 +22,172 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <sys/time.h>
 
 #include "uart/uart.h"
 #include "ui.h"
 #include "crc16.h"
+#include "lz4/lz4.h"
 #include "util.h" // g_pendingPrompt
 #include "util_posix.h" // msclock
 #include "util_darwin.h" // en/dis-ableNapp();
+#include "usart_defs.h" // USART_FIFOLEN
 
 //#define COMMS_DEBUG
 //#define COMMS_DEBUG_RAW
 
-// Serial port that we are communicating with the PM3 on.
-static serial_port sp = NULL;
+// longest sleep of a waiter, so timeouts and warnings are still checked without packets
+#define RX_WAIT_SLICE_MS 100
+
+// State of the connection to one Proxmark3
+typedef struct {
+    pm3_device_t device;
+    communication_arg_t arg;        // g_conn of the device
+    capabilities_t capabilities;    // g_pm3_capabilities of the device
+    bool present;
+
+    // Serial port that we are communicating with the PM3 on.
+    serial_port sp;
+
+    pthread_t communication_thread;
+    bool comm_thread_dead;
+
+    // Transmit buffer.
+    PacketCommandOLD txBuffer;
+    PacketCommandNGSeqRaw txBufferNG;
+    size_t txBufferNGLen;
+    bool txBuffer_pending;
+    pthread_mutex_t txBufferMutex;
+    pthread_cond_t txBufferSig;
+    // set when uart_send failed, the communication thread gives up then
+    bool tx_failed;
+    // last sequence number used in windowed mode, 0 is never used
+    uint16_t tx_seq;
+
+    // Used by PacketResponseReceived as a ring buffer for messages that are yet to be
+    // processed by a command handler (WaitForResponse{,Timeout})
+    PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
+    // Points to the next empty position to write to
+    int cmd_head;
+    // Points to the position of the last unread command
+    int cmd_tail;
+    // to lock rxBuffer operations from different threads
+    pthread_mutex_t rxBufferMutex;
+
+    // signalled by storeReply when a packet the waiter is interested in arrives,
+    // rx_waiter_cmd is the command it waits for, CMD_UNKNOWN wakes on any packet.
+    // Both are protected by rxBufferMutex
+    pthread_cond_t rxBufferSig;
+    uint32_t rx_waiter_cmd;
+    bool rx_waiter_woken;
+
+    // Bulk download: the communication thread receives the chunks (OLD frames of cmd) of the running
+    // download straight into dest, they don't pass rxBuffer. rxBulkMutex is held while dest is written,
+    // so once bulkStop(c) returned the buffer is not touched anymore.
+    // Compressed BigBuf chunks (CMD_DOWNLOADED_BIGBUF_LZ4, MIX frames) are decompressed into dest, see receiveLZ4.
+    pthread_mutex_t rxBulkMutex;
+    struct {
+        uint64_t cmd;
+        uint8_t *dest;          // NULL if no download is running
+        uint32_t size;
+        uint32_t received;      // atomic, read by the waiter for its progress
+        bool overflow;          // a chunk didn't fit into dest
+    } rx_bulk;
+
+    // Start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
+    // as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
+    uint64_t timeout_start_time;
+    uint64_t last_packet_time;
+} pm3_connection_t;
+
+static pm3_connection_t connections[PM3_MAX_DEVICES + 1]; // + PM3_OFFLINE_DEVICE
+static pthread_once_t connections_once = PTHREAD_ONCE_INIT;
+// device selected by the calling thread, see SelectProxmark
+static __thread pm3_connection_t *selected_connection = NULL;
+
+static void initConnections(void) {
+    for (int i = 0; i <= PM3_OFFLINE_DEVICE; i++) {
+        pm3_connection_t *c = &connections[i];
+        c->device.conn = &c->arg;
+        c->device.index = i;
+        c->rx_waiter_cmd = CMD_UNKNOWN;
+        pthread_mutex_init(&c->txBufferMutex, NULL);
+        pthread_cond_init(&c->txBufferSig, NULL);
+        pthread_mutex_init(&c->rxBufferMutex, NULL);
+        pthread_cond_init(&c->rxBufferSig, NULL);
+        pthread_mutex_init(&c->rxBulkMutex, NULL);
+    }
+}
 
-communication_arg_t g_conn;
-capabilities_t g_pm3_capabilities;
+// the connection the calling thread talks to
+static pm3_connection_t *conn(void) {
+    pthread_once(&connections_once, initConnections);
+    if (selected_connection) {
+        return selected_connection;
+    }
+    // the default device, slot 0 until one is connected
+    if (g_session.current_device) {
+        return &connections[g_session.current_device->index];
+    }
+    return &connections[0];
+}
 
-static pthread_t communication_thread;
-static bool comm_thread_dead = false;
+static pm3_connection_t *deviceConn(pm3_device_t *dev) {
+    pthread_once(&connections_once, initConnections);
+    return &connections[dev->index];
+}
 
-// Transmit buffer.
-static PacketCommandOLD txBuffer;
-static PacketCommandNGRaw txBufferNG;
-static size_t txBufferNGLen;
-static bool txBuffer_pending = false;
-static pthread_mutex_t txBufferMutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t txBufferSig = PTHREAD_COND_INITIALIZER;
+communication_arg_t *GetConnection(void) {
+    return &conn()->arg;
+}
 
-// Used by PacketResponseReceived as a ring buffer for messages that are yet to be
-// processed by a command handler (WaitForResponse{,Timeout})
-static PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
+capabilities_t *GetCapabilities(void) {
+    return &conn()->capabilities;
+}
 
-// Points to the next empty position to write to
-static int cmd_head = 0;
+static bool dl_it(pm3_connection_t *c, uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd, dl_progress_t progress, void *progress_ctx);
 
-// Points to the position of the last unread command
-static int cmd_tail = 0;
+// Sends the pending txBuffer to the device, txBufferMutex must be held.
+static void sendTxBuffer(pm3_connection_t *c) {
+    if (c->txBuffer_pending == false || c->sp == NULL) {
+        return;
+    }
+
+    int res;
+    if (c->txBufferNGLen) { // NG packet
+        res = uart_send(c->sp, (uint8_t *) &c->txBufferNG, c->txBufferNGLen);
+        c->arg.last_command = c->txBufferNG.pre.pre.cmd;
+        c->txBufferNGLen = 0;
+    } else {
+        res = uart_send(c->sp, (uint8_t *) &c->txBuffer, sizeof(PacketCommandOLD));
+        c->arg.last_command = c->txBuffer.cmd;
+    }
+    if (res == PM3_EIO) {
+        c->tx_failed = true;
+    }
+
+    c->txBuffer_pending = false;
 
-// to lock rxBuffer operations from different threads
-static pthread_mutex_t rxBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+    // main thread doesn't know send failed...
 
-// Global start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
-// as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
-static uint64_t timeout_start_time;
+    // tell main thread that txBuffer is empty
+    pthread_cond_signal(&c->txBufferSig);
+}
 
-static uint64_t last_packet_time;
+// Commands are sent right away by the calling thread instead of waiting for the communication
+// thread to time out in uart_receive. Only in block_after_ACK mode the communication thread
+// sends them, as it waits for the next command after an ACK anyway.
+static void queueTxBuffer(pm3_connection_t *c) {
+    c->txBuffer_pending = true;
 
-static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
+    if (c->arg.block_after_ACK == false) {
+        sendTxBuffer(c);
+    }
+
+    // tell communication thread that a new command can be send
+    pthread_cond_signal(&c->txBufferSig);
+}
 
 // Simple alias to track usages linked to the Bootloader, these commands must not be migrated.
 // - commands sent to enter bootloader mode as we might have to talk to old firmwares
@@ -79,55 +197,53 @@ void SendCommandBL(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, vo
 }
 
 void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len) {
-    PacketCommandOLD c = {CMD_UNKNOWN, {0, 0, 0}, {{0}}};
-    c.cmd = cmd;
-    c.arg[0] = arg0;
-    c.arg[1] = arg1;
-    c.arg[2] = arg2;
+    pm3_connection_t *c = conn();
+    PacketCommandOLD packet = {CMD_UNKNOWN, {0, 0, 0}, {{0}}};
+    packet.cmd = cmd;
+    packet.arg[0] = arg0;
+    packet.arg[1] = arg1;
+    packet.arg[2] = arg2;
     if (len && data)
-        memcpy(&c.d, data, len);
+        memcpy(&packet.d, data, len);
 
 #ifdef COMMS_DEBUG
     PrintAndLogEx(NORMAL, "Sending %s", "OLD");
 #endif
 #ifdef COMMS_DEBUG_RAW
-    print_hex_break((uint8_t *)&c.cmd, sizeof(c.cmd), 32);
-    print_hex_break((uint8_t *)&c.arg, sizeof(c.arg), 32);
-    print_hex_break((uint8_t *)&c.d, sizeof(c.d), 32);
+    print_hex_break((uint8_t *)&packet.cmd, sizeof(packet.cmd), 32);
+    print_hex_break((uint8_t *)&packet.arg, sizeof(packet.arg), 32);
+    print_hex_break((uint8_t *)&packet.d, sizeof(packet.d), 32);
 #endif
 
-    if (!g_session.pm3_present) {
+    if (!c->present) {
         PrintAndLogEx(WARNING, "Sending bytes to Proxmark3 failed." _YELLOW_("offline"));
         return;
     }
 
-    pthread_mutex_lock(&txBufferMutex);
+    pthread_mutex_lock(&c->txBufferMutex);
     /**
     This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
     but comm thread just spins here. Not good.../holiman
     **/
-    while (txBuffer_pending) {
+    while (c->txBuffer_pending) {
         // wait for communication thread to complete sending a previous command
-        pthread_cond_wait(&txBufferSig, &txBufferMutex);
+        pthread_cond_wait(&c->txBufferSig, &c->txBufferMutex);
     }
 
-    txBuffer = c;
-    txBuffer_pending = true;
-
-    // tell communication thread that a new command can be send
-    pthread_cond_signal(&txBufferSig);
+    c->txBuffer = packet;
+    queueTxBuffer(c);
 
-    pthread_mutex_unlock(&txBufferMutex);
+    pthread_mutex_unlock(&c->txBufferMutex);
 
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
 
-static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool ng) {
+static void SendCommandNG_internal(pm3_connection_t *c, uint16_t cmd, uint8_t *data, size_t len, bool ng, uint16_t seq) {
 #ifdef COMMS_DEBUG
     PrintAndLogEx(INFO, "Sending %s", ng ? "NG" : "MIX");
 #endif
 
-    if (!g_session.pm3_present) {
+    if (!c->present) {
         PrintAndLogEx(INFO, "Sending bytes to proxmark failed - offline");
         return;
     }
@@ -136,60 +252,77 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
         return;
     }
 
-    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketCommandNGPreamble) + len);
+    // windowed commands carry their sequence number after the preamble
+    size_t prelen = seq ? sizeof(PacketCommandNGSeqPreamble) : sizeof(PacketCommandNGPreamble);
+    uint8_t *tx_data = (uint8_t *)&c->txBufferNG + prelen;
+    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)(tx_data + len);
 
-    pthread_mutex_lock(&txBufferMutex);
+    pthread_mutex_lock(&c->txBufferMutex);
     /**
     This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
     but comm thread just spins here. Not good.../holiman
     **/
-    while (txBuffer_pending) {
+    while (c->txBuffer_pending) {
         // wait for communication thread to complete sending a previous command
-        pthread_cond_wait(&txBufferSig, &txBufferMutex);
+        pthread_cond_wait(&c->txBufferSig, &c->txBufferMutex);
     }
 
-    txBufferNG.pre.magic = COMMANDNG_PREAMBLE_MAGIC;
-    txBufferNG.pre.ng = ng;
-    txBufferNG.pre.length = len;
-    txBufferNG.pre.cmd = cmd;
+    c->txBufferNG.pre.pre.magic = seq ? COMMANDNG_SEQ_PREAMBLE_MAGIC : COMMANDNG_PREAMBLE_MAGIC;
+    c->txBufferNG.pre.pre.ng = ng;
+    c->txBufferNG.pre.pre.length = len;
+    c->txBufferNG.pre.pre.cmd = cmd;
+    c->txBufferNG.pre.seq = seq;
     if (len > 0 && data)
-        memcpy(&txBufferNG.data, data, len);
+        memcpy(tx_data, data, len);
 
-    if ((g_conn.send_via_fpc_usart && g_conn.send_with_crc_on_fpc) || ((!g_conn.send_via_fpc_usart) && g_conn.send_with_crc_on_usb)) {
+    if ((c->arg.send_via_fpc_usart && c->arg.send_with_crc_on_fpc) || ((!c->arg.send_via_fpc_usart) && c->arg.send_with_crc_on_usb)) {
         uint8_t first, second;
-        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketCommandNGPreamble) + len, &first, &second);
+        compute_crc(CRC_14443_A, (uint8_t *)&c->txBufferNG, prelen + len, &first, &second);
         tx_post->crc = (first << 8) + second;
     } else {
         tx_post->crc = COMMANDNG_POSTAMBLE_MAGIC;
     }
 
-    txBufferNGLen = sizeof(PacketCommandNGPreamble) + len + sizeof(PacketCommandNGPostamble);
+    c->txBufferNGLen = prelen + len + sizeof(PacketCommandNGPostamble);
 
 #ifdef COMMS_DEBUG_RAW
-    print_hex_break((uint8_t *)&txBufferNG.pre, sizeof(PacketCommandNGPreamble), 32);
+    print_hex_break((uint8_t *)&c->txBufferNG.pre, prelen, 32);
     if (ng) {
-        print_hex_break((uint8_t *)&txBufferNG.data, len, 32);
+        print_hex_break(tx_data, len, 32);
     } else {
-        print_hex_break((uint8_t *)&txBufferNG.data, 3 * sizeof(uint64_t), 32);
-        print_hex_break((uint8_t *)&txBufferNG.data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
+        print_hex_break(tx_data, 3 * sizeof(uint64_t), 32);
+        print_hex_break(tx_data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
     }
     print_hex_break((uint8_t *)tx_post, sizeof(PacketCommandNGPostamble), 32);
 #endif
-    txBuffer_pending = true;
-
-    // tell communication thread that a new command can be send
-    pthread_cond_signal(&txBufferSig);
+    queueTxBuffer(c);
 
-    pthread_mutex_unlock(&txBufferMutex);
+    pthread_mutex_unlock(&c->txBufferMutex);
 
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
 
 void SendCommandNG(uint16_t cmd, uint8_t *data, size_t len) {
-    SendCommandNG_internal(cmd, data, len, true);
+    pm3_connection_t *c = conn();
+    SendCommandNG_internal(c, cmd, data, len, true, 0);
+}
+
+uint16_t SendCommandNGSeq(uint16_t cmd, uint8_t *data, size_t len) {
+    pm3_connection_t *c = conn();
+    if (c->arg.cmd_window == 0) {
+        return 0;
+    }
+
+    c->tx_seq++;
+    if (c->tx_seq == 0) {
+        c->tx_seq = 1;
+    }
+    SendCommandNG_internal(c, cmd, data, len, true, c->tx_seq);
+    return c->tx_seq;
 }
 
 void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len) {
+    pm3_connection_t *c = conn();
     uint64_t arg[3] = {arg0, arg1, arg2};
     if (len > PM3_CMD_DATA_SIZE_MIX) {
         PrintAndLogEx(WARNING, "Sending %zu bytes of payload is too much for MIX frames, abort", len);
@@ -199,7 +332,7 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, v
     memcpy(cmddata, arg, sizeof(arg));
     if (len && data)
         memcpy(cmddata + sizeof(arg), data, len);
-    SendCommandNG_internal(cmd, cmddata, len + sizeof(arg), false);
+    SendCommandNG_internal(c, cmd, cmddata, len + sizeof(arg), false, 0);
 }
 
 
@@ -210,65 +343,257 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, v
  *  operation. Right now we'll just have to live with this.
  */
 void clearCommandBuffer(void) {
+    pm3_connection_t *c = conn();
     //This is a very simple operation
-    pthread_mutex_lock(&rxBufferMutex);
-    cmd_tail = cmd_head;
-    pthread_mutex_unlock(&rxBufferMutex);
+    pthread_mutex_lock(&c->rxBufferMutex);
+    c->cmd_tail = c->cmd_head;
+    pthread_mutex_unlock(&c->rxBufferMutex);
 }
 /**
  * @brief storeCommand stores a USB command in a circular buffer
  * @param UC
  */
-static void storeReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    if ((cmd_head + 1) % CMD_BUFFER_SIZE == cmd_tail) {
+static void storeReply(pm3_connection_t *c, PacketResponseNG *packet) {
+    pthread_mutex_lock(&c->rxBufferMutex);
+    if ((c->cmd_head + 1) % CMD_BUFFER_SIZE == c->cmd_tail) {
         //If these two are equal, we're about to overwrite in the
         // circular buffer.
         PrintAndLogEx(FAILED, "WARNING: Command buffer about to overwrite command! This needs to be fixed!");
         fflush(stdout);
     }
     //Store the command at the 'head' location
-    PacketResponseNG *destination = &rxBuffer[cmd_head];
+    PacketResponseNG *destination = &c->rxBuffer[c->cmd_head];
     memcpy(destination, packet, sizeof(PacketResponseNG));
 
     //increment head and wrap
-    cmd_head = (cmd_head + 1) % CMD_BUFFER_SIZE;
-    pthread_mutex_unlock(&rxBufferMutex);
+    c->cmd_head = (c->cmd_head + 1) % CMD_BUFFER_SIZE;
+
+    // wake up the waiter if it is interested in this one
+    if (c->rx_waiter_cmd == CMD_UNKNOWN || packet->cmd == c->rx_waiter_cmd || packet->cmd == CMD_WTX) {
+        c->rx_waiter_woken = true;
+        pthread_cond_signal(&c->rxBufferSig);
+    }
+    pthread_mutex_unlock(&c->rxBufferMutex);
+}
+
+/**
+ * @brief registers the command a waiter is waiting for. Call it before draining the buffer with getReply,
+ *  so no reply stored in between is missed.
+ * @param cmd command to wait for, or CMD_UNKNOWN to wake up on any command.
+ */
+static void setReplyWaiter(pm3_connection_t *c, uint32_t cmd) {
+    pthread_mutex_lock(&c->rxBufferMutex);
+    c->rx_waiter_cmd = cmd;
+    c->rx_waiter_woken = false;
+    pthread_mutex_unlock(&c->rxBufferMutex);
+}
+
+/**
+ * @brief sleeps until storeReply got a packet for the registered waiter, the communication thread
+ *  died or ms milliseconds elapsed.
+ */
+static void waitReply(pm3_connection_t *c, uint64_t ms) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    uint64_t ns = (uint64_t)now.tv_usec * 1000 + ms * 1000000;
+    struct timespec deadline;
+    deadline.tv_sec = now.tv_sec + ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    pthread_mutex_lock(&c->rxBufferMutex);
+    while (c->rx_waiter_woken == false) {
+        if (pthread_cond_timedwait(&c->rxBufferSig, &c->rxBufferMutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    c->rx_waiter_woken = false;
+    pthread_mutex_unlock(&c->rxBufferMutex);
+}
+
+// how long a waiter may sleep before it has to look at its timeout again
+static uint64_t waitReplySlice(size_t ms_timeout, uint64_t start_clk) {
+    uint64_t elapsed = msclock() - start_clk;
+    if (ms_timeout != (size_t) - 1 && elapsed < ms_timeout) {
+        return MIN(ms_timeout - elapsed + 1, RX_WAIT_SLICE_MS);
+    }
+    return RX_WAIT_SLICE_MS;
+}
+
+// directs the chunks cmd into dest, call it before sending the download command
+static void bulkStart(pm3_connection_t *c, uint64_t cmd, uint8_t *dest, uint32_t size) {
+    pthread_mutex_lock(&c->rxBulkMutex);
+    c->rx_bulk.cmd = cmd;
+    c->rx_bulk.dest = dest;
+    c->rx_bulk.size = size;
+    c->rx_bulk.overflow = false;
+    __atomic_store_n(&c->rx_bulk.received, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&c->rxBulkMutex);
+}
+
+// ends the download, late chunks go to rxBuffer again. Returns false if a chunk didn't fit
+static bool bulkStop(pm3_connection_t *c) {
+    pthread_mutex_lock(&c->rxBulkMutex);
+    c->rx_bulk.dest = NULL;
+    bool ok = (c->rx_bulk.overflow == false);
+    pthread_mutex_unlock(&c->rxBulkMutex);
+    return ok;
+}
+
+/**
+ * @brief receives the rest of an OLD frame, after its preamble. The payload of a chunk of the running
+ *  bulk download is received right into its destination.
+ * @return PM3_SUCCESS if it was a bulk chunk, PM3_ENODATA for other frames, PM3_EIO on errors
+ */
+static int receiveOLD(pm3_connection_t *c, PacketResponseOLD *rx_old) {
+    uint8_t *p = (uint8_t *)rx_old + sizeof(PacketResponseNGPreamble);
+    uint32_t hdrlen = offsetof(PacketResponseOLD, d) - sizeof(PacketResponseNGPreamble);
+    uint32_t rxlen = 0;
+
+    if ((uart_receive(c->sp, p, hdrlen, &rxlen) != PM3_SUCCESS) || (rxlen != hdrlen)) {
+        return PM3_EIO;
+    }
+
+    int res = PM3_ENODATA;
+    uint32_t chunklen = 0;
+    pthread_mutex_lock(&c->rxBulkMutex);
+    if (c->rx_bulk.dest && rx_old->cmd == c->rx_bulk.cmd) {
+        uint64_t offset = rx_old->arg[0];
+        chunklen = MIN(rx_old->arg[1], PM3_CMD_DATA_SIZE);
+        if (offset + chunklen > c->rx_bulk.size) {
+            PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %" PRIu64 " | len %u | buf_size %u", offset, chunklen, c->rx_bulk.size);
+            c->rx_bulk.overflow = true;
+            chunklen = 0;
+        } else if (chunklen) {
+            if ((uart_receive(c->sp, c->rx_bulk.dest + offset, chunklen, &rxlen) != PM3_SUCCESS) || (rxlen != chunklen)) {
+                pthread_mutex_unlock(&c->rxBulkMutex);
+                return PM3_EIO;
+            }
+            __atomic_add_fetch(&c->rx_bulk.received, chunklen, __ATOMIC_SEQ_CST);
+        }
+        res = PM3_SUCCESS;
+    }
+    pthread_mutex_unlock(&c->rxBulkMutex);
+
+    // the rest of the frame
+    uint32_t restlen = PM3_CMD_DATA_SIZE - chunklen;
+    if (restlen && ((uart_receive(c->sp, rx_old->d.asBytes + chunklen, restlen, &rxlen) != PM3_SUCCESS) || (rxlen != restlen))) {
+        return PM3_EIO;
+    }
+
+    if (res == PM3_SUCCESS) {
+        // like PacketResponseReceived, a chunk resets the timeout and wakes the waiter
+        __atomic_store_n(&c->timeout_start_time, msclock(), __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&c->rxBufferMutex);
+        c->rx_waiter_woken = true;
+        pthread_cond_signal(&c->rxBufferSig);
+        pthread_mutex_unlock(&c->rxBufferMutex);
+    }
+    return res;
 }
+/**
+ * @brief decompresses a CMD_DOWNLOADED_BIGBUF_LZ4 chunk of the running BigBuf download into its destination.
+ *  arg0 = offset, arg1 = uncompressed length, data = one LZ4 block
+ * @return true if the packet was such a chunk
+ */
+static bool receiveLZ4(pm3_connection_t *c, PacketResponseNG *rx) {
+    if (rx->cmd != CMD_DOWNLOADED_BIGBUF_LZ4) {
+        return false;
+    }
+
+    pthread_mutex_lock(&c->rxBulkMutex);
+    if ((c->rx_bulk.dest == NULL) || (c->rx_bulk.cmd != CMD_DOWNLOADED_BIGBUF)) {
+        // late chunk, nobody is waiting for it
+        pthread_mutex_unlock(&c->rxBulkMutex);
+        return true;
+    }
+
+    uint64_t offset = rx->oldarg[0];
+    uint32_t chunklen = rx->oldarg[1];
+    if (offset + chunklen > c->rx_bulk.size) {
+        PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %" PRIu64 " | len %u | buf_size %u", offset, chunklen, c->rx_bulk.size);
+        c->rx_bulk.overflow = true;
+    } else {
+        int res = LZ4_decompress_safe((const char *)rx->data.asBytes, (char *)c->rx_bulk.dest + offset, rx->length, chunklen);
+        if (res != (int)chunklen) {
+            PrintAndLogEx(FAILED, "ERROR: Failed to decompress chunk from device,  offset %" PRIu64 " | len %u | result %d", offset, chunklen, res);
+            c->rx_bulk.overflow = true;
+        } else {
+            __atomic_add_fetch(&c->rx_bulk.received, chunklen, __ATOMIC_SEQ_CST);
+        }
+    }
+    pthread_mutex_unlock(&c->rxBulkMutex);
+
+    __atomic_store_n(&c->timeout_start_time, msclock(), __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&c->rxBufferMutex);
+    c->rx_waiter_woken = true;
+    pthread_cond_signal(&c->rxBufferSig);
+    pthread_mutex_unlock(&c->rxBufferMutex);
+    return true;
+}
+
 /**
  * @brief getCommand gets a command from an internal circular buffer.
  * @param response location to write command
  * @return 1 if response was returned, 0 if nothing has been received
  */
-static int getReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
+static int getReply(pm3_connection_t *c, PacketResponseNG *packet) {
+    pthread_mutex_lock(&c->rxBufferMutex);
     //If head == tail, there's nothing to read, or if we just got initialized
-    if (cmd_head == cmd_tail)  {
-        pthread_mutex_unlock(&rxBufferMutex);
+    if (c->cmd_head == c->cmd_tail)  {
+        pthread_mutex_unlock(&c->rxBufferMutex);
         return 0;
     }
 
     //Pick out the next unread command
-    memcpy(packet, &rxBuffer[cmd_tail], sizeof(PacketResponseNG));
+    memcpy(packet, &c->rxBuffer[c->cmd_tail], sizeof(PacketResponseNG));
 
     //Increment tail - this is a circular buffer, so modulo buffer size
-    cmd_tail = (cmd_tail + 1) % CMD_BUFFER_SIZE;
+    c->cmd_tail = (c->cmd_tail + 1) % CMD_BUFFER_SIZE;
 
-    pthread_mutex_unlock(&rxBufferMutex);
+    pthread_mutex_unlock(&c->rxBufferMutex);
     return 1;
 }
 
+/**
+ * @brief getReplySeq takes the reply with sequence number seq (or a CMD_WTX) out of the circular buffer,
+ *  leaving the other replies in place for their waiters.
+ * @return 1 if response was returned, 0 if it hasn't been received
+ */
+static int getReplySeq(pm3_connection_t *c, uint16_t seq, PacketResponseNG *packet) {
+    pthread_mutex_lock(&c->rxBufferMutex);
+    for (int i = c->cmd_tail; i != c->cmd_head; i = (i + 1) % CMD_BUFFER_SIZE) {
+        if (c->rxBuffer[i].seq != seq && c->rxBuffer[i].cmd != CMD_WTX) {
+            continue;
+        }
+
+        memcpy(packet, &c->rxBuffer[i], sizeof(PacketResponseNG));
+
+        // close the gap, the older replies move up by one
+        while (i != c->cmd_tail) {
+            int prev = (i + CMD_BUFFER_SIZE - 1) % CMD_BUFFER_SIZE;
+            memcpy(&c->rxBuffer[i], &c->rxBuffer[prev], sizeof(PacketResponseNG));
+            i = prev;
+        }
+        c->cmd_tail = (c->cmd_tail + 1) % CMD_BUFFER_SIZE;
+
+        pthread_mutex_unlock(&c->rxBufferMutex);
+        return 1;
+    }
+    pthread_mutex_unlock(&c->rxBufferMutex);
+    return 0;
+}
+
 //-----------------------------------------------------------------------------
 // Entry point into our code: called whenever we received a packet over USB
 // that we weren't necessarily expecting, for example a debug print.
 //-----------------------------------------------------------------------------
-static void PacketResponseReceived(PacketResponseNG *packet) {
+static void PacketResponseReceived(pm3_connection_t *c, PacketResponseNG *packet) {
 
     // we got a packet, reset WaitForResponseTimeout timeout
-    uint64_t prev_clk = __atomic_load_n(&last_packet_time, __ATOMIC_SEQ_CST);
+    uint64_t prev_clk = __atomic_load_n(&c->last_packet_time, __ATOMIC_SEQ_CST);
     uint64_t clk = msclock();
-    __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
-    __atomic_store_n(&last_packet_time, clk, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&c->timeout_start_time,  clk, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&c->last_packet_time, clk, __ATOMIC_SEQ_CST);
     (void) prev_clk;
 //    PrintAndLogEx(NORMAL, "[%07"PRIu64"] RECV %s magic %08x length %04x status %04x crc %04x cmd %04x",
 //                clk - prev_clk, packet->ng ? "NG" : "OLD", packet->magic, packet->length, packet->status, packet->crc, packet->cmd);
@@ -303,7 +628,12 @@ static void PacketResponseReceived(PacketResponseNG *packet) {
                     g_pendingPrompt = false;
                 }
                 //PrintAndLogEx(NORMAL, "[" _MAGENTA_("pm3") "] ["_BLUE_("#")"] " "%s", s);
-                PrintAndLogEx(NORMAL, "[" _BLUE_("#") "] %s", s);
+                if (CountProxmarks() > 1) {
+                    // tell which device is talking
+                    PrintAndLogEx(NORMAL, "[" _BLUE_("#%d") "] %s", c->device.index, s);
+                } else {
+                    PrintAndLogEx(NORMAL, "[" _BLUE_("#") "] %s", s);
+                }
             } else {
                 if (flag & FLAG_INPLACE)
                     PrintAndLogEx(NORMAL, "\r" NOLF);
@@ -324,7 +654,7 @@ static void PacketResponseReceived(PacketResponseNG *packet) {
         // CMD_DOWNLOAD_BIGBUF packages which is not dealt with. I wonder if simply ignoring them will
         // work. lets try it.
         default: {
-            storeReply(packet);
+            storeReply(c, packet);
             break;
         }
     }
@@ -341,11 +671,15 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 *uart_communication(void *targ) {
-    communication_arg_t *connection = (communication_arg_t *)targ;
+    pm3_connection_t *c = (pm3_connection_t *)targ;
+    communication_arg_t *connection = &c->arg;
     uint32_t rxlen;
     bool commfailed = false;
     PacketResponseNG rx;
-    PacketResponseNGRaw rx_raw;
+    PacketResponseNGSeqRaw rx_raw;
+
+    // g_conn of this thread is the one of its device
+    selected_connection = c;
 
 #if defined(__MACH__) && defined(__APPLE__)
     disableAppNap("Proxmark3 polling UART");
@@ -361,37 +695,54 @@ __attribute__((force_align_arg_pointer))
         // Signal to main thread that communications seems off.
         // main thread will kill and restart this thread.
         if (commfailed) {
-            if (g_conn.last_command != CMD_HARDWARE_RESET) {
+            if (c->arg.last_command != CMD_HARDWARE_RESET) {
                 PrintAndLogEx(WARNING, "\nCommunicating with Proxmark3 device " _RED_("failed"));
             }
-            __atomic_test_and_set(&comm_thread_dead, __ATOMIC_SEQ_CST);
+            __atomic_test_and_set(&c->comm_thread_dead, __ATOMIC_SEQ_CST);
+            // don't let a waiter sleep on a dead thread
+            pthread_mutex_lock(&c->rxBufferMutex);
+            c->rx_waiter_woken = true;
+            pthread_cond_signal(&c->rxBufferSig);
+            pthread_mutex_unlock(&c->rxBufferMutex);
             break;
         }
 
-        res = uart_receive(sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
+        res = uart_receive(c->sp, (uint8_t *)&rx_raw.pre.pre, sizeof(PacketResponseNGPreamble), &rxlen);
         if ((res == PM3_SUCCESS) && (rxlen == sizeof(PacketResponseNGPreamble))) {
-            rx.magic = rx_raw.pre.magic;
-            uint16_t length = rx_raw.pre.length;
-            rx.ng = rx_raw.pre.ng;
-            rx.status = rx_raw.pre.status;
-            rx.cmd = rx_raw.pre.cmd;
-            if (rx.magic == RESPONSENG_PREAMBLE_MAGIC) { // New style NG reply
+            rx.magic = rx_raw.pre.pre.magic;
+            uint16_t length = rx_raw.pre.pre.length;
+            rx.ng = rx_raw.pre.pre.ng;
+            rx.status = rx_raw.pre.pre.status;
+            rx.cmd = rx_raw.pre.pre.cmd;
+            rx.seq = 0;
+            if (rx.magic == RESPONSENG_PREAMBLE_MAGIC || rx.magic == RESPONSENG_SEQ_PREAMBLE_MAGIC) { // New style NG reply
+                size_t prelen = sizeof(PacketResponseNGPreamble);
                 if (length > PM3_CMD_DATA_SIZE) {
                     PrintAndLogEx(WARNING, "Received packet frame with incompatible length: 0x%04x", length);
                     error = true;
                 }
+                if ((!error) && (rx.magic == RESPONSENG_SEQ_PREAMBLE_MAGIC)) { // Reply to a windowed command
+                    res = uart_receive(c->sp, (uint8_t *)&rx_raw.pre.seq, sizeof(rx_raw.pre.seq), &rxlen);
+                    if ((res != PM3_SUCCESS) || (rxlen != sizeof(rx_raw.pre.seq))) {
+                        PrintAndLogEx(WARNING, "Received packet frame without sequence number");
+                        error = true;
+                    }
+                    rx.seq = rx_raw.pre.seq;
+                    prelen = sizeof(PacketResponseNGSeqPreamble);
+                }
+                uint8_t *rx_data = (uint8_t *)&rx_raw + prelen;
                 if ((!error) && (length > 0)) { // Get the variable length payload
 
-                    res = uart_receive(sp, (uint8_t *)&rx_raw.data, length, &rxlen);
+                    res = uart_receive(c->sp, rx_data, length, &rxlen);
                     if ((res != PM3_SUCCESS) || (rxlen != length)) {
                         PrintAndLogEx(WARNING, "Received packet frame with variable part too short? %d/%d", rxlen, length);
                         error = true;
                     } else {
 
                         if (rx.ng) {      // Received a valid NG frame
-                            memcpy(&rx.data, &rx_raw.data, length);
+                            memcpy(&rx.data, rx_data, length);
                             rx.length = length;
-                            if ((rx.cmd == g_conn.last_command) && (rx.status == PM3_SUCCESS)) {
+                            if ((rx.cmd == c->arg.last_command) && (rx.status == PM3_SUCCESS)) {
                                 ACK_received = true;
                             }
                         } else {
@@ -401,11 +752,11 @@ __attribute__((force_align_arg_pointer))
                                 error = true;
                             }
                             if (!error) { // Received a valid MIX frame
-                                memcpy(arg, &rx_raw.data, sizeof(arg));
+                                memcpy(arg, rx_data, sizeof(arg));
                                 rx.oldarg[0] = arg[0];
                                 rx.oldarg[1] = arg[1];
                                 rx.oldarg[2] = arg[2];
-                                memcpy(&rx.data, ((uint8_t *)&rx_raw.data) + sizeof(arg), length - sizeof(arg));
+                                memcpy(&rx.data, rx_data + sizeof(arg), length - sizeof(arg));
                                 rx.length = length - sizeof(arg);
                                 if (rx.cmd == CMD_ACK) {
                                     ACK_received = true;
@@ -415,7 +766,7 @@ __attribute__((force_align_arg_pointer))
                     }
                 }
                 if (!error) {                        // Get the postamble
-                    res = uart_receive(sp, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
+                    res = uart_receive(c->sp, (uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), &rxlen);
                     if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseNGPostamble))) {
                         PrintAndLogEx(WARNING, "Received packet frame without postamble");
                         error = true;
@@ -425,7 +776,7 @@ __attribute__((force_align_arg_pointer))
                     rx.crc = rx_raw.foopost.crc;
                     if (rx.crc != RESPONSENG_POSTAMBLE_MAGIC) {
                         uint8_t first, second;
-                        compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, sizeof(PacketResponseNGPreamble) + length, &first, &second);
+                        compute_crc(CRC_14443_A, (uint8_t *)&rx_raw, prelen + length, &first, &second);
                         if ((first << 8) + second != rx.crc) {
                             PrintAndLogEx(WARNING, "Received packet frame with invalid CRC %02X%02X <> %04X", first, second, rx.crc);
                             error = true;
@@ -437,22 +788,26 @@ __attribute__((force_align_arg_pointer))
                     PrintAndLogEx(NORMAL, "Receiving %s:", rx.ng ? "NG" : "MIX");
 #endif
 #ifdef COMMS_DEBUG_RAW
-                    print_hex_break((uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), 32);
-                    print_hex_break((uint8_t *)&rx_raw.data, rx_raw.pre.length, 32);
+                    print_hex_break((uint8_t *)&rx_raw.pre, prelen, 32);
+                    print_hex_break(rx_data, length, 32);
                     print_hex_break((uint8_t *)&rx_raw.foopost, sizeof(PacketResponseNGPostamble), 32);
 #endif
-                    PacketResponseReceived(&rx);
+                    // compressed bulk download chunks are done here
+                    if (receiveLZ4(c, &rx) == false) {
+                        PacketResponseReceived(c, &rx);
+                    }
                 }
             } else {                               // Old style reply
                 PacketResponseOLD rx_old;
-                memcpy(&rx_old, &rx_raw.pre, sizeof(PacketResponseNGPreamble));
+                memcpy(&rx_old, &rx_raw.pre.pre, sizeof(PacketResponseNGPreamble));
 
-                res = uart_receive(sp, ((uint8_t *)&rx_old) + sizeof(PacketResponseNGPreamble), sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble), &rxlen);
-                if ((res != PM3_SUCCESS) || (rxlen != sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble))) {
-                    PrintAndLogEx(WARNING, "Received packet OLD frame with payload too short? %d/%zu", rxlen, sizeof(PacketResponseOLD) - sizeof(PacketResponseNGPreamble));
+                res = receiveOLD(c, &rx_old);
+                if (res == PM3_EIO) {
+                    PrintAndLogEx(WARNING, "Received packet OLD frame with payload too short?");
                     error = true;
                 }
-                if (!error) {
+                // bulk download chunks are done already
+                if ((!error) && (res != PM3_SUCCESS)) {
 #ifdef COMMS_DEBUG
                     PrintAndLogEx(NORMAL, "Receiving OLD:");
 #endif
@@ -471,7 +826,7 @@ __attribute__((force_align_arg_pointer))
                     rx.oldarg[2] = rx_old.arg[2];
                     rx.length = PM3_CMD_DATA_SIZE;
                     memcpy(&rx.data, &rx_old.d, rx.length);
-                    PacketResponseReceived(&rx);
+                    PacketResponseReceived(c, &rx);
                     if (rx.cmd == CMD_ACK) {
                         ACK_received = true;
                     }
@@ -489,7 +844,7 @@ __attribute__((force_align_arg_pointer))
 
         // TODO if error, shall we resync ?
 
-        pthread_mutex_lock(&txBufferMutex);
+        pthread_mutex_lock(&c->txBufferMutex);
 
         if (connection->block_after_ACK) {
             // if we just received an ACK, wait here until a new command is to be transmitted
@@ -498,43 +853,26 @@ __attribute__((force_align_arg_pointer))
 #ifdef COMMS_DEBUG
                 PrintAndLogEx(NORMAL, "Received ACK, fast TX mode: ignoring other RX till TX");
 #endif
-                while (!txBuffer_pending) {
-                    pthread_cond_wait(&txBufferSig, &txBufferMutex);
+                while (!c->txBuffer_pending) {
+                    pthread_cond_wait(&c->txBufferSig, &c->txBufferMutex);
                 }
             }
         }
 
-        if (txBuffer_pending) {
-
-            if (txBufferNGLen) { // NG packet
-                res = uart_send(sp, (uint8_t *) &txBufferNG, txBufferNGLen);
-                if (res == PM3_EIO) {
-                    commfailed = true;
-                }
-                g_conn.last_command = txBufferNG.pre.cmd;
-                txBufferNGLen = 0;
-            } else {
-                res = uart_send(sp, (uint8_t *) &txBuffer, sizeof(PacketCommandOLD));
-                if (res == PM3_EIO) {
-                    commfailed = true;
-                }
-                g_conn.last_command = txBuffer.cmd;
-            }
-
-            txBuffer_pending = false;
+        sendTxBuffer(c);
 
-            // main thread doesn't know send failed...
-
-            // tell main thread that txBuffer is empty
-            pthread_cond_signal(&txBufferSig);
+        if (c->tx_failed) {
+            commfailed = true;
         }
 
-        pthread_mutex_unlock(&txBufferMutex);
+        pthread_mutex_unlock(&c->txBufferMutex);
     }
 
     // when thread dies, we close the serial port.
-    uart_close(sp);
-    sp = NULL;
+    pthread_mutex_lock(&c->txBufferMutex);
+    uart_close(c->sp);
+    c->sp = NULL;
+    pthread_mutex_unlock(&c->txBufferMutex);
 
 #if defined(__MACH__) && defined(__APPLE__)
     enableAppNap();
@@ -545,70 +883,107 @@ __attribute__((force_align_arg_pointer))
 }
 
 bool IsCommunicationThreadDead(void) {
-    bool ret = __atomic_load_n(&comm_thread_dead, __ATOMIC_SEQ_CST);
+    pm3_connection_t *c = conn();
+    bool ret = __atomic_load_n(&c->comm_thread_dead, __ATOMIC_SEQ_CST);
     return ret;
 }
 
+// g_session.pm3_present tells whether the default device is connected
+static void updatePresent(void) {
+    g_session.pm3_present = (g_session.current_device != NULL) && deviceConn(g_session.current_device)->present;
+}
+
+// a slot for a new device, NULL if all are used
+static pm3_connection_t *freeConnection(void) {
+    pthread_once(&connections_once, initConnections);
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        pm3_connection_t *c = &connections[i];
+        // the slot of a disconnected default device is kept for its reconnection
+        if ((c->present == false) && (&c->device != g_session.current_device)) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
 bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int timeout, bool flash_mode, uint32_t speed) {
 
+    pm3_connection_t *c;
+    if (*dev == NULL) {
+        c = freeConnection();
+        if (c == NULL) {
+            PrintAndLogEx(WARNING, "Can't connect more than " _YELLOW_("%d") " devices", PM3_MAX_DEVICES);
+            return false;
+        }
+    } else {
+        c = deviceConn(*dev);
+    }
+
+    // uart_open sets g_conn.uart_speed of the device being opened
+    pm3_connection_t *prev = selected_connection;
+    selected_connection = c;
+
     if (!wait_for_port) {
         PrintAndLogEx(INFO, "Using UART port " _YELLOW_("%s"), port);
-        sp = uart_open(port, speed);
+        c->sp = uart_open(port, speed);
     } else {
         PrintAndLogEx(SUCCESS, "Waiting for Proxmark3 to appear on " _YELLOW_("%s"), port);
         fflush(stdout);
         int openCount = 0;
         PrintAndLogEx(INPLACE, "% 3i", timeout);
         do {
-            sp = uart_open(port, speed);
+            c->sp = uart_open(port, speed);
             msleep(500);
             PrintAndLogEx(INPLACE, "% 3i", timeout - openCount - 1);
 
-        } while (++openCount < timeout && (sp == INVALID_SERIAL_PORT || sp == CLAIMED_SERIAL_PORT));
+        } while (++openCount < timeout && (c->sp == INVALID_SERIAL_PORT || c->sp == CLAIMED_SERIAL_PORT));
     }
 
+    selected_connection = prev;
+
     // check result of uart opening
-    if (sp == INVALID_SERIAL_PORT) {
+    if (c->sp == INVALID_SERIAL_PORT) {
         PrintAndLogEx(WARNING, "\n" _RED_("ERROR:") " invalid serial port " _YELLOW_("%s"), port);
         PrintAndLogEx(HINT, "Try the shell script " _YELLOW_("`./pm3 --list`") " to get a list of possible serial ports");
-        sp = NULL;
+        c->sp = NULL;
         return false;
-    } else if (sp == CLAIMED_SERIAL_PORT) {
+    } else if (c->sp == CLAIMED_SERIAL_PORT) {
         PrintAndLogEx(WARNING, "\n" _RED_("ERROR:") " serial port " _YELLOW_("%s") " is claimed by another process", port);
         PrintAndLogEx(HINT, "Try the shell script " _YELLOW_("`./pm3 --list`") " to get a list of possible serial ports");
 
-        sp = NULL;
+        c->sp = NULL;
         return false;
     } else {
         // start the communication thread
-        if (port != g_conn.serial_port_name) {
+        if (port != c->arg.serial_port_name) {
             uint16_t len = MIN(strlen(port), FILE_PATH_SIZE - 1);
-            memset(g_conn.serial_port_name, 0, FILE_PATH_SIZE);
-            memcpy(g_conn.serial_port_name, port, len);
+            memset(c->arg.serial_port_name, 0, FILE_PATH_SIZE);
+            memcpy(c->arg.serial_port_name, port, len);
         }
-        g_conn.run = true;
-        g_conn.block_after_ACK = flash_mode;
+        c->arg.run = true;
+        c->arg.block_after_ACK = flash_mode;
         // Flags to tell where to add CRC on sent replies
-        g_conn.send_with_crc_on_usb = false;
-        g_conn.send_with_crc_on_fpc = true;
+        c->arg.send_with_crc_on_usb = false;
+        c->arg.send_with_crc_on_fpc = true;
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
-        g_conn.send_via_fpc_usart = false;
+        c->arg.send_via_fpc_usart = false;
+        // until the capabilities tell otherwise
+        c->arg.cmd_window = 0;
 
-        pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
-        __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
-        g_session.pm3_present = true; // TODO support for multiple devices
+        c->tx_failed = false;
+        __atomic_clear(&c->comm_thread_dead, __ATOMIC_SEQ_CST);
+        c->present = true;
+        pthread_create(&c->communication_thread, NULL, &uart_communication, c);
 
         fflush(stdout);
-        if (*dev == NULL) {
-            *dev = calloc(sizeof(pm3_device_t), sizeof(uint8_t));
-        }
-        (*dev)->g_conn = &g_conn; // TODO g_conn shouldn't be global
+        *dev = &c->device;
+        updatePresent();
         return true;
     }
 }
 
-// check if we can communicate with Pm3
-int TestProxmark(pm3_device_t *dev) {
+// check if we can communicate with Pm3, c is the selected connection
+static int testProxmark(pm3_connection_t *c) {
 
     PacketResponseNG resp;
     uint16_t len = 32;
@@ -616,7 +991,7 @@ int TestProxmark(pm3_device_t *dev) {
     for (uint16_t i = 0; i < len; i++)
         data[i] = i & 0xFF;
 
-    __atomic_store_n(&last_packet_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&c->last_packet_time,  msclock(), __ATOMIC_SEQ_CST);
     clearCommandBuffer();
     SendCommandNG(CMD_PING, data, len);
 
@@ -645,23 +1020,44 @@ int TestProxmark(pm3_device_t *dev) {
         return PM3_ETIMEOUT;
     }
 
-    if ((resp.length != sizeof(g_pm3_capabilities)) || (resp.data.asBytes[0] != CAPABILITIES_VERSION)) {
+    // older firmware sends the same structure, without the fields added since
+    size_t caps_len = sizeof(c->capabilities);
+    switch (resp.data.asBytes[0]) {
+        case CAPABILITIES_VERSION_NO_WINDOW:
+            caps_len -= sizeof(c->capabilities.cmd_window);
+        /* fall through */
+        case CAPABILITIES_VERSION_NO_COMPRESSION:
+            caps_len -= sizeof(c->capabilities.download_compression);
+        /* fall through */
+        case CAPABILITIES_VERSION_NO_DEVICE_CMDS:
+            caps_len -= sizeof(c->capabilities.device_cmds);
+        /* fall through */
+        case CAPABILITIES_VERSION:
+            break;
+        default:
+            caps_len = 0;
+            break;
+    }
+
+    if ((caps_len == 0) || (resp.length != caps_len)) {
         PrintAndLogEx(ERR, _RED_("Capabilities structure version sent by Proxmark3 is not the same as the one used by the client!"));
         PrintAndLogEx(ERR, _RED_("Please flash the Proxmark with the same version as the client."));
         return PM3_EDEVNOTSUPP;
     }
 
-    memcpy(&g_pm3_capabilities, resp.data.asBytes, MIN(sizeof(capabilities_t), resp.length));
-    g_conn.send_via_fpc_usart = g_pm3_capabilities.via_fpc;
-    g_conn.uart_speed = g_pm3_capabilities.baudrate;
+    memset(&c->capabilities, 0, sizeof(capabilities_t));
+    memcpy(&c->capabilities, resp.data.asBytes, MIN(sizeof(capabilities_t), resp.length));
+    c->arg.send_via_fpc_usart = c->capabilities.via_fpc;
+    c->arg.uart_speed = c->capabilities.baudrate;
+    c->arg.cmd_window = c->capabilities.cmd_window;
 
     PrintAndLogEx(INFO, "Communicating with PM3 over %s%s%s",
-                  g_conn.send_via_fpc_usart ? _YELLOW_("FPC UART") : _YELLOW_("USB-CDC"),
-                  memcmp(g_conn.serial_port_name, "tcp:", 4) == 0 ? " over " _YELLOW_("TCP") : "",
-                  memcmp(g_conn.serial_port_name, "bt:", 3) == 0 ? " over " _YELLOW_("BT") : "");
+                  c->arg.send_via_fpc_usart ? _YELLOW_("FPC UART") : _YELLOW_("USB-CDC"),
+                  memcmp(c->arg.serial_port_name, "tcp:", 4) == 0 ? " over " _YELLOW_("TCP") : "",
+                  memcmp(c->arg.serial_port_name, "bt:", 3) == 0 ? " over " _YELLOW_("BT") : "");
 
-    if (g_conn.send_via_fpc_usart) {
-        PrintAndLogEx(INFO, "PM3 UART serial baudrate: " _YELLOW_("%u") "\n", g_conn.uart_speed);
+    if (c->arg.send_via_fpc_usart) {
+        PrintAndLogEx(INFO, "PM3 UART serial baudrate: " _YELLOW_("%u") "\n", c->arg.uart_speed);
     } else {
         int res = uart_reconfigure_timeouts(UART_USB_CLIENT_RX_TIMEOUT_MS);
         if (res != PM3_SUCCESS) {
@@ -671,32 +1067,146 @@ int TestProxmark(pm3_device_t *dev) {
     return PM3_SUCCESS;
 }
 
+int TestProxmark(pm3_device_t *dev) {
+    pm3_device_t *prev = SelectProxmark(dev);
+    int res = testProxmark(deviceConn(dev));
+    SelectProxmark(prev);
+    return res;
+}
+
 void CloseProxmark(pm3_device_t *dev) {
-    dev->g_conn->run = false;
+    pm3_connection_t *c = deviceConn(dev);
+    c->arg.run = false;
 
 #ifdef __BIONIC__
-    if (communication_thread != 0) {
-        pthread_join(communication_thread, NULL);
+    if (c->communication_thread != 0) {
+        pthread_join(c->communication_thread, NULL);
     }
 #else
-    pthread_join(communication_thread, NULL);
+    pthread_join(c->communication_thread, NULL);
 #endif
 
-    if (sp) {
-        uart_close(sp);
+    if (c->sp) {
+        uart_close(c->sp);
     }
 
     // Clean up our state
-    sp = NULL;
+    c->sp = NULL;
 #ifdef __BIONIC__
-    if (communication_thread != 0) {
-        memset(&communication_thread, 0, sizeof(pthread_t));
+    if (c->communication_thread != 0) {
+        memset(&c->communication_thread, 0, sizeof(pthread_t));
     }
 #else
-    memset(&communication_thread, 0, sizeof(pthread_t));
+    memset(&c->communication_thread, 0, sizeof(pthread_t));
 #endif
 
-    g_session.pm3_present = false;
+    c->present = false;
+    updatePresent();
+}
+
+void CloseProxmarks(void) {
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        pm3_device_t *dev = GetProxmark(i);
+        if (dev) {
+            CloseProxmark(dev);
+        }
+    }
+}
+
+pm3_device_t *GetProxmark(int idx) {
+    pthread_once(&connections_once, initConnections);
+    if ((idx < 0) || (idx >= PM3_MAX_DEVICES) || (connections[idx].present == false)) {
+        return NULL;
+    }
+    return &connections[idx].device;
+}
+
+bool IsProxmarkPresent(void) {
+    return conn()->present;
+}
+
+int CountProxmarks(void) {
+    int count = 0;
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        if (GetProxmark(i)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+pm3_device_t *SelectProxmark(pm3_device_t *dev) {
+    pm3_device_t *prev = selected_connection ? &selected_connection->device : NULL;
+    selected_connection = dev ? deviceConn(dev) : NULL;
+    return prev;
+}
+
+void SetDefaultProxmark(pm3_device_t *dev) {
+    g_session.current_device = dev;
+    updatePresent();
+}
+
+typedef struct {
+    pm3_device_job_t job;
+    pm3_device_t *dev;
+    int n;
+    int count;
+    void *ctx;
+    int res;
+} device_job_t;
+
+static void *runDeviceJob(void *targ) {
+    device_job_t *dj = (device_job_t *)targ;
+    SelectProxmark(dj->dev);
+    dj->res = dj->job(dj->dev, dj->n, dj->count, dj->ctx);
+    return NULL;
+}
+
+int RunOnProxmarks(pm3_device_job_t job, void *ctx) {
+
+    // the default device gets job 0, which runs in the calling thread
+    device_job_t jobs[PM3_MAX_DEVICES];
+    int count = 0;
+    if (g_session.pm3_present) {
+        jobs[count++].dev = g_session.current_device;
+    }
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        pm3_device_t *dev = GetProxmark(i);
+        if (dev && (dev != g_session.current_device)) {
+            jobs[count++].dev = dev;
+        }
+    }
+    if (count == 0) {
+        return PM3_ENOTTY;
+    }
+
+    pthread_t threads[PM3_MAX_DEVICES];
+    for (int n = 0; n < count; n++) {
+        jobs[n].job = job;
+        jobs[n].n = n;
+        jobs[n].count = count;
+        jobs[n].ctx = ctx;
+        jobs[n].res = PM3_SUCCESS;
+        if ((n > 0) && pthread_create(&threads[n], NULL, runDeviceJob, &jobs[n])) {
+            jobs[n].res = PM3_EFAILED;
+            jobs[n].dev = NULL;
+        }
+    }
+
+    pm3_device_t *prev = SelectProxmark(NULL);
+    runDeviceJob(&jobs[0]);
+    SelectProxmark(prev);
+
+    int res = jobs[0].res;
+    for (int n = 1; n < count; n++) {
+        if (jobs[n].dev) {
+            pthread_join(threads[n], NULL);
+        }
+        if (res == PM3_SUCCESS) {
+            res = jobs[n].res;
+        }
+    }
+    return res;
 }
 
 // Gives a rough estimate of the communication delay based on channel & baudrate
@@ -708,9 +1218,9 @@ void CloseProxmark(pm3_device_t *dev) {
 //   9600 -> 1100..1150ms
 //           ~ = 12000000 / USART_BAUD_RATE
 // Let's take 2x (maybe we need more for BT link?)
-static size_t communication_delay(void) {
-    if (g_conn.send_via_fpc_usart)  // needed also for Windows USB USART??
-        return 2 * (12000000 / g_conn.uart_speed);
+static size_t communication_delay(pm3_connection_t *c) {
+    if (c->arg.send_via_fpc_usart)  // needed also for Windows USB USART??
+        return 2 * (12000000 / c->arg.uart_speed);
     return 0;
 }
 
@@ -725,6 +1235,7 @@ static size_t communication_delay(void) {
  * @return true if command was returned, otherwise false
  */
 bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
+    pm3_connection_t *c = conn();
 
     PacketResponseNG resp;
 
@@ -733,14 +1244,16 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
 
     // Add delay depending on the communication channel & speed
     if (ms_timeout != (size_t) - 1)
-        ms_timeout += communication_delay();
+        ms_timeout += communication_delay(c);
 
-    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&c->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+
+    setReplyWaiter(c, cmd);
 
     // Wait until the command is received
     while (true) {
 
-        while (getReply(response)) {
+        while (getReply(c, response)) {
             if (cmd == CMD_UNKNOWN || response->cmd == cmd) {
                 return true;
             }
@@ -752,7 +1265,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
             }
         }
 
-        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        uint64_t tmp_clk = __atomic_load_n(&c->timeout_start_time, __ATOMIC_SEQ_CST);
         if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout))
             break;
 
@@ -762,8 +1275,9 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
-        // just to avoid CPU busy loop:
-        msleep(10);
+
+        // sleep until the communication thread stored a reply for us
+        waitReply(c, waitReplySlice(ms_timeout, tmp_clk));
     }
     return false;
 }
@@ -776,6 +1290,136 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
     return WaitForResponseTimeoutW(cmd, response, -1, true);
 }
 
+/**
+ * @brief Waits for the reply to a command sent with SendCommandNGSeq. Replies to other
+ * windowed commands stay in the buffer.
+
+ * @param seq sequence number returned by SendCommandNGSeq
+ * @param response struct to copy received command into.
+ * @param ms_timeout timeout in milliseconds
+ * @return true if command was returned, otherwise false
+ */
+bool WaitForResponseSeq(uint16_t seq, PacketResponseNG *response, size_t ms_timeout) {
+    pm3_connection_t *c = conn();
+
+    PacketResponseNG resp;
+
+    if (response == NULL)
+        response = &resp;
+
+    if (ms_timeout != (size_t) - 1)
+        ms_timeout += communication_delay(c);
+
+    __atomic_store_n(&c->timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+
+    setReplyWaiter(c, CMD_UNKNOWN);
+
+    while (true) {
+
+        while (getReplySeq(c, seq, response)) {
+            if (response->seq == seq && response->cmd != CMD_WTX) {
+                return true;
+            }
+            if (response->length == sizeof(uint16_t)) {
+                uint16_t wtx = response->data.asDwords[0] & 0xFFFF;
+                PrintAndLogEx(DEBUG, "Got Waiting Time eXtension request %i ms", wtx);
+                if (ms_timeout != (size_t) - 1)
+                    ms_timeout += wtx;
+            }
+        }
+
+        uint64_t tmp_clk = __atomic_load_n(&c->timeout_start_time, __ATOMIC_SEQ_CST);
+        if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout))
+            break;
+
+        if (IsCommunicationThreadDead())
+            break;
+
+        waitReply(c, waitReplySlice(ms_timeout, tmp_clk));
+    }
+    return false;
+}
+
+int SendCommandNGWindowed(uint16_t cmd, uint32_t count, cmd_window_build_t build, cmd_window_reply_t reply, void *ctx, size_t ms_timeout) {
+    pm3_connection_t *c = conn();
+
+    uint8_t data[PM3_CMD_DATA_SIZE];
+    PacketResponseNG resp;
+
+    // firmware without windowed mode, one command at a time
+    if (c->arg.cmd_window == 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            size_t len = build(i, data, ctx);
+            clearCommandBuffer();
+            SendCommandNG(cmd, data, len);
+            bool received = WaitForResponseTimeout(cmd, &resp, ms_timeout);
+            reply(i, received ? &resp : NULL, ctx);
+        }
+        return PM3_SUCCESS;
+    }
+
+    // the USART fifo of the device must hold all commands in flight
+    size_t max_bytes = c->arg.send_via_fpc_usart ? USART_FIFOLEN : SIZE_MAX;
+    uint8_t window = MIN(c->arg.cmd_window, PM3_CMD_WINDOW);
+
+    struct {
+        uint16_t seq;
+        size_t bytes;
+    } inflight[PM3_CMD_WINDOW];
+
+    uint32_t sent = 0, done = 0;
+    size_t inflight_bytes = 0;
+    // payload of command sent, built but not sent yet when it didn't fit
+    size_t len = 0;
+    bool built = false;
+    int res = PM3_SUCCESS;
+
+    clearCommandBuffer();
+
+    while (done < count) {
+
+        // keep the window full, unless something went wrong
+        while ((res == PM3_SUCCESS) && (sent < count) && (sent - done < window)) {
+            if (built == false) {
+                len = build(sent, data, ctx);
+                built = true;
+            }
+            size_t bytes = sizeof(PacketCommandNGSeqPreamble) + len + sizeof(PacketCommandNGPostamble);
+            if ((sent > done) && (inflight_bytes + bytes > max_bytes)) {
+                break;
+            }
+            uint16_t seq = SendCommandNGSeq(cmd, data, len);
+            built = false;
+            if (seq == 0) {
+                res = PM3_EIO;
+                break;
+            }
+            inflight[sent % PM3_CMD_WINDOW].seq = seq;
+            inflight[sent % PM3_CMD_WINDOW].bytes = bytes;
+            inflight_bytes += bytes;
+            sent++;
+        }
+
+        if (done == sent) {
+            // nothing in flight any more, the rest is never sent
+            for (; done < count; done++) {
+                reply(done, NULL, ctx);
+            }
+            break;
+        }
+
+        // the device answers in order, wait for the oldest one
+        bool received = WaitForResponseSeq(inflight[done % PM3_CMD_WINDOW].seq, &resp, ms_timeout);
+        if (received == false) {
+            res = PM3_ETIMEOUT;
+        }
+        reply(done, received ? &resp : NULL, ctx);
+        inflight_bytes -= inflight[done % PM3_CMD_WINDOW].bytes;
+        done++;
+    }
+    return res;
+}
+
 /**
 * Data transfer from Proxmark to client. This method times out after
 * ms_timeout milliseconds.
@@ -792,6 +1436,16 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
 * @return true if command was returned, otherwise false
 */
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
+    return GetFromDeviceEx(memtype, dest, bytes, start_index, data, datalen, response, ms_timeout, show_warning, NULL, NULL);
+}
+
+/**
+* @brief GetFromDeviceEx is GetFromDevice, reporting the progress of the download to progress()
+* @param progress called about every 100 ms while downloading and once at the end, can be NULL
+* @param progress_ctx passed to progress()
+*/
+bool GetFromDeviceEx(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning, dl_progress_t progress, void *progress_ctx) {
+    pm3_connection_t *c = conn();
 
     if (dest == NULL) return false;
     if (bytes == 0) return true;
@@ -800,57 +1454,96 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
     if (response == NULL)
         response = &resp;
 
-    // clear
-    clearCommandBuffer();
-
+    uint64_t cmd;
+    uint32_t rec_cmd;
     switch (memtype) {
         case BIG_BUF: {
-            SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF);
+            cmd = CMD_DOWNLOAD_BIGBUF;
+            rec_cmd = CMD_DOWNLOADED_BIGBUF;
+            break;
         }
         case BIG_BUF_EML: {
-            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_EML_BIGBUF);
+            cmd = CMD_DOWNLOAD_EML_BIGBUF;
+            rec_cmd = CMD_DOWNLOADED_EML_BIGBUF;
+            break;
         }
         case SPIFFS: {
-            SendCommandMIX(CMD_SPIFFS_DOWNLOAD, start_index, bytes, 0, data, datalen);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_SPIFFS_DOWNLOADED);
+            cmd = CMD_SPIFFS_DOWNLOAD;
+            rec_cmd = CMD_SPIFFS_DOWNLOADED;
+            break;
         }
         case FLASH_MEM: {
-            SendCommandMIX(CMD_FLASHMEM_DOWNLOAD, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_FLASHMEM_DOWNLOADED);
+            cmd = CMD_FLASHMEM_DOWNLOAD;
+            rec_cmd = CMD_FLASHMEM_DOWNLOADED;
+            break;
         }
-        case SIM_MEM: {
+        case FPGA_MEM: {
+            cmd = CMD_FPGAMEM_DOWNLOAD;
+            rec_cmd = CMD_FPGAMEM_DOWNLOADED;
+            break;
+        }
+        case SIM_MEM:
+        default: {
             //SendCommandMIX(CMD_DOWNLOAD_SIM_MEM, start_index, bytes, 0, NULL, 0);
-            //return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_SIMMEM);
+            //return dl_it(c, dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_SIMMEM);
             return false;
         }
-        case FPGA_MEM: {
-            SendCommandMIX(CMD_FPGAMEM_DOWNLOAD, start_index, bytes, 0, NULL, 0);
-            return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_FPGAMEM_DOWNLOADED);
+    }
+
+    // clear
+    clearCommandBuffer();
+
+    // the chunks may arrive before dl_it is waiting for them
+    bulkStart(c, rec_cmd, dest, bytes);
+
+    if (memtype == SPIFFS) {
+        SendCommandMIX(cmd, start_index, bytes, 0, data, datalen);
+    } else if (memtype == BIG_BUF) {
+        // Samples and traces compress well, but compressing costs the device more time than it saves on USB.
+        // Only ask for it on the slow FPC UART / BT links
+        uint64_t compression = 0;
+        if (c->arg.send_via_fpc_usart && (c->capabilities.download_compression & DOWNLOAD_COMPRESS_LZ4)) {
+            compression = DOWNLOAD_COMPRESS_LZ4;
         }
+        SendCommandMIX(cmd, start_index, bytes, compression, NULL, 0);
+    } else {
+        SendCommandMIX(cmd, start_index, bytes, 0, NULL, 0);
     }
-    return false;
+    bool res = dl_it(c, dest, bytes, response, ms_timeout, show_warning, rec_cmd, progress, progress_ctx);
+    if (bulkStop(c) == false) {
+        res = false;
+    }
+    return res;
 }
 
-static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
+// Chunks are normally received straight into dest by the communication thread, see receiveOLD.
+// Chunks sent as NG / MIX frames still come through rxBuffer.
+static bool dl_it(pm3_connection_t *c, uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd, dl_progress_t progress, void *progress_ctx) {
 
     uint32_t bytes_completed = 0;
-    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+    uint64_t start_clk = msclock();
+    uint64_t progress_clk = start_clk;
+    __atomic_store_n(&c->timeout_start_time, start_clk, __ATOMIC_SEQ_CST);
 
     // Add delay depending on the communication channel & speed
     if (ms_timeout != (size_t) - 1)
-        ms_timeout += communication_delay();
+        ms_timeout += communication_delay(c);
+
+    // every packet is of interest while downloading
+    setReplyWaiter(c, CMD_UNKNOWN);
 
     while (true) {
 
-        if (getReply(response)) {
+        while (getReply(c, response)) {
 
-            if (response->cmd == CMD_ACK)
-                return true;
             // Spiffs download is converted to NG,
-            if (response->cmd == CMD_SPIFFS_DOWNLOAD)
+            if (response->cmd == CMD_ACK || response->cmd == CMD_SPIFFS_DOWNLOAD) {
+                if (progress) {
+                    uint32_t done = bytes_completed + __atomic_load_n(&c->rx_bulk.received, __ATOMIC_SEQ_CST);
+                    progress(MIN(done, bytes), bytes, msclock() - start_clk, true, progress_ctx);
+                }
                 return true;
+            }
 
             // sample_buf is a array pointer, located in data.c
             // arg0 = offset in transfer. Startindex of this chunk
@@ -869,7 +1562,7 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
                 // extended bounds check2.
                 if (offset + copy_bytes > bytes) {
                     PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %u | len %u | total len %u > buf_size %u", offset, copy_bytes,  offset + copy_bytes,  bytes);
-                    break;
+                    return false;
                 }
 
                 memcpy(dest + offset, response->data.asBytes, copy_bytes);
@@ -882,7 +1575,13 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
             }
         }
 
-        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        if (progress && msclock() - progress_clk >= RX_WAIT_SLICE_MS) {
+            progress_clk = msclock();
+            uint32_t done = bytes_completed + __atomic_load_n(&c->rx_bulk.received, __ATOMIC_SEQ_CST);
+            progress(MIN(done, bytes), bytes, progress_clk - start_clk, false, progress_ctx);
+        }
+
+        uint64_t tmp_clk = __atomic_load_n(&c->timeout_start_time, __ATOMIC_SEQ_CST);
         if (msclock() - tmp_clk > ms_timeout) {
             PrintAndLogEx(FAILED, "Timed out while trying to download data from device");
             break;
@@ -894,6 +1593,27 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
             PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
             show_warning = false;
         }
+
+        waitReply(c, waitReplySlice(ms_timeout, tmp_clk));
     }
     return false;
 }
+
+static bool dl_progress_inplace = false;
+
+void PrintDownloadProgress(uint32_t bytes_done, uint32_t bytes_total, uint64_t elapsed_ms, bool finished, void *ctx) {
+    if (finished == false) {
+        PrintAndLogEx(INPLACE, " %u / %u bytes ( %u%% )", bytes_done, bytes_total, (uint32_t)((uint64_t)bytes_done * 100 / bytes_total));
+        dl_progress_inplace = true;
+        return;
+    }
+    if (dl_progress_inplace) {
+        PrintAndLogEx(NORMAL, "");
+        dl_progress_inplace = false;
+    }
+    PrintAndLogEx(INFO, "downloaded " _YELLOW_("%u") " bytes in %.2f s ( %.1f kB/s )"
+                  , bytes_done
+                  , (float)elapsed_ms / 1000.0
+                  , elapsed_ms ? (float)bytes_done / elapsed_ms : 0.0
+                 );
+}
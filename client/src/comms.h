@@ -65,36 +65,88 @@ typedef struct {
     // To memorise baudrate
     uint32_t uart_speed;
     uint16_t last_command;
+    // Windowed commands the device can queue, 0 if it doesn't support windowed mode
+    uint8_t cmd_window;
     char serial_port_name[FILE_PATH_SIZE];
 } communication_arg_t;
 
-extern communication_arg_t g_conn;
+// Several Proxmark3 devices can be connected at once. Each one has its own communication thread,
+// reply buffer, g_conn and g_pm3_capabilities. Device 0 is the default one, g_session.current_device.
+#define PM3_MAX_DEVICES 8
+// slot of libpm3 handles without device, it is never connected
+#define PM3_OFFLINE_DEVICE PM3_MAX_DEVICES
 
 typedef struct pm3_device {
-    communication_arg_t *g_conn;
+    communication_arg_t *conn;
     int script_embedded;
+    int index; // slot of the device, see GetProxmark
+    struct pm3_context *ctx; // buffers of a libpm3 handle, NULL for the default context
 } pm3_device_t;
 
+// Commands of a thread go to the device it selected with SelectProxmark, else to the default device.
+// g_conn and g_pm3_capabilities are the ones of that device.
+communication_arg_t *GetConnection(void);
+capabilities_t *GetCapabilities(void);
+#define g_conn (*GetConnection())
+#define g_pm3_capabilities (*GetCapabilities())
+
+// Device in slot idx, NULL if it isn't connected
+pm3_device_t *GetProxmark(int idx);
+// Number of connected devices
+int CountProxmarks(void);
+// Whether the device of the calling thread is connected
+bool IsProxmarkPresent(void);
+// Selects the device for the calling thread, NULL for the default device. Returns the previous selection
+pm3_device_t *SelectProxmark(pm3_device_t *dev);
+// Makes dev the default device, g_session.current_device
+void SetDefaultProxmark(pm3_device_t *dev);
+
+// Runs job(dev, n, count, ctx) for each of the count connected devices in parallel, in a thread
+// which selected dev. Returns the first error of the jobs, PM3_SUCCESS if all succeeded
+typedef int (*pm3_device_job_t)(pm3_device_t *dev, int n, int count, void *ctx);
+int RunOnProxmarks(pm3_device_job_t job, void *ctx);
+
 void *uart_receiver(void *targ);
 void SendCommandBL(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len);
 void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len);
 void SendCommandNG(uint16_t cmd, uint8_t *data, size_t len);
+// Sends a command with a sequence number, returns it or 0 if the device doesn't support windowed mode
+uint16_t SendCommandNGSeq(uint16_t cmd, uint8_t *data, size_t len);
 void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, void *data, size_t len);
 void clearCommandBuffer(void);
 
 #define FLASHMODE_SPEED 460800
 bool IsCommunicationThreadDead(void);
+// Opens port for *dev, a new device is allocated in a free slot if *dev is NULL
 bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int timeout, bool flash_mode, uint32_t speed);
 int TestProxmark(pm3_device_t *dev);
 void CloseProxmark(pm3_device_t *dev);
+// Closes all connected devices
+void CloseProxmarks(void);
 
 bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool WaitForResponseTimeout(uint32_t cmd, PacketResponseNG *response, size_t ms_timeout);
 bool WaitForResponse(uint32_t cmd, PacketResponseNG *response);
+bool WaitForResponseSeq(uint16_t seq, PacketResponseNG *response, size_t ms_timeout);
+
+// Windowed command submission: the payload of command idx is built by build(), its reply (NULL on timeout)
+// is handed to reply(), in order. Up to g_conn.cmd_window commands are in flight, one at a time if the
+// device doesn't support windowed mode.
+// Only for commands which don't abort on incoming data (data_available() in the firmware).
+// Returns PM3_ETIMEOUT if a reply timed out, no new commands are sent then.
+typedef size_t (*cmd_window_build_t)(uint32_t idx, uint8_t *data, void *ctx);
+typedef void (*cmd_window_reply_t)(uint32_t idx, PacketResponseNG *resp, void *ctx);
+int SendCommandNGWindowed(uint16_t cmd, uint32_t count, cmd_window_build_t build, cmd_window_reply_t reply, void *ctx, size_t ms_timeout);
 
 //bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 
+// Progress of a download: bytes received so far, finished is set on the last call
+typedef void (*dl_progress_t)(uint32_t bytes_done, uint32_t bytes_total, uint64_t elapsed_ms, bool finished, void *ctx);
+bool GetFromDeviceEx(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning, dl_progress_t progress, void *progress_ctx);
+// dl_progress_t printing a progress line and the throughput at the end
+void PrintDownloadProgress(uint32_t bytes_done, uint32_t bytes_total, uint64_t elapsed_ms, bool finished, void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,9 +25,6 @@
 #include "cmddata.h" //for g_debugmode
 
 
-int g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-size_t g_GraphTraceLen;
-
 /* write a manchester bit to the graph
 TODO,  verfy that this doesn't overflow buffer  (iceman)
 */
@@ -62,20 +59,17 @@ size_t ClearGraph(bool redraw) {
 }
 // option '1' to save g_GraphBuffer any other to restore
 void save_restoreGB(uint8_t saveOpt) {
-    static int SavedGB[MAX_GRAPH_TRACE_LEN];
-    static size_t SavedGBlen = 0;
-    static bool GB_Saved = false;
-    static int Savedg_GridOffsetAdj = 0;
+    pm3_context_t *ctx = GetContext();
 
     if (saveOpt == GRAPH_SAVE) { //save
-        memcpy(SavedGB, g_GraphBuffer, sizeof(g_GraphBuffer));
-        SavedGBlen = g_GraphTraceLen;
-        GB_Saved = true;
-        Savedg_GridOffsetAdj = g_GridOffset;
-    } else if (GB_Saved) { //restore
-        memcpy(g_GraphBuffer, SavedGB, sizeof(g_GraphBuffer));
-        g_GraphTraceLen = SavedGBlen;
-        g_GridOffset = Savedg_GridOffsetAdj;
+        memcpy(ctx->saved_graph_buffer, g_GraphBuffer, sizeof(g_GraphBuffer));
+        ctx->saved_graph_trace_len = g_GraphTraceLen;
+        ctx->graph_saved = true;
+        ctx->saved_grid_offset = g_GridOffset;
+    } else if (ctx->graph_saved) { //restore
+        memcpy(g_GraphBuffer, ctx->saved_graph_buffer, sizeof(g_GraphBuffer));
+        g_GraphTraceLen = ctx->saved_graph_trace_len;
+        g_GridOffset = ctx->saved_grid_offset;
         RepaintGraphWindow();
     }
 }
@@ -20,6 +20,7 @@
 #define GRAPH_H__
 
 #include "common.h"
+#include "clientctx.h" // g_GraphBuffer
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,12 +43,12 @@ int GetNrzClock(const char *str, bool verbose);
 int GetFskClock(const char *str, bool verbose);
 bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge);
 
-#define MAX_GRAPH_TRACE_LEN (40000 * 8)
 #define GRAPH_SAVE 1
 #define GRAPH_RESTORE 0
 
-extern int g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-extern size_t g_GraphTraceLen;
+// graph of the calling thread's context, see clientctx.h
+#define g_GraphBuffer (GetContext()->graph_buffer)
+#define g_GraphTraceLen (GetContext()->graph_trace_len)
 
 #ifdef __cplusplus
 }
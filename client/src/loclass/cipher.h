@@ -40,8 +40,13 @@
 void doMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]);
 void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_key_p, uint8_t mac[4]);
 
+// number of keys the bitsliced engine handles per pass
+#define DOMAC_BATCH_SIZE  64
+void doMAC_batch(const uint8_t *cc_nr_p, const uint8_t *div_keys, uint32_t keycnt, uint8_t *macs);
+
 #ifndef ON_DEVICE
 int testMAC(void);
+int benchMAC(void);
 #endif
 
 #endif // CIPHER_H
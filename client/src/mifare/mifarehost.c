@@ -29,7 +29,9 @@
 #include "mifare4.h"
 #include "ui.h"                 // PrintAndLog...
 #include "crapto1/crapto1.h"
+#include "bucketsort.h"
 #include "crc16.h"
+#include "crc32.h"
 #include "protocols.h"
 #include "mfkey.h"
 #include "util_posix.h"         // msclock
@@ -381,6 +383,13 @@ int mfKeyBrute(uint8_t blockNo, uint8_t keyType, const uint8_t *key, uint64_t *r
     return found;
 }
 
+// the 16 Bits of the cryptostate which already contain part of the key
+#define STATE_16BITS_MASK   UINT64_C(0x00ff000000ff0000)
+
+static inline uint64_t State16Bits(const struct Crypto1State *s) {
+    return *(const uint64_t *)s & STATE_16BITS_MASK;
+}
+
 // Compare 16 Bits out of cryptostate
 inline static int Compare16Bits(const void *a, const void *b) {
     if ((*(uint64_t *)b & 0x00ff000000ff0000) == (*(uint64_t *)a & 0x00ff000000ff0000)) return 0;
@@ -388,29 +397,28 @@ inline static int Compare16Bits(const void *a, const void *b) {
     return -1;
 }
 
-// wrapper function for multi-threaded lfsr_recovery32
-static void
-#ifdef __has_attribute
-#if __has_attribute(force_align_arg_pointer)
-__attribute__((force_align_arg_pointer))
-#endif
-#endif
-*nested_worker_thread(void *arg) {
+// recover the statelist of one nested authentication, using all CPUs of the arena
+static int nested_recovery(StateList_t *statelist, crapto1_arena_t *arena) {
     struct Crypto1State *p1;
-    StateList_t *statelist = arg;
-    statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+
+    if (arena) {
+        statelist->head.slhead = lfsr_recovery32_ex(statelist->ks1, statelist->nt_enc ^ statelist->uid, arena);
+    } else {
+        statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+    }
+
+    if (statelist->head.slhead == NULL) {
+        return PM3_EMALLOC;
+    }
 
     for (p1 = statelist->head.slhead; p1->odd | p1->even; p1++) {};
 
     statelist->len = p1 - statelist->head.slhead;
     statelist->tail.sltail = --p1;
-
-    qsort(statelist->head.slhead, statelist->len, sizeof(uint64_t), Compare16Bits);
-
-    return statelist->head.slhead;
+    return PM3_SUCCESS;
 }
 
-int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
+int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate, crapto1_arena_t *arena) {
 
     uint32_t uid;
     StateList_t statelists[2];
@@ -470,118 +478,140 @@ int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo,
     memcpy(&statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
     memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
 
-    // calc keys
-    pthread_t thread_id[2];
+    uint64_t t_start = msclock();
 
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+    // calc keys, each recovery runs multi-threaded
+    if (nested_recovery(&statelists[0], arena) != PM3_SUCCESS) {
+        return PM3_EMALLOC;
+    }
+    if (nested_recovery(&statelists[1], arena) != PM3_SUCCESS) {
+        free(statelists[0].head.slhead);
+        return PM3_EMALLOC;
+    }
+
+    uint64_t t_recover = msclock();
 
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
+    uint32_t maxlen = MAX(statelists[0].len, statelists[1].len);
+    uint64_t *tmp = calloc(maxlen + 1, sizeof(uint64_t));
+    if (tmp == NULL) {
+        free(statelists[0].head.slhead);
+        free(statelists[1].head.slhead);
+        return PM3_EMALLOC;
+    }
 
     // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
+    // Sort both lists on these 16 Bits, keep the states which have a partner
+    // in the other list and roll them back
+    radix_sort_u64(statelists[0].head.keyhead, tmp, statelists[0].len, STATE_16BITS_MASK);
+    radix_sort_u64(statelists[1].head.keyhead, tmp, statelists[1].len, STATE_16BITS_MASK);
+
     p1 = p3 = statelists[0].head.slhead;
     p2 = p4 = statelists[1].head.slhead;
 
     while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-        if (Compare16Bits(p1, p2) == 0) {
-
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
+        uint64_t bits = State16Bits(p1);
+        if (bits < State16Bits(p2)) {
+            p1++;
+        } else if (bits > State16Bits(p2)) {
+            p2++;
+        } else {
+            while (p1 <= statelists[0].tail.sltail && State16Bits(p1) == bits) {
                 *p3 = *p1;
                 lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
                 p3++;
                 p1++;
             }
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
+            while (p2 <= statelists[1].tail.sltail && State16Bits(p2) == bits) {
                 *p4 = *p2;
                 lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
                 p4++;
                 p2++;
             }
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
         }
     }
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
     statelists[0].len = p3 - statelists[0].head.slhead;
     statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
 
     // the statelists now contain possible keys. The key we are searching for must be in the
     // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
+    radix_sort_u64(statelists[0].head.keyhead, tmp, statelists[0].len, UINT64_C(-1));
+    radix_sort_u64(statelists[1].head.keyhead, tmp, statelists[1].len, UINT64_C(-1));
 
-    //statelists[0].tail.keytail = --p7;
-    uint32_t keycnt = statelists[0].len;
-    if (keycnt == 0) goto out;
+    uint64_t t_sort = msclock();
 
-    PrintAndLogEx(SUCCESS, "Found " _YELLOW_("%u") " key candidates", keycnt);
+    // The intersection is created in chunks of KEYS_IN_BLOCK candidates, each chunk is tested
+    // with mfCheckKeys as soon as it is known.
+    sorted_intersect_t it;
+    sorted_intersect_init(&it, statelists[0].head.keyhead, statelists[0].len, statelists[1].head.keyhead, statelists[1].len);
 
     memset(resultKey, 0, 6);
-    uint64_t key64 = -1;
-
-    // The list may still contain several key candidates. Test each of them with mfCheckKeys
-    uint32_t max_keys = keycnt > KEYS_IN_BLOCK ? KEYS_IN_BLOCK : keycnt;
     uint8_t keyBlock[PM3_CMD_DATA_SIZE] = {0x00};
+    uint64_t key64 = -1;
+    uint64_t t_intersect = 0, t_verify = 0;
+    uint32_t keycnt = 0;
+    int res = PM3_ESOFT;
+
+    for (;;) {
+        uint64_t t1 = msclock();
+        uint32_t size = sorted_intersect_next(&it, tmp, KEYS_IN_BLOCK);
+        t_intersect += msclock() - t1;
+        if (size == 0) {
+            break;
+        }
 
-    for (uint32_t i = 0; i < keycnt; i += max_keys) {
-
-        uint64_t start_time = msclock();
-
-        uint8_t size = keycnt - i > max_keys ? max_keys : keycnt - i;
-
-        register uint8_t j;
-        for (j = 0; j < size; j++) {
-            crypto1_get_lfsr(statelists[0].head.slhead + i, &key64);
+        for (uint32_t j = 0; j < size; j++) {
+            crypto1_get_lfsr((struct Crypto1State *)(tmp + j), &key64);
             num_to_bytes(key64, 6, keyBlock + j * 6);
         }
+        keycnt += size;
 
-        if (mfCheckKeys(statelists[0].blockNo, statelists[0].keyType, false, size, keyBlock, &key64) == PM3_SUCCESS) {
-            free(statelists[0].head.slhead);
-            free(statelists[1].head.slhead);
-            num_to_bytes(key64, 6, resultKey);
+        t1 = msclock();
+        res = mfCheckKeys(statelists[0].blockNo, statelists[0].keyType, false, size, keyBlock, &key64);
+        t_verify += msclock() - t1;
 
-            PrintAndLogEx(SUCCESS, "\ntarget block %4u key type %c -- found valid key [ " _GREEN_("%s") " ]",
-                          package->block,
-                          package->keytype ? 'B' : 'A',
-                          sprint_hex_inrow(resultKey, 6)
-                         );
-            return PM3_SUCCESS;
+        if (res == PM3_SUCCESS) {
+            num_to_bytes(key64, 6, resultKey);
+            break;
         }
 
-        float bruteforce_per_second = (float)(i + max_keys) / ((msclock() - start_time) / 1000.0);
-        PrintAndLogEx(INPLACE, "%6d/%u keys | %5.1f keys/sec | worst case %6.1f seconds remaining", i, keycnt, bruteforce_per_second, (keycnt - i) / bruteforce_per_second);
+        float bruteforce_per_second = t_verify ? (float)keycnt / (t_verify / 1000.0) : 0;
+        PrintAndLogEx(INPLACE, "%6u keys | %5.1f keys/sec", keycnt, bruteforce_per_second);
     }
 
-out:
-    PrintAndLogEx(SUCCESS, "\ntarget block %4u key type %c",
-                  package->block,
-                  package->keytype ? 'B' : 'A'
+    PrintAndLogEx(DEBUG, "\nmfnested timing: recovery %" PRIu64 " ms, sort %" PRIu64 " ms, intersection %" PRIu64 " ms, verify %" PRIu64 " ms ( %u candidates )"
+                  , t_recover - t_start
+                  , t_sort - t_recover
+                  , t_intersect
+                  , t_verify
+                  , keycnt
                  );
 
+    free(tmp);
     free(statelists[0].head.slhead);
     free(statelists[1].head.slhead);
+
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(SUCCESS, "\ntarget block %4u key type %c -- found valid key [ " _GREEN_("%s") " ]",
+                      package->block,
+                      package->keytype ? 'B' : 'A',
+                      sprint_hex_inrow(resultKey, 6)
+                     );
+        return PM3_SUCCESS;
+    }
+
+    if (keycnt) {
+        PrintAndLogEx(SUCCESS, "\ntested " _YELLOW_("%u") " key candidates", keycnt);
+    }
+    PrintAndLogEx(SUCCESS, "\ntarget block %4u key type %c",
+                  package->block,
+                  package->keytype ? 'B' : 'A'
+                 );
     return PM3_ESOFT;
 }
 
 
-int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey) {
+int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, crapto1_arena_t *arena) {
 
     uint32_t uid;
     StateList_t statelists[1];
@@ -633,13 +663,9 @@ int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBl
     memcpy(&statelists[0].ks1, package->ks, sizeof(package->ks));
 
     // calc keys
-    pthread_t t;
-
-    // create and run worker thread
-    pthread_create(&t, NULL, nested_worker_thread, &statelists[0]);
-
-    // wait for thread to terminate:
-    pthread_join(t, (void *)&statelists[0].head.slhead);
+    if (nested_recovery(&statelists[0], arena) != PM3_SUCCESS) {
+        return PM3_EMALLOC;
+    }
 
     // the first 16 Bits of the cryptostate already contain part of our key.
     p1 = p3 = statelists[0].head.slhead;
@@ -891,6 +917,80 @@ int mfEmlSetMem_xt(uint8_t *data, int blockNum, int blocksCount, int blockBtWidt
     return PM3_SUCCESS;
 }
 
+// Uploads blocksCount blocks as full packets in fast push mode, printing a dot per packet.
+// Only the last packet waits for the ACK
+int mfEmlSetMemBulk(uint8_t *data, int blockNum, int blocksCount, int blockBtWidth) {
+    if (blockBtWidth <= 0) {
+        return PM3_EINVARG;
+    }
+
+    // blockno, blockcnt and blockwidth take 3 bytes of the packet
+    int per_packet = (PM3_CMD_DATA_SIZE - 3) / blockBtWidth;
+    int res = PM3_SUCCESS;
+
+    g_conn.block_after_ACK = true;
+    while (blocksCount > 0) {
+        // start block is a uint8_t in the packet
+        if (blockNum > 0xFF) {
+            res = PM3_EOVFLOW;
+            break;
+        }
+
+        int cnt = MIN(per_packet, blocksCount);
+        if (cnt == blocksCount) {
+            // Disable fast mode on last packet
+            g_conn.block_after_ACK = false;
+        }
+
+        res = mfEmlSetMem_xt(data, blockNum, cnt, blockBtWidth);
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+        PrintAndLogEx(NORMAL, "." NOLF);
+        fflush(stdout);
+
+        data += cnt * blockBtWidth;
+        blockNum += cnt;
+        blocksCount -= cnt;
+    }
+    g_conn.block_after_ACK = false;
+    return res;
+}
+
+// Reads back blocksCount blocks of emulator memory and compares their CRC to the one of data
+int mfEmlVerifyMem(uint8_t *data, int blockNum, int blocksCount, int blockBtWidth) {
+    size_t len = blocksCount * blockBtWidth;
+    uint8_t *mem = calloc(len, sizeof(uint8_t));
+    if (mem == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    if (GetFromDevice(BIG_BUF_EML, mem, len, blockNum * blockBtWidth, NULL, 0, NULL, 2500, false) == false) {
+        PrintAndLogEx(WARNING, "Fail, transfer from device time-out");
+        free(mem);
+        return PM3_ETIMEOUT;
+    }
+
+    uint8_t crc_file[4] = {0};
+    uint8_t crc_mem[4] = {0};
+    crc32_ex(data, len, crc_file);
+    crc32_ex(mem, len, crc_mem);
+
+    int res = PM3_SUCCESS;
+    if (memcmp(crc_file, crc_mem, sizeof(crc_file)) != 0) {
+        for (int i = 0; i < blocksCount; i++) {
+            if (memcmp(data + i * blockBtWidth, mem + i * blockBtWidth, blockBtWidth) != 0) {
+                PrintAndLogEx(FAILED, "Emulator memory differs at block: %3d", blockNum + i);
+                break;
+            }
+        }
+        res = PM3_ESOFT;
+    }
+    PrintAndLogEx(DEBUG, "crc32 file %s emulator %s", sprint_hex_inrow(crc_file, 4), sprint_hex_inrow(crc_mem, 4));
+    free(mem);
+    return res;
+}
+
 // "MAGIC" CARD
 int mfCSetUID(uint8_t *uid, uint8_t uidlen, const uint8_t *atqa, const uint8_t *sak, uint8_t *old_uid, uint8_t *verifed_uid, uint8_t wipecard) {
 
@@ -19,6 +19,8 @@
 #include "pm3.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "proxmark3.h"
 #include "cmdmain.h"
@@ -26,42 +28,145 @@
 #include "usart_defs.h"
 #include "util_posix.h"
 #include "comms.h"
+#include "clientctx.h"
+#include "graph.h"
+#include "cmddata.h"
+#include "jansson.h"
 
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+// Each handle has its own context and its own device slot, the first device opened becomes the default one.
+// Commands of a handle run in the calling thread, so different handles can be used from parallel threads.
 pm3_device_t *pm3_open(const char *port) {
-    pm3_init();
-    OpenProxmark(&g_session.current_device, port, false, 20, false, USART_BAUD_RATE);
-    if (g_session.pm3_present && (TestProxmark(g_session.current_device) != PM3_SUCCESS)) {
-        PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark\n");
-        CloseProxmark(g_session.current_device);
-    }
+    pthread_once(&init_once, pm3_init);
 
-    if ((port != NULL) && (!g_session.pm3_present))
-        exit(EXIT_FAILURE);
+    pm3_device_t *dev = calloc(1, sizeof(pm3_device_t));
+    if (dev == NULL) {
+        return NULL;
+    }
+    dev->ctx = NewContext();
+    if (dev->ctx == NULL) {
+        free(dev);
+        return NULL;
+    }
+    dev->index = PM3_OFFLINE_DEVICE;
 
-    if (!g_session.pm3_present)
+    if (port == NULL) {
         PrintAndLogEx(INFO, "Running in " _YELLOW_("OFFLINE") " mode");
-    // For now, there is no real device context:
-    return g_session.current_device;
+        return dev;
+    }
+
+    pm3_device_t *opened = NULL;
+    pm3_device_t **slot = g_session.pm3_present ? &opened : &g_session.current_device;
+    if (OpenProxmark(slot, port, false, 20, false, USART_BAUD_RATE) == false) {
+        pm3_close(dev);
+        return NULL;
+    }
+    if (TestProxmark(*slot) != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark\n");
+        CloseProxmark(*slot);
+        pm3_close(dev);
+        return NULL;
+    }
+    dev->conn = (*slot)->conn;
+    dev->index = (*slot)->index;
+    return dev;
 }
 
 void pm3_close(pm3_device_t *dev) {
     // Clean up the port
-    if (g_session.pm3_present) {
+    pm3_device_t *slot = GetProxmark(dev->index);
+    if (slot) {
+        pm3_device_t *prev = SelectProxmark(slot);
         clearCommandBuffer();
         SendCommandNG(CMD_QUIT_SESSION, NULL, 0);
         msleep(100); // Make sure command is sent before killing client
-        CloseProxmark(dev);
+        SelectProxmark(prev);
+        CloseProxmark(slot);
+    }
+
+    // handles of pm3_open, not the device of pm3_get_current_dev
+    if (dev->ctx) {
+        FreeContext(dev->ctx);
+        free(dev);
     }
 }
 
 int pm3_console(pm3_device_t *dev, const char *cmd) {
-    // For now, there is no real device context:
-    (void) dev;
-    return CommandReceived(cmd);
+    pm3_device_t *prev_dev = SelectProxmark(dev);
+    pm3_context_t *prev_ctx = SelectContext(dev->ctx);
+    int res = CommandReceived(cmd);
+    SelectContext(prev_ctx);
+    SelectProxmark(prev_dev);
+    return res;
+}
+
+static const char *level_names[] = {"normal", "success", "info", "failed", "warning", "error", "debug", "inplace", "hint"};
+
+static void collect_line(int level, const char *line, void *arg) {
+    json_t *lines = (json_t *)arg;
+    json_t *entry = json_object();
+    json_object_set_new(entry, "level", json_string(level_names[level]));
+    json_object_set_new(entry, "text", json_string(line));
+    json_array_append_new(lines, entry);
+}
+
+char *pm3_console_json(pm3_device_t *dev, const char *cmd) {
+    pm3_device_t *prev_dev = SelectProxmark(dev);
+    pm3_context_t *prev_ctx = SelectContext(dev->ctx);
+
+    // the default context of the console keeps printing, so only handles collect their lines
+    json_t *lines = json_array();
+    pm3_context_t *ctx = GetContext();
+    if (dev->ctx) {
+        ctx->print_cb = collect_line;
+        ctx->print_arg = lines;
+    }
+
+    int res = CommandReceived(cmd);
+
+    ctx->print_cb = NULL;
+    ctx->print_arg = NULL;
+
+    json_t *root = json_object();
+    json_object_set_new(root, "command", json_string(cmd));
+    json_object_set_new(root, "status", json_integer(res));
+    json_object_set_new(root, "lines", lines);
+    json_object_set_new(root, "samples", json_integer(g_GraphTraceLen));
+
+    json_t *demod = json_object();
+    char *bits = calloc(g_DemodBufferLen + 1, sizeof(char));
+    if (bits) {
+        for (size_t i = 0; i < g_DemodBufferLen; i++) {
+            bits[i] = g_DemodBuffer[i] ? '1' : '0';
+        }
+        json_object_set_new(demod, "bits", json_string(bits));
+        free(bits);
+    }
+    json_object_set_new(demod, "clock", json_integer(g_DemodClock));
+    json_object_set_new(demod, "start", json_integer(g_DemodStartIdx));
+    json_object_set_new(root, "demod", demod);
+
+    char *out = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+
+    SelectContext(prev_ctx);
+    SelectProxmark(prev_dev);
+    return out;
+}
+
+size_t pm3_samples_get(pm3_device_t *dev, int *dest, size_t len) {
+    pm3_context_t *ctx = dev->ctx ? dev->ctx : &g_default_context;
+    len = MIN(len, ctx->graph_trace_len);
+    memcpy(dest, ctx->graph_buffer, len * sizeof(int));
+    return len;
 }
 
 const char *pm3_name_get(pm3_device_t *dev) {
-    return dev->g_conn->serial_port_name;
+    if (dev->conn == NULL) {
+        return "offline";
+    }
+    return dev->conn->serial_port_name;
 }
 
 pm3_device_t *pm3_get_current_dev(void) {
@@ -8,6 +8,52 @@
 /* Strip "pm3_" from API functions for SWIG */
 %rename("%(strip:[pm3_])s") "";
 %feature("immutable","1") pm3_current_dev;
+/* console_json() returns a malloc'd string, release it once converted */
+%newobject console_json;
+
+/* samples_get(len) returns up to len samples as a list / table */
+%typemap(freearg) (int *dest, size_t len) {
+    free($1);
+}
+#ifdef SWIGPYTHON
+%typemap(in, numinputs=1) (int *dest, size_t len) {
+    $2 = PyLong_AsSize_t($input);
+    if (PyErr_Occurred())
+        SWIG_fail;
+    $1 = (int *)calloc($2 ? $2 : 1, sizeof(int));
+    if ($1 == NULL)
+        SWIG_exception_fail(SWIG_MemoryError, "in method '$symname', cannot allocate samples buffer");
+}
+%typemap(argout) (int *dest, size_t len) {
+    PyObject *list = PyList_New(result);
+    if (list == NULL)
+        SWIG_fail;
+    for (size_t i = 0; i < result; i++)
+        PyList_SET_ITEM(list, i, PyLong_FromLong($1[i]));
+    Py_DECREF($result);
+    $result = list;
+}
+#endif
+#ifdef SWIGLUA
+%typemap(in, numinputs=1) (int *dest, size_t len) {
+    if (!lua_isnumber(L, $input))
+        SWIG_fail_arg("$symname", $input, "size_t");
+    $2 = (size_t)lua_tonumber(L, $input);
+    $1 = (int *)calloc($2 ? $2 : 1, sizeof(int));
+    if ($1 == NULL) {
+        lua_pushstring(L, "cannot allocate samples buffer");
+        SWIG_fail;
+    }
+}
+%typemap(argout) (int *dest, size_t len) {
+    lua_pop(L, 1);
+    lua_createtable(L, (int)result, 0);
+    for (size_t i = 0; i < result; i++) {
+        lua_pushnumber(L, (lua_Number)$1[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+}
+#endif
 typedef struct {
     %extend {
         pm3() {
@@ -19,7 +65,8 @@ typedef struct {
         pm3(char *port) {
 //            printf("SWIG pm3 constructor with port, open pm3\n");
             pm3_device_t * p = pm3_open(port);
-            p->script_embedded = 0;
+            if (p)
+                p->script_embedded = 0;
             return p;
         }
         ~pm3() {
@@ -31,6 +78,8 @@ typedef struct {
             }
         }
         int console(char *cmd);
+        char *console_json(char *cmd);
+        size_t samples_get(int *dest, size_t len);
         char const * const name;
     }
 } pm3;
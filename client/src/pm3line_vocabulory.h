@@ -421,8 +421,10 @@ const static vocabulory_t vocabulory[] = {
     { 0, "hw lcd" }, 
     { 0, "hw lcdreset" }, 
     { 0, "hw ping" }, 
+    { 0, "hw pingbench" }, 
     { 0, "hw readmem" }, 
     { 0, "hw reset" }, 
+    { 1, "hw select" }, 
     { 0, "hw setlfdivisor" }, 
     { 0, "hw setmux" }, 
     { 0, "hw standalone" }, 
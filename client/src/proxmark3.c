@@ -140,6 +140,20 @@ static int check_comm(void) {
         pm3line_update_prompt(prompt_filtered);
         CloseProxmark(g_session.current_device);
     }
+    // the other devices just go away
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        pm3_device_t *dev = GetProxmark(i);
+        if ((dev == NULL) || (dev == g_session.current_device)) {
+            continue;
+        }
+        pm3_device_t *prev = SelectProxmark(dev);
+        bool dead = IsCommunicationThreadDead();
+        SelectProxmark(prev);
+        if (dead) {
+            PrintAndLogEx(INFO, "Device " _YELLOW_("%d") " on " _YELLOW_("%s") " disconnected", i, dev->conn->serial_port_name);
+            CloseProxmark(dev);
+        }
+    }
     msleep(10);
     return 0;
 }
@@ -552,7 +566,7 @@ static void show_help(bool showFullHelp, char *exec_name) {
         PrintAndLogEx(NORMAL, "\nCommon options:");
         PrintAndLogEx(NORMAL, "      -h/--help                           this help");
         PrintAndLogEx(NORMAL, "      -v/--version                        print client version");
-        PrintAndLogEx(NORMAL, "      -p/--port                           serial port to connect to");
+        PrintAndLogEx(NORMAL, "      -p/--port                           serial port to connect to, repeat it to connect several devices");
         PrintAndLogEx(NORMAL, "      -w/--wait                           20sec waiting the serial port to appear in the OS");
         PrintAndLogEx(NORMAL, "      -f/--flush                          output will be flushed after every print");
         PrintAndLogEx(NORMAL, "      -d/--debug <0|1|2>                  set debugmode");
@@ -712,6 +726,9 @@ int main(int argc, char *argv[]) {
     char *script_cmds_file = NULL;
     char *script_cmd = NULL;
     char *port = NULL;
+    // more devices to connect, -p given several times
+    char *extra_ports[PM3_MAX_DEVICES - 1];
+    int num_extra_ports = 0;
     uint32_t speed = 0;
 
     pm3line_init();
@@ -769,10 +786,14 @@ int main(int argc, char *argv[]) {
                 return 1;
             }
             if (port != NULL) {
-                // We got already one
-                PrintAndLogEx(ERR, _RED_("ERROR:") " cannot parse command line. We got " _YELLOW_("%s") " as port and now we got also: " _YELLOW_("%s") "\n", port, argv[i + 1]);
-                show_help(false, exec_name);
-                return 1;
+                // We got already one, connect several devices
+                if (num_extra_ports == PM3_MAX_DEVICES - 1) {
+                    PrintAndLogEx(ERR, _RED_("ERROR:") " cannot connect more than " _YELLOW_("%d") " devices\n", PM3_MAX_DEVICES);
+                    show_help(false, exec_name);
+                    return 1;
+                }
+                extra_ports[num_extra_ports++] = argv[++i];
+                continue;
             }
             port = argv[++i];
             continue;
@@ -978,6 +999,10 @@ int main(int argc, char *argv[]) {
         speed = USART_BAUD_RATE;
 
     if (flash_mode) {
+        if (num_extra_ports) {
+            PrintAndLogEx(ERR, _RED_("ERROR:") " only one device can be flashed at a time\n");
+            return 1;
+        }
         flash_pm3(port, flash_num_files, flash_filenames, flash_can_write_bl);
         exit(EXIT_SUCCESS);
     }
@@ -1020,6 +1045,21 @@ int main(int argc, char *argv[]) {
     if ((port != NULL) && (!g_session.pm3_present))
         exit(EXIT_FAILURE);
 
+    for (int i = 0; i < num_extra_ports; i++) {
+        pm3_device_t *dev = NULL;
+        if (OpenProxmark(&dev, extra_ports[i], waitCOMPort, 20, false, speed) == false) {
+            exit(EXIT_FAILURE);
+        }
+        if (TestProxmark(dev) != PM3_SUCCESS) {
+            PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark on " _YELLOW_("%s") "\n", extra_ports[i]);
+            CloseProxmark(dev);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (num_extra_ports) {
+        PrintAndLogEx(INFO, "Connected to " _YELLOW_("%d") " devices, see " _YELLOW_("`hw select`"), CountProxmarks());
+    }
+
     if (!g_session.pm3_present)
         PrintAndLogEx(INFO, "Running in " _YELLOW_("OFFLINE") " mode. Check " _YELLOW_("\"%s -h\"") " if it's not what you want.\n", exec_name);
 
@@ -1068,10 +1108,8 @@ int main(int argc, char *argv[]) {
     main_loop(script_cmds_file, script_cmd, stayInCommandLoop);
 #endif
 
-    // Clean up the port
-    if (g_session.pm3_present) {
-        CloseProxmark(g_session.current_device);
-    }
+    // Clean up the ports
+    CloseProxmarks();
 
     if (g_session.window_changed) // Plot/Overlay moved or resized
         preferences_save();
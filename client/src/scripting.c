@@ -503,6 +503,41 @@ static int l_foobar(lua_State *L) {
     return 2;
 }
 
+/**
+ * @brief Number of connected Proxmark3 devices
+ * @param L
+ * @return number of devices
+ */
+static int l_device_count(lua_State *L) {
+    lua_pushinteger(L, CountProxmarks());
+    return 1;
+}
+
+/**
+ * @brief Selects the device the following commands of the script are sent to. Each device
+ * has its own reply buffer, so a script can keep commands running on several devices at once.
+ * The following params expected:
+ *  device number, see `hw select`. Without, the default device is selected again
+ * @param L
+ * @return true, or nil and an error message if the device isn't connected
+ */
+static int l_select_device(lua_State *L) {
+    if (lua_gettop(L) == 0 || lua_isnil(L, 1)) {
+        SelectProxmark(NULL);
+        lua_pushboolean(L, true);
+        return 1;
+    }
+
+    int idx = luaL_checkinteger(L, 1);
+    pm3_device_t *dev = GetProxmark(idx);
+    if (dev == NULL) {
+        return returnToLuaWithError(L, "No device %d connected", idx);
+    }
+    SelectProxmark(dev);
+    lua_pushboolean(L, true);
+    return 1;
+}
+
 /**
  * @brief Utility to check if a key has been pressed by the user. This method does not block.
  * @param L
@@ -1399,6 +1434,8 @@ int set_pm3_libraries(lua_State *L) {
         {"t55xx_detect",                l_T55xx_detect},
         {"ndefparse",                   l_ndefparse},
         {"fast_push_mode",              l_fast_push_mode},
+        {"device_count",                l_device_count},
+        {"select_device",               l_select_device},
         {"search_file",                 l_searchfile},
         {"cwd",                         l_cwd},
         {"ewd",                         l_ewd},
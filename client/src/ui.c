@@ -46,6 +46,7 @@
 #include <time.h>
 #include "emojis.h"
 #include "emojis_alt.h"
+#include "clientctx.h"
 session_arg_t g_session;
 
 double g_CursorScaleFactor = 1;
@@ -187,6 +188,25 @@ void PrintAndLogOptions(const char *str[][2], size_t size, size_t space) {
 
 static uint8_t PrintAndLogEx_spinidx = 0;
 
+// hands the lines of buffer to the print callback of the context instead of printing them
+static void PrintToContext(pm3_context_t *ctx, logLevel_t level, const char *buffer) {
+    char line[MAX_PRINT_BUFFER] = {0};
+    memcpy_filter_ansi(line, buffer, sizeof(line), true);
+
+    char *start = line;
+    while (*start) {
+        char *end = strchr(start, '\n');
+        if (end) {
+            *end = '\0';
+        }
+        ctx->print_cb(level, start, ctx->print_arg);
+        if (end == NULL) {
+            break;
+        }
+        start = end + 1;
+    }
+}
+
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
 
     // skip debug messages if client debugging is turned off i.e. 'DATA SETDEBUG -0'
@@ -197,6 +217,21 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
     if (g_session.show_hints == false && level == HINT)
         return;
 
+    pm3_context_t *ctx = GetContext();
+    if (ctx->print_cb) {
+        // spinners are of no use to a callback
+        if (level == INPLACE)
+            return;
+
+        char buf[MAX_PRINT_BUFFER] = {0};
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        PrintToContext(ctx, level, buf);
+        return;
+    }
+
     char prefix[40] = {0};
     char buffer[MAX_PRINT_BUFFER] = {0};
     char buffer2[MAX_PRINT_BUFFER + sizeof(prefix)] = {0};
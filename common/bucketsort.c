@@ -14,6 +14,7 @@
 // See LICENSE.txt for the text of the license.
 //-----------------------------------------------------------------------------
 #include "bucketsort.h"
+#include <string.h>
 
 extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                                   uint32_t *const ostart, uint32_t *const ostop,
@@ -58,3 +59,67 @@ extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
         bucket_info->numbuckets = nonempty_bucket;
     }
 }
+
+void radix_sort_u64(uint64_t *list, uint64_t *tmp, size_t n, uint64_t mask) {
+    uint64_t *src = list, *dst = tmp;
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        if (((mask >> shift) & 0xff) == 0)
+            continue;
+
+        size_t count[0x100] = {0};
+        for (size_t i = 0; i < n; i++)
+            count[(src[i] & mask) >> shift & 0xff]++;
+
+        // all values in one bucket, nothing to do for this byte
+        if (n == 0 || count[(src[0] & mask) >> shift & 0xff] == n)
+            continue;
+
+        size_t pos = 0;
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            size_t c = count[j];
+            count[j] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[count[(src[i] & mask) >> shift & 0xff]++] = src[i];
+
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != list)
+        memcpy(list, src, n * sizeof(uint64_t));
+}
+
+void sorted_intersect_init(sorted_intersect_t *it, const uint64_t *a, size_t na, const uint64_t *b, size_t nb) {
+    it->a = a;
+    it->a_end = a + na;
+    it->b = b;
+    it->b_end = b + nb;
+}
+
+size_t sorted_intersect_next(sorted_intersect_t *it, uint64_t *out, size_t max) {
+    const uint64_t *a = it->a, *b = it->b;
+    size_t n = 0;
+
+    while (a < it->a_end && b < it->b_end && n < max) {
+        // skip whole runs of smaller values first, the lists are long and the intersection small
+        while (a + 4 < it->a_end && a[3] < *b)
+            a += 4;
+        while (b + 4 < it->b_end && b[3] < *a)
+            b += 4;
+
+        // branchless merge step
+        uint64_t x = *a, y = *b;
+        out[n] = x;
+        n += (x == y);
+        a += (x <= y);
+        b += (y <= x);
+    }
+
+    it->a = a;
+    it->b = b;
+    return n;
+}
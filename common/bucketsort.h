@@ -36,4 +36,18 @@ void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                            uint32_t *const ostart, uint32_t *const ostop,
                            bucket_info_t *bucket_info, bucket_array_t bucket);
 
+// LSD radix sort of list[0..n-1] in ascending order of (value & mask), 8 bits per pass.
+// The sort is stable, tmp must have room for n values.
+void radix_sort_u64(uint64_t *list, uint64_t *tmp, size_t n, uint64_t mask);
+
+// resumable intersection of two ascending sorted lists
+typedef struct sorted_intersect {
+    const uint64_t *a, *a_end;
+    const uint64_t *b, *b_end;
+} sorted_intersect_t;
+
+void sorted_intersect_init(sorted_intersect_t *it, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+// writes the next (at most max) common values to out[], returns their number. 0 when done
+size_t sorted_intersect_next(sorted_intersect_t *it, uint64_t *out, size_t max);
+
 #endif
@@ -246,3 +246,10 @@ uint16_t get_sw(const uint8_t *d, uint8_t n) {
     n -= 2;
     return d[n] * 0x0100 + d[n + 1];
 }
+
+void mf_decode_access_rights(const uint8_t *trailer, uint8_t rights[4]) {
+    rights[0] = ((trailer[7] & 0x10) >> 2) | ((trailer[8] & 0x1) << 1) | ((trailer[8] & 0x10) >> 4); // C1C2C3 for data area 0
+    rights[1] = ((trailer[7] & 0x20) >> 3) | ((trailer[8] & 0x2) << 0) | ((trailer[8] & 0x20) >> 5); // C1C2C3 for data area 1
+    rights[2] = ((trailer[7] & 0x40) >> 4) | ((trailer[8] & 0x4) >> 1) | ((trailer[8] & 0x40) >> 6); // C1C2C3 for data area 2
+    rights[3] = ((trailer[7] & 0x80) >> 5) | ((trailer[8] & 0x8) >> 2) | ((trailer[8] & 0x80) >> 7); // C1C2C3 for sector trailer
+}
@@ -85,4 +85,7 @@ uint32_t rotl(uint32_t a, uint8_t n);
 uint32_t rotr(uint32_t a, uint8_t n);
 
 uint16_t get_sw(const uint8_t *d, uint8_t n);
+
+// MIFARE Classic access bits C1C2C3 of data areas 0..2 and of the trailer (rights[3]), from a sector trailer block
+void mf_decode_access_rights(const uint8_t *trailer, uint8_t rights[4]);
 #endif
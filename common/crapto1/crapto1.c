@@ -19,8 +19,18 @@
 #include "bucketsort.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include "parity.h"
 
+#if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+#include <pthread.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#endif
+
 #if !defined LOWMEM && defined __GNUC__
 static uint8_t filterlut[1 << 20];
 static void __attribute__((constructor)) fill_lut(void) {
@@ -124,15 +134,218 @@ recover(uint32_t *o_head, uint32_t *o_tail, uint32_t oks,
 
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+
+#define RECOVERY32_TABLE_SIZE   (1 << 21)
+#define RECOVERY32_BUCKET_SIZE  (1 << 14)
+#define RECOVERY32_STATES       (1 << 18)
+#define RECOVERY64_STATES       (1 << 4)
+#define RECOVERY64_CHUNK_BITS   12
+#define RECOVERY64_CHUNKS       (1 << (20 - RECOVERY64_CHUNK_BITS))
+#define RECOVERY_MAX_JOBS       0x100
+
+typedef struct crapto1_worker {
+    struct crapto1_arena *arena;
+    uint32_t *odd, *even;
+    bucket_array_t bucket;
+    struct Crypto1State *statelist;
+} crapto1_worker_t;
+
+struct crapto1_arena {
+    uint32_t threads;
+    // lfsr_recovery32() tables and buckets, also used by the workers' first step
+    uint32_t *odd, *even;
+    bucket_array_t bucket;
+    bucket_info_t bucket_info;
+    // one worker per thread, only when running multi-threaded
+    crapto1_worker_t *worker;
+    // parameters of the current recovery, shared by all workers
+    uint32_t oks, eks, in;
+    int rem;
+    uint8_t oks64[32], eks64[32];
+    // jobs are handed out in order, results are collected in order too. This gives the same
+    // statelist as the single-threaded recovery, independent of the number of threads
+    uint32_t num_jobs;
+    uint32_t next_job;
+    struct {
+        struct Crypto1State *statelist;
+        uint32_t len;
+    } job[RECOVERY_MAX_JOBS];
+};
+
+static uint32_t num_cpus(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? count : 1;
+#endif
+}
+
+static void free_buckets(bucket_array_t bucket) {
+    for (uint32_t i = 0; i < 2; i++)
+        for (uint32_t j = 0; j <= 0xff; j++)
+            free(bucket[i][j].head);
+}
+
+static bool alloc_buckets(bucket_array_t bucket) {
+    bool ok = true;
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            bucket[i][j].head = malloc(sizeof(uint32_t) * RECOVERY32_BUCKET_SIZE);
+            ok &= (bucket[i][j].head != NULL);
+        }
+    }
+    return ok;
+}
+
+/** crapto1_arena_create
+ * allocate the working memory of lfsr_recovery32_ex() and lfsr_recovery64_ex() once,
+ * to be reused by many recoveries. threads = 0 means one thread per CPU.
+ * Pages are only touched when a recovery needs them.
+ */
+crapto1_arena_t *crapto1_arena_create(uint32_t threads) {
+    crapto1_arena_t *arena = calloc(1, sizeof(crapto1_arena_t));
+    if (!arena)
+        return NULL;
+
+    arena->threads = threads ? threads : num_cpus();
+    if (arena->threads > RECOVERY_MAX_JOBS)
+        arena->threads = RECOVERY_MAX_JOBS;
+
+    arena->odd = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    arena->even = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+    bool ok = arena->odd && arena->even && alloc_buckets(arena->bucket);
+
+    if (ok && arena->threads > 1) {
+        arena->worker = calloc(arena->threads, sizeof(crapto1_worker_t));
+        ok = (arena->worker != NULL);
+        for (uint32_t t = 0; ok && t < arena->threads; t++) {
+            crapto1_worker_t *w = &arena->worker[t];
+            w->arena = arena;
+            w->odd = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+            w->even = malloc(sizeof(uint32_t) * RECOVERY32_TABLE_SIZE);
+            w->statelist = malloc(sizeof(struct Crypto1State) * RECOVERY32_STATES);
+            ok = w->odd && w->even && w->statelist && alloc_buckets(w->bucket);
+        }
+    }
+
+    if (!ok) {
+        crapto1_arena_destroy(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void crapto1_arena_destroy(crapto1_arena_t *arena) {
+    if (!arena)
+        return;
+
+    if (arena->worker) {
+        for (uint32_t t = 0; t < arena->threads; t++) {
+            crapto1_worker_t *w = &arena->worker[t];
+            free(w->odd);
+            free(w->even);
+            free(w->statelist);
+            free_buckets(w->bucket);
+        }
+        free(arena->worker);
+    }
+    free(arena->odd);
+    free(arena->even);
+    free_buckets(arena->bucket);
+    free(arena);
+}
+
+// run worker 0 in the calling thread and the others in their own threads
+static void run_workers(crapto1_arena_t *arena, void *(*fn)(void *)) {
+    pthread_t thread_id[arena->threads];
+    bool started[arena->threads];
+
+    arena->next_job = 0;
+    for (uint32_t t = 1; t < arena->threads; t++)
+        started[t] = (pthread_create(&thread_id[t], NULL, fn, &arena->worker[t]) == 0);
+
+    fn(&arena->worker[0]);
+
+    for (uint32_t t = 1; t < arena->threads; t++)
+        if (started[t])
+            pthread_join(thread_id[t], NULL);
+}
+
+// concatenate the results of all jobs into a new statelist
+static struct Crypto1State *collect_jobs(crapto1_arena_t *arena) {
+    size_t len = 0;
+    for (uint32_t j = 0; j < arena->num_jobs; j++)
+        len += arena->job[j].len;
+
+    struct Crypto1State *statelist = malloc(sizeof(struct Crypto1State) * (len + 1));
+    if (!statelist)
+        return NULL;
+
+    struct Crypto1State *sl = statelist;
+    for (uint32_t j = 0; j < arena->num_jobs; j++) {
+        memcpy(sl, arena->job[j].statelist, sizeof(struct Crypto1State) * arena->job[j].len);
+        sl += arena->job[j].len;
+    }
+    sl->odd = sl->even = 0;
+    return statelist;
+}
+
+/** recovery32_worker
+ * recover() for the buckets of the first bucket sort, each one copied to the worker's own
+ * tables, since recover() may grow a bucket into its neighbour.
+ */
+static void *recovery32_worker(void *arg) {
+    crapto1_worker_t *w = arg;
+    crapto1_arena_t *arena = w->arena;
+    struct Crypto1State *sl = w->statelist;
+    uint32_t j;
+
+    while ((j = __atomic_fetch_add(&arena->next_job, 1, __ATOMIC_SEQ_CST)) < arena->num_jobs) {
+        // recover() works through the buckets starting with the last one
+        uint32_t b = arena->num_jobs - 1 - j;
+        uint32_t *o_head = arena->bucket_info.bucket_info[1][b].head;
+        uint32_t *e_head = arena->bucket_info.bucket_info[0][b].head;
+        uint32_t olen = arena->bucket_info.bucket_info[1][b].tail - o_head + 1;
+        uint32_t elen = arena->bucket_info.bucket_info[0][b].tail - e_head + 1;
+        memcpy(w->odd, o_head, sizeof(uint32_t) * olen);
+        memcpy(w->even, e_head, sizeof(uint32_t) * elen);
+
+        arena->job[j].statelist = sl;
+        sl = recover(w->odd, w->odd + olen - 1, arena->oks,
+                     w->even, w->even + elen - 1, arena->eks,
+                     arena->rem, sl, arena->in, w->bucket);
+        arena->job[j].len = sl - arena->job[j].statelist;
+    }
+    return NULL;
+}
+
 /** lfsr_recovery
  * recover the state of the lfsr given 32 bits of the keystream
  * additionally you can use the in parameter to specify the value
  * that was fed into the lfsr at the time the keystream was generated
  */
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
-    struct Crypto1State *statelist;
-    uint32_t *odd_head = 0, *odd_tail = 0, oks = 0;
-    uint32_t *even_head = 0, *even_tail = 0, eks = 0;
+    crapto1_arena_t *arena = crapto1_arena_create(1);
+    if (!arena)
+        return NULL;
+
+    struct Crypto1State *statelist = lfsr_recovery32_ex(ks2, in, arena);
+    crapto1_arena_destroy(arena);
+    return statelist;
+}
+
+/** lfsr_recovery32_ex
+ * lfsr_recovery32() using the tables of a caller owned arena. With more than one
+ * thread the buckets of the first bucket sort are recovered in parallel.
+ * The statelist is allocated and must be free()d by the caller.
+ */
+struct Crypto1State *lfsr_recovery32_ex(uint32_t ks2, uint32_t in, crapto1_arena_t *arena) {
+    struct Crypto1State *statelist = NULL;
+    uint32_t *odd_head = arena->odd, *odd_tail = odd_head - 1, oks = 0;
+    uint32_t *even_head = arena->even, *even_tail = even_head - 1, eks = 0;
     int i;
 
     // split the keystream into an odd and even part
@@ -141,29 +354,6 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     for (i = 30; i >= 0; i -= 2)
         eks = eks << 1 | BEBIT(ks2, i);
 
-    odd_head = odd_tail = calloc(1, sizeof(uint32_t) << 21);
-    even_head = even_tail = calloc(1, sizeof(uint32_t) << 21);
-    statelist =  calloc(1, sizeof(struct Crypto1State) << 18);
-    if (!odd_tail-- || !even_tail-- || !statelist) {
-        free(statelist);
-        statelist = 0;
-        goto out;
-    }
-
-    statelist->odd = statelist->even = 0;
-
-    // allocate memory for out of place bucket_sort
-    bucket_array_t bucket;
-
-    for (i = 0; i < 2; i++) {
-        for (uint32_t j = 0; j <= 0xff; j++) {
-            bucket[i][j].head = calloc(1, sizeof(uint32_t) << 14);
-            if (!bucket[i][j].head) {
-                goto out;
-            }
-        }
-    }
-
     // initialize statelists: add all possible states which would result into the rightmost 2 bits of the keystream
     for (i = 1 << 20; i >= 0; --i) {
         if (filter(i) == (oks & 1))
@@ -182,15 +372,40 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in) {
     // 22 bits to go to recover 32 bits in total. From now on, we need to take the "in"
     // parameter into account.
     in = (in >> 16 & 0xff) | (in << 16) | (in & 0xff00); // Byte swapping
-    recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in << 1, bucket);
+    in <<= 1;
 
-out:
-    for (i = 0; i < 2; i++)
-        for (uint32_t j = 0; j <= 0xff; j++)
-            free(bucket[i][j].head);
-    free(odd_head);
-    free(even_head);
-    return statelist;
+    if (arena->threads <= 1) {
+        statelist = calloc(1, sizeof(struct Crypto1State) * RECOVERY32_STATES);
+        if (statelist)
+            recover(odd_head, odd_tail, oks, even_head, even_tail, eks, 11, statelist, in, arena->bucket);
+        return statelist;
+    }
+
+    // first step of recover(), done here to share its buckets out between the threads
+    int rem = 11;
+    for (i = 0; i < 4 && rem--; i++) {
+        oks >>= 1;
+        eks >>= 1;
+        in >>= 2;
+        extend_table(odd_head, &odd_tail, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1, 0);
+        if (odd_head > odd_tail)
+            return calloc(1, sizeof(struct Crypto1State));
+
+        extend_table(even_head, &even_tail, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1, in & 3);
+        if (even_head > even_tail)
+            return calloc(1, sizeof(struct Crypto1State));
+    }
+
+    bucket_sort_intersect(even_head, even_tail, odd_head, odd_tail, &arena->bucket_info, arena->bucket);
+
+    arena->oks = oks;
+    arena->eks = eks;
+    arena->in = in;
+    arena->rem = rem;
+    arena->num_jobs = arena->bucket_info.numbuckets;
+    run_workers(arena, recovery32_worker);
+
+    return collect_jobs(arena);
 }
 
 static const uint32_t S1[] = {     0x62141, 0x310A0, 0x18850, 0x0C428, 0x06214,
@@ -217,31 +432,16 @@ static const uint32_t T2[] = {  0x3C88B810, 0x5E445C08, 0x2982A580, 0x14C152C0,
                              };
 static const uint32_t C1[] = { 0x846B5, 0x4235A, 0x211AD};
 static const uint32_t C2[] = { 0x1A822E0, 0x21A822E0, 0x21A822E0};
-/** Reverse 64 bits of keystream into possible cipher states
- * Variation mentioned in the paper. Somewhat optimized version
+/** recovery64_range
+ * the states of lfsr_recovery64() with odd part i in from..to, from >= to
  */
-struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
-    struct Crypto1State *statelist, *sl;
-    uint8_t oks[32], eks[32], hi[32];
+static struct Crypto1State *recovery64_range(const uint8_t *oks, const uint8_t *eks, int from, int to, uint32_t *table, struct Crypto1State *sl) {
+    uint8_t hi[32];
     uint32_t low = 0,  win = 0;
-    uint32_t *tail, table[1 << 16];
+    uint32_t *tail;
     int i, j;
 
-    sl = statelist = calloc(1, sizeof(struct Crypto1State) << 4);
-    if (!sl)
-        return 0;
-    sl->odd = sl->even = 0;
-
-    for (i = 30; i >= 0; i -= 2) {
-        oks[i >> 1] = BEBIT(ks2, i);
-        oks[16 + (i >> 1)] = BEBIT(ks3, i);
-    }
-    for (i = 31; i >= 0; i -= 2) {
-        eks[i >> 1] = BEBIT(ks2, i);
-        eks[16 + (i >> 1)] = BEBIT(ks3, i);
-    }
-
-    for (i = 0xfffff; i >= 0; --i) {
+    for (i = from; i >= to; --i) {
         if (filter(i) != oks[0])
             continue;
 
@@ -284,7 +484,61 @@ continue2:
             ;
         }
     }
-    return statelist;
+    return sl;
+}
+
+static void *recovery64_worker(void *arg) {
+    crapto1_worker_t *w = arg;
+    crapto1_arena_t *arena = w->arena;
+    struct Crypto1State *sl = w->statelist;
+    uint32_t j;
+
+    while ((j = __atomic_fetch_add(&arena->next_job, 1, __ATOMIC_SEQ_CST)) < arena->num_jobs) {
+        int from = 0xfffff - (j << RECOVERY64_CHUNK_BITS);
+        arena->job[j].statelist = sl;
+        sl = recovery64_range(arena->oks64, arena->eks64, from, from - (1 << RECOVERY64_CHUNK_BITS) + 1, w->odd, sl);
+        arena->job[j].len = sl - arena->job[j].statelist;
+    }
+    return NULL;
+}
+
+/** Reverse 64 bits of keystream into possible cipher states
+ * Variation mentioned in the paper. Somewhat optimized version
+ */
+struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
+    crapto1_arena_t arena = { .threads = 1 };
+    return lfsr_recovery64_ex(ks2, ks3, &arena);
+}
+
+/** lfsr_recovery64_ex
+ * lfsr_recovery64() splitting the odd part of the state between the threads of the arena.
+ * The statelist is allocated and must be free()d by the caller.
+ */
+struct Crypto1State *lfsr_recovery64_ex(uint32_t ks2, uint32_t ks3, crapto1_arena_t *arena) {
+    uint8_t *oks = arena->oks64, *eks = arena->eks64;
+    int i;
+
+    for (i = 30; i >= 0; i -= 2) {
+        oks[i >> 1] = BEBIT(ks2, i);
+        oks[16 + (i >> 1)] = BEBIT(ks3, i);
+    }
+    for (i = 31; i >= 0; i -= 2) {
+        eks[i >> 1] = BEBIT(ks2, i);
+        eks[16 + (i >> 1)] = BEBIT(ks3, i);
+    }
+
+    if (arena->threads <= 1) {
+        uint32_t table[1 << 16];
+        struct Crypto1State *statelist = calloc(1, sizeof(struct Crypto1State) * RECOVERY64_STATES);
+        if (statelist)
+            recovery64_range(oks, eks, 0xfffff, 0, table, statelist);
+        return statelist;
+    }
+
+    arena->num_jobs = RECOVERY64_CHUNKS;
+    run_workers(arena, recovery64_worker);
+
+    return collect_jobs(arena);
 }
 #endif
 
@@ -37,6 +37,15 @@ uint32_t prng_successor(uint32_t x, uint32_t n);
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
 struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
+
+// Working memory of the recovery functions, allocate it once and reuse it for many recoveries.
+// With threads > 1 (0 = one per CPU) the recovery runs in parallel. An arena can only be used
+// by one recovery at a time. The result is the same statelist lfsr_recovery32/64() would return.
+typedef struct crapto1_arena crapto1_arena_t;
+crapto1_arena_t *crapto1_arena_create(uint32_t threads);
+void crapto1_arena_destroy(crapto1_arena_t *arena);
+struct Crypto1State *lfsr_recovery32_ex(uint32_t ks2, uint32_t in, crapto1_arena_t *arena);
+struct Crypto1State *lfsr_recovery64_ex(uint32_t ks2, uint32_t ks3, crapto1_arena_t *arena);
 struct Crypto1State *
 lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par);
 #endif
@@ -0,0 +1,165 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1: test many keys against one authentication at once
+//
+// Bit n of every word belongs to key n. The LFSR is kept as a stream y[] of
+// bits, y[t] being the bit shifted in last. In terms of struct Crypto1State
+// at time t:  odd bit j = y[t - 2j],  even bit j = y[t - 1 - 2j]
+//-----------------------------------------------------------------------------
+#include "crypto1_bs.h"
+#include <string.h>
+#include "crapto1.h"
+
+typedef uint64_t bs_t;
+
+#define BS_ONES        (~(bs_t)0)
+#define BS_BIT(x, n)   ((bs_t)0 - (bs_t)BEBIT(x, n))
+
+// initial state (48 bits) + four 32 bit words (nt, nr, ar, at)
+#define BS_STREAM_LEN  (48 + 4 * 32)
+
+// filter function, made of two 4 bit functions and a 5 bit one
+static inline bs_t bs_fa(bs_t a, bs_t b, bs_t c, bs_t d) {
+    return ((a | b) ^ (a & d)) ^ (c & ((a ^ b) | d));
+}
+
+static inline bs_t bs_fb(bs_t a, bs_t b, bs_t c, bs_t d) {
+    return ((a & b) | c) ^ ((a ^ b) & (c | d));
+}
+
+static inline bs_t bs_fc(bs_t a, bs_t b, bs_t c, bs_t d, bs_t e) {
+    return (a | ((b | e) & (d ^ e))) ^ ((a ^ (b & d)) & ((c ^ d) | (b & e)));
+}
+
+static inline bs_t bs_filter(const bs_t *y) {
+    // y points to the newest bit, odd bits 0..19 are y[0], y[-2] .. y[-38]
+    bs_t n0 = bs_fb(y[-6],  y[-4],  y[-2],  y[0]);
+    bs_t n1 = bs_fa(y[-14], y[-12], y[-10], y[-8]);
+    bs_t n2 = bs_fb(y[-22], y[-20], y[-18], y[-16]);
+    bs_t n3 = bs_fb(y[-30], y[-28], y[-26], y[-24]);
+    bs_t n4 = bs_fa(y[-38], y[-36], y[-34], y[-32]);
+    return bs_fc(n4, n3, n2, n1, n0);
+}
+
+// one crypto1_bit() for all keys, returns the keystream bit
+static inline bs_t bs_bit(bs_t *y, bs_t in, bool is_encrypted) {
+    bs_t ks = bs_filter(y);
+    // LF_POLY_ODD and LF_POLY_EVEN taps
+    bs_t fb = y[-4] ^ y[-5] ^ y[-6] ^ y[-8] ^ y[-12] ^ y[-18] ^ y[-20] ^ y[-22] ^ y[-23]
+              ^ y[-28] ^ y[-30] ^ y[-32] ^ y[-33] ^ y[-35] ^ y[-37] ^ y[-38] ^ y[-42] ^ y[-47];
+    y[1] = fb ^ in ^ (is_encrypted ? ks : 0);
+    return ks;
+}
+
+// loads the keys and runs the tag and the reader nonce. Returns the position of the newest bit.
+// z[] (if given) gets the tag PRNG stream, z[64..95] is suc64(nt), z[96..127] is suc96(nt)
+static bs_t *run_nonces(const crypto1_auth_t *auth, const uint64_t *keys, size_t lanes, bs_t *y, bs_t *z) {
+
+    // load the keys, see crypto1_init(): y[47 - m] = key bit m ^ 7
+    memset(y, 0, 48 * sizeof(bs_t));
+    for (size_t lane = 0; lane < lanes; lane++) {
+        uint64_t key = keys[lane];
+        for (uint8_t m = 0; m < 48; m++) {
+            y[47 - m] |= (bs_t)((key >> (m ^ 7)) & 1) << lane;
+        }
+    }
+    bs_t *p = y + 47;
+
+    // uid ^ nt, the tag nonce is encrypted in nested authentications
+    uint32_t in = auth->uid ^ auth->nt;
+    for (uint8_t i = 0; i < 32; i++, p++) {
+        bs_t ks = bs_bit(p, BS_BIT(in, i), auth->nested);
+        if (z) {
+            z[i] = BS_BIT(auth->nt, i) ^ (auth->nested ? ks : 0);
+        }
+    }
+
+    // prng_successor() as a stream, in crypto1_word() bit order
+    if (z) {
+        for (uint8_t i = 0; i < 128 - 32; i++) {
+            z[i + 32] = z[i + 16] ^ z[i + 18] ^ z[i + 19] ^ z[i + 21];
+        }
+    }
+
+    // encrypted reader nonce
+    for (uint8_t i = 0; i < 32; i++, p++) {
+        bs_bit(p, BS_BIT(auth->nr_enc, i), true);
+    }
+    return p;
+}
+
+// returns the lanes (keys) which pass the authentication
+static bs_t check_block(const crypto1_auth_t *auth, const uint64_t *keys, size_t lanes) {
+    bs_t y[BS_STREAM_LEN];
+    bs_t z[128];
+    bs_t alive = (lanes >= CRYPTO1_BS_LANES) ? BS_ONES : ((bs_t)1 << lanes) - 1;
+
+    bs_t *p = run_nonces(auth, keys, lanes, y, z);
+
+    // reader answer: ks2 ^ suc64(nt) == ar_enc. Most keys fail within the first few bits
+    bs_t fail = 0;
+    for (uint8_t i = 0; i < 32; i++, p++) {
+        fail |= bs_bit(p, 0, false) ^ z[64 + i] ^ BS_BIT(auth->ar_enc, i);
+        if ((fail & alive) == alive) {
+            return 0;
+        }
+    }
+
+    // tag answer: ks3 ^ suc96(nt) == at_enc
+    if (auth->has_at) {
+        for (uint8_t i = 0; i < 32; i++, p++) {
+            fail |= bs_bit(p, 0, false) ^ z[96 + i] ^ BS_BIT(auth->at_enc, i);
+            if ((fail & alive) == alive) {
+                return 0;
+            }
+        }
+    }
+    return alive & ~fail;
+}
+
+size_t crypto1_bs_check_keys(const crypto1_auth_t *auth, const uint64_t *keys, size_t count, uint32_t *found, size_t max_found) {
+    size_t num_found = 0;
+    for (size_t base = 0; base < count; base += CRYPTO1_BS_LANES) {
+        size_t lanes = count - base;
+        if (lanes > CRYPTO1_BS_LANES) {
+            lanes = CRYPTO1_BS_LANES;
+        }
+        bs_t match = check_block(auth, keys + base, lanes);
+        while (match) {
+            if (num_found < max_found) {
+                found[num_found] = base + __builtin_ctzll(match);
+            }
+            num_found++;
+            match &= match - 1;
+        }
+    }
+    return num_found;
+}
+
+void crypto1_bs_keystream(const crypto1_auth_t *auth, const uint64_t *keys, size_t lanes, uint64_t *ks, size_t nbits) {
+    bs_t y[BS_STREAM_LEN + nbits];
+
+    bs_t *p = run_nonces(auth, keys, lanes, y, NULL);
+
+    // reader and tag answer
+    for (uint8_t i = 0; i < 64; i++, p++) {
+        bs_bit(p, 0, false);
+    }
+
+    for (size_t i = 0; i < nbits; i++, p++) {
+        ks[i] = bs_bit(p, 0, false);
+    }
+}
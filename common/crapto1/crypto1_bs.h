@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1: test many keys against one authentication at once
+//-----------------------------------------------------------------------------
+#ifndef CRYPTO1_BS_INCLUDED
+#define CRYPTO1_BS_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// number of keys run in parallel, one per bit of a uint64_t
+#define CRYPTO1_BS_LANES 64
+
+// one authentication as seen in a trace
+typedef struct {
+    uint32_t uid;
+    uint32_t nt;        // tag nonce, encrypted when nested is set
+    uint32_t nr_enc;
+    uint32_t ar_enc;
+    uint32_t at_enc;    // only used when has_at is set
+    bool nested;
+    bool has_at;
+} crypto1_auth_t;
+
+// Tests keys[0..count-1] against one authentication. A key matches if it reproduces ar_enc (and
+// at_enc). Indices of matching keys are written to found[], at most max_found of them.
+// Returns the number of matching keys.
+size_t crypto1_bs_check_keys(const crypto1_auth_t *auth, const uint64_t *keys, size_t count, uint32_t *found, size_t max_found);
+
+// Keystream following a complete authentication ({nt}, {nr}, {ar}, {at}) for keys[0..lanes-1],
+// lanes <= CRYPTO1_BS_LANES. ar_enc and at_enc are not checked. Bit n of ks[i] is keystream bit i
+// of keys[n], in crypto1_byte() order: bit i is bit (i % 8) of keystream byte i / 8.
+void crypto1_bs_keystream(const crypto1_auth_t *auth, const uint64_t *keys, size_t lanes, uint64_t *ks, size_t nbits);
+
+#endif
@@ -20,9 +20,9 @@
 #include <string.h>
 #include "commonutil.h"
 
-static uint16_t crc_table[256];
-static bool crc_table_init = false;
-static CrcType_t current_crc_type = CRC_NONE;
+static THREAD_LOCAL uint16_t crc_table[256];
+static THREAD_LOCAL bool crc_table_init = false;
+static THREAD_LOCAL CrcType_t current_crc_type = CRC_NONE;
 
 void init_table(CrcType_t crctype) {
 
@@ -69,7 +69,7 @@ uint8_t g_debugMode = 0;
 # define prnt Dbprintf
 #endif
 
-static signal_t signalprop = { 255, -255, 0, 0, true };
+static THREAD_LOCAL signal_t signalprop = { 255, -255, 0, 0, true };
 signal_t *getSignalProperties(void) {
     return &signalprop;
 }
@@ -82,6 +82,84 @@ static void resetSignal(void) {
     signalprop.isnoise = true;
 }
 
+#ifndef ON_DEVICE
+// Clock detection cache. lf search and the clock detection commands run many demods over copies of the
+// same samples, each detecting the clocks again. Results are kept by a hash of the samples, the parameters
+// and the signal properties, so any change of the samples misses. Not used in debug mode, to keep its prints.
+#define CLOCK_CACHE_SIZE 32
+
+typedef enum {CC_ASK, CC_NRZ, CC_PSK, CC_FC, CC_FSK} clock_cache_kind_t;
+
+typedef struct {
+    bool used;
+    clock_cache_kind_t kind;
+    uint64_t hash;
+    size_t size;
+    int in[4];
+    signal_t signal;
+    int ret;
+    int out[3];
+} clock_cache_t;
+
+static THREAD_LOCAL clock_cache_t clock_cache[CLOCK_CACHE_SIZE];
+static THREAD_LOCAL uint8_t clock_cache_next = 0;
+
+static uint64_t hashSamples(const uint8_t *samples, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, samples + i, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ samples[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static bool sameSignal(const signal_t *a, const signal_t *b) {
+    return (a->low == b->low) && (a->high == b->high) && (a->mean == b->mean)
+           && (a->amplitude == b->amplitude) && (a->isnoise == b->isnoise);
+}
+
+// Returns the cached result of the detection, else NULL and key is set up for clockCacheStore
+static clock_cache_t *clockCacheLookup(clock_cache_t *key, clock_cache_kind_t kind, const uint8_t *samples, size_t size, int in0, int in1, int in2, int in3) {
+    key->used = false;
+    if (g_debugMode) {
+        return NULL;
+    }
+
+    key->used = true;
+    key->kind = kind;
+    key->hash = hashSamples(samples, size);
+    key->size = size;
+    key->in[0] = in0;
+    key->in[1] = in1;
+    key->in[2] = in2;
+    key->in[3] = in3;
+    key->signal = signalprop;
+
+    for (uint8_t i = 0; i < CLOCK_CACHE_SIZE; i++) {
+        clock_cache_t *e = &clock_cache[i];
+        if (e->used && (e->kind == kind) && (e->hash == key->hash) && (e->size == size)
+                && (memcmp(e->in, key->in, sizeof(e->in)) == 0) && sameSignal(&e->signal, &signalprop)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void clockCacheStore(const clock_cache_t *key) {
+    if (key->used == false) {
+        return;
+    }
+    clock_cache[clock_cache_next] = *key;
+    clock_cache_next = (clock_cache_next + 1) % CLOCK_CACHE_SIZE;
+}
+#endif
+
 static void printSignal(void) {
     prnt("LF signal properties:");
     prnt("  high..........%d", signalprop.high);
@@ -683,7 +761,7 @@ int DetectStrongAskClock(uint8_t *dest, size_t size, int high, int low, int *clo
 // not perfect especially with lower clocks or VERY good antennas (heavy wave clipping)
 // maybe somehow adjust peak trimming value based on samples to fix?
 // return start index of best starting position for that clock and return clock (by reference)
-int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
+static int askClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
 
     //don't need to loop through entire array. (cotag has clock of 384)
     uint16_t loopCnt = 2000;
@@ -838,6 +916,23 @@ int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
     return bestStart[best];
 }
 
+int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr) {
+#ifndef ON_DEVICE
+    clock_cache_t key;
+    clock_cache_t *e = clockCacheLookup(&key, CC_ASK, dest, size, *clock, maxErr, 0, 0);
+    if (e) {
+        *clock = e->out[0];
+        return e->ret;
+    }
+    key.ret = askClock(dest, size, clock, maxErr);
+    key.out[0] = *clock;
+    clockCacheStore(&key);
+    return key.ret;
+#else
+    return askClock(dest, size, clock, maxErr);
+#endif
+}
+
 int DetectStrongNRZClk(const uint8_t *dest, size_t size, int peak, int low, bool *strong) {
     //find shortest transition from high to low
     *strong = false;
@@ -882,7 +977,7 @@ int DetectStrongNRZClk(const uint8_t *dest, size_t size, int peak, int low, bool
 }
 
 // detect nrz clock by reading #peaks vs no peaks(or errors)
-int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
+static int nrzClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
     size_t i = 0;
     uint8_t clk[] = {8, 16, 32, 40, 50, 64, 100, 128, 255};
     size_t loopCnt = 4096;  //don't need to loop through entire array...
@@ -1008,10 +1103,27 @@ int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx)
     return clk[best];
 }
 
+int DetectNRZClock(uint8_t *dest, size_t size, int clock, size_t *clockStartIdx) {
+#ifndef ON_DEVICE
+    clock_cache_t key;
+    clock_cache_t *e = clockCacheLookup(&key, CC_NRZ, dest, size, clock, *clockStartIdx, 0, 0);
+    if (e) {
+        *clockStartIdx = e->out[0];
+        return e->ret;
+    }
+    key.ret = nrzClock(dest, size, clock, clockStartIdx);
+    key.out[0] = *clockStartIdx;
+    clockCacheStore(&key);
+    return key.ret;
+#else
+    return nrzClock(dest, size, clock, clockStartIdx);
+#endif
+}
+
 // countFC is to detect the field clock lengths.
 // counts and returns the 2 most common wave lengths
 // mainly used for FSK field clock detection
-uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj) {
+static uint16_t fieldClocks(const uint8_t *bits, size_t size, bool fskAdj) {
     uint8_t fcLens[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint16_t fcCnts[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t fcLensFnd = 0;
@@ -1098,9 +1210,24 @@ uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj) {
     return (uint16_t)fcLens[best2] << 8 | fcLens[best1];
 }
 
+uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj) {
+#ifndef ON_DEVICE
+    clock_cache_t key;
+    clock_cache_t *e = clockCacheLookup(&key, CC_FC, bits, size, fskAdj, 0, 0, 0);
+    if (e) {
+        return e->ret;
+    }
+    key.ret = fieldClocks(bits, size, fskAdj);
+    clockCacheStore(&key);
+    return key.ret;
+#else
+    return fieldClocks(bits, size, fskAdj);
+#endif
+}
+
 // detect psk clock by reading each phase shift
 // a phase shift is determined by measuring the sample length of each wave
-int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
+static int pskClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
     uint8_t clk[] = {255, 16, 32, 40, 50, 64, 100, 128, 255}; //255 is not a valid clock
     uint16_t loopCnt = 4096;  //don't need to loop through entire array...
 
@@ -1196,8 +1323,29 @@ int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShif
     return clk[best];
 }
 
+int DetectPSKClock(uint8_t *dest, size_t size, int clock, size_t *firstPhaseShift, uint8_t *curPhase, uint8_t *fc) {
+#ifndef ON_DEVICE
+    clock_cache_t key;
+    clock_cache_t *e = clockCacheLookup(&key, CC_PSK, dest, size, clock, *firstPhaseShift, *curPhase, *fc);
+    if (e) {
+        *firstPhaseShift = e->out[0];
+        *curPhase = e->out[1];
+        *fc = e->out[2];
+        return e->ret;
+    }
+    key.ret = pskClock(dest, size, clock, firstPhaseShift, curPhase, fc);
+    key.out[0] = *firstPhaseShift;
+    key.out[1] = *curPhase;
+    key.out[2] = *fc;
+    clockCacheStore(&key);
+    return key.ret;
+#else
+    return pskClock(dest, size, clock, firstPhaseShift, curPhase, fc);
+#endif
+}
+
 // detects the bit clock for FSK given the high and low Field Clocks
-uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t fcLow, int *firstClockEdge) {
+static uint8_t fskClock(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t fcLow, int *firstClockEdge) {
 
     if (size == 0)
         return 0;
@@ -1304,6 +1452,23 @@ uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t f
     return clk[m];
 }
 
+uint8_t detectFSKClk(const uint8_t *bits, size_t size, uint8_t fcHigh, uint8_t fcLow, int *firstClockEdge) {
+#ifndef ON_DEVICE
+    clock_cache_t key;
+    clock_cache_t *e = clockCacheLookup(&key, CC_FSK, bits, size, fcHigh, fcLow, *firstClockEdge, 0);
+    if (e) {
+        *firstClockEdge = e->out[0];
+        return e->ret;
+    }
+    key.ret = fskClock(bits, size, fcHigh, fcLow, firstClockEdge);
+    key.out[0] = *firstClockEdge;
+    clockCacheStore(&key);
+    return key.ret;
+#else
+    return fskClock(bits, size, fcHigh, fcLow, firstClockEdge);
+#endif
+}
+
 
 // **********************************************************************************************
 // --------------------Modulation Demods &/or Decoding Section-----------------------------------
@@ -143,3 +143,18 @@ uint64_t msclock(void) {
 #endif
 }
 
+// a microseconds timer for latency measurement
+uint64_t usclock(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER freq = {{0, 0}};
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1000000.0 / (double)freq.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (1000000 * (uint64_t)t.tv_sec + t.tv_nsec / 1000);
+#endif
+}
@@ -45,6 +45,13 @@
 
 #define PACKED __attribute__((packed))
 
+// State of shared code kept per thread in the client, where libpm3 handles run commands in parallel threads
+#ifdef ON_DEVICE
+#define THREAD_LOCAL
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 #define VERSION_INFORMATION_MAGIC 0x56334d50 // "PM3V"
 struct version_information_t {
     int magic; /* Magic sequence to identify this as a correct version information structure. Must be VERSION_INFORMATION_MAGIC */
@@ -37,5 +37,24 @@ typedef enum ISO15_COMMAND {
     ISO15_READ_RESPONSE = (1 << 5)
 } iso15_command_t;
 
+// hf 15 dump, blocks read on device
+typedef struct {
+    uint8_t flags;          // request flags, ISO15_REQ_ADDRESS adds the uid
+    uint8_t uid[8];
+    uint8_t fast;           // 1 out of 4 instead of 1 out of 256
+    uint8_t start;          // first block
+    uint8_t count;          // blocks to read
+    uint8_t per_read;       // blocks per READ MULTIPLE BLOCKS, 1 reads single blocks
+    uint8_t blocksize;
+    uint8_t retries;        // per read, on timeout or CRC error
+} PACKED iso15_read_blocks_t;
+
+typedef struct {
+    uint8_t read;           // blocks read
+    uint8_t per_read;       // blocks per read the tag accepted
+    uint8_t error;          // tag error code, 0 if none
+    uint8_t data[];         // per block, security status (ISO15_REQ_OPTION) then data
+} PACKED iso15_read_blocks_resp_t;
+
 
 #endif // _ISO15_H_
@@ -47,6 +47,15 @@ typedef struct {
 #define COMMANDNG_PREAMBLE_MAGIC  0x61334d50 // PM3a
 #define COMMANDNG_POSTAMBLE_MAGIC 0x3361     // a3
 
+// Windowed mode: the preamble is followed by a sequence number, which the device echoes
+// in all replies to the command. Only sent if the device announces a cmd_window in its capabilities
+typedef struct {
+    PacketCommandNGPreamble pre;
+    uint16_t seq;
+} PACKED PacketCommandNGSeqPreamble;
+
+#define COMMANDNG_SEQ_PREAMBLE_MAGIC 0x63334d50 // PM3c
+
 typedef struct {
     uint16_t crc;
 } PACKED PacketCommandNGPostamble;
@@ -63,6 +72,7 @@ typedef struct {
         uint32_t asDwords[PM3_CMD_DATA_SIZE / 4];
     } data;
     bool ng;             // does it store NG data or OLD data?
+    uint16_t seq;        // sequence number, 0 if none
 } PacketCommandNG;
 
 // For reception and CRC check
@@ -72,6 +82,12 @@ typedef struct {
     PacketCommandNGPostamble foopost; // Probably not at that offset!
 } PACKED PacketCommandNGRaw;
 
+typedef struct {
+    PacketCommandNGSeqPreamble pre;
+    uint8_t data[PM3_CMD_DATA_SIZE];
+    PacketCommandNGPostamble foopost; // Probably not at that offset!
+} PACKED PacketCommandNGSeqRaw;
+
 typedef struct {
     uint64_t cmd;
     uint64_t arg[3];
@@ -92,6 +108,14 @@ typedef struct {
 #define RESPONSENG_PREAMBLE_MAGIC  0x62334d50 // PM3b
 #define RESPONSENG_POSTAMBLE_MAGIC 0x3362     // b3
 
+// Reply to a command sent in windowed mode, see PacketCommandNGSeqPreamble
+typedef struct {
+    PacketResponseNGPreamble pre;
+    uint16_t seq;
+} PACKED PacketResponseNGSeqPreamble;
+
+#define RESPONSENG_SEQ_PREAMBLE_MAGIC 0x64334d50 // PM3d
+
 typedef struct {
     uint16_t crc;
 } PACKED PacketResponseNGPostamble;
@@ -109,6 +133,7 @@ typedef struct {
         uint32_t asDwords[PM3_CMD_DATA_SIZE / 4];
     } data;
     bool ng;             // does it store NG data or OLD data?
+    uint16_t seq;        // sequence number of the command, 0 if none
 } PacketResponseNG;
 
 // For reception and CRC check
@@ -118,6 +143,12 @@ typedef struct {
     PacketResponseNGPostamble foopost; // Probably not at that offset!
 } PACKED PacketResponseNGRaw;
 
+typedef struct {
+    PacketResponseNGSeqPreamble pre;
+    uint8_t data[PM3_CMD_DATA_SIZE];
+    PacketResponseNGPostamble foopost; // Probably not at that offset!
+} PACKED PacketResponseNGSeqRaw;
+
 // A struct used to send sample-configs over USB
 typedef struct {
     int8_t decimation;
@@ -205,9 +236,32 @@ typedef struct {
     // rdv4
     bool hw_available_flash            : 1;
     bool hw_available_smartcard        : 1;
+
+    // number of windowed commands the device can queue, 0 if not supported
+    uint8_t cmd_window;
+    // DOWNLOAD_COMPRESS_* methods CMD_DOWNLOAD_BIGBUF can use
+    uint8_t download_compression;
+    // DEVICE_CMD_* commands the firmware runs on its own, the client falls back to host side loops without them
+    uint32_t device_cmds;
 } PACKED capabilities_t;
-#define CAPABILITIES_VERSION 6
-extern capabilities_t g_pm3_capabilities;
+#define CAPABILITIES_VERSION 9
+// older versions are the same structure, shorter. Still accepted by the client
+#define CAPABILITIES_VERSION_NO_WINDOW 6
+#define CAPABILITIES_VERSION_NO_COMPRESSION 7
+#define CAPABILITIES_VERSION_NO_DEVICE_CMDS 8
+
+// capabilities_t device_cmds
+#define DEVICE_CMD_DESFIRE_CHKKEYS      0x00000001
+#define DEVICE_CMD_14A_SNIFF_STREAM     0x00000002
+#define DEVICE_CMD_MIFARE_DUMP          0x00000004
+#define DEVICE_CMD_ISO15_READ_BLOCKS    0x00000008
+
+// commands in flight in windowed mode
+#define PM3_CMD_WINDOW 8
+
+// CMD_DOWNLOAD_BIGBUF arg2: compression the client accepts. Compressed chunks are CMD_DOWNLOADED_BIGBUF_LZ4
+// MIX frames, arg0 = offset, arg1 = uncompressed length, arg2 = tracelen, data = one LZ4 block
+#define DOWNLOAD_COMPRESS_LZ4 0x01
 
 // For CMD_LF_T55XX_WRITEBL
 typedef struct {
@@ -284,6 +338,18 @@ typedef struct {
     uint8_t keytype;
 } PACKED mfc_eload_t;
 
+// hf mf dump, all sectors read on device with the keys of a key file
+typedef struct {
+    uint8_t sectorcnt;
+    uint8_t keys[2][40][6];     // [key type][sector]
+} PACKED mfc_dump_t;
+
+typedef struct {
+    uint32_t offset;            // dump offset in BigBuf
+    uint16_t blocks;            // blocks in the dump, 16 bytes each
+    uint8_t read[32];           // bitmap of the blocks read, by block number
+} PACKED mfc_dump_resp_t;
+
 typedef struct {
     uint8_t status;
     uint8_t CSN[8];
@@ -447,6 +513,7 @@ typedef struct {
 #define CMD_LF_MOD_THEN_ACQ_RAW_ADC                                       0x0206
 #define CMD_DOWNLOAD_BIGBUF                                               0x0207
 #define CMD_DOWNLOADED_BIGBUF                                             0x0208
+#define CMD_DOWNLOADED_BIGBUF_LZ4                                         0x0212
 #define CMD_LF_UPLOAD_SIM_SAMPLES                                         0x0209
 #define CMD_LF_SIMULATE                                                   0x020A
 #define CMD_LF_HID_WATCH                                                  0x020B
@@ -519,6 +586,7 @@ typedef struct {
 #define CMD_HF_ISO15693_FINDAFI                                           0x0315
 #define CMD_HF_ISO15693_CSETUID                                           0x0316
 #define CMD_HF_ISO15693_SLIX_L_DISABLE_PRIVACY                            0x0317
+#define CMD_HF_ISO15693_READ_BLOCKS                                       0x0318
 
 #define CMD_LF_SNIFF_RAW_ADC                                              0x0360
 
@@ -543,6 +611,7 @@ typedef struct {
 #define CMD_HF_ISO14443A_SIMULATE                                         0x0384
 
 #define CMD_HF_ISO14443A_READER                                           0x0385
+#define CMD_HF_ISO14443A_SNIFF_STREAM                                     0x0386
 
 #define CMD_HF_LEGIC_SIMULATE                                             0x0387
 #define CMD_HF_LEGIC_READER                                               0x0388
@@ -611,6 +680,7 @@ typedef struct {
 #define CMD_HF_MIFARE_READBL                                              0x0620
 #define CMD_HF_MIFAREU_READBL                                             0x0720
 #define CMD_HF_MIFARE_READSC                                              0x0621
+#define CMD_HF_MIFARE_DUMP                                                0x0627
 #define CMD_HF_MIFAREU_READCARD                                           0x0721
 #define CMD_HF_MIFARE_WRITEBL                                             0x0622
 #define CMD_HF_MIFAREU_WRITEBL                                            0x0722
@@ -638,6 +708,7 @@ typedef struct {
 #define CMD_HF_DESFIRE_READER                                             0x072c
 #define CMD_HF_DESFIRE_INFO                                               0x072d
 #define CMD_HF_DESFIRE_COMMAND                                            0x072e
+#define CMD_HF_DESFIRE_CHKKEYS                                            0x072f
 
 #define CMD_HF_MIFARE_NACK_DETECT                                         0x0730
 #define CMD_HF_MIFARE_STATIC_NONCE                                        0x0731
@@ -9,9 +9,11 @@
 #include <unistd.h>
 #include <ctype.h>
 #include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
 #include "protocol.h"
 #include "iso14443crc.h"
 #include "util_posix.h"
+#include "common.h"
 
 #define AEND  "\x1b[0m"
 #define _RED_(s) "\x1b[31m" s AEND
@@ -39,14 +41,11 @@ uint32_t at_par_err = 0;
 typedef struct thread_args {
     uint16_t xored;
     int thread;
-    int idx;
-    bool ev1;
 } targs;
 
 #define ENC_LEN  (200)
 typedef struct thread_key_args {
     int thread;
-    int idx;
     uint32_t uid;
     uint32_t part_key;
     uint32_t nt_enc;
@@ -68,12 +67,205 @@ uint8_t cmds[8][2] = {
     {MIFARE_CMD_TRANSFER, 0}
 };
 
-//static int global_counter = 0;
 static int global_found = 0;
 static int global_found_candidate = 0;
 static uint64_t global_candidate_key = 0;
 static int thread_count = 2;
 
+//------------------------------------------------------------------
+// work scheduling
+//
+// Both phases search 2^16 values (tag nonces in phase 1, upper key bits in phase 2), split into
+// chunks. Threads take the next chunk from a shared counter, so a thread which is done early
+// simply takes more chunks and no core idles until the phase is over.
+// Phase 1 searches all nonces twice: first the chunks for normal tags, which check all parity
+// bits, then the chunks for EV1 tags with the nonces left over. A normal key candidate ends
+// phase 1 at once. An EV1 candidate only stops the EV1 chunks, the normal chunks still running
+// are finished first since a normal candidate takes precedence.
+
+#define CHUNK_BITS      8
+#define NUM_CHUNKS      (0x10000 >> CHUNK_BITS)
+#define MAX_CHUNKS      (2 * NUM_CHUNKS)
+
+typedef struct {
+    const char *name;       // what is counted, for the progress meter
+    uint32_t num_chunks;
+    uint32_t next_chunk;
+    uint32_t chunks_done;
+    uint64_t tested;
+    uint64_t start_time;
+    uint64_t last_print;
+} phase_t;
+
+static phase_t phases[2] = {
+    { .name = "nonces", .num_chunks = 2 * NUM_CHUNKS },
+    { .name = "keys", .num_chunks = NUM_CHUNKS },
+};
+
+//------------------------------------------------------------------
+// checkpoints
+//
+// With --checkpoint <file> the finished chunks of both phases and the result of phase 1 are
+// written to <file> after every chunk. Started again with the same file and arguments, finished
+// chunks are skipped.
+
+#define CHECKPOINT_MAGIC    "PM3NBCK"
+#define CHECKPOINT_VERSION  1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t args[8];                       // uid, {nt}, nt_par_err, {nr}, {ar}, ar_par_err, {at}, at_par_err
+    uint16_t enc_len;
+    uint8_t enc[ENC_LEN];
+    uint32_t done[2][MAX_CHUNKS / 32];      // finished chunks of both phases
+    uint8_t phase1_found;                   // 0 = no key yet, 1 = key, 2 = EV1 key candidate
+    uint64_t phase1_key;
+} PACKED checkpoint_t;
+
+static const char *checkpoint_filename = NULL;
+static checkpoint_t checkpoint;
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void checkpoint_init(const uint8_t *enc, uint16_t enc_len) {
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    memcpy(checkpoint.magic, CHECKPOINT_MAGIC, sizeof(checkpoint.magic));
+    checkpoint.version = CHECKPOINT_VERSION;
+    uint32_t args[8] = { uid, nt_enc, nt_par_err, nr_enc, ar_enc, ar_par_err, at_enc, at_par_err };
+    memcpy(checkpoint.args, args, sizeof(args));
+    checkpoint.enc_len = enc_len;
+    memcpy(checkpoint.enc, enc, enc_len);
+}
+
+// load a checkpoint written for the same arguments
+static bool checkpoint_read(void) {
+    FILE *f = fopen(checkpoint_filename, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    checkpoint_t cp;
+    bool ok = (fread(&cp, sizeof(cp), 1, f) == 1);
+    fclose(f);
+
+    ok = ok
+         && memcmp(cp.magic, checkpoint.magic, sizeof(cp.magic)) == 0
+         && cp.version == CHECKPOINT_VERSION
+         && memcmp(cp.args, checkpoint.args, sizeof(cp.args)) == 0
+         && cp.enc_len == checkpoint.enc_len
+         && memcmp(cp.enc, checkpoint.enc, cp.enc_len) == 0;
+
+    if (ok) {
+        memcpy(&checkpoint, &cp, sizeof(checkpoint));
+    }
+    return ok;
+}
+
+// caller holds checkpoint_lock
+static void checkpoint_write(void) {
+    if (checkpoint_filename == NULL) {
+        return;
+    }
+
+    size_t len = strlen(checkpoint_filename) + 5;
+    char tmpname[len];
+    snprintf(tmpname, len, "%s.tmp", checkpoint_filename);
+
+    FILE *f = fopen(tmpname, "wb");
+    bool ok = (f != NULL);
+    ok = ok && (fwrite(&checkpoint, sizeof(checkpoint), 1, f) == 1);
+    if (f != NULL) {
+        ok &= (fclose(f) == 0);
+    }
+    if (ok == false || rename(tmpname, checkpoint_filename) != 0) {
+        printf("\nFailed to write checkpoint %s\n", checkpoint_filename);
+    }
+}
+
+static bool chunk_is_done(int phase, uint32_t chunk) {
+    return (checkpoint.done[phase][chunk / 32] >> (chunk % 32)) & 1;
+}
+
+static bool all_chunks_done(int phase) {
+    for (uint32_t chunk = 0; chunk < phases[phase].num_chunks; chunk++) {
+        if (chunk_is_done(phase, chunk) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void phase_start(int phase) {
+    phase_t *ph = &phases[phase];
+    ph->next_chunk = 0;
+    ph->chunks_done = 0;
+    ph->tested = 0;
+    ph->start_time = msclock();
+    ph->last_print = ph->start_time;
+}
+
+// next chunk to search, false when there is nothing left to do
+static bool claim_chunk(int phase, uint32_t *chunk) {
+    phase_t *ph = &phases[phase];
+
+    while (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 0) {
+        uint32_t c = __atomic_fetch_add(&ph->next_chunk, 1, __ATOMIC_SEQ_CST);
+        if (c >= ph->num_chunks) {
+            return false;
+        }
+        if (chunk_is_done(phase, c)) {
+            __atomic_fetch_add(&ph->chunks_done, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        *chunk = c;
+        return true;
+    }
+    return false;
+}
+
+static void print_progress(phase_t *ph, bool force) {
+    uint64_t now = msclock();
+    if (force == false && now - ph->last_print < 1000) {
+        return;
+    }
+    ph->last_print = now;
+
+    uint64_t tested = __atomic_load_n(&ph->tested, __ATOMIC_SEQ_CST);
+    uint32_t chunks_done = __atomic_load_n(&ph->chunks_done, __ATOMIC_SEQ_CST);
+    float rate = (now > ph->start_time) ? tested * 1000.0 / (now - ph->start_time) : 0;
+    printf("\r%3u%% | %10.0f %s/s | %3u / %u chunks ", chunks_done * 100 / ph->num_chunks, rate, ph->name, chunks_done, ph->num_chunks);
+    fflush(stdout);
+}
+
+static void finish_chunk(int phase, uint32_t chunk, uint32_t tested) {
+    phase_t *ph = &phases[phase];
+    __atomic_fetch_add(&ph->tested, tested, __ATOMIC_SEQ_CST);
+
+    // an interrupted chunk (key found by another thread) isn't done
+    if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    if (phase == 0 && chunk >= NUM_CHUNKS && __atomic_load_n(&global_found_candidate, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_fetch_add(&ph->chunks_done, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint.done[phase][chunk / 32] |= (1U << (chunk % 32));
+    checkpoint_write();
+    pthread_mutex_unlock(&checkpoint_lock);
+
+    pthread_mutex_lock(&print_lock);
+    print_progress(ph, false);
+    pthread_mutex_unlock(&print_lock);
+}
+
+static void checkpoint_remove(void) {
+    if (checkpoint_filename != NULL && remove(checkpoint_filename) == 0) {
+        printf("Removed checkpoint " _YELLOW_("%s") "\n", checkpoint_filename);
+    }
+}
+
 static int param_getptr(const char *line, int *bg, int *en, int paramnum) {
     int i;
     int len = strlen(line);
@@ -372,36 +564,66 @@ static void *brute_thread(void *arguments) {
     uint32_t nt;      // current tag nonce
 
     uint32_t p64 = 0;
-    uint32_t count;
-    // TC == 4  (
-    // threads calls 0 ev1 == false
-    // threads calls 0,1,2  ev1 == true
-    for (count = args->idx; count <= 0xFFFF; count += thread_count - 1) {
+    uint32_t chunk;
+
+    while (claim_chunk(0, &chunk)) {
+
+        // the second half of the chunks are for EV1 tags
+        bool ev1 = (chunk >= NUM_CHUNKS);
 
-        if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
+        // all normal chunks are handed out before the EV1 ones, nothing left to do after an EV1 candidate
+        if (ev1 && __atomic_load_n(&global_found_candidate, __ATOMIC_ACQUIRE)) {
             break;
         }
 
-        nt = count << 16 | prng_successor(count, 16);
+        uint32_t first = (chunk % NUM_CHUNKS) << CHUNK_BITS;
 
-        if (candidate_nonce(args->xored, nt, args->ev1) == false)
-            continue;
+        uint32_t count;
+        for (count = first; count < first + (1 << CHUNK_BITS); count++) {
+
+            if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
+                break;
+            }
+            if (ev1 && __atomic_load_n(&global_found_candidate, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+
+            nt = count << 16 | prng_successor(count, 16);
+
+            // EV1 tags don't give away the parity of the first two bytes of nt,
+            // the nonces which pass the full check were already tested
+            if (candidate_nonce(args->xored, nt, ev1) == false)
+                continue;
+
+            if (ev1 && candidate_nonce(args->xored, nt, false))
+                continue;
 
-        p64 = prng_successor(nt, 64);
-        ks2 = ar_enc ^ p64;
-        ks3 = at_enc ^ prng_successor(p64, 32);
-        revstate = lfsr_recovery64(ks2, ks3);
-        ks4 = crypto1_word(revstate, 0, 0);
+            p64 = prng_successor(nt, 64);
+            ks2 = ar_enc ^ p64;
+            ks3 = at_enc ^ prng_successor(p64, 32);
+            revstate = lfsr_recovery64(ks2, ks3);
+            ks4 = crypto1_word(revstate, 0, 0);
 
-        if (ks4 != 0) {
+            if (ks4 == 0) {
+                free(revstate);
+                continue;
+            }
 
             // lock this section to avoid interlacing prints from different threats
             pthread_mutex_lock(&print_lock);
-            if (args->ev1)
+
+            // another thread found a candidate meanwhile, only a normal one replaces an EV1 one
+            if (global_found || (ev1 && global_found_candidate)) {
+                pthread_mutex_unlock(&print_lock);
+                free(revstate);
+                break;
+            }
+
+            if (ev1)
                 printf("\n**** Possible key candidate ****\n");
 
 #if 0
-            printf("thread #%d idx %d %s\n", args->thread, args->idx, (args->ev1) ? "(Ev1)" : "");
+            printf("thread #%d %s\n", args->thread, (ev1) ? "(Ev1)" : "");
             printf("current nt(%08x)  ar_enc(%08x)  at_enc(%08x)\n", nt, ar_enc, at_enc);
             printf("ks2:%08x\n", ks2);
             printf("ks3:%08x\n", ks3);
@@ -409,7 +631,7 @@ static void *brute_thread(void *arguments) {
 #endif
             if (cmd_enc) {
                 uint32_t decrypted = ks4 ^ cmd_enc;
-                printf("CMD enc( %08x )\n", cmd_enc);
+                printf("\nCMD enc( %08x )\n", cmd_enc);
                 printf("    dec( %08x )    ", decrypted);
 
                 // check if cmd exists
@@ -439,71 +661,126 @@ static void *brute_thread(void *arguments) {
             lfsr_rollback_word(revstate, nr_enc, 1);
             lfsr_rollback_word(revstate, uid ^ nt, 0);
             crypto1_get_lfsr(revstate, &key);
+            free(revstate);
 
-            if (args->ev1) {
+            __atomic_store_n(&global_candidate_key, key, __ATOMIC_SEQ_CST);
+            if (ev1) {
                 // if it was EV1,  we know for sure xxxAAAAAAAA recovery
                 printf("\nKey candidate [ " _YELLOW_("....%08" PRIx64)" ]\n\n", key & 0xFFFFFFFF);
-                __sync_fetch_and_add(&global_found_candidate, 1);
+
+                // stops the EV1 chunks, the normal chunks still running may find a better candidate
+                __atomic_store_n(&global_found_candidate, 1, __ATOMIC_RELEASE);
             } else {
                 printf("\nKey candidate [ " _GREEN_("....%08" PRIx64) " ]\n\n", key & 0xFFFFFFFF);
-                __sync_fetch_and_add(&global_found, 1);
+
+                // a normal candidate ends phase 1
+                __atomic_store_n(&global_found_candidate, 0, __ATOMIC_RELEASE);
+                __atomic_store_n(&global_found, 1, __ATOMIC_RELEASE);
             }
+
             //release lock
             pthread_mutex_unlock(&print_lock);
-            __sync_fetch_and_add(&global_candidate_key, key);
-            free(revstate);
             break;
         }
-        free(revstate);
+        finish_chunk(0, chunk, count - first);
     }
     free(args);
     return NULL;
 }
 
+// decrypt the data following the authentication with one key, prints the key if it looks right
+static bool check_key(struct thread_key_args *args, uint64_t key) {
+
+    // Init cipher with key
+    struct Crypto1State *pcs = crypto1_create(key);
+
+    // NESTED decrypt nt with help of new key
+    crypto1_word(pcs, args->nt_enc ^ args->uid, 1);
+    crypto1_word(pcs, args->nr_enc, 1);
+    crypto1_word(pcs, 0, 0);
+    crypto1_word(pcs, 0, 0);
+
+    // decrypt 22 bytes
+    uint8_t dec[args->enc_len];
+    for (int i = 0; i < args->enc_len; i++)
+        dec[i] = crypto1_byte(pcs, 0x00, 0) ^ args->enc[i];
+
+    crypto1_destroy(pcs);
+
+    // check if cmd exists
+    if (checkValidCmdByte(dec, args->enc_len) == false) {
+        return false;
+    }
+    __sync_fetch_and_add(&global_found, 1);
+
+    // lock this section to avoid interlacing prints from different threats
+    pthread_mutex_lock(&print_lock);
+    printf("\n\nenc:  %s\n", sprint_hex_inrow_ex(args->enc, args->enc_len, 0));
+    printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
+    printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
+    pthread_mutex_unlock(&print_lock);
+    return true;
+}
+
 static void *brute_key_thread(void *arguments) {
 
     struct thread_key_args *args = (struct thread_key_args *) arguments;
-    uint64_t key;
-    uint8_t local_enc[args->enc_len];
-    memcpy(local_enc, args->enc, args->enc_len);
 
-    for (uint64_t count = args->idx; count <= 0xFFFF; count += thread_count) {
+    crypto1_auth_t auth = {
+        .uid = args->uid,
+        .nt = args->nt_enc,
+        .nr_enc = args->nr_enc,
+        .nested = true,
+    };
 
-        if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
-            break;
+    // lanes whose first decrypted byte is a known command, for a keystream byte given bitsliced
+    uint64_t cmd_bits[8][8];
+    for (int c = 0; c < 8; c++) {
+        uint8_t ks = cmds[c][0] ^ args->enc[0];
+        for (int i = 0; i < 8; i++) {
+            cmd_bits[c][i] = ((ks >> i) & 1) ? ~UINT64_C(0) : 0;
         }
+    }
 
-        key = args->part_key | (count << 32);
+    uint64_t keys[CRYPTO1_BS_LANES];
+    uint64_t ks[8];
+    uint32_t chunk;
 
-        // Init cipher with key
-        struct Crypto1State *pcs = crypto1_create(key);
+    while (claim_chunk(1, &chunk)) {
 
-        // NESTED decrypt nt with help of new key
-        crypto1_word(pcs, args->nt_enc ^ args->uid, 1);
-        crypto1_word(pcs, args->nr_enc, 1);
-        crypto1_word(pcs, 0, 0);
-        crypto1_word(pcs, 0, 0);
+        uint32_t count;
+        for (count = chunk << CHUNK_BITS; count < (chunk + 1) << CHUNK_BITS; count += CRYPTO1_BS_LANES) {
 
-        // decrypt 22 bytes
-        uint8_t dec[args->enc_len];
-        for (int i = 0; i < args->enc_len; i++)
-            dec[i] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[i];
+            if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
+                break;
+            }
 
-        crypto1_destroy(pcs);
+            for (int lane = 0; lane < CRYPTO1_BS_LANES; lane++) {
+                keys[lane] = args->part_key | ((uint64_t)(count + lane) << 32);
+            }
 
-        // check if cmd exists
-        if (checkValidCmdByte(dec, args->enc_len) == false) {
-            continue;
+            // first keystream byte of all keys at once
+            crypto1_bs_keystream(&auth, keys, CRYPTO1_BS_LANES, ks, 8);
+
+            uint64_t match = 0;
+            for (int c = 0; c < 8; c++) {
+                uint64_t diff = 0;
+                for (int i = 0; i < 8; i++) {
+                    diff |= ks[i] ^ cmd_bits[c][i];
+                }
+                match |= ~diff;
+            }
+
+            // the few keys left are checked completely
+            while (match) {
+                int lane = __builtin_ctzll(match);
+                match &= match - 1;
+                if (check_key(args, keys[lane])) {
+                    break;
+                }
+            }
         }
-        __sync_fetch_and_add(&global_found, 1);
-
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
-        printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
-        printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
-        printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
-        pthread_mutex_unlock(&print_lock);
-        break;
+        finish_chunk(1, chunk, count - (chunk << CHUNK_BITS));
     }
     free(args);
     return NULL;
@@ -511,7 +788,9 @@ static void *brute_key_thread(void *arguments) {
 
 static int usage(void) {
     printf("\n");
-    printf("syntax:  mf_nonce_brute <uid> <nt> <nt_par_err> <nr> <ar> <ar_par_err> <at> <at_par_err> [<next_command>]\n\n");
+    printf("syntax:  mf_nonce_brute [--checkpoint <file>] <uid> <nt> <nt_par_err> <nr> <ar> <ar_par_err> <at> <at_par_err> [<next_command>]\n\n");
+    printf("    --checkpoint <file>   save progress to <file>, an interrupted run started again with the same\n");
+    printf("                          file and arguments continues where it stopped\n\n");
     printf("how to convert trace data to needed input:\n");
     printf("    nt in trace = 8c! 42 e6! 4e!\n");
     printf("             nt = 8c42e64e\n");
@@ -535,6 +814,12 @@ static int usage(void) {
 int main(int argc, char *argv[]) {
     printf("\nMifare classic nested auth key recovery\n\n");
 
+    if (argc > 2 && strcmp(argv[1], "--checkpoint") == 0) {
+        checkpoint_filename = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 9) return usage();
 
     sscanf(argv[1], "%x", &uid);
@@ -568,6 +853,15 @@ int main(int argc, char *argv[]) {
         printf("next encrypted cmd... %s\n", sprint_hex_inrow_ex(enc, enc_len, 0));
     }
 
+    checkpoint_init(enc, enc_len);
+    if (checkpoint_filename != NULL) {
+        if (checkpoint_read()) {
+            printf("\nResuming from checkpoint " _YELLOW_("%s") "\n", checkpoint_filename);
+        } else {
+            printf("\nSaving progress to checkpoint " _YELLOW_("%s") "\n", checkpoint_filename);
+        }
+    }
+
     uint64_t t1 = msclock();
     uint16_t nt_par = parity_from_err(nt_enc, nt_par_err);
     uint16_t ar_par = parity_from_err(ar_enc, ar_par_err);
@@ -578,39 +872,50 @@ int main(int argc, char *argv[]) {
 
 #if !defined(_WIN32) || !defined(__WIN32__)
     thread_count = sysconf(_SC_NPROCESSORS_CONF);
-    if (thread_count < 2)
-        thread_count = 2;
+    if (thread_count < 1)
+        thread_count = 1;
 #endif  /* _WIN32 */
 
-    printf("\nBruteforce using " _YELLOW_("%d") " threads\n", thread_count);
-    printf("looking for the last bytes of the encrypted tagnonce\n");
-
     pthread_t threads[thread_count];
 
     // create a mutex to avoid interlacing print commands from our different threads
     pthread_mutex_init(&print_lock, NULL);
 
-    // one thread T0 for none EV1.
-    struct thread_args *a = calloc(1, sizeof(struct thread_args));
-    a->xored = xored;
-    a->thread = 0;
-    a->idx = 0;
-    a->ev1 = false;
-    pthread_create(&threads[0], NULL, brute_thread, (void *)a);
-
-    // the rest of available threads to EV1 scenario
-    for (int i = 0; i < thread_count - 1; ++i) {
-        struct thread_args *b = calloc(1, sizeof(struct thread_args));
-        b->xored = xored;
-        b->thread = i + 1;
-        b->idx = i;
-        b->ev1 = true;
-        pthread_create(&threads[i + 1], NULL, brute_thread, (void *)b);
-    }
+    if (checkpoint.phase1_found) {
+        global_candidate_key = checkpoint.phase1_key;
+        global_found_candidate = (checkpoint.phase1_found == 2);
+        global_found = (checkpoint.phase1_found == 1);
+        printf("\nKey candidate from checkpoint [ " _GREEN_("....%08" PRIx64) " ]\n", global_candidate_key & 0xFFFFFFFF);
+    } else {
+        printf("\nBruteforce using " _YELLOW_("%d") " threads\n", thread_count);
+        printf("looking for the last bytes of the encrypted tagnonce\n");
+
+        phase_start(0);
+        for (int i = 0; i < thread_count; ++i) {
+            struct thread_args *a = calloc(1, sizeof(struct thread_args));
+            a->xored = xored;
+            a->thread = i;
+            pthread_create(&threads[i], NULL, brute_thread, (void *)a);
+        }
+
+        // wait for threads to terminate:
+        for (int i = 0; i < thread_count; ++i)
+            pthread_join(threads[i], NULL);
 
-    // wait for threads to terminate:
-    for (int i = 0; i < thread_count; ++i)
-        pthread_join(threads[i], NULL);
+        if (global_found == 0) {
+            print_progress(&phases[0], true);
+            printf("\n");
+        }
+
+        // phase 1 is over only now, an EV1 candidate could still have been replaced before
+        if (global_found || global_found_candidate) {
+            pthread_mutex_lock(&checkpoint_lock);
+            checkpoint.phase1_found = global_found ? 1 : 2;
+            checkpoint.phase1_key = global_candidate_key;
+            checkpoint_write();
+            pthread_mutex_unlock(&checkpoint_lock);
+        }
+    }
 
     t1 = msclock() - t1;
     printf("execution time " _YELLOW_("%.2f") " sec\n", (float)t1 / 1000.0);
@@ -639,26 +944,33 @@ int main(int argc, char *argv[]) {
     printf("\nlooking for the upper 16 bits of key\n");
     fflush(stdout);
 
-    // threads
-    for (int i = 0; i < thread_count; ++i) {
-        struct thread_key_args *b = calloc(1, sizeof(struct thread_key_args));
-        b->thread = i;
-        b->idx = i;
-        b->uid = uid;
-        b->part_key = (uint32_t)(global_candidate_key & 0xFFFFFFFF);
-        b->nt_enc = nt_enc;
-        b->nr_enc = nr_enc;
-        b->enc_len = enc_len;
-        memcpy(b->enc, enc, enc_len);
-        pthread_create(&threads[i], NULL, brute_key_thread, (void *)b);
-    }
+    if (all_chunks_done(1)) {
+        printf("\nAll keys already tested according to checkpoint\n");
+    } else {
+        // threads
+        phase_start(1);
+        for (int i = 0; i < thread_count; ++i) {
+            struct thread_key_args *b = calloc(1, sizeof(struct thread_key_args));
+            b->thread = i;
+            b->uid = uid;
+            b->part_key = (uint32_t)(global_candidate_key & 0xFFFFFFFF);
+            b->nt_enc = nt_enc;
+            b->nr_enc = nr_enc;
+            b->enc_len = enc_len;
+            memcpy(b->enc, enc, enc_len);
+            pthread_create(&threads[i], NULL, brute_key_thread, (void *)b);
+        }
 
-    // wait for threads to terminate:
-    for (int i = 0; i < thread_count; ++i)
-        pthread_join(threads[i], NULL);
+        // wait for threads to terminate:
+        for (int i = 0; i < thread_count; ++i)
+            pthread_join(threads[i], NULL);
+    }
 
     if (!global_found && !global_found_candidate) {
-        printf("\nfailed to find a key\n\n");
+        print_progress(&phases[1], true);
+        printf("\n\nfailed to find a key\n\n");
+    } else {
+        checkpoint_remove();
     }
 
 out:
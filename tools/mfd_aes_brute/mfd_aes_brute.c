@@ -33,6 +33,9 @@
 #include <time.h>
 #include <pthread.h>
 #include <unistd.h>
+#if defined(__AES__)
+#include <wmmintrin.h>
+#endif
 #include "util_posix.h"
 
 #define AEND  "\x1b[0m"
@@ -49,13 +52,161 @@ static int thread_count = 2;
 
 typedef struct thread_args {
     int thread;
-    int idx;
-    uint64_t starttime;
-    uint64_t stoptime;
     uint8_t tag[16];
-    uint8_t rdr[32]; 
+    uint8_t rdr[32];
 } targs;
 
+//------------------------------------------------------------------
+// work scheduling
+//
+// The seed range is split into chunks of 2^20 seeds. Threads take the next chunk from a shared
+// counter, so all threads stay busy until the whole range is searched.
+
+#define CHUNK_BITS          20
+#define CHUNK_SIZE          (UINT64_C(1) << CHUNK_BITS)
+#define MAX_CHUNKS          (UINT64_C(1) << (32 - CHUNK_BITS))
+
+// seeds tested at once by the AES kernel
+#define BATCH               8
+
+static uint64_t range_start = 0;
+static uint64_t range_stop = 0;
+static uint32_t num_chunks = 0;
+static uint32_t next_chunk = 0;
+static uint32_t chunks_done = 0;
+static uint64_t keys_tested = 0;
+static uint64_t bf_start_time = 0;
+static uint64_t last_print_time = 0;
+
+//------------------------------------------------------------------
+// checkpoints
+//
+// With --checkpoint <file> the finished chunks are written to <file>, at most once a second.
+// Started again with the same file and arguments, finished chunks are skipped. The end of the
+// range is taken from the checkpoint, not from the current time.
+
+#define CHECKPOINT_MAGIC    "PM3AESCK"
+#define CHECKPOINT_VERSION  1
+#define CHECKPOINT_INTERVAL 1000
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint64_t start;
+    uint64_t stop;
+    uint8_t tag[16];
+    uint8_t rdr[32];
+    uint8_t done[MAX_CHUNKS / 8];       // finished chunks
+} __attribute__((packed)) checkpoint_t;
+
+static const char *checkpoint_filename = NULL;
+static checkpoint_t checkpoint;
+static uint64_t last_checkpoint_time = 0;
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool checkpoint_read(void) {
+    FILE *f = fopen(checkpoint_filename, "rb");
+    if (f == NULL) {
+        return false;
+    }
+
+    checkpoint_t cp;
+    bool ok = (fread(&cp, sizeof(cp), 1, f) == 1);
+    fclose(f);
+
+    ok = ok
+         && memcmp(cp.magic, checkpoint.magic, sizeof(cp.magic)) == 0
+         && cp.version == CHECKPOINT_VERSION
+         && cp.start == checkpoint.start
+         && memcmp(cp.tag, checkpoint.tag, sizeof(cp.tag)) == 0
+         && memcmp(cp.rdr, checkpoint.rdr, sizeof(cp.rdr)) == 0;
+
+    if (ok) {
+        memcpy(&checkpoint, &cp, sizeof(checkpoint));
+    }
+    return ok;
+}
+
+// caller holds checkpoint_lock
+static void checkpoint_write(void) {
+    if (checkpoint_filename == NULL) {
+        return;
+    }
+
+    last_checkpoint_time = msclock();
+
+    size_t len = strlen(checkpoint_filename) + 5;
+    char tmpname[len];
+    snprintf(tmpname, len, "%s.tmp", checkpoint_filename);
+
+    FILE *f = fopen(tmpname, "wb");
+    bool ok = (f != NULL);
+    ok = ok && (fwrite(&checkpoint, sizeof(checkpoint), 1, f) == 1);
+    if (f != NULL) {
+        ok &= (fclose(f) == 0);
+    }
+    if (ok == false || rename(tmpname, checkpoint_filename) != 0) {
+        printf("\nFailed to write checkpoint %s\n", checkpoint_filename);
+    }
+}
+
+static bool chunk_is_done(uint32_t chunk) {
+    return (checkpoint.done[chunk / 8] >> (chunk % 8)) & 1;
+}
+
+// next chunk to search, false when there is nothing left to do
+static bool claim_chunk(uint32_t *chunk) {
+    while (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 0) {
+        uint32_t c = __atomic_fetch_add(&next_chunk, 1, __ATOMIC_SEQ_CST);
+        if (c >= num_chunks) {
+            return false;
+        }
+        if (chunk_is_done(c)) {
+            __atomic_fetch_add(&chunks_done, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        *chunk = c;
+        return true;
+    }
+    return false;
+}
+
+// caller holds print_lock
+static void print_progress(bool force) {
+    uint64_t now = msclock();
+    if (force == false && now - last_print_time < 1000) {
+        return;
+    }
+    last_print_time = now;
+
+    uint64_t tested = __atomic_load_n(&keys_tested, __ATOMIC_SEQ_CST);
+    uint32_t done = __atomic_load_n(&chunks_done, __ATOMIC_SEQ_CST);
+    float rate = (now > bf_start_time) ? tested * 1000.0 / (now - bf_start_time) : 0;
+    printf("\r%3u%% | %11.0f keys/s | %4u / %u chunks ", (unsigned)((uint64_t)done * 100 / num_chunks), rate, done, num_chunks);
+    fflush(stdout);
+}
+
+static void finish_chunk(uint32_t chunk, uint64_t tested) {
+    __atomic_fetch_add(&keys_tested, tested, __ATOMIC_SEQ_CST);
+
+    // an interrupted chunk (key found by another thread) isn't done
+    if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_fetch_add(&chunks_done, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint.done[chunk / 8] |= (1 << (chunk % 8));
+    if (msclock() - last_checkpoint_time > CHECKPOINT_INTERVAL) {
+        checkpoint_write();
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+
+    pthread_mutex_lock(&print_lock);
+    print_progress(false);
+    pthread_mutex_unlock(&print_lock);
+}
+
 static void make_key(uint32_t seed, uint8_t key[]) {
 
     uint32_t lseed = seed;
@@ -74,30 +225,168 @@ static void handleErrors(void) {
     abort();
 }
 
-// source https://wiki.openssl.org/index.php/EVP_Symmetric_Encryption_and_Decryption#Decrypting_the_Message
-static int decrypt_aes(uint8_t ciphertext[], int ciphertext_len, uint8_t key[], uint8_t iv[], uint8_t plaintext[]) {
-    EVP_CIPHER_CTX *ctx;
-    if (!(ctx = EVP_CIPHER_CTX_new()))
-        handleErrors();
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
+//------------------------------------------------------------------
+// AES key check
+//
+// A key is right when the reader response, decrypted in CBC mode with the tag challenge as IV,
+// ends with the decrypted tag challenge rotated left by one byte:
+//     rol(D(tag)) == D(rdr[16..31]) ^ rdr[0..15]
+// so two blocks have to be decrypted per key.
+
+// plain AES decryption of the two blocks with OpenSSL, the context is reused for all keys
+static void decrypt_blocks(EVP_CIPHER_CTX *ctx, const uint8_t key[16], const uint8_t *in0, const uint8_t *in1, uint8_t *out0, uint8_t *out1) {
+    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, key, NULL))
         handleErrors();
 
     EVP_CIPHER_CTX_set_padding(ctx, 0);
 
     int len = 0;
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
+    if (1 != EVP_DecryptUpdate(ctx, out0, &len, in0, 16))
+        handleErrors();
+    if (1 != EVP_DecryptUpdate(ctx, out1, &len, in1, 16))
         handleErrors();
+}
+
+static bool check_decrypted(const uint8_t dec_tag[16], const uint8_t dec_rdr1[16], const uint8_t rdr[32]) {
+    for (int i = 0; i < 16; i++) {
+        if (dec_tag[(i + 1) % 16] != (dec_rdr1[i] ^ rdr[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(__AES__)
+
+static inline __m128i aes_expand_step(__m128i key, __m128i keygened) {
+    keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, keygened);
+}
+
+#define AES_EXPAND(rk, i, rcon) rk[i] = aes_expand_step(rk[i - 1], _mm_aeskeygenassist_si128(rk[i - 1], rcon))
+
+// AES-NI decryption key schedule
+static inline void aes_decrypt_key(const uint8_t key[16], __m128i dk[11]) {
+    __m128i rk[11];
+    rk[0] = _mm_loadu_si128((const __m128i *)key);
+    AES_EXPAND(rk, 1, 0x01);
+    AES_EXPAND(rk, 2, 0x02);
+    AES_EXPAND(rk, 3, 0x04);
+    AES_EXPAND(rk, 4, 0x08);
+    AES_EXPAND(rk, 5, 0x10);
+    AES_EXPAND(rk, 6, 0x20);
+    AES_EXPAND(rk, 7, 0x40);
+    AES_EXPAND(rk, 8, 0x80);
+    AES_EXPAND(rk, 9, 0x1b);
+    AES_EXPAND(rk, 10, 0x36);
+
+    dk[0] = rk[10];
+    for (int r = 1; r < 10; r++) {
+        dk[r] = _mm_aesimc_si128(rk[10 - r]);
+    }
+    dk[10] = rk[0];
+}
+
+// checks n <= BATCH keys, returns a bitmask of the matching ones. The rounds of all keys are
+// interleaved to keep the AES unit busy.
+static uint32_t check_batch(uint8_t keys[BATCH][16], int n, const uint8_t tag[16], const uint8_t rdr[32], EVP_CIPHER_CTX *ctx) {
+    (void)ctx;
+    __m128i dk[BATCH][11];
+    __m128i x[BATCH], y[BATCH];
+
+    __m128i tag_blk = _mm_loadu_si128((const __m128i *)tag);
+    __m128i rdr0_blk = _mm_loadu_si128((const __m128i *)rdr);
+    __m128i rdr1_blk = _mm_loadu_si128((const __m128i *)(rdr + 16));
+
+    for (int k = 0; k < n; k++) {
+        aes_decrypt_key(keys[k], dk[k]);
+        x[k] = _mm_xor_si128(tag_blk, dk[k][0]);
+        y[k] = _mm_xor_si128(rdr1_blk, dk[k][0]);
+    }
+    for (int r = 1; r < 10; r++) {
+        for (int k = 0; k < n; k++) {
+            x[k] = _mm_aesdec_si128(x[k], dk[k][r]);
+            y[k] = _mm_aesdec_si128(y[k], dk[k][r]);
+        }
+    }
+
+    uint32_t match = 0;
+    for (int k = 0; k < n; k++) {
+        x[k] = _mm_aesdeclast_si128(x[k], dk[k][10]);
+        y[k] = _mm_xor_si128(_mm_aesdeclast_si128(y[k], dk[k][10]), rdr0_blk);
+        // rotate D(tag) left by one byte
+        __m128i rot = _mm_or_si128(_mm_srli_si128(x[k], 1), _mm_slli_si128(x[k], 15));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(rot, y[k])) == 0xffff) {
+            match |= 1 << k;
+        }
+    }
+    return match;
+}
+
+#else
+
+static uint32_t check_batch(uint8_t keys[BATCH][16], int n, const uint8_t tag[16], const uint8_t rdr[32], EVP_CIPHER_CTX *ctx) {
+    uint32_t match = 0;
+    for (int k = 0; k < n; k++) {
+        uint8_t dec_tag[16], dec_rdr1[16];
+        decrypt_blocks(ctx, keys[k], tag, rdr + 16, dec_tag, dec_rdr1);
+        if (check_decrypted(dec_tag, dec_rdr1, rdr)) {
+            match |= 1 << k;
+        }
+    }
+    return match;
+}
 
-    int plaintext_len = len;
+#endif
 
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
+// the batched kernel against OpenSSL, for a few keys with and without a match
+static bool selftest(EVP_CIPHER_CTX *ctx) {
+    uint8_t keys[BATCH][16];
+    uint8_t tag[16], rdr[32];
+
+    for (int k = 0; k < BATCH; k++) {
+        make_key(0x5eed0000 + k, keys[k]);
+    }
+    for (int i = 0; i < 16; i++) {
+        tag[i] = i * 17 + 3;
+    }
+
+    // reader response for keys[5], as a reader would encrypt it: CBC, IV = tag
+    EVP_CIPHER_CTX *enc = EVP_CIPHER_CTX_new();
+    if (enc == NULL)
         handleErrors();
 
-    plaintext_len += len;
+    uint8_t dec_tag[16], dummy[16], plain[32];
+    decrypt_blocks(ctx, keys[5], tag, tag, dec_tag, dummy);
+    for (int i = 0; i < 16; i++) {
+        plain[i] = 0xa5 ^ i;
+        plain[16 + i] = dec_tag[(i + 1) % 16];
+    }
 
-    EVP_CIPHER_CTX_free(ctx);
-    return plaintext_len;
+    int len = 0;
+    if (1 != EVP_EncryptInit_ex(enc, EVP_aes_128_cbc(), NULL, keys[5], tag))
+        handleErrors();
+    EVP_CIPHER_CTX_set_padding(enc, 0);
+    if (1 != EVP_EncryptUpdate(enc, rdr, &len, plain, sizeof(plain)))
+        handleErrors();
+    EVP_CIPHER_CTX_free(enc);
+
+    // the same with one plain OpenSSL decryption per key
+    uint32_t expected = 0;
+    for (int k = 0; k < BATCH; k++) {
+        uint8_t dec_rdr1[16];
+        decrypt_blocks(ctx, keys[k], tag, rdr + 16, dec_tag, dec_rdr1);
+        if (check_decrypted(dec_tag, dec_rdr1, rdr)) {
+            expected |= 1 << k;
+        }
+    }
+
+    return expected == (1 << 5)
+           && check_batch(keys, BATCH, tag, rdr, ctx) == expected
+           && check_batch(keys, 5, tag, rdr, ctx) == 0;
 }
 
 static int hexstr_to_byte_array(char hexstr[], uint8_t bytes[], size_t byte_len) {
@@ -149,73 +438,69 @@ static void *brute_thread(void *arguments) {
 
     struct thread_args *args = (struct thread_args *) arguments;
 
-    uint64_t starttime = args->starttime;
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL)
+        handleErrors();
 
-    uint64_t stoptime = args->stoptime;  
-    uint8_t local_tag[16];
-    uint8_t local_rdr[32]; 
-    memcpy(local_tag, args->tag, 16);
-    memcpy(local_rdr, args->rdr, 32);
+    uint8_t keys[BATCH][16];
+    uint32_t chunk;
 
-    for (uint64_t i = starttime + args->idx; i < stoptime; i += thread_count) {
+    while (claim_chunk(&chunk)) {
 
-        if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
-            break;
+        uint64_t first = range_start + ((uint64_t)chunk << CHUNK_BITS);
+        uint64_t last = first + CHUNK_SIZE;
+        if (last > range_stop) {
+            last = range_stop;
         }
 
-        uint8_t key[16] = {0x00};
-        make_key(i, key);
+        uint64_t i;
+        for (i = first; i < last; i += BATCH) {
 
-        uint8_t iv[16] = {0x00};
-        uint8_t dec_tag[16] = {0x00};
-        decrypt_aes(local_tag, 16, key, iv, dec_tag);
+            if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
+                break;
+            }
 
-        uint8_t dec_rdr[32] = {0x00};
-        decrypt_aes(local_rdr, 32, key, local_tag, dec_rdr);
+            int n = (last - i < BATCH) ? last - i : BATCH;
+            for (int k = 0; k < n; k++) {
+                make_key(i + k, keys[k]);
+            }
 
-        // check rol byte first
-        if (dec_tag[0] != dec_rdr[31]) continue;
+            uint32_t match = check_batch(keys, n, args->tag, args->rdr, ctx);
+            if (match == 0) {
+                continue;
+            }
 
-        // compare rest
-        if (dec_tag[1] != dec_rdr[16]) continue;
-        if (dec_tag[2] != dec_rdr[17]) continue;
-        if (dec_tag[3] != dec_rdr[18]) continue;
-        if (dec_tag[4] != dec_rdr[19]) continue;
-        if (dec_tag[5] != dec_rdr[20]) continue;
-        if (dec_tag[6] != dec_rdr[21]) continue;
-        if (dec_tag[7] != dec_rdr[22]) continue;
-        if (dec_tag[8] != dec_rdr[23]) continue;
-        if (dec_tag[9] != dec_rdr[24]) continue;
-        if (dec_tag[10] != dec_rdr[25]) continue;
-        if (dec_tag[11] != dec_rdr[26]) continue;
-        if (dec_tag[12] != dec_rdr[27]) continue;
-        if (dec_tag[13] != dec_rdr[28]) continue;
-        if (dec_tag[14] != dec_rdr[29]) continue;
-        if (dec_tag[15] != dec_rdr[30]) continue;
+            int k = __builtin_ctz(match);
 
-        __sync_fetch_and_add(&global_found, 1);
+            __sync_fetch_and_add(&global_found, 1);
 
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
+            // lock this section to avoid interlacing prints from different threats
+            pthread_mutex_lock(&print_lock);
 
-        printf("Found timestamp........ ");
-        print_time(i);
+            printf("\nFound timestamp........ ");
+            print_time(i + k);
 
-        printf("key.................... \x1b[32m");
-        print_hex(key, sizeof(key));
-        printf(AEND);
+            printf("key.................... \x1b[32m");
+            print_hex(keys[k], sizeof(keys[k]));
+            printf(AEND);
 
-        pthread_mutex_unlock(&print_lock);
-        break;
+            pthread_mutex_unlock(&print_lock);
+            break;
+        }
+        finish_chunk(chunk, i - first);
     }
 
+    EVP_CIPHER_CTX_free(ctx);
     free(args);
     return NULL;
 }
 
 static int usage(const char* s) {
     printf(_YELLOW_("syntax:") "\n");
-    printf("    %s <unix timestamp> <16 byte tag challenge> <32 byte reader response challenge>\n", s);
+    printf("    %s [--checkpoint <file>] <unix timestamp> <16 byte tag challenge> <32 byte reader response challenge>\n", s);
+    printf("\n");
+    printf("    --checkpoint <file>   save progress to <file>, an interrupted run started again with the same\n");
+    printf("                          file and arguments continues where it stopped\n");
     printf("\n");
     printf(_YELLOW_("example:") "\n");
     printf("    ./mfd_aes_brute 1605394800 bb6aea729414a5b1eff7b16328ce37fd 82f5f498dbc29f7570102397a2e5ef2b6dc14a864f665b3c54d11765af81e95c\n");
@@ -231,7 +516,14 @@ int main (int argc, char* argv[]) {
     printf("-----------------------------------------------------\n");
     printf("\n");
 
-    if (argc != 4) return usage(argv[0]);
+    const char *prog = argv[0];
+    if (argc > 2 && strcmp(argv[1], "--checkpoint") == 0) {
+        checkpoint_filename = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+
+    if (argc != 4) return usage(prog);
 
     uint64_t start_time = atoi(argv[1]);
 
@@ -252,16 +544,53 @@ int main (int argc, char* argv[]) {
     printf("Rdr Resp & Challenge... ");
     print_hex(rdr_resp_challenge, sizeof(rdr_resp_challenge));
 
-   
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL)
+        handleErrors();
+    bool selftest_ok = selftest(ctx);
+    EVP_CIPHER_CTX_free(ctx);
+    if (selftest_ok == false) {
+        printf("\n" _RED_("!!!") " AES kernel self test failed\n\n");
+        return 4;
+    }
+
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    memcpy(checkpoint.magic, CHECKPOINT_MAGIC, sizeof(checkpoint.magic));
+    checkpoint.version = CHECKPOINT_VERSION;
+    checkpoint.start = start_time;
+    checkpoint.stop = time(NULL);
+    memcpy(checkpoint.tag, tag_challenge, sizeof(checkpoint.tag));
+    memcpy(checkpoint.rdr, rdr_resp_challenge, sizeof(checkpoint.rdr));
+
+    if (checkpoint_filename != NULL) {
+        if (checkpoint_read()) {
+            printf("\nResuming from checkpoint " _YELLOW_("%s") "\n", checkpoint_filename);
+        } else {
+            printf("\nSaving progress to checkpoint " _YELLOW_("%s") "\n", checkpoint_filename);
+        }
+    }
+
+    range_start = checkpoint.start;
+    range_stop = checkpoint.stop;
+    if (range_stop < range_start || range_stop - range_start > (UINT64_C(1) << 32)) {
+        printf("\n" _RED_("!!!") " invalid timestamp\n\n");
+        return 5;
+    }
+    num_chunks = (range_stop - range_start + CHUNK_SIZE - 1) >> CHUNK_BITS;
+
     uint64_t t1 = msclock();
 
 #if !defined(_WIN32) || !defined(__WIN32__)
     thread_count = sysconf(_SC_NPROCESSORS_CONF);
-    if (thread_count < 2)
-        thread_count = 2;
+    if (thread_count < 1)
+        thread_count = 1;
 #endif  /* _WIN32 */
 
+#if defined(__AES__)
+    printf("\nBruteforce using " _YELLOW_("%d") " threads, AES-NI, %d keys at a time\n", thread_count, BATCH);
+#else
     printf("\nBruteforce using " _YELLOW_("%d") " threads\n", thread_count);
+#endif
 
     pthread_t threads[thread_count];
 
@@ -269,13 +598,10 @@ int main (int argc, char* argv[]) {
     pthread_mutex_init(&print_lock, NULL);
 
     // threads
-    uint64_t stop_time = time(NULL); 
+    bf_start_time = last_print_time = msclock();
     for (int i = 0; i < thread_count; ++i) {
         struct thread_args *a = calloc(1, sizeof(struct thread_args));
         a->thread = i;
-        a->idx = i;
-        a->starttime = start_time;
-        a->stoptime = stop_time;
         memcpy(a->tag, tag_challenge, 16);
         memcpy(a->rdr, rdr_resp_challenge, 32);
         pthread_create(&threads[i], NULL, brute_thread, (void *)a);
@@ -286,8 +612,13 @@ int main (int argc, char* argv[]) {
         pthread_join(threads[i], NULL);
     }
 
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint_write();
+    pthread_mutex_unlock(&checkpoint_lock);
+
     if (global_found == false) {
-        printf("\n" _RED_("!!!") " failed to find a key\n\n");
+        print_progress(true);
+        printf("\n\n" _RED_("!!!") " failed to find a key\n\n");
     }
 
     t1 = msclock() - t1;
@@ -0,0 +1,188 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Self test and benchmark of the bitsliced Crypto1 key check (crypto1_bs.h)
+// against the plain crypto1_word() implementation.
+//-----------------------------------------------------------------------------
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "crapto1/crapto1.h"
+#include "crapto1/crypto1_bs.h"
+#include "util_posix.h"
+
+#define MAX_FOUND 16
+
+static uint64_t rand64(void) {
+    return ((uint64_t)rand() & 0xffff) << 32 | ((uint64_t)rand() & 0xffff) << 16 | ((uint64_t)rand() & 0xffff);
+}
+
+// the reference: one crypto1 state per key
+static bool check_key(const crypto1_auth_t *auth, uint64_t key) {
+    struct Crypto1State s;
+    crypto1_init(&s, key);
+    uint32_t nt = auth->nt;
+    if (auth->nested) {
+        nt = crypto1_word(&s, auth->uid ^ auth->nt, 1) ^ auth->nt;
+    } else {
+        crypto1_word(&s, auth->uid ^ auth->nt, 0);
+    }
+    crypto1_word(&s, auth->nr_enc, 1);
+    if ((crypto1_word(&s, 0, 0) ^ prng_successor(nt, 64)) != auth->ar_enc) {
+        return false;
+    }
+    if (auth->has_at && (crypto1_word(&s, 0, 0) ^ prng_successor(nt, 96)) != auth->at_enc) {
+        return false;
+    }
+    return true;
+}
+
+// an authentication with key, like a reader and a tag would do it
+static void make_auth(crypto1_auth_t *auth, uint64_t key, bool nested, bool has_at) {
+    struct Crypto1State s;
+    crypto1_init(&s, key);
+    uint32_t nt = rand64();
+    uint32_t nr = rand64();
+    auth->uid = rand64();
+    auth->nested = nested;
+    auth->has_at = has_at;
+    if (nested) {
+        auth->nt = crypto1_word(&s, auth->uid ^ nt, 0) ^ nt;
+    } else {
+        auth->nt = nt;
+        crypto1_word(&s, auth->uid ^ nt, 0);
+    }
+    auth->nr_enc = crypto1_word(&s, nr, 0) ^ nr;
+    auth->ar_enc = crypto1_word(&s, 0, 0) ^ prng_successor(nt, 64);
+    auth->at_enc = crypto1_word(&s, 0, 0) ^ prng_successor(nt, 96);
+}
+
+static bool self_test(uint64_t *keys, uint32_t count) {
+    bool ok = true;
+    for (uint8_t mode = 0; mode < 4; mode++) {
+        bool nested = mode & 1;
+        bool has_at = mode & 2;
+        // odd sizes to test partial blocks
+        uint32_t n = count - mode * 7;
+        uint32_t idx = rand() % n;
+        crypto1_auth_t auth;
+        make_auth(&auth, keys[idx], nested, has_at);
+
+        uint32_t found[MAX_FOUND];
+        size_t num_found = crypto1_bs_check_keys(&auth, keys, n, found, MAX_FOUND);
+
+        size_t num_expected = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (check_key(&auth, keys[i])) {
+                if (num_expected >= num_found || found[num_expected] != i) {
+                    ok = false;
+                }
+                num_expected++;
+            }
+        }
+        bool mode_ok = (num_found == num_expected) && (num_found > 0);
+        printf("%-6s auth %s at, %6u keys... %s\n", nested ? "nested" : "plain", has_at ? "with   " : "without", n, mode_ok ? "ok" : "fail");
+        ok &= mode_ok;
+    }
+    return ok;
+}
+
+// keystream after the authentication, against crypto1_byte()
+static bool keystream_test(uint64_t *keys, uint32_t count) {
+    crypto1_auth_t auth;
+    make_auth(&auth, keys[0], true, true);
+
+    uint32_t n = count < CRYPTO1_BS_LANES ? count : CRYPTO1_BS_LANES;
+    uint64_t ks[16];
+    crypto1_bs_keystream(&auth, keys, n, ks, 16);
+
+    bool ok = true;
+    for (uint32_t lane = 0; lane < n; lane++) {
+        struct Crypto1State s;
+        crypto1_init(&s, keys[lane]);
+        crypto1_word(&s, auth.uid ^ auth.nt, 1);
+        crypto1_word(&s, auth.nr_enc, 1);
+        crypto1_word(&s, 0, 0);
+        crypto1_word(&s, 0, 0);
+        uint16_t expected = crypto1_byte(&s, 0, 0) | crypto1_byte(&s, 0, 0) << 8;
+        uint16_t bs = 0;
+        for (uint8_t i = 0; i < 16; i++) {
+            bs |= ((ks[i] >> lane) & 1) << i;
+        }
+        ok &= (bs == expected);
+    }
+    printf("keystream after auth, %6u keys... %s\n", n, ok ? "ok" : "fail");
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t count = 1 << 20;
+
+    if (argc > 2) {
+        printf(" syntax: %s [<number of keys>]\n\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        count = strtoul(argv[1], NULL, 0);
+        if (count < 64) {
+            count = 64;
+        }
+    }
+
+    printf("Bitsliced Crypto1 self test and benchmark, %u keys\n\n", count);
+
+    uint64_t *keys = calloc(count, sizeof(uint64_t));
+    if (keys == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    srand(0x31337);
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = rand64();
+    }
+
+    bool ok = self_test(keys, count);
+    ok &= keystream_test(keys, count);
+
+    crypto1_auth_t auth;
+    make_auth(&auth, keys[count - 1], true, true);
+
+    uint64_t t1 = msclock();
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        hits += check_key(&auth, keys[i]);
+    }
+    uint64_t t_plain = msclock() - t1;
+
+    t1 = msclock();
+    uint32_t found[MAX_FOUND];
+    size_t bs_hits = crypto1_bs_check_keys(&auth, keys, count, found, MAX_FOUND);
+    uint64_t t_bs = msclock() - t1;
+
+    if (bs_hits != hits) {
+        ok = false;
+    }
+
+    printf("\n");
+    printf("crypto1_word()  %8" PRIu64 " ms  %12.0f keys/s\n", t_plain, t_plain ? count * 1000.0 / t_plain : 0.0);
+    printf("bitsliced       %8" PRIu64 " ms  %12.0f keys/s\n", t_bs, t_bs ? count * 1000.0 / t_bs : 0.0);
+    printf("\nSelf test [ %s ]\n", ok ? "ok" : "fail");
+
+    free(keys);
+    return ok ? 0 : 1;
+}
@@ -51,7 +51,18 @@ int main(int argc, char *argv[]) {
     ks2 = ar0_enc ^ p64;
     printf("  ks2: %08x\n", ks2);
 
-    s = lfsr_recovery32(ar0_enc ^ p64, 0);
+    // one recovery thread per CPU
+    crapto1_arena_t *arena = crapto1_arena_create(0);
+    if (arena == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    s = lfsr_recovery32_ex(ar0_enc ^ p64, 0, arena);
+    crapto1_arena_destroy(arena);
+    if (s == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
 
     for (t = s; t->odd | t->even; ++t) {
         lfsr_rollback_word(t, 0, 0);
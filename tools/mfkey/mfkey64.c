@@ -71,7 +71,18 @@ int main(int argc, char *argv[]) {
     printf("  ks2: %08x\n", ks2);
     printf("  ks3: %08x\n", ks3);
 
-    revstate = lfsr_recovery64(ks2, ks3);
+    // one recovery thread per CPU
+    crapto1_arena_t *arena = crapto1_arena_create(0);
+    if (arena == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    revstate = lfsr_recovery64_ex(ks2, ks3, arena);
+    crapto1_arena_destroy(arena);
+    if (revstate == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
 
     // Decrypting communication using keystream if presented
     if (argc > 6) {
@@ -14,6 +14,7 @@ TESTNONCE2KEY=false
 TESTMFNONCEBRUTE=false
 TESTMFDAESBRUTE=false
 TESTHITAG2CRACK=false
+TESTVPM3=false
 TESTFPGACOMPRESS=false
 TESTBOOTROM=false
 TESTARMSRC=false
@@ -27,7 +28,7 @@ while (( "$#" )); do
   case "$1" in
     -h|--help)
       echo """
-Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|mfd_aes_brute|fpga_compress|bootrom|armsrc|client|recovery|common]
+Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|mf_nonce_brute|mfd_aes_brute|fpga_compress|bootrom|armsrc|client|recovery|common|vpm3]
     --long:          Enable slow tests
     --opencl:        Enable tests requiring OpenCL (preferably a Nvidia GPU)
     --clientbin ...: Specify path to proxmark3 binary to test
@@ -82,6 +83,11 @@ Usage: $0 [--long] [--opencl] [--clientbin /path/to/proxmark3] [mfkey|nonce2key|
       TESTHITAG2CRACK=true
       shift
       ;;
+    vpm3)
+      TESTALL=false
+      TESTVPM3=true
+      shift
+      ;;
     bootrom)
       TESTALL=false
       TESTBOOTROM=true
@@ -269,11 +275,13 @@ while true; do
       if ! CheckFileExist "fpgacompress exists"            "$FPGACPMPRESSBIN"; then break; fi
     fi
     if $TESTALL || $TESTMFKEY; then
-      echo -e "\n${C_BLUE}Testing mfkey:${C_NC} ${MFKEY32V2BIN:=./tools/mfkey/mfkey32v2} ${MFKEY64BIN:=./tools/mfkey/mfkey64}"
+      echo -e "\n${C_BLUE}Testing mfkey:${C_NC} ${MFKEY32V2BIN:=./tools/mfkey/mfkey32v2} ${MFKEY64BIN:=./tools/mfkey/mfkey64} ${CRYPTO1BSBIN:=./tools/mfkey/crypto1_bs_bench}"
       if ! CheckFileExist "mfkey32v2 exists"               "$MFKEY32V2BIN"; then break; fi
       if ! CheckFileExist "mfkey64 exists"                 "$MFKEY64BIN"; then break; fi
+      if ! CheckFileExist "crypto1_bs_bench exists"        "$CRYPTO1BSBIN"; then break; fi
       # Need a decent example for mfkey32...
       if ! CheckExecute "mfkey32v2 test"                   "$MFKEY32V2BIN 12345678 1AD8DF2B 1D316024 620EF048 30D6CB07 C52077E2 837AC61A" "Found Key: \[a0a1a2a3a4a5\]"; then break; fi
+      if ! CheckExecute "crypto1 bitsliced test"           "$CRYPTO1BSBIN 4096" "Self test \[ ok \]"; then break; fi
       if ! CheckExecute "mfkey64 test"                     "$MFKEY64BIN 9c599b32 82a4166c a1e458ce 6eea41e0 5cadf439" "Found Key: \[ffffffffffff\]"; then break; fi
       if ! CheckExecute "mfkey64 long trace test"          "$MFKEY64BIN 14579f69 ce844261 f8049ccb 0525c84f 9431cc40 7093df99 9972428ce2e8523f456b99c831e769dced09 8ca6827b ab797fd369e8b93a86776b40dae3ef686efd c3c381ba 49e2c9def4868d1777670e584c27230286f4 fbdcd7c1 4abd964b07d3563aa066ed0a2eac7f6312bf 9f9149ea" "Found Key: \[091e639cb715\]"; then break; fi
     fi
@@ -348,6 +356,23 @@ while true; do
       # Order of magnitude to crack it: ~15s -> tagged as "slow"
       if ! CheckExecute slow opencl "ht2crack5opencl test"     "cd $HT2CRACK5OPENCLPATH; ./ht2crack5opencl $HT2CRACK5OPENCLUID $HT2CRACK5OPENCLNRAR" "Key found.*$HT2CRACK5OPENCLKEY"; then break; fi
     fi
+    # vpm3 not yet part of "all"
+    if $TESTVPM3; then
+      echo -e "\n${C_BLUE}Testing vpm3:${C_NC} ${VPM3BIN:=./tools/vpm3/vpm3}"
+      if ! CheckFileExist "vpm3 exists"                    "$VPM3BIN"; then break; fi
+      if ! CheckFileExist "proxmark3 exists"               "${CLIENTBIN:=./client/proxmark3}"; then break; fi
+      # one virtual device per test, it exits when the client disconnects
+      VPM3PORT="socket:pm3_tests_vpm3_$$"
+      VPM3CLIENT="sleep 0.2; $CLIENTBIN --incognito $VPM3PORT -c"
+      if ! CheckExecute "vpm3 ping test"                   "$VPM3BIN -1 $VPM3PORT >/dev/null & $VPM3CLIENT 'hw ping; hw pingbench -n 200 -w'" "200 ok, 0 timeout, 0 content errors"; then break; fi
+      if ! CheckExecute "vpm3 trace list test"             "$VPM3BIN -1 -t traces/hf_14a_mfu.trace $VPM3PORT >/dev/null & $VPM3CLIENT 'trace list -t 14a'" "PWD-AUTH KEY: 0xdae55796"; then break; fi
+      if ! CheckExecute "vpm3 data samples test"           "$VPM3BIN -1 -s traces/lf_ATA5577_em410x.pm3 $VPM3PORT >/dev/null & $VPM3CLIENT 'data samples; lf em 410x demod'" "EM 410x ID.*0F0368568B"; then break; fi
+      if ! CheckExecute "vpm3 compressed samples test"     "$VPM3BIN -1 -b 115200 -s traces/lf_ATA5577_hid.pm3 $VPM3PORT >/dev/null & $VPM3CLIENT 'data samples; lf hid demod'" "raw: 000000000000002006ec0c86"; then break; fi
+      if ! CheckExecute "vpm3 eload test"                  "$VPM3BIN -1 $VPM3PORT >/dev/null & $VPM3CLIENT 'hf mf eload --mini -f traces/hf_mf_4k_dump.bin; hf mf egetblk --blk 3'" "  3 | FF FF FF FF FF FF FF 07 80 69 FF FF FF FF FF FF"; then break; fi
+      if ! CheckExecute "vpm3 eload verify test"           "$VPM3BIN -1 $VPM3PORT >/dev/null & $VPM3CLIENT 'hf mf eload --4k --verify -f traces/hf_mf_4k_dump.bin'" "Verify emulator memory.*ok"; then break; fi
+      if ! CheckExecute "vpm3 sniff stream test"           "$VPM3BIN -1 -t traces/hf_14a_mfu.trace $VPM3PORT >/dev/null & $VPM3CLIENT 'hf 14a sniff --stream -f /tmp/pm3_tests_stream_$$; trace load -f /tmp/pm3_tests_stream_$$.trace; trace list -1 -t 14a'; rm -f /tmp/pm3_tests_stream_$$.trace /tmp/pm3_tests_stream_$$.trace.idx" "loaded 372 bytes"; then break; fi
+      if ! CheckExecute "vpm3 multi device test"           "$VPM3BIN -1 $VPM3PORT >/dev/null & $VPM3BIN -1 -s traces/lf_ATA5577_em410x.pm3 ${VPM3PORT}_2 >/dev/null & sleep 0.2; $CLIENTBIN --incognito -p $VPM3PORT -p ${VPM3PORT}_2 -c 'hw select -d 1; data samples; lf em 410x demod'" "EM 410x ID.*0F0368568B"; then break; fi
+    fi
     if $TESTALL || $TESTCLIENT; then
       echo -e "\n${C_BLUE}Testing client:${C_NC} ${CLIENTBIN:=./client/proxmark3}"
       if ! CheckFileExist "proxmark3 exists"               "$CLIENTBIN"; then break; fi
@@ -383,6 +408,7 @@ while true; do
       if ! CheckExecute "jooki encode test"       "$CLIENTBIN -c 'hf jooki encode -t'" "04 28 F4 DA F0 4A 81  ( ok )"; then break; fi
       if ! CheckExecute "trace load/list 14a"     "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a;'" "READBLOCK(8)"; then break; fi
       if ! CheckExecute "trace load/list x"       "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -x1 -t 14a;'" "0.0101840425"; then break; fi
+      if ! CheckExecute "trace list frame range"  "$CLIENTBIN -c 'trace load -f traces/hf_14a_mfu.trace; trace list -1 -t 14a --from 2000000 -n 1;'" "PWD-AUTH KEY: 0xdae55796"; then break; fi
       if ! CheckExecute "nfc decode test - oob"           "$CLIENTBIN -c 'nfc decode -d DA2010016170706C69636174696F6E2F766E642E626C7565746F6F74682E65702E6F6F62301000649201B96DFB0709466C65782032'" "Flex 2"; then break; fi
       if ! CheckExecute "nfc decode test - device info"   "$CLIENTBIN -c 'nfc decode -d d1025744690004536f6e79010752432d533338300220426c61636b204e46432052656164657220636f6e6e656374656420746f2050430310123e4567e89b12d3a45642665544000004124e464320506f72742d3130302076312e3032'" "NFC Port-100 v1.02"; then break; fi
       if ! CheckExecute "nfc decode test - vcard"         "$CLIENTBIN -c 'nfc decode -d d20ca3746578742f782d7643617264424547494e3a56434152440a56455253494f4e3a332e300a4e3a43687269733b4963656d616e3b3b3b0a464e3a476f7468656e627572670a5245563a323032312d30362d32345432303a31353a30385a0a6974656d322e582d4142444154453b747970653d707265663a323032302d30362d32340a4954454d322e582d41424c4142454c3a5f24213c416e6e69766572736172793e21245f0a454e443a56434152440a'" "END:VCARD"; then break; fi
@@ -406,6 +432,7 @@ while true; do
       if ! CheckExecute "lf PARADOX test"       "$CLIENTBIN -c 'data load -f traces/lf_Paradox-96_40426-APJN08.pm3;lf search -1'" "Paradox ID found"; then break; fi
       if ! CheckExecute "lf VIKING test"        "$CLIENTBIN -c 'data load -f traces/lf_Transit999-best.pm3;lf search -1'" "Viking ID found"; then break; fi
       if ! CheckExecute "lf VISA2000 test"      "$CLIENTBIN -c 'data load -f traces/lf_VISA2000.pm3;lf search -1'" "Visa2000 ID found"; then break; fi
+      if ! CheckExecute "lf search dir test"    "$CLIENTBIN -c 'lf search --dir traces -j 2'" "\"file\":\"traces/lf_VISA2000.pm3\",\"status\":0,\"samples\":[0-9]*,\"found\":\[\"Visa2000 ID\"\]"; then break; fi
 
       if ! CheckExecute slow "lf T55 awid 26 test"               "$CLIENTBIN -c 'data load -f traces/lf_ATA5577_awid_26.pm3; lf search -1'" "AWID ID found"; then break; fi
       if ! CheckExecute slow "lf T55 awid 26 test2"              "$CLIENTBIN -c 'data load -f traces/lf_ATA5577_awid_26.pm3; lf awid demod'" \
@@ -500,6 +527,7 @@ while true; do
 
       echo -e "\n${C_BLUE}Testing HF:${C_NC}"
       if ! CheckExecute "hf mf offline text"               "$CLIENTBIN -c 'hf mf'" "at_enc"; then break; fi
+      if ! CheckExecute "hf mf hardnested SIMD test"       "$CLIENTBIN -c 'hf mf hardnested --bench'" "All SIMD instruction sets"; then break; fi
       if ! CheckExecute slow retry ignore "hf mf hardnested long test"  "$CLIENTBIN -c 'hf mf hardnested -t --tk 000000000000'" "found:"; then break; fi
       if ! CheckExecute slow "hf iclass loclass long test" "$CLIENTBIN -c 'hf iclass loclass --long'" "verified (ok)"; then break; fi
       if ! CheckExecute slow "emv long test"               "$CLIENTBIN -c 'emv test -l'" "Test(s) \[ ok"; then break; fi
@@ -0,0 +1,793 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Virtual Proxmark3: a host process speaking the device side of the NG
+// protocol, to benchmark and test the client without hardware.
+//
+//     vpm3 -t traces/hf_14a_mfu.trace socket:vpm3 &
+//     proxmark3 socket:vpm3 -c "hw pingbench; trace list -t 14a"
+//
+// It answers the communication commands (ping, capabilities, version),
+// BigBuf and emulator memory download / upload, and a 14a sniff that
+// captures the preloaded trace again. BigBuf and emulator memory
+// can be preloaded from files, e.g. the ones in traces/. Link latency,
+// bandwidth and the processing time of single commands are configurable,
+// everything else is answered with PM3_ENOTIMPL.
+//
+// To compile it:
+// make vpm3
+//-----------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "pm3_cmd.h"
+#include "util_posix.h"
+#include "lz4.h"
+
+#define VPM3_BIGBUF_SIZE    40000
+#define CARD_MEMORY_SIZE    4096    // as in armsrc/BigBuf.h
+#define VPM3_MAX_DELAYS     16
+
+// a frame on its way over the link, due is the time it arrives at the other end
+typedef struct frame_s {
+    struct frame_s *next;
+    uint64_t due;
+    size_t len;
+    uint8_t data[];
+} frame_t;
+
+typedef struct {
+    frame_t *head;
+    frame_t *tail;
+    uint64_t link_free;     // time the link is done with the previous frame
+} frame_queue_t;
+
+typedef struct {
+    uint16_t cmd;
+    uint32_t us;
+} cmd_delay_t;
+
+static struct {
+    uint32_t latency_us;
+    uint32_t bandwidth;     // bytes/s, 0 for unlimited
+    cmd_delay_t delays[VPM3_MAX_DELAYS];
+    uint8_t num_delays;
+    bool verbose;
+} g_opts;
+
+// device state
+static uint8_t g_bigbuf[VPM3_BIGBUF_SIZE];
+static uint32_t g_tracelen = 0;
+static uint8_t g_emlmem[CARD_MEMORY_SIZE];
+static uint16_t g_reply_seq = 0;
+
+static frame_queue_t g_rxq;
+static frame_queue_t g_txq;
+static uint64_t g_busy_until = 0;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// link emulation
+
+static uint64_t link_time(size_t len) {
+    if (g_opts.bandwidth == 0) {
+        return 0;
+    }
+    return (uint64_t)len * 1000000 / g_opts.bandwidth;
+}
+
+// frames leave one after the other, each one takes its transfer time plus the latency
+static void queue_frame(frame_queue_t *q, uint64_t now, const void *data, size_t len) {
+    frame_t *f = malloc(sizeof(frame_t) + len);
+    if (f == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    if (q->link_free < now) {
+        q->link_free = now;
+    }
+    q->link_free += link_time(len);
+    f->next = NULL;
+    f->due = q->link_free + g_opts.latency_us;
+    f->len = len;
+    memcpy(f->data, data, len);
+    if (q->tail) {
+        q->tail->next = f;
+    } else {
+        q->head = f;
+    }
+    q->tail = f;
+}
+
+static frame_t *pop_frame(frame_queue_t *q) {
+    frame_t *f = q->head;
+    if (f) {
+        q->head = f->next;
+        if (q->head == NULL) {
+            q->tail = NULL;
+        }
+    }
+    return f;
+}
+
+static void clear_queue(frame_queue_t *q) {
+    frame_t *f;
+    while ((f = pop_frame(q)) != NULL) {
+        free(f);
+    }
+    q->link_free = 0;
+}
+
+static uint32_t cmd_delay(uint16_t cmd) {
+    for (uint8_t i = 0; i < g_opts.num_delays; i++) {
+        if (g_opts.delays[i].cmd == cmd) {
+            return g_opts.delays[i].us;
+        }
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// replies, in the same framing as armsrc/cmd.c
+
+static uint64_t g_reply_time = 0;
+
+static void reply_ng_internal(uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
+    PacketResponseNGSeqRaw frame;
+    size_t prelen = sizeof(PacketResponseNGPreamble);
+
+    if (len > PM3_CMD_DATA_SIZE) {
+        len = PM3_CMD_DATA_SIZE;
+        status = PM3_EOVFLOW;
+    }
+
+    frame.pre.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    if (g_reply_seq) {
+        frame.pre.pre.magic = RESPONSENG_SEQ_PREAMBLE_MAGIC;
+        frame.pre.seq = g_reply_seq;
+        prelen = sizeof(PacketResponseNGSeqPreamble);
+    }
+    frame.pre.pre.length = len;
+    frame.pre.pre.ng = ng;
+    frame.pre.pre.status = status;
+    frame.pre.pre.cmd = cmd;
+
+    uint8_t *tx_data = (uint8_t *)&frame + prelen;
+    if (len && data) {
+        memcpy(tx_data, data, len);
+    }
+    // the client accepts the magic in place of a CRC
+    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)(tx_data + len);
+    tx_post->crc = RESPONSENG_POSTAMBLE_MAGIC;
+
+    queue_frame(&g_txq, g_reply_time, &frame, prelen + len + sizeof(PacketResponseNGPostamble));
+}
+
+static void reply_ng(uint16_t cmd, int16_t status, const uint8_t *data, size_t len) {
+    reply_ng_internal(cmd, status, data, len, true);
+}
+
+static void reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    uint64_t arg[3] = {arg0, arg1, arg2};
+    uint8_t cmddata[PM3_CMD_DATA_SIZE];
+    if (len > PM3_CMD_DATA_SIZE - sizeof(arg)) {
+        len = PM3_CMD_DATA_SIZE - sizeof(arg);
+    }
+    memcpy(cmddata, arg, sizeof(arg));
+    if (len && data) {
+        memcpy(cmddata + sizeof(arg), data, len);
+    }
+    reply_ng_internal(cmd & 0xFFFF, PM3_SUCCESS, cmddata, len + sizeof(arg), false);
+}
+
+static void reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
+    PacketResponseOLD frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.cmd = cmd;
+    frame.arg[0] = arg0;
+    frame.arg[1] = arg1;
+    frame.arg[2] = arg2;
+    if (len > PM3_CMD_DATA_SIZE) {
+        len = PM3_CMD_DATA_SIZE;
+    }
+    if (len && data) {
+        memcpy(frame.d.asBytes, data, len);
+    }
+    queue_frame(&g_txq, g_reply_time, &frame, sizeof(frame));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// emulated commands
+
+static void send_capabilities(void) {
+    capabilities_t capabilities;
+    memset(&capabilities, 0, sizeof(capabilities));
+    capabilities.version = CAPABILITIES_VERSION;
+    // a limited link is announced as FPC UART, the client adapts to it like to a real one
+    if (g_opts.bandwidth) {
+        capabilities.via_fpc = true;
+        capabilities.baudrate = g_opts.bandwidth * 10;
+    } else {
+        capabilities.via_usb = true;
+    }
+    capabilities.bigbuf_size = VPM3_BIGBUF_SIZE;
+    capabilities.cmd_window = PM3_CMD_WINDOW;
+    capabilities.download_compression = DOWNLOAD_COMPRESS_LZ4;
+    capabilities.device_cmds = DEVICE_CMD_14A_SNIFF_STREAM;
+    capabilities.compiled_with_lf = true;
+    capabilities.compiled_with_iso14443a = true;
+    reply_ng(CMD_CAPABILITIES, PM3_SUCCESS, (uint8_t *)&capabilities, sizeof(capabilities));
+}
+
+static void send_version(void) {
+    struct p {
+        uint32_t id;
+        uint32_t section_size;
+        uint32_t versionstr_len;
+        char versionstr[PM3_CMD_DATA_SIZE - 12];
+    } PACKED payload;
+    memset(&payload, 0, sizeof(payload));
+    snprintf(payload.versionstr, sizeof(payload.versionstr), " vpm3: virtual Proxmark3, %u bytes BigBuf\n", VPM3_BIGBUF_SIZE);
+    payload.versionstr_len = strlen(payload.versionstr) + 1;
+    reply_ng(CMD_VERSION, PM3_SUCCESS, (uint8_t *)&payload, 12 + payload.versionstr_len);
+}
+
+// sends mem[start..start+len) like the firmware, in PM3_CMD_DATA_SIZE chunks
+static void download(uint64_t cmd, const uint8_t *mem, size_t memsize, uint32_t start, uint32_t len, uint32_t arg2) {
+    uint8_t chunk[PM3_CMD_DATA_SIZE];
+    for (uint32_t i = 0; i < len; i += PM3_CMD_DATA_SIZE) {
+        uint32_t n = len - i < PM3_CMD_DATA_SIZE ? len - i : PM3_CMD_DATA_SIZE;
+        memset(chunk, 0, sizeof(chunk));
+        for (uint32_t j = 0; j < n; j++) {
+            uint64_t idx = (uint64_t)start + i + j;
+            if (idx < memsize) {
+                chunk[j] = mem[idx];
+            }
+        }
+        reply_old(cmd, i, n, arg2, chunk, n);
+    }
+}
+
+// as armsrc/appmain.c, chunks of LZ4 blocks as MIX frames
+static void download_lz4(const uint8_t *mem, size_t memsize, uint32_t start, uint32_t len, uint32_t arg2) {
+    if (start >= memsize) {
+        return;
+    }
+    if (len > memsize - start) {
+        len = memsize - start;
+    }
+    uint8_t block[PM3_CMD_DATA_SIZE_MIX];
+    for (uint32_t i = 0; i < len;) {
+        int srclen = len - i;
+        int complen = LZ4_compress_destSize((const char *)mem + start + i, (char *)block, &srclen, sizeof(block));
+        if (complen <= 0 || srclen <= 0) {
+            return;
+        }
+        reply_mix(CMD_DOWNLOADED_BIGBUF_LZ4, i, srclen, arg2, block, complen);
+        i += srclen;
+    }
+}
+
+static void handle_packet(const PacketCommandNG *packet) {
+
+    g_reply_seq = packet->seq;
+
+    switch (packet->cmd) {
+        case CMD_PING: {
+            reply_ng(CMD_PING, PM3_SUCCESS, packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_CAPABILITIES: {
+            send_capabilities();
+            break;
+        }
+        case CMD_VERSION: {
+            send_version();
+            break;
+        }
+        case CMD_QUIT_SESSION:
+        case CMD_DEBUG_PRINT_STRING: {
+            break;
+        }
+        case CMD_SET_DBGMODE: {
+            reply_ng(CMD_SET_DBGMODE, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_BUFF_CLEAR: {
+            memset(g_bigbuf, 0, sizeof(g_bigbuf));
+            g_tracelen = 0;
+            break;
+        }
+        case CMD_DOWNLOAD_BIGBUF: {
+            sample_config sc = {1, 8, 1, LF_DIVISOR_125, 0, 0, false};
+            if (packet->oldarg[2] & DOWNLOAD_COMPRESS_LZ4) {
+                download_lz4(g_bigbuf, sizeof(g_bigbuf), packet->oldarg[0], packet->oldarg[1], g_tracelen);
+            } else {
+                download(CMD_DOWNLOADED_BIGBUF, g_bigbuf, sizeof(g_bigbuf), packet->oldarg[0], packet->oldarg[1], g_tracelen);
+            }
+            reply_mix(CMD_ACK, 1, 0, g_tracelen, &sc, sizeof(sc));
+            break;
+        }
+        case CMD_DOWNLOAD_EML_BIGBUF: {
+            download(CMD_DOWNLOADED_EML_BIGBUF, g_emlmem, sizeof(g_emlmem), packet->oldarg[0], packet->oldarg[1], 0);
+            reply_mix(CMD_ACK, 1, 0, 0, NULL, 0);
+            break;
+        }
+        case CMD_LF_UPLOAD_SIM_SAMPLES: {
+            struct p {
+                uint8_t flag;
+                uint16_t offset;
+                uint8_t data[PM3_CMD_DATA_SIZE - sizeof(uint8_t) - sizeof(uint16_t)];
+            } PACKED;
+            const struct p *payload = (const struct p *)packet->data.asBytes;
+            if (payload->flag & 0x1) {
+                memset(g_bigbuf, 0, sizeof(g_bigbuf));
+                g_tracelen = 0;
+            }
+            if (payload->offset >= sizeof(g_bigbuf)) {
+                reply_ng(CMD_LF_UPLOAD_SIM_SAMPLES, PM3_EOVFLOW, NULL, 0);
+                break;
+            }
+            size_t len = sizeof(g_bigbuf) - payload->offset;
+            if (len > sizeof(payload->data)) {
+                len = sizeof(payload->data);
+            }
+            memcpy(g_bigbuf + payload->offset, payload->data, len);
+            reply_ng(CMD_LF_UPLOAD_SIM_SAMPLES, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMCLR: {
+            memset(g_emlmem, 0, sizeof(g_emlmem));
+            reply_ng(CMD_HF_MIFARE_EML_MEMCLR, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMSET: {
+            struct p {
+                uint8_t blockno;
+                uint8_t blockcnt;
+                uint8_t blockwidth;
+                uint8_t data[];
+            } PACKED;
+            const struct p *payload = (const struct p *)packet->data.asBytes;
+            uint8_t width = payload->blockwidth ? payload->blockwidth : 16;
+            size_t offset = (size_t)payload->blockno * width;
+            size_t len = (size_t)payload->blockcnt * width;
+            if (offset + len <= sizeof(g_emlmem) && sizeof(*payload) + len <= packet->length) {
+                memcpy(g_emlmem + offset, payload->data, len);
+            }
+            break;
+        }
+        case CMD_HF_MIFARE_EML_MEMGET: {
+            struct p {
+                uint8_t blockno;
+                uint8_t blockcnt;
+            } PACKED;
+            const struct p *payload = (const struct p *)packet->data.asBytes;
+            size_t offset = (size_t)payload->blockno * 16;
+            size_t len = (size_t)payload->blockcnt * 16;
+            if (offset + len > sizeof(g_emlmem) || len > PM3_CMD_DATA_SIZE) {
+                reply_ng(CMD_HF_MIFARE_EML_MEMGET, PM3_EOUTOFBOUND, NULL, 0);
+                break;
+            }
+            reply_ng(CMD_HF_MIFARE_EML_MEMGET, PM3_SUCCESS, g_emlmem + offset, len);
+            break;
+        }
+        case CMD_HF_ISO14443A_SNIFF: {
+            // the trace in BigBuf is what was sniffed. Streamed like SniffIso14443a() does it,
+            // whole records per packet
+            if (packet->length && (packet->data.asBytes[0] & 0x04)) {
+                uint32_t streamed = 0;
+                while (streamed < g_tracelen) {
+                    uint32_t end = streamed;
+                    while (end + TRACELOG_HDR_LEN <= g_tracelen) {
+                        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(g_bigbuf + end);
+                        uint32_t rec_len = TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+                        if (end + rec_len > g_tracelen || end + rec_len - streamed > PM3_CMD_DATA_SIZE) {
+                            break;
+                        }
+                        end += rec_len;
+                    }
+                    if (end == streamed) {
+                        break;
+                    }
+                    reply_ng(CMD_HF_ISO14443A_SNIFF_STREAM, PM3_SUCCESS, g_bigbuf + streamed, end - streamed);
+                    streamed = end;
+                }
+                g_tracelen = 0;
+            }
+            reply_ng(CMD_HF_ISO14443A_SNIFF, PM3_SUCCESS, NULL, 0);
+            break;
+        }
+        default: {
+            // better than a client waiting for its timeout
+            if (g_opts.verbose) {
+                printf("[!] command 0x%04x not emulated\n", packet->cmd);
+            }
+            reply_ng(packet->cmd, PM3_ENOTIMPL, NULL, 0);
+            break;
+        }
+    }
+    g_reply_seq = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// reception, like receive_ng_internal() and the OLD frame fallback in armsrc/cmd.c
+
+static uint8_t g_rx_buf[2 * sizeof(PacketCommandOLD)];
+static size_t g_rx_len = 0;
+
+// splits the received bytes into frames, returns false on garbage
+static bool split_frames(uint64_t now) {
+    while (g_rx_len >= sizeof(PacketCommandNGPreamble)) {
+        const PacketCommandNGPreamble *pre = (const PacketCommandNGPreamble *)g_rx_buf;
+        size_t framelen;
+        if (pre->magic == COMMANDNG_PREAMBLE_MAGIC || pre->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) {
+            size_t prelen = (pre->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) ? sizeof(PacketCommandNGSeqPreamble) : sizeof(PacketCommandNGPreamble);
+            if (pre->length > PM3_CMD_DATA_SIZE) {
+                return false;
+            }
+            framelen = prelen + pre->length + sizeof(PacketCommandNGPostamble);
+        } else {
+            framelen = sizeof(PacketCommandOLD);
+        }
+        if (g_rx_len < framelen) {
+            break;
+        }
+        queue_frame(&g_rxq, now, g_rx_buf, framelen);
+        g_rx_len -= framelen;
+        memmove(g_rx_buf, g_rx_buf + framelen, g_rx_len);
+    }
+    return true;
+}
+
+static bool parse_frame(const frame_t *f, PacketCommandNG *packet) {
+    memset(packet, 0, sizeof(PacketCommandNG));
+    const PacketCommandNGPreamble *pre = (const PacketCommandNGPreamble *)f->data;
+
+    if (pre->magic == COMMANDNG_PREAMBLE_MAGIC || pre->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) {
+        size_t prelen = sizeof(PacketCommandNGPreamble);
+        if (pre->magic == COMMANDNG_SEQ_PREAMBLE_MAGIC) {
+            packet->seq = ((const PacketCommandNGSeqPreamble *)f->data)->seq;
+            prelen = sizeof(PacketCommandNGSeqPreamble);
+        }
+        const uint8_t *rx_data = f->data + prelen;
+        packet->magic = pre->magic;
+        packet->cmd = pre->cmd;
+        packet->ng = pre->ng;
+        packet->length = pre->length;
+        if (packet->ng) {
+            memcpy(packet->data.asBytes, rx_data, packet->length);
+        } else {
+            if (packet->length < sizeof(packet->oldarg)) {
+                return false;
+            }
+            memcpy(packet->oldarg, rx_data, sizeof(packet->oldarg));
+            packet->length -= sizeof(packet->oldarg);
+            memcpy(packet->data.asBytes, rx_data + sizeof(packet->oldarg), packet->length);
+        }
+        return true;
+    }
+
+    const PacketCommandOLD *old = (const PacketCommandOLD *)f->data;
+    packet->cmd = old->cmd;
+    packet->oldarg[0] = old->arg[0];
+    packet->oldarg[1] = old->arg[1];
+    packet->oldarg[2] = old->arg[2];
+    packet->length = PM3_CMD_DATA_SIZE;
+    memcpy(packet->data.asBytes, old->d.asBytes, PM3_CMD_DATA_SIZE);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// session
+
+static void serve(int fd) {
+    g_rx_len = 0;
+    clear_queue(&g_rxq);
+    clear_queue(&g_txq);
+    g_busy_until = 0;
+
+    while (true) {
+        uint64_t now = usclock();
+
+        // commands which made it over the link, one after the other
+        while (g_rxq.head && g_rxq.head->due <= now && g_busy_until <= now) {
+            frame_t *f = pop_frame(&g_rxq);
+            PacketCommandNG packet;
+            bool ok = parse_frame(f, &packet);
+            free(f);
+            if (ok == false) {
+                continue;
+            }
+            uint32_t delay = cmd_delay(packet.cmd);
+            if (g_opts.verbose) {
+                printf("[=] cmd 0x%04x %s len %u seq %u\n", packet.cmd, packet.ng ? "NG " : "MIX", packet.length, packet.seq);
+            }
+            g_busy_until = now + delay;
+            g_reply_time = g_busy_until;
+            handle_packet(&packet);
+        }
+
+        // replies which made it over the link
+        while (g_txq.head && g_txq.head->due <= now) {
+            frame_t *f = pop_frame(&g_txq);
+            size_t sent = 0;
+            while (sent < f->len) {
+                ssize_t res = send(fd, f->data + sent, f->len - sent, MSG_NOSIGNAL);
+                if (res < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (res <= 0) {
+                    free(f);
+                    return;
+                }
+                sent += res;
+            }
+            free(f);
+        }
+
+        // sleep until the next event
+        int timeout = -1;
+        uint64_t next = UINT64_MAX;
+        if (g_rxq.head) {
+            next = g_rxq.head->due > g_busy_until ? g_rxq.head->due : g_busy_until;
+        }
+        if (g_txq.head && g_txq.head->due < next) {
+            next = g_txq.head->due;
+        }
+        if (next != UINT64_MAX) {
+            now = usclock();
+            timeout = (next > now) ? (int)((next - now + 999) / 1000) : 0;
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int res = poll(&pfd, 1, timeout);
+        if (res < 0 && errno != EINTR) {
+            return;
+        }
+        if (res > 0) {
+            ssize_t n = recv(fd, g_rx_buf + g_rx_len, sizeof(g_rx_buf) - g_rx_len, 0);
+            if (n <= 0) {
+                return;
+            }
+            g_rx_len += n;
+            if (split_frames(usclock()) == false) {
+                fprintf(stderr, "[!] invalid frame, closing connection\n");
+                return;
+            }
+        }
+    }
+}
+
+static int open_listener(const char *portname) {
+    if (strncmp(portname, "tcp:", 4) == 0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(strtoul(portname + 4, NULL, 10));
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (strncmp(portname, "socket:", 7) == 0) {
+        // abstract namespace, see uart_posix.c
+        const char *name = portname + 7;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_LOCAL;
+        if (strlen(name) == 0 || strlen(name) + 1 >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        strcpy(addr.sun_path + 1, name);
+        socklen_t len = 1 + strlen(name) + offsetof(struct sockaddr_un, sun_path);
+        int fd = socket(PF_LOCAL, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (bind(fd, (struct sockaddr *)&addr, len) < 0 || listen(fd, 1) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// preloading
+
+static bool load_binary(const char *filename, uint8_t *dest, size_t maxlen, size_t *len) {
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "[!] failed to open %s\n", filename);
+        return false;
+    }
+    *len = fread(dest, 1, maxlen, f);
+    fclose(f);
+    return true;
+}
+
+// .pm3 sample files hold one signed sample per line, the device keeps them unsigned
+static bool load_samples(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        fprintf(stderr, "[!] failed to open %s\n", filename);
+        return false;
+    }
+    size_t n = 0;
+    int val;
+    while (n < sizeof(g_bigbuf) && fscanf(f, "%d", &val) == 1) {
+        g_bigbuf[n++] = (uint8_t)(val + 128);
+    }
+    fclose(f);
+    printf("[=] loaded %zu samples from %s\n", n, filename);
+    return true;
+}
+
+static bool add_delay(const char *arg) {
+    unsigned int cmd, us;
+    if (g_opts.num_delays >= VPM3_MAX_DELAYS || sscanf(arg, "%x:%u", &cmd, &us) != 2 || cmd > 0xFFFF) {
+        return false;
+    }
+    g_opts.delays[g_opts.num_delays].cmd = cmd;
+    g_opts.delays[g_opts.num_delays].us = us;
+    g_opts.num_delays++;
+    return true;
+}
+
+static int usage(const char *prog) {
+    printf("Usage: %s [options] <tcp:<port> | socket:<name>>\n", prog);
+    printf("\n");
+    printf("  Virtual Proxmark3, connect the client with tcp:localhost:<port> or socket:<name>\n");
+    printf("\n");
+    printf("  -l <ms>         one way link latency, default 0\n");
+    printf("  -b <bytes/s>    link bandwidth in both directions, default 0 (unlimited, USB)\n");
+    printf("                  a limited link is announced as FPC UART at 10x the bandwidth in baud\n");
+    printf("  -d <cmd>:<us>   processing time of command <cmd> (hex), can be repeated\n");
+    printf("  -t <file>       load a trace into BigBuf, e.g. traces/hf_14a_mfu.trace\n");
+    printf("  -s <file>       load samples into BigBuf, e.g. traces/lf_ATA5577_em410x.pm3\n");
+    printf("  -e <file>       load a binary dump into the emulator memory\n");
+    printf("  -1              exit after the first session\n");
+    printf("  -v              print every command\n");
+    printf("\n");
+    printf("  Example: %s -l 2 -b 115200 -t traces/hf_14a_mfu.trace socket:vpm3\n", prog);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+
+    const char *tracefile = NULL;
+    const char *samplefile = NULL;
+    const char *emlfile = NULL;
+    bool one_session = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:b:d:t:s:e:1vh")) != -1) {
+        switch (opt) {
+            case 'l':
+                g_opts.latency_us = strtoul(optarg, NULL, 0) * 1000;
+                break;
+            case 'b':
+                g_opts.bandwidth = strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                if (add_delay(optarg) == false) {
+                    fprintf(stderr, "[!] invalid command delay %s, expected <cmd>:<us>\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                tracefile = optarg;
+                break;
+            case 's':
+                samplefile = optarg;
+                break;
+            case 'e':
+                emlfile = optarg;
+                break;
+            case '1':
+                one_session = true;
+                break;
+            case 'v':
+                g_opts.verbose = true;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) {
+        return usage(argv[0]);
+    }
+
+    // trace and samples share BigBuf, like on the device
+    if (tracefile && samplefile) {
+        fprintf(stderr, "[!] use either a trace or samples\n");
+        return 1;
+    }
+    if (tracefile) {
+        size_t len;
+        if (load_binary(tracefile, g_bigbuf, sizeof(g_bigbuf), &len) == false) {
+            return 1;
+        }
+        g_tracelen = len;
+        printf("[=] loaded %u bytes of trace from %s\n", g_tracelen, tracefile);
+    }
+    if (samplefile && load_samples(samplefile) == false) {
+        return 1;
+    }
+    if (emlfile) {
+        size_t len;
+        if (load_binary(emlfile, g_emlmem, sizeof(g_emlmem), &len) == false) {
+            return 1;
+        }
+        printf("[=] loaded %zu bytes of emulator memory from %s\n", len, emlfile);
+    }
+
+    int lfd = open_listener(argv[optind]);
+    if (lfd < 0) {
+        fprintf(stderr, "[!] failed to listen on %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    printf("[=] listening on %s, latency %u ms, bandwidth %u bytes/s\n", argv[optind], g_opts.latency_us / 1000, g_opts.bandwidth);
+    fflush(stdout);
+
+    do {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (g_opts.verbose) {
+            printf("[=] client connected\n");
+        }
+        serve(fd);
+        close(fd);
+        if (g_opts.verbose) {
+            printf("[=] client disconnected\n");
+        }
+        fflush(stdout);
+    } while (one_session == false);
+
+    close(lfd);
+    return 0;
+}